@@ -0,0 +1,57 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/function.hpp>
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// When a server stops taking on work. A limit of zero means no limit.
+///
+/// The server is overloaded while its io_service is lagging by more than
+/// the maximum lag, measured by how late a timer firing every check
+/// interval is run, or while the application's overload signal, such as a
+/// check of a TaskPool's queue, returns true. Connections over the limit,
+/// or made while overloaded, are accepted and closed at once, or are left
+/// waiting in the listen backlog if the server pauses accepting instead.
+/// Messages over the limit, or received while overloaded, are not passed
+/// to the event handler; they fail with ErrorCode::MessagePortServerBusy,
+/// which the handler's MessageError() sees and may answer.
+///
+struct AdmissionPolicy
+{
+  enum ConnectionAction
+  {
+    RejectConnections,
+    PauseAccepting
+  };
+
+  typedef boost::function<bool ()> OverloadSignal;
+
+  AdmissionPolicy(
+      unsigned int maxConnections = 0,
+      unsigned int maxPendingMessages = 0,
+      ConnectionAction connectionAction = RejectConnections) :
+    maxConnections(maxConnections),
+    maxPendingMessages(maxPendingMessages),
+    connectionAction(connectionAction),
+    maxLagMilliseconds(0),
+    checkIntervalMilliseconds(100)
+  {
+  }
+
+  unsigned int        maxConnections;
+  unsigned int        maxPendingMessages;
+  ConnectionAction    connectionAction;
+  unsigned int        maxLagMilliseconds;
+  unsigned int        checkIntervalMilliseconds;
+  OverloadSignal      isOverloaded;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,79 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+struct BroadcastFailure
+{
+  BroadcastFailure(MessagePortId id, AsioExpress::Error error) :
+    id(id),
+    error(error)
+  {
+  }
+
+  MessagePortId         id;
+  AsioExpress::Error    error;
+};
+
+///
+/// Reports how a broadcast went for each port it was sent to. A port that
+/// did not finish in time is listed with a MessagePortBroadcastTimeout
+/// error.
+///
+class BroadcastResult
+{
+public:
+  typedef std::vector<BroadcastFailure> FailureList;
+
+  BroadcastResult() :
+    m_recipientCount(0)
+  {
+  }
+
+  /// The number of ports the message was sent to one at a time.
+  std::size_t GetRecipientCount() const
+  {
+    return m_recipientCount;
+  }
+
+  FailureList const & GetFailures() const
+  {
+    return m_failures;
+  }
+
+  bool IsComplete() const
+  {
+    return m_failures.empty();
+  }
+
+  void SetRecipientCount(std::size_t count)
+  {
+    m_recipientCount = count;
+  }
+
+  void AddFailure(MessagePortId id, AsioExpress::Error error)
+  {
+    m_failures.push_back(BroadcastFailure(id, error));
+  }
+
+private:
+  std::size_t   m_recipientCount;
+  FailureList   m_failures;
+};
+
+typedef boost::shared_ptr<BroadcastResult> BroadcastResultPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -35,6 +35,16 @@ public:
   virtual AsioExpress::Error MessageError(
       AsioExpress::MessagePort::ClientMessage message, 
       AsioExpress::Error error) = 0;
+
+  ///
+  /// Called when a client with a reconnect policy is about to wait the
+  /// given time before trying to connect again.
+  ///
+  virtual void ClientReconnecting(
+      AsioExpress::MessagePort::ClientConnection,
+      unsigned int)
+  {
+  }
 };
 
 typedef boost::shared_ptr<ClientEventHandler> ClientEventHandlerPointer;
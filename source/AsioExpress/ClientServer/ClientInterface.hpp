@@ -11,6 +11,7 @@
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 #include "AsioExpress/ClientServer/MessagePortId.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -47,6 +48,13 @@ public:
   ///
   virtual std::string GetAddress() const = 0;
 
+  ///
+  /// Gets the traffic of the client's connection, or of all of them added
+  /// together for a client with several. Returns false if the client is
+  /// not connected.
+  ///
+  virtual bool GetStatistics(PortStatistics & statistics) const = 0;
+
   virtual ~ClientInterface() {}
 };
 
@@ -0,0 +1,33 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Follows the set of connected message ports. Listeners are called while
+/// the server's port table is locked, so they must be quick and must not
+/// call back into the server.
+///
+class ConnectionListener
+{
+public:
+  virtual ~ConnectionListener() {}
+
+  virtual void Connected(MessagePortId id) = 0;
+
+  virtual void Disconnected(MessagePortId id) = 0;
+};
+
+typedef boost::shared_ptr<ConnectionListener> ConnectionListenerPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,66 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/ConsistentHashStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+ConsistentHashStrategy::ConsistentHashStrategy(unsigned pointsPerPort) :
+  m_pointsPerPort(pointsPerPort)
+{
+  CHECK(pointsPerPort > 0);
+}
+
+void ConsistentHashStrategy::Add(MessagePortId id)
+{
+  // A point that collides with another port's stays with the first owner.
+  for (unsigned point = 0; point < m_pointsPerPort; ++point)
+    m_ring.insert(Ring::value_type(Hash(id, point), id));
+}
+
+void ConsistentHashStrategy::Remove(MessagePortId id)
+{
+  for (unsigned point = 0; point < m_pointsPerPort; ++point)
+  {
+    Ring::iterator owner = m_ring.find(Hash(id, point));
+    if (owner != m_ring.end() && owner->second == id)
+      m_ring.erase(owner);
+  }
+}
+
+MessagePortId ConsistentHashStrategy::Select(std::string const & key)
+{
+  if (m_ring.empty())
+    return InvalidMessagePortId;
+
+  Ring::const_iterator owner = m_ring.lower_bound(Hash(key.data(), key.size()));
+  if (owner == m_ring.end())
+    owner = m_ring.begin();
+
+  return owner->second;
+}
+
+boost::uint32_t ConsistentHashStrategy::Hash(void const * data, std::size_t size)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+boost::uint32_t ConsistentHashStrategy::Hash(MessagePortId id, unsigned point)
+{
+  boost::uint32_t const bytes[2] = 
+  {
+    static_cast<boost::uint32_t>(id), 
+    static_cast<boost::uint32_t>(point)
+  };
+  return Hash(bytes, sizeof(bytes));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
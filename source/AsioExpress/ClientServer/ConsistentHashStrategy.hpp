@@ -0,0 +1,46 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <map>
+
+#include <boost/cstdint.hpp>
+
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Sends all the messages with the same key to the same port. Each port
+/// owns points spread around a hash ring and a key goes to the owner of
+/// the next point, so a port connecting or disconnecting only moves the
+/// keys next to its own points.
+///
+class ConsistentHashStrategy : public DispatchStrategy
+{
+public:
+  explicit ConsistentHashStrategy(unsigned pointsPerPort = 100);
+
+  virtual void Add(MessagePortId id);
+
+  virtual void Remove(MessagePortId id);
+
+  virtual MessagePortId Select(std::string const & key);
+
+private:
+  typedef std::map<boost::uint32_t, MessagePortId> Ring;
+
+  static boost::uint32_t Hash(void const * data, std::size_t size);
+
+  static boost::uint32_t Hash(MessagePortId id, unsigned point);
+
+  unsigned  m_pointsPerPort;
+  Ring      m_ring;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,53 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Chooses which connected port gets the next message. The ports are added
+/// and removed as they connect and disconnect, so choosing does not depend
+/// on listing them. Strategies are not thread safe; RoundRobinServer calls
+/// them with its lock held.
+///
+class DispatchStrategy
+{
+public:
+  virtual ~DispatchStrategy() {}
+
+  virtual void Add(MessagePortId id) = 0;
+
+  virtual void Remove(MessagePortId id) = 0;
+
+  ///
+  /// Chooses the port for the next message, or returns
+  /// InvalidMessagePortId if there are none. The key is only used by
+  /// strategies that route by key.
+  ///
+  virtual MessagePortId Select(std::string const & key) = 0;
+
+  /// Reports that a message dispatched to the port has been dealt with.
+  virtual void Completed(MessagePortId)
+  {
+  }
+
+  /// Sets the port's share of the messages, for strategies with weights.
+  virtual void SetWeight(MessagePortId, unsigned)
+  {
+  }
+};
+
+typedef boost::shared_ptr<DispatchStrategy> DispatchStrategyPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,39 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Reports how a server's graceful stop went. Flushed messages are those
+/// the server sent while draining. Dropped messages are those received
+/// while draining, those still in the event handler at the deadline and
+/// those still waiting to be sent when the connections were closed.
+///
+struct DrainResult
+{
+  DrainResult() :
+    messagesFlushed(0),
+    messagesDropped(0),
+    connectionsClosed(0),
+    connectionsForced(0)
+  {
+  }
+
+  boost::uint64_t   messagesFlushed;
+  boost::uint64_t   messagesDropped;
+  unsigned int      connectionsClosed;
+  unsigned int      connectionsForced;
+};
+
+typedef boost::shared_ptr<DrainResult> DrainResultPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,222 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/private/FailoverClient.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A client for several equivalent end points. Each message goes to the
+/// connected end point with the lowest latency, measured from connecting
+/// and from the replies to requests. When a connection dies its messages
+/// are sent again to the next best end point, and the end points that are
+/// down are tried again at every health check.
+///
+/// The end points report to the one event handler. The disconnects of
+/// health checks that could not connect are not reported, and neither are
+/// the replies to AsyncRequest().
+///
+template<typename MessagePort>
+class FailoverMessagePortClient : public ClientInterface
+{
+public:
+  typedef typename MessagePort::EndPointType EndPointType;
+  typedef std::vector<EndPointType> EndPointList;
+  typedef FailoverClient::ReplyKeyFunction ReplyKeyFunction;
+
+  FailoverMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointList const & endPoints,
+    ClientEventHandler * eventHandler);
+
+  ~FailoverMessagePortClient();
+
+  virtual void Connect();
+
+  virtual void ShutDown();
+
+  virtual void Disconnect();
+
+  virtual void AsyncSend(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends a request and completes once its reply has been copied into the
+  /// reply buffer. A reply is the message whose reply key, as returned by
+  /// the function given to SetReplyKey(), is the request's key. The key
+  /// must not be in use by another request.
+  ///
+  void AsyncRequest(
+      std::string const & key,
+      DataBufferPointer request,
+      DataBufferPointer reply,
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Gets the address of the end point messages are being sent to.
+  virtual std::string GetAddress() const;
+
+  virtual bool GetStatistics(PortStatistics & statistics) const;
+
+  /// Sets how the reply key is taken from a message.
+  void SetReplyKey(ReplyKeyFunction replyKey);
+
+  ///
+  /// Sends a request that has had no reply within the 95th percentile of
+  /// the reply times seen so far to a second end point as well, and takes
+  /// whichever reply arrives first.
+  ///
+  void SetHedging(bool isHedging);
+
+  /// Sets how often the end points that are down are tried again.
+  void SetHealthCheckInterval(unsigned int milliseconds);
+
+  /// Sets the message window of each end point. Call this before Connect().
+  void SetMessageWindow(unsigned int size, bool isOrdered = false);
+
+private:
+  typedef MessagePortClient<MessagePort> ClientType;
+  typedef boost::shared_ptr<ClientType> ClientPointer;
+  typedef std::vector<ClientPointer> ClientList;
+
+  ClientEventHandlerPointer   m_eventHandler;
+  FailoverClientPointer       m_failoverClient;
+  ClientList                  m_clients;
+  unsigned int                m_healthCheckMilliseconds;
+};
+
+template<typename MessagePort>
+FailoverMessagePortClient<MessagePort>::FailoverMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointList const & endPoints,
+    ClientEventHandler * eventHandler) :
+  m_eventHandler(eventHandler),
+  m_failoverClient(new FailoverClient(ioService)),
+  m_healthCheckMilliseconds(1000)
+{
+  for (unsigned int index = 0; index < endPoints.size(); ++index)
+  {
+    ClientPointer client(new ClientType(
+      ioService,
+      endPoints[index],
+      new FailoverEventHandler(m_eventHandler, m_failoverClient, index)));
+
+    m_clients.push_back(client);
+    m_failoverClient->AddEndPoint(client);
+  }
+}
+
+template<typename MessagePort>
+FailoverMessagePortClient<MessagePort>::~FailoverMessagePortClient()
+{
+  m_failoverClient->Stop();
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::Connect()
+{
+  m_failoverClient->Start(m_healthCheckMilliseconds);
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::Disconnect()
+{
+  m_failoverClient->Stop();
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->Disconnect();
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::ShutDown()
+{
+  m_failoverClient->Stop();
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->ShutDown();
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::AsyncSend(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_failoverClient->AsyncSend(buffer, completionHandler);
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::AsyncRequest(
+    std::string const & key,
+    DataBufferPointer request,
+    DataBufferPointer reply,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_failoverClient->AsyncRequest(key, request, reply, completionHandler);
+}
+
+template<typename MessagePort>
+bool FailoverMessagePortClient<MessagePort>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  statistics = PortStatistics();
+
+  bool isConnected = false;
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+  {
+    PortStatistics connection;
+    if (m_clients[index]->GetStatistics(connection))
+    {
+      statistics.Add(connection);
+      isConnected = true;
+    }
+  }
+
+  return isConnected;
+}
+
+template<typename MessagePort>
+std::string FailoverMessagePortClient<MessagePort>::GetAddress() const
+{
+  return m_failoverClient->GetAddress();
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::SetReplyKey(
+    ReplyKeyFunction replyKey)
+{
+  m_failoverClient->SetReplyKey(replyKey);
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::SetHedging(
+    bool isHedging)
+{
+  m_failoverClient->SetHedging(isHedging);
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::SetHealthCheckInterval(
+    unsigned int milliseconds)
+{
+  CHECK(milliseconds > 0);
+  m_healthCheckMilliseconds = milliseconds;
+}
+
+template<typename MessagePort>
+void FailoverMessagePortClient<MessagePort>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->SetMessageWindow(size, isOrdered);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,84 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/LeastOutstandingStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+LeastOutstandingStrategy::LeastOutstandingStrategy() :
+  m_order(0)
+{
+}
+
+void LeastOutstandingStrategy::Add(MessagePortId id)
+{
+  if (m_loadMap.find(id) != m_loadMap.end())
+    return;
+
+  Load load;
+  load.outstanding = 0;
+  load.order = ++m_order;
+  load.id = id;
+  m_loadMap[id] = m_loads.insert(load).first;
+}
+
+void LeastOutstandingStrategy::Remove(MessagePortId id)
+{
+  LoadMap::iterator load = m_loadMap.find(id);
+  if (load == m_loadMap.end())
+    return;
+
+  m_loads.erase(load->second);
+  m_loadMap.erase(load);
+}
+
+MessagePortId LeastOutstandingStrategy::Select(std::string const &)
+{
+  if (m_loads.empty())
+    return InvalidMessagePortId;
+
+  MessagePortId id = m_loads.begin()->id;
+  LoadMap::iterator load = m_loadMap.find(id);
+  Update(load, load->second->outstanding + 1, true);
+  return id;
+}
+
+void LeastOutstandingStrategy::Completed(MessagePortId id)
+{
+  LoadMap::iterator load = m_loadMap.find(id);
+  if (load == m_loadMap.end() || load->second->outstanding == 0)
+    return;
+
+  Update(load, load->second->outstanding - 1, false);
+}
+
+unsigned LeastOutstandingStrategy::GetOutstanding(MessagePortId id) const
+{
+  LoadMap::const_iterator load = m_loadMap.find(id);
+  if (load == m_loadMap.end())
+    return 0;
+
+  return load->second->outstanding;
+}
+
+void LeastOutstandingStrategy::Update(
+    LoadMap::iterator load,
+    unsigned outstanding,
+    bool isChosen)
+{
+  Load updated = *load->second;
+  updated.outstanding = outstanding;
+  if (isChosen)
+    updated.order = ++m_order;
+
+  m_loads.erase(load->second);
+  load->second = m_loads.insert(updated).first;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,65 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <set>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Hands each message to the port with the fewest messages outstanding. A
+/// message is outstanding from the time it is dispatched until Completed()
+/// is called for its port. Ties go to the port that has waited longest.
+///
+class LeastOutstandingStrategy : public DispatchStrategy
+{
+public:
+  LeastOutstandingStrategy();
+
+  virtual void Add(MessagePortId id);
+
+  virtual void Remove(MessagePortId id);
+
+  virtual MessagePortId Select(std::string const & key);
+
+  virtual void Completed(MessagePortId id);
+
+  /// Gets the number of messages outstanding on the port.
+  unsigned GetOutstanding(MessagePortId id) const;
+
+private:
+  struct Load
+  {
+    bool operator<(Load const & that) const
+    {
+      if (outstanding != that.outstanding)
+        return outstanding < that.outstanding;
+      return order < that.order;
+    }
+
+    unsigned          outstanding;
+    boost::uint64_t   order;
+    MessagePortId     id;
+  };
+
+  typedef std::set<Load> LoadSet;
+  typedef boost::unordered_map<MessagePortId, LoadSet::iterator> LoadMap;
+
+  void Update(LoadMap::iterator load, unsigned outstanding, bool isChosen);
+
+  LoadSet           m_loads;
+  LoadMap           m_loadMap;
+  boost::uint64_t   m_order;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -6,11 +6,19 @@
 #pragma once
 
 #include "AsioExpress/ClientServer/private/InternalMessagePortClient.hpp"
+#include "AsioExpress/ClientServer/private/StaticClientEvents.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
-template<typename MessagePort>
+///
+/// Connects to a server and passes its events and messages to the event
+/// handler. By default the handler is called through the
+/// ClientEventHandler interface. Giving its type as the Handler parameter
+/// calls it directly instead; it then needs ClientEventHandler's member
+/// functions but not its base class.
+///
+template<typename MessagePort, typename Handler = ClientEventHandler>
 class MessagePortClient : public ClientInterface
 {
 public:
@@ -19,7 +27,7 @@ public:
   MessagePortClient(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ClientEventHandler * eventHandler);
+    Handler * eventHandler);
 
   ~MessagePortClient();
 
@@ -35,6 +43,24 @@ public:
   
   virtual std::string GetAddress() const;
 
+  virtual bool GetStatistics(PortStatistics & statistics) const;
+
+  ///
+  /// Lets up to the given number of messages be in the event handler at
+  /// once, instead of one. With an ordered window a message's completion is
+  /// only acted on after the completions of the messages received before
+  /// it. Call this before Connect().
+  ///
+  void SetMessageWindow(unsigned int size, bool isOrdered = false);
+
+  ///
+  /// Reconnects the client whenever it loses its connection, until
+  /// Disconnect() or ShutDown() is called. Messages sent while it is
+  /// disconnected are held and sent once it is connected again. Call this
+  /// before Connect().
+  ///
+  void SetReconnectPolicy(ReconnectPolicy const & policy);
+
 private:
   typedef InternalMessagePortClient<MessagePort> ImplementationType;
   typedef boost::shared_ptr<ImplementationType> ImplementationPointer;
@@ -42,55 +68,77 @@ private:
   ImplementationPointer  m_implementation;
 };
 
-template<typename MessagePort>
-MessagePortClient<MessagePort>::MessagePortClient(
+template<typename MessagePort, typename Handler>
+MessagePortClient<MessagePort, Handler>::MessagePortClient(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ClientEventHandler * eventHandler) :
+    Handler * eventHandler) :
   m_implementation(new InternalMessagePortClient<MessagePort>(
     ioService, 
     endPoint, 
-    eventHandler))
+    MakeClientEvents(eventHandler)))
 {
 }
 
-template<typename MessagePort>
-MessagePortClient<MessagePort>::~MessagePortClient()
+template<typename MessagePort, typename Handler>
+MessagePortClient<MessagePort, Handler>::~MessagePortClient()
 {
   m_implementation->Disconnect();
 }
 
-template<typename MessagePort>
-void MessagePortClient<MessagePort>::Connect()
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::Connect()
 {
   m_implementation->Connect();
 }
 
-template<typename MessagePort>
-void MessagePortClient<MessagePort>::Disconnect()
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::Disconnect()
 {
   m_implementation->Disconnect();
 }
 
-template<typename MessagePort>
-void MessagePortClient<MessagePort>::ShutDown()
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::ShutDown()
 {
   m_implementation->ShutDown();
 }
 
-template<typename MessagePort>
-void MessagePortClient<MessagePort>::AsyncSend(
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::AsyncSend(
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
 {
     m_implementation->AsyncSend(buffer, completionHandler);
 }
 
-template<typename MessagePort>
-std::string MessagePortClient<MessagePort>::GetAddress() const
+template<typename MessagePort, typename Handler>
+std::string MessagePortClient<MessagePort, Handler>::GetAddress() const
 {
     return m_implementation->GetAddress();
 }
 
+template<typename MessagePort, typename Handler>
+bool MessagePortClient<MessagePort, Handler>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  return m_implementation->GetStatistics(statistics);
+}
+
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  m_implementation->SetMessageWindow(size, isOrdered);
+}
+
+template<typename MessagePort, typename Handler>
+void MessagePortClient<MessagePort, Handler>::SetReconnectPolicy(
+    ReconnectPolicy const & policy)
+{
+  m_implementation->SetReconnectPolicy(policy);
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
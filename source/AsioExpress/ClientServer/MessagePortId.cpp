@@ -5,6 +5,8 @@
 
 #include "AsioExpress/pch.hpp"
 
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
 namespace AsioExpress {
 namespace MessagePort {
 
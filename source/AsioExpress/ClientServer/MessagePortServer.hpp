@@ -6,11 +6,28 @@
 #pragma once
 
 #include "AsioExpress/ClientServer/private/InternalMessagePortServer.hpp"
+#include "AsioExpress/ClientServer/private/StaticServerEvents.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
-template<typename MessagePortAcceptor>
+///
+/// Accepts connections and passes their events and messages to the event
+/// handler. The io_service may be run from several threads: each
+/// connection's events are called on its own strand, one at a time, while
+/// different connections are handled in parallel. Sends and broadcasts may
+/// be started from any thread.
+///
+/// AsyncPublish() sends a message to a topic's subscribers only. Once
+/// EnableTopics() is called, clients subscribe themselves by sending the
+/// messages made by TopicControl, which then do not reach the event handler.
+///
+/// By default the event handler is called through the ServerEventHandler
+/// interface. Giving its type as the Handler parameter calls it directly
+/// instead; it then needs ServerEventHandler's member functions but not
+/// its base class.
+///
+template<typename MessagePortAcceptor, typename Handler = ServerEventHandler>
 class MessagePortServer : public ServerInterface
 {
 public:
@@ -19,7 +36,7 @@ public:
   MessagePortServer(
     boost::asio::io_service& ioService,
     EndPointType endPoint,
-    ServerEventHandler * eventHandler);
+    Handler * eventHandler);
 
   ~MessagePortServer();
 
@@ -27,6 +44,20 @@ public:
 
   virtual void Stop();
 
+  ///
+  /// Stops the server gracefully. It stops accepting connections and drops
+  /// the messages received from now on, while the event handler finishes
+  /// the messages it has and the queued sends are flushed. Then the
+  /// connections are half closed so the clients hang up. Connections still
+  /// open at the deadline are closed by force. The result, if given,
+  /// reports the messages flushed and dropped. The completion handler is
+  /// called once every connection is closed.
+  ///
+  void AsyncStop(
+      unsigned int deadlineMilliseconds,
+      DrainResultPointer result,
+      AsioExpress::CompletionHandler completionHandler);
+
   virtual void GetIds(MessagePortIdList & list) const;
 
   virtual void AsyncSend(
@@ -38,8 +69,119 @@ public:
       DataBufferPointer buffer, 
       AsioExpress::CompletionHandler completionHandler);
 
+  virtual void AsyncBroadcast(
+      DataBufferPointer buffer, 
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      SendManyResultPointer result,
+      AsioExpress::CompletionHandler completionHandler);
+
   virtual std::string GetAddress(MessagePortId id) const;
 
+  virtual bool GetStatistics(
+      MessagePortId id, 
+      PortStatistics & statistics) const;
+
+  virtual void AddListener(ConnectionListenerPointer listener);
+
+  ///
+  /// Subscribes the port to the topic, as its client's control message
+  /// would. Returns false if it was already subscribed or is not connected.
+  ///
+  bool Subscribe(MessagePortId id, std::string const & topic);
+
+  /// Returns false if the port was not subscribed to the topic.
+  bool Unsubscribe(MessagePortId id, std::string const & topic);
+
+  ///
+  /// Sends the message to the topic's subscribers, all at once and sharing
+  /// the one buffer. The completion handler is called when every send has
+  /// completed; a topic without subscribers completes at once.
+  ///
+  void AsyncPublish(
+      std::string const & topic,
+      DataBufferPointer buffer, 
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Publishes as AsyncBroadcast() does with a result and timeout.
+  void AsyncPublish(
+      std::string const & topic,
+      DataBufferPointer buffer, 
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Gets the number of topics with subscribers.
+  std::size_t GetTopicCount() const;
+
+  ///
+  /// Acts on the clients' TopicControl messages. Until then they are passed
+  /// to the event handler like any other message, so protocols whose
+  /// messages may start with a zero byte are left alone. Subscribe() and
+  /// AsyncPublish() work either way. Call this before Start().
+  ///
+  void EnableTopics();
+
+  ///
+  /// Lets each connection have up to the given number of messages in the
+  /// event handler at once, instead of one. With an ordered window a
+  /// message's completion is only acted on after the completions of the
+  /// messages received before it. Call this before Start().
+  ///
+  void SetMessageWindow(unsigned int size, bool isOrdered = false);
+
+  ///
+  /// Limits the connections and the messages in the event handler, and
+  /// sheds load while the server is overloaded. Call this before Start().
+  ///
+  void SetAdmissionPolicy(AdmissionPolicy const & policy);
+
+  ///
+  /// Shares the event handler fairly among the connections. At most the
+  /// given number of messages, over all connections, are in the event
+  /// handler at once; the others wait while the connections take turns by
+  /// deficit round robin. Each turn lets a connection pass on messages of
+  /// up to its weight times the quantum bytes, so a connection flooding the
+  /// server cannot hold up one that sends little. Call this before Start().
+  ///
+  void SetFairScheduling(unsigned int concurrency, unsigned int quantumBytes = 4096);
+
+  ///
+  /// Gives a connection a larger share of the event handler under fair
+  /// scheduling. The default weight is one.
+  ///
+  void SetConnectionWeight(MessagePortId id, unsigned int weight);
+
+  ///
+  /// Stops reading the connections while the backpressure is paused, so
+  /// TCP flow control pushes back on the clients, and reads them again once
+  /// it is resumed. Give the backpressure to the queues the event handler
+  /// passes messages on to, such as a TaskPool. Stop() and AsyncStop() abort
+  /// the waits of the backpressure. Call this before Start().
+  ///
+  void SetBackpressure(BackpressurePointer backpressure);
+
+  /// Returns true while an overload signal of the admission policy is on.
+  bool IsOverloaded() const;
+
+  unsigned int GetConnectionCount() const;
+
+  unsigned int GetPendingMessages() const;
+
+  /// Gets the number of connections closed as soon as they were accepted.
+  unsigned int GetRejectedConnections() const;
+
+  /// Gets the number of messages failed as busy.
+  unsigned int GetShedMessages() const;
+
 private:
   typedef InternalMessagePortServer<MessagePortAcceptor> ImplementationType;
   typedef boost::shared_ptr<ImplementationType> ImplementationPointer;
@@ -47,45 +189,54 @@ private:
   ImplementationPointer  m_implementation;
 };
 
-template<typename MessagePortAcceptor>
-MessagePortServer<MessagePortAcceptor>::MessagePortServer(
+template<typename MessagePortAcceptor, typename Handler>
+MessagePortServer<MessagePortAcceptor, Handler>::MessagePortServer(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ServerEventHandler * eventHandler) :
+    Handler * eventHandler) :
   m_implementation(new InternalMessagePortServer<MessagePortAcceptor>(
     ioService, 
     endPoint, 
-    eventHandler))
+    MakeServerEvents(eventHandler)))
 {
 }
 
-template<typename MessagePortAcceptor>
-MessagePortServer<MessagePortAcceptor>::~MessagePortServer()
+template<typename MessagePortAcceptor, typename Handler>
+MessagePortServer<MessagePortAcceptor, Handler>::~MessagePortServer()
 {
   m_implementation->Stop();
 }
 
-template<typename MessagePortAcceptor>
-void MessagePortServer<MessagePortAcceptor>::Start()
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::Start()
 {
   m_implementation->Start();
 }
 
-template<typename MessagePortAcceptor>
-void MessagePortServer<MessagePortAcceptor>::Stop()
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::Stop()
 {
   m_implementation->Stop();
 }
 
-template<typename MessagePortAcceptor>
-void MessagePortServer<MessagePortAcceptor>::GetIds(
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncStop(
+    unsigned int deadlineMilliseconds,
+    DrainResultPointer result,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncStop(deadlineMilliseconds, result, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::GetIds(
     MessagePortIdList & list) const
 {
   m_implementation->GetIds(list);
 }
 
-template<typename MessagePortAcceptor>
-void MessagePortServer<MessagePortAcceptor>::AsyncSend(
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncSend(
     MessagePortId id, 
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
@@ -93,20 +244,178 @@ void MessagePortServer<MessagePortAcceptor>::AsyncSend(
   m_implementation->AsyncSend(id, buffer, completionHandler);
 }
 
-template<typename MessagePortAcceptor>
-void MessagePortServer<MessagePortAcceptor>::AsyncBroadcast(
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncBroadcast(
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
 {
   m_implementation->AsyncBroadcast(buffer, completionHandler);
 }
 
-template<typename MessagePortAcceptor>
-std::string MessagePortServer<MessagePortAcceptor>::GetAddress(
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncBroadcast(
+    DataBufferPointer buffer, 
+    BroadcastResultPointer result,
+    unsigned int timeoutMilliseconds,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncBroadcast(buffer, result, timeoutMilliseconds, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncSendMany(
+    SendList const & list, 
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncSendMany(list, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncSendMany(
+    SendList const & list, 
+    SendManyResultPointer result,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncSendMany(list, result, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+std::string MessagePortServer<MessagePortAcceptor, Handler>::GetAddress(
     MessagePortId id) const
 {
     return m_implementation->GetAddress(id);
 }
 
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  m_implementation->SetMessageWindow(size, isOrdered);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+bool MessagePortServer<MessagePortAcceptor, Handler>::Subscribe(
+    MessagePortId id,
+    std::string const & topic)
+{
+  return m_implementation->Subscribe(id, topic);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+bool MessagePortServer<MessagePortAcceptor, Handler>::Unsubscribe(
+    MessagePortId id,
+    std::string const & topic)
+{
+  return m_implementation->Unsubscribe(id, topic);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncPublish(
+    std::string const & topic,
+    DataBufferPointer buffer, 
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncPublish(topic, buffer, BroadcastResultPointer(), 0, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AsyncPublish(
+    std::string const & topic,
+    DataBufferPointer buffer, 
+    BroadcastResultPointer result,
+    unsigned int timeoutMilliseconds,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_implementation->AsyncPublish(topic, buffer, result, timeoutMilliseconds, completionHandler);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+std::size_t MessagePortServer<MessagePortAcceptor, Handler>::GetTopicCount() const
+{
+  return m_implementation->GetTopicCount();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::EnableTopics()
+{
+  m_implementation->EnableTopics();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::SetAdmissionPolicy(
+    AdmissionPolicy const & policy)
+{
+  m_implementation->SetAdmissionPolicy(policy);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::SetFairScheduling(
+    unsigned int concurrency,
+    unsigned int quantumBytes)
+{
+  m_implementation->SetFairScheduling(concurrency, quantumBytes);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::SetConnectionWeight(
+    MessagePortId id,
+    unsigned int weight)
+{
+  m_implementation->SetConnectionWeight(id, weight);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::SetBackpressure(
+    BackpressurePointer backpressure)
+{
+  m_implementation->SetBackpressure(backpressure);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+bool MessagePortServer<MessagePortAcceptor, Handler>::IsOverloaded() const
+{
+  return m_implementation->GetAdmissionControl()->IsOverloaded();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+unsigned int MessagePortServer<MessagePortAcceptor, Handler>::GetConnectionCount() const
+{
+  return m_implementation->GetAdmissionControl()->GetConnections();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+unsigned int MessagePortServer<MessagePortAcceptor, Handler>::GetPendingMessages() const
+{
+  return m_implementation->GetAdmissionControl()->GetPendingMessages();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+unsigned int MessagePortServer<MessagePortAcceptor, Handler>::GetRejectedConnections() const
+{
+  return m_implementation->GetAdmissionControl()->GetRejectedConnections();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+unsigned int MessagePortServer<MessagePortAcceptor, Handler>::GetShedMessages() const
+{
+  return m_implementation->GetAdmissionControl()->GetShedMessages();
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+bool MessagePortServer<MessagePortAcceptor, Handler>::GetStatistics(
+    MessagePortId id, 
+    PortStatistics & statistics) const
+{
+  return m_implementation->GetStatistics(id, statistics);
+}
+
+template<typename MessagePortAcceptor, typename Handler>
+void MessagePortServer<MessagePortAcceptor, Handler>::AddListener(
+    ConnectionListenerPointer listener)
+{
+  m_implementation->AddListener(listener);
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
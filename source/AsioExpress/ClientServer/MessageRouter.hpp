@@ -0,0 +1,172 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/mpl/for_each.hpp>
+
+#include "AsioExpressError/Check.hpp"
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/ClientServer/MessageTypeFrame.hpp"
+#include "AsioExpress/ClientServer/RouteStatistics.hpp"
+#include "AsioExpress/ClientServer/ServerEventHandler.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Routes the messages of one type to a member function of the handler.
+/// The function is a template argument, so the call to it is made
+/// directly and may be inlined.
+///
+template<
+  typename Handler, 
+  MessageTypeFrame::TypeId Type, 
+  void (Handler::*Process)(AsioExpress::MessagePort::ServerMessage)>
+struct MessageRoute
+{
+  static MessageTypeFrame::TypeId const type = Type;
+
+  static void Dispatch(Handler & handler, ServerMessage message)
+  {
+    (handler.*Process)(message);
+  }
+};
+
+///
+/// The event handler of a server whose messages are framed by
+/// MessageTypeFrame. The handler derives from MessageRouter<Handler> and
+/// lists its routes in a Routes typedef, a boost::mpl sequence of
+/// MessageRoutes:
+///
+///   class MyHandler : public MessageRouter<MyHandler>
+///   {
+///   public:
+///     void ProcessEcho(ServerMessage message);
+///
+///     typedef boost::mpl::vector<
+///       MessageRoute<MyHandler, 1, &MyHandler::ProcessEcho> > Routes;
+///     ...
+///   };
+///
+/// A message is dispatched by indexing a table by its type, so type ids
+/// should be kept small; the table is as long as the largest. The handler
+/// gets the message without its header. A message that is too short fails
+/// with ErrorCode::MessagePortBadFrame, and one of a type without a route
+/// with ErrorCode::MessagePortUnknownMessageType. Each route counts its
+/// messages and their latency.
+///
+template<typename Handler>
+class MessageRouter : public ServerEventHandler
+{
+public:
+  MessageRouter();
+
+  virtual void AsyncProcessMessage(
+      AsioExpress::MessagePort::ServerMessage message);
+
+  ///
+  /// Gets the messages of the type handled so far. Returns false if the
+  /// type has no route.
+  ///
+  bool GetStatistics(
+      MessageTypeFrame::TypeId type,
+      RouteStatistics & statistics) const;
+
+private:
+  typedef void (*Dispatch)(Handler & handler, ServerMessage message);
+
+  struct Route
+  {
+    Route() :
+      dispatch(0)
+    {
+    }
+
+    Dispatch                dispatch;
+    RouteCountersPointer    counters;
+  };
+
+  typedef std::vector<Route> RouteTable;
+
+  // Adds each route of the handler's list to the table.
+  class AddRoute
+  {
+  public:
+    AddRoute(RouteTable & table) :
+      m_table(&table)
+    {
+    }
+
+    template<typename MessageRouteType>
+    void operator()(MessageRouteType)
+    {
+      MessageTypeFrame::TypeId type = MessageRouteType::type;
+      if (m_table->size() <= type)
+        m_table->resize(type + 1);
+
+      Route & route = (*m_table)[type];
+      CHECK_MSG(route.dispatch == 0, "Message type routed twice.");
+      route.dispatch = &MessageRouteType::Dispatch;
+      route.counters.reset(new RouteCounters);
+    }
+
+  private:
+    RouteTable *  m_table;
+  };
+
+  RouteTable    m_routes;
+};
+
+template<typename Handler>
+MessageRouter<Handler>::MessageRouter()
+{
+  boost::mpl::for_each<typename Handler::Routes>(AddRoute(m_routes));
+}
+
+template<typename Handler>
+void MessageRouter<Handler>::AsyncProcessMessage(
+    ServerMessage message)
+{
+  MessageTypeFrame::TypeId type = 0;
+  if (!MessageTypeFrame::Decode(*message.GetDataBuffer(), type))
+  {
+    message.CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortBadFrame));
+    return;
+  }
+
+  if (type >= m_routes.size() || m_routes[type].dispatch == 0)
+  {
+    message.CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortUnknownMessageType));
+    return;
+  }
+
+  Route const & route = m_routes[type];
+  route.dispatch(
+    static_cast<Handler &>(*this),
+    ServerMessage(
+      message.GetConnection(),
+      message.GetDataBuffer(),
+      CountingRouteHandler<AsioExpress::CompletionHandler>(
+        route.counters,
+        message.GetCompletionHandler())));
+}
+
+template<typename Handler>
+bool MessageRouter<Handler>::GetStatistics(
+    MessageTypeFrame::TypeId type,
+    RouteStatistics & statistics) const
+{
+  if (type >= m_routes.size() || m_routes[type].dispatch == 0)
+    return false;
+
+  m_routes[type].counters->Get(statistics);
+  return true;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
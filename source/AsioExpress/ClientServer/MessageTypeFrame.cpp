@@ -0,0 +1,46 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/MessageTypeFrame.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+DataBuffer::SizeType const MessageTypeFrame::HeaderSize;
+
+DataBufferPointer MessageTypeFrame::Encode(
+    TypeId type,
+    DataBuffer const & payload)
+{
+  DataBufferPointer frame(new DataBuffer(HeaderSize + payload.Size()));
+
+  unsigned char * header = reinterpret_cast<unsigned char *>(frame->Get());
+  header[0] = static_cast<unsigned char>(type >> 8);
+  header[1] = static_cast<unsigned char>(type);
+
+  if (payload.Size() > 0)
+    memcpy(frame->Get() + HeaderSize, payload.Get(), payload.Size());
+
+  return frame;
+}
+
+bool MessageTypeFrame::Decode(
+    DataBuffer & buffer,
+    TypeId & type)
+{
+  if (buffer.Size() < HeaderSize)
+    return false;
+
+  unsigned char const * header = reinterpret_cast<unsigned char const *>(buffer.Get());
+  type = static_cast<TypeId>(header[0] << 8 | header[1]);
+
+  buffer.Consume(HeaderSize);
+  return true;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,41 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The framing of messages sent to a MessageRouter. Each message starts
+/// with its type id in two bytes, most significant first.
+///
+class MessageTypeFrame
+{
+public:
+  typedef boost::uint16_t TypeId;
+
+  static DataBuffer::SizeType const HeaderSize = 2;
+
+  /// Makes a frame holding a copy of the payload.
+  static DataBufferPointer Encode(
+      TypeId type,
+      DataBuffer const & payload);
+
+  ///
+  /// Reads the type and drops the header from the buffer, leaving the
+  /// payload. Returns false if the buffer is too short to be a frame.
+  ///
+  static bool Decode(
+      DataBuffer & buffer,
+      TypeId & type);
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
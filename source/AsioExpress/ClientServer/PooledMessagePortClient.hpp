@@ -0,0 +1,202 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/LeastOutstandingStrategy.hpp"
+#include "AsioExpress/ClientServer/private/ClientPool.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A client that keeps several connections to the same end point and
+/// spreads its messages across them. By default each message goes to the
+/// connection with the fewest sends outstanding; with a
+/// ConsistentHashStrategy the messages sent with the same key stay on one
+/// connection for as long as it is connected.
+///
+/// All the connections report to the one event handler, so it must be
+/// safe to call from several connections at once when the io_service is
+/// run from several threads. The client in the events it is given is the
+/// connection's own, so a reply sent through it goes back on the
+/// connection the message came in on.
+///
+template<typename MessagePort>
+class PooledMessagePortClient : public ClientInterface
+{
+public:
+  typedef typename MessagePort::EndPointType EndPointType;
+
+  PooledMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointType endPoint,
+    ClientEventHandler * eventHandler,
+    unsigned int connectionCount,
+    DispatchStrategyPointer strategy = DispatchStrategyPointer());
+
+  virtual void Connect();
+
+  virtual void ShutDown();
+
+  virtual void Disconnect();
+
+  virtual void AsyncSend(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends the message on the connection the strategy chooses for the key.
+  ///
+  void AsyncSend(
+      std::string const & key,
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual std::string GetAddress() const;
+
+  virtual bool GetStatistics(PortStatistics & statistics) const;
+
+  unsigned int GetConnectionCount() const;
+
+  /// Sets the message window of each connection. Call this before Connect().
+  void SetMessageWindow(unsigned int size, bool isOrdered = false);
+
+  /// Sets the reconnect policy of each connection. Call this before Connect().
+  void SetReconnectPolicy(ReconnectPolicy const & policy);
+
+private:
+  typedef MessagePortClient<MessagePort> ClientType;
+  typedef boost::shared_ptr<ClientType> ClientPointer;
+  typedef std::vector<ClientPointer> ClientList;
+
+  ClientEventHandlerPointer   m_eventHandler;
+  ClientPoolPointer           m_pool;
+  ClientList                  m_clients;
+};
+
+template<typename MessagePort>
+PooledMessagePortClient<MessagePort>::PooledMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointType endPoint,
+    ClientEventHandler * eventHandler,
+    unsigned int connectionCount,
+    DispatchStrategyPointer strategy) :
+  m_eventHandler(eventHandler)
+{
+  if (!strategy)
+    strategy.reset(new LeastOutstandingStrategy);
+
+  m_pool.reset(new ClientPool(strategy, connectionCount));
+
+  for (unsigned int index = 0; index < connectionCount; ++index)
+  {
+    m_clients.push_back(ClientPointer(new ClientType(
+      ioService,
+      endPoint,
+      new ClientPoolEventHandler(m_eventHandler, m_pool, index))));
+  }
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::Connect()
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->Connect();
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::Disconnect()
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->Disconnect();
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::ShutDown()
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->ShutDown();
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::AsyncSend(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  AsyncSend(std::string(), buffer, completionHandler);
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::AsyncSend(
+    std::string const & key,
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  unsigned int index = m_pool->Select(key);
+  m_clients[index]->AsyncSend(
+    buffer,
+    ClientPoolSendHandler(m_pool, index, completionHandler));
+}
+
+template<typename MessagePort>
+bool PooledMessagePortClient<MessagePort>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  statistics = PortStatistics();
+
+  bool isConnected = false;
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+  {
+    PortStatistics connection;
+    if (m_clients[index]->GetStatistics(connection))
+    {
+      statistics.Add(connection);
+      isConnected = true;
+    }
+  }
+
+  return isConnected;
+}
+
+template<typename MessagePort>
+std::string PooledMessagePortClient<MessagePort>::GetAddress() const
+{
+  std::string address;
+  for (std::size_t index = 0; index < m_clients.size() && address.empty(); ++index)
+    address = m_clients[index]->GetAddress();
+
+  return address;
+}
+
+template<typename MessagePort>
+unsigned int PooledMessagePortClient<MessagePort>::GetConnectionCount() const
+{
+  return m_pool->GetSize();
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->SetMessageWindow(size, isOrdered);
+}
+
+template<typename MessagePort>
+void PooledMessagePortClient<MessagePort>::SetReconnectPolicy(
+    ReconnectPolicy const & policy)
+{
+  for (std::size_t index = 0; index < m_clients.size(); ++index)
+    m_clients[index]->SetReconnectPolicy(policy);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
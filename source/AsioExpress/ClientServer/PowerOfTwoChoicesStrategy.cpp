@@ -0,0 +1,72 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/PowerOfTwoChoicesStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+PowerOfTwoChoicesStrategy::PowerOfTwoChoicesStrategy(unsigned seed) :
+  m_random(seed)
+{
+}
+
+void PowerOfTwoChoicesStrategy::Add(MessagePortId id)
+{
+  if (m_ids.Add(id))
+    m_outstanding[id] = 0;
+}
+
+void PowerOfTwoChoicesStrategy::Remove(MessagePortId id)
+{
+  if (m_ids.Remove(id))
+    m_outstanding.erase(id);
+}
+
+MessagePortId PowerOfTwoChoicesStrategy::Select(std::string const &)
+{
+  std::size_t count = m_ids.Size();
+  if (count == 0)
+    return InvalidMessagePortId;
+
+  std::size_t first = m_random() % count;
+  MessagePortId id = m_ids[first];
+
+  if (count > 1)
+  {
+    // The second choice is drawn from the other ports.
+    std::size_t second = m_random() % (count - 1);
+    if (second >= first)
+      ++second;
+
+    MessagePortId other = m_ids[second];
+    if (m_outstanding[other] < m_outstanding[id])
+      id = other;
+  }
+
+  ++m_outstanding[id];
+  return id;
+}
+
+void PowerOfTwoChoicesStrategy::Completed(MessagePortId id)
+{
+  OutstandingMap::iterator outstanding = m_outstanding.find(id);
+  if (outstanding != m_outstanding.end() && outstanding->second > 0)
+    --outstanding->second;
+}
+
+unsigned PowerOfTwoChoicesStrategy::GetOutstanding(MessagePortId id) const
+{
+  OutstandingMap::const_iterator outstanding = m_outstanding.find(id);
+  if (outstanding == m_outstanding.end())
+    return 0;
+
+  return outstanding->second;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,49 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+#include "AsioExpress/ClientServer/private/MessagePortIdSet.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Picks two ports at random and hands the message to the one with fewer
+/// messages outstanding. This keeps the load nearly as even as always
+/// choosing the least loaded port, at a cost that does not grow with the
+/// number of ports. A message is outstanding until Completed() is called
+/// for its port.
+///
+class PowerOfTwoChoicesStrategy : public DispatchStrategy
+{
+public:
+  explicit PowerOfTwoChoicesStrategy(unsigned seed = 5489u);
+
+  virtual void Add(MessagePortId id);
+
+  virtual void Remove(MessagePortId id);
+
+  virtual MessagePortId Select(std::string const & key);
+
+  virtual void Completed(MessagePortId id);
+
+  /// Gets the number of messages outstanding on the port.
+  unsigned GetOutstanding(MessagePortId id) const;
+
+private:
+  typedef boost::unordered_map<MessagePortId, unsigned> OutstandingMap;
+
+  MessagePortIdSet          m_ids;
+  OutstandingMap            m_outstanding;
+  boost::random::mt19937    m_random;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
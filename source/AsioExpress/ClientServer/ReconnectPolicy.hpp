@@ -0,0 +1,43 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// How a client reconnects after losing its connection. The wait before
+/// each attempt doubles from the initial delay up to the maximum, and a
+/// random part of it is left out so that clients dropped together do not
+/// all come back at once. Messages sent while disconnected are held, up to
+/// the given number, and sent once the client is connected again. A message
+/// whose send is cut off by a lost connection is tried at most
+/// maxSendAttempts times in all before its error is reported.
+///
+struct ReconnectPolicy
+{
+  ReconnectPolicy(
+      unsigned int initialDelayMilliseconds = 100,
+      unsigned int maxDelayMilliseconds = 30000,
+      std::size_t maxBufferedMessages = 1000,
+      unsigned int maxSendAttempts = 3) :
+    initialDelayMilliseconds(initialDelayMilliseconds),
+    maxDelayMilliseconds(maxDelayMilliseconds),
+    maxBufferedMessages(maxBufferedMessages),
+    maxSendAttempts(maxSendAttempts)
+  {
+  }
+
+  unsigned int    initialDelayMilliseconds;
+  unsigned int    maxDelayMilliseconds;
+  std::size_t     maxBufferedMessages;
+  unsigned int    maxSendAttempts;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -6,41 +6,99 @@
 #include "AsioExpress/pch.hpp"
 
 #include "AsioExpress/ClientServer/RoundRobinServer.hpp"
+#include "AsioExpress/ClientServer/RoundRobinStrategy.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
+// Keeps the strategy up to date with the server's ports.
+class RoundRobinServer::Dispatcher : public ConnectionListener
+{
+public:
+  explicit Dispatcher(DispatchStrategyPointer strategy) :
+    m_strategy(strategy)
+  {
+  }
+
+  virtual void Connected(MessagePortId id)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_strategy->Add(id);
+  }
+
+  virtual void Disconnected(MessagePortId id)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_strategy->Remove(id);
+  }
+
+  MessagePortId Select(std::string const & key)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_strategy->Select(key);
+  }
+
+  void Completed(MessagePortId id)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_strategy->Completed(id);
+  }
+
+  void SetWeight(MessagePortId id, unsigned weight)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_strategy->SetWeight(id, weight);
+  }
+
+private:
+  boost::mutex              m_mutex;
+  DispatchStrategyPointer   m_strategy;
+};
+
 RoundRobinServer::RoundRobinServer(
-        ServerInterfacePointer server) :
-    server(server),
-    nextClientIndex(0)    
+    ServerInterfacePointer server,
+    DispatchStrategyPointer strategy) :
+  m_server(server)
 {
+  if (!strategy)
+    strategy.reset(new RoundRobinStrategy);
+
+  m_dispatcher.reset(new Dispatcher(strategy));
+  m_server->AddListener(m_dispatcher);
 }
   
-void RoundRobinServer::AsyncSendRoundRobin(
+MessagePortId RoundRobinServer::AsyncSendRoundRobin(
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
 {
-    MessagePortIdList messagePortIds;
-    server->GetIds(messagePortIds);
-
-    // we will use this invalid id if there are no clients to send to.
-    MessagePortId id(1);
-    
-    if (messagePortIds.size() != 0)
-    {
-        if (nextClientIndex >= messagePortIds.size())
-            nextClientIndex = 0;        
-        id = messagePortIds.at(nextClientIndex);
-    }
-        
-    ++nextClientIndex;
-    
-    server->AsyncSend(
-      id, 
-      buffer, 
-      completionHandler);    
+  return AsyncSend(std::string(), buffer, completionHandler);
 }  
 
+MessagePortId RoundRobinServer::AsyncSend(
+    std::string const & key,
+    DataBufferPointer buffer, 
+    AsioExpress::CompletionHandler completionHandler)
+{
+  MessagePortId id = m_dispatcher->Select(key);
+
+  // The server completes sends to unknown ports without an error.
+  m_server->AsyncSend(
+    id, 
+    buffer, 
+    completionHandler);    
+
+  return id;
+}
+
+void RoundRobinServer::Completed(MessagePortId id)
+{
+  m_dispatcher->Completed(id);
+}
+
+void RoundRobinServer::SetWeight(MessagePortId id, unsigned weight)
+{
+  m_dispatcher->SetWeight(id, weight);
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -8,23 +8,52 @@
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 #include "AsioExpress/ClientServer/ServerInterface.hpp"
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
+///
+/// Spreads messages over a server's connected ports. The server reports
+/// each port as it connects and disconnects, so choosing a port costs the
+/// same however many there are. The strategy decides which port is chosen;
+/// by default the ports take turns. The methods may be called from any
+/// thread.
+///
 class RoundRobinServer
 {
 public:
   explicit RoundRobinServer(
-      ServerInterfacePointer server);
+      ServerInterfacePointer server,
+      DispatchStrategyPointer strategy = DispatchStrategyPointer());
   
-  void AsyncSendRoundRobin(
+  ///
+  /// Sends the message to the next port chosen by the strategy and returns
+  /// its id. With no ports connected nothing is sent, the completion
+  /// handler is called without an error and InvalidMessagePortId is
+  /// returned.
+  ///
+  MessagePortId AsyncSendRoundRobin(
       DataBufferPointer buffer, 
       AsioExpress::CompletionHandler completionHandler);
+
+  /// Sends the message to the port the strategy chooses for the key.
+  MessagePortId AsyncSend(
+      std::string const & key,
+      DataBufferPointer buffer, 
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Reports that a message sent to the port has been dealt with.
+  void Completed(MessagePortId id);
+
+  void SetWeight(MessagePortId id, unsigned weight);
   
 private:
-    ServerInterfacePointer  server;
-    size_t                  nextClientIndex;
+  class Dispatcher;
+  typedef boost::shared_ptr<Dispatcher> DispatcherPointer;
+
+  ServerInterfacePointer  m_server;
+  DispatcherPointer       m_dispatcher;
 };
 
 } // namespace MessagePort
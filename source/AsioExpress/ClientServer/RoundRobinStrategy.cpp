@@ -0,0 +1,40 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/RoundRobinStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+RoundRobinStrategy::RoundRobinStrategy() :
+  m_next(0)
+{
+}
+
+void RoundRobinStrategy::Add(MessagePortId id)
+{
+  m_ids.Add(id);
+}
+
+void RoundRobinStrategy::Remove(MessagePortId id)
+{
+  m_ids.Remove(id);
+}
+
+MessagePortId RoundRobinStrategy::Select(std::string const &)
+{
+  if (m_ids.Empty())
+    return InvalidMessagePortId;
+
+  if (m_next >= m_ids.Size())
+    m_next = 0;
+
+  return m_ids[m_next++];
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
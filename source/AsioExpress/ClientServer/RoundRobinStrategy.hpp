@@ -0,0 +1,32 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+#include "AsioExpress/ClientServer/private/MessagePortIdSet.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+/// Hands the messages to the ports in turn.
+class RoundRobinStrategy : public DispatchStrategy
+{
+public:
+  RoundRobinStrategy();
+
+  virtual void Add(MessagePortId id);
+
+  virtual void Remove(MessagePortId id);
+
+  virtual MessagePortId Select(std::string const & key);
+
+private:
+  MessagePortIdSet  m_ids;
+  std::size_t       m_next;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,64 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/RouteStatistics.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+RouteStatistics::RouteStatistics() :
+  messages(0),
+  failures(0),
+  pending(0)
+{
+  for (int i = 0; i < LatencyBuckets; ++i)
+    latency[i] = 0;
+}
+
+boost::uint64_t RouteStatistics::GetLatencyPercentile(double fraction) const
+{
+  return PortStatistics::GetLatencyPercentile(latency, fraction);
+}
+
+RouteCounters::RouteCounters() :
+  m_messages(0),
+  m_failures(0),
+  m_pending(0)
+{
+  for (int i = 0; i < RouteStatistics::LatencyBuckets; ++i)
+    m_latency[i].store(0, boost::memory_order_relaxed);
+}
+
+PortCounters::Time RouteCounters::Begin()
+{
+  m_messages.fetch_add(1, boost::memory_order_relaxed);
+  m_pending.fetch_add(1, boost::memory_order_relaxed);
+  return PortCounters::Now();
+}
+
+void RouteCounters::End(PortCounters::Time started, bool isFailed)
+{
+  m_pending.fetch_sub(1, boost::memory_order_relaxed);
+  if (isFailed)
+    m_failures.fetch_add(1, boost::memory_order_relaxed);
+
+  PortCounters::Time now = PortCounters::Now();
+  boost::uint64_t latency = now > started ? static_cast<boost::uint64_t>(now - started) : 0;
+  m_latency[PortStatistics::GetLatencyBucket(latency)].fetch_add(1, boost::memory_order_relaxed);
+}
+
+void RouteCounters::Get(RouteStatistics & statistics) const
+{
+  statistics.messages = m_messages.load(boost::memory_order_relaxed);
+  statistics.failures = m_failures.load(boost::memory_order_relaxed);
+  statistics.pending = m_pending.load(boost::memory_order_relaxed);
+  for (int i = 0; i < RouteStatistics::LatencyBuckets; ++i)
+    statistics.latency[i] = m_latency[i].load(boost::memory_order_relaxed);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
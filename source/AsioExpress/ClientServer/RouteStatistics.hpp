@@ -0,0 +1,96 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The messages of one type a MessageRouter has handled. A message's
+/// latency is the time from its dispatch until the handler completes it,
+/// counted in the same buckets as PortStatistics.
+///
+struct RouteStatistics
+{
+  enum { LatencyBuckets = PortStatistics::LatencyBuckets };
+
+  RouteStatistics();
+
+  /// Gets an upper bound, in microseconds, on the latency of the fraction.
+  boost::uint64_t GetLatencyPercentile(double fraction) const;
+
+  boost::uint64_t   messages;
+  boost::uint64_t   failures;
+  boost::uint64_t   pending;
+  boost::uint64_t   latency[LatencyBuckets];
+};
+
+///
+/// The counters a MessageRouter keeps for a message type. They are updated
+/// without locks.
+///
+class RouteCounters
+{
+public:
+  RouteCounters();
+
+  /// Counts a message passed to its handler and gets its start time.
+  PortCounters::Time Begin();
+
+  void End(PortCounters::Time started, bool isFailed);
+
+  void Get(RouteStatistics & statistics) const;
+
+private:
+  RouteCounters(RouteCounters const &);
+  RouteCounters & operator=(RouteCounters const &);
+
+  boost::atomic<boost::uint64_t>    m_messages;
+  boost::atomic<boost::uint64_t>    m_failures;
+  boost::atomic<boost::uint64_t>    m_pending;
+  boost::atomic<boost::uint64_t>    m_latency[RouteStatistics::LatencyBuckets];
+};
+
+typedef boost::shared_ptr<RouteCounters> RouteCountersPointer;
+
+///
+/// Counts a routed message when its handler completes it and then calls
+/// the message's completion handler.
+///
+template<typename H>
+class CountingRouteHandler
+{
+public:
+  CountingRouteHandler(
+      RouteCountersPointer counters,
+      H completionHandler) :
+    m_counters(counters),
+    m_started(counters->Begin()),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    m_counters->End(m_started, error);
+    m_completionHandler(error);
+  }
+
+private:
+  RouteCountersPointer    m_counters;
+  PortCounters::Time      m_started;
+  H                       m_completionHandler;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
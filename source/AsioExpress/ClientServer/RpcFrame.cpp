@@ -0,0 +1,58 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/RpcFrame.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+DataBuffer::SizeType const RpcFrame::HeaderSize;
+
+DataBufferPointer RpcFrame::Encode(
+    Kind kind,
+    CallId id,
+    DataBuffer const & payload)
+{
+  DataBufferPointer frame(new DataBuffer(HeaderSize + payload.Size()));
+
+  unsigned char * header = reinterpret_cast<unsigned char *>(frame->Get());
+  header[0] = static_cast<unsigned char>(kind);
+  header[1] = static_cast<unsigned char>(id >> 24);
+  header[2] = static_cast<unsigned char>(id >> 16);
+  header[3] = static_cast<unsigned char>(id >> 8);
+  header[4] = static_cast<unsigned char>(id);
+
+  if (payload.Size() > 0)
+    memcpy(frame->Get() + HeaderSize, payload.Get(), payload.Size());
+
+  return frame;
+}
+
+bool RpcFrame::Decode(
+    DataBuffer & buffer,
+    Kind & kind,
+    CallId & id)
+{
+  if (buffer.Size() < HeaderSize)
+    return false;
+
+  unsigned char const * header = reinterpret_cast<unsigned char const *>(buffer.Get());
+  if (header[0] < Message || header[0] > Reply)
+    return false;
+
+  kind = static_cast<Kind>(header[0]);
+  id = static_cast<CallId>(header[1]) << 24 |
+       static_cast<CallId>(header[2]) << 16 |
+       static_cast<CallId>(header[3]) << 8 |
+       static_cast<CallId>(header[4]);
+
+  buffer.Consume(HeaderSize);
+  return true;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,51 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The framing of the messages on an RPC connection. Each message starts
+/// with a byte giving its kind and the call's correlation id in four bytes,
+/// most significant first. One-way messages carry an id of zero.
+///
+class RpcFrame
+{
+public:
+  typedef boost::uint32_t CallId;
+
+  enum Kind
+  {
+    Message = 1,
+    Request = 2,
+    Reply = 3
+  };
+
+  static DataBuffer::SizeType const HeaderSize = 5;
+
+  /// Makes a frame holding a copy of the payload.
+  static DataBufferPointer Encode(
+      Kind kind,
+      CallId id,
+      DataBuffer const & payload);
+
+  ///
+  /// Reads the header and drops it from the buffer, leaving the payload.
+  /// Returns false, leaving the buffer as it was, if it is not a frame.
+  ///
+  static bool Decode(
+      DataBuffer & buffer,
+      Kind & kind,
+      CallId & id);
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
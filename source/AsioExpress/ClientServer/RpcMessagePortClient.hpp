@@ -0,0 +1,170 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/RpcFrame.hpp"
+#include "AsioExpress/ClientServer/private/RpcCalls.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A client that calls a server and waits for its replies. Each request is
+/// sent with a correlation id that the server's reply carries back, so any
+/// number of calls can be waiting on the one connection. The server's
+/// event handler is an RpcServerEventHandler.
+///
+/// Messages sent with AsyncSend() are one-way; they reach the server's
+/// AsyncProcessOneWay(), and the one-way messages the server sends reach
+/// this client's event handler. The calls waiting when the connection is
+/// lost fail with the connection's error.
+///
+template<typename MessagePort>
+class RpcMessagePortClient : public ClientInterface
+{
+public:
+  typedef typename MessagePort::EndPointType EndPointType;
+
+  RpcMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointType endPoint,
+    ClientEventHandler * eventHandler);
+
+  ~RpcMessagePortClient();
+
+  virtual void Connect();
+
+  virtual void ShutDown();
+
+  virtual void Disconnect();
+
+  virtual void AsyncSend(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends the request and completes once the reply has been copied into
+  /// the reply buffer, or with ErrorCode::MessagePortCallTimeout if it has
+  /// not come within the timeout. A timeout of zero waits until the reply
+  /// comes or the connection is lost.
+  ///
+  void AsyncCall(
+      DataBufferPointer request,
+      DataBufferPointer reply,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual std::string GetAddress() const;
+
+  virtual bool GetStatistics(PortStatistics & statistics) const;
+
+  /// Gets the number of calls waiting for their replies.
+  std::size_t GetOutstandingCalls() const;
+
+  /// Sets the client's message window. Call this before Connect().
+  void SetMessageWindow(unsigned int size, bool isOrdered = false);
+
+private:
+  typedef MessagePortClient<MessagePort> ClientType;
+
+  ClientEventHandlerPointer   m_eventHandler;
+  RpcCallsPointer             m_calls;
+  ClientType                  m_client;
+};
+
+template<typename MessagePort>
+RpcMessagePortClient<MessagePort>::RpcMessagePortClient(
+    boost::asio::io_service & ioService,
+    EndPointType endPoint,
+    ClientEventHandler * eventHandler) :
+  m_eventHandler(eventHandler),
+  m_calls(new RpcCalls(ioService)),
+  m_client(ioService, endPoint, new RpcClientEventHandler(m_eventHandler, m_calls))
+{
+}
+
+template<typename MessagePort>
+RpcMessagePortClient<MessagePort>::~RpcMessagePortClient()
+{
+  m_calls->FailAll(AsioExpress::Error(boost::asio::error::operation_aborted));
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::Connect()
+{
+  m_client.Connect();
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::Disconnect()
+{
+  m_client.Disconnect();
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::ShutDown()
+{
+  m_client.ShutDown();
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::AsyncSend(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_client.AsyncSend(
+    RpcFrame::Encode(RpcFrame::Message, 0, *buffer),
+    completionHandler);
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::AsyncCall(
+    DataBufferPointer request,
+    DataBufferPointer reply,
+    unsigned int timeoutMilliseconds,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  RpcFrame::CallId id = m_calls->Begin(reply, completionHandler, timeoutMilliseconds);
+  if (id == 0)
+    return;
+
+  m_client.AsyncSend(
+    RpcFrame::Encode(RpcFrame::Request, id, *request),
+    boost::bind(&RpcCalls::RequestSent, m_calls, id, _1));
+}
+
+template<typename MessagePort>
+std::string RpcMessagePortClient<MessagePort>::GetAddress() const
+{
+  return m_client.GetAddress();
+}
+
+template<typename MessagePort>
+bool RpcMessagePortClient<MessagePort>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  return m_client.GetStatistics(statistics);
+}
+
+template<typename MessagePort>
+std::size_t RpcMessagePortClient<MessagePort>::GetOutstandingCalls() const
+{
+  return m_calls->GetOutstanding();
+}
+
+template<typename MessagePort>
+void RpcMessagePortClient<MessagePort>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  m_client.SetMessageWindow(size, isOrdered);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,79 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/ClientServer/RpcServerEventHandler.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+RpcRequest::RpcRequest(ServerMessage message, RpcFrame::CallId id) :
+  m_message(message),
+  m_id(id)
+{
+}
+
+DataBufferPointer RpcRequest::GetDataBuffer() const
+{
+  return m_message.GetDataBuffer();
+}
+
+MessagePortId RpcRequest::GetMessagePortId() const
+{
+  return m_message.GetMessagePortId();
+}
+
+ServerConnection RpcRequest::GetConnection() const
+{
+  return m_message.GetConnection();
+}
+
+void RpcRequest::AsyncReply(
+    DataBufferPointer reply,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_message.AsyncSend(
+    m_message.GetMessagePortId(),
+    RpcFrame::Encode(RpcFrame::Reply, m_id, *reply),
+    completionHandler);
+}
+
+void RpcRequest::CallCompletionHandler(AsioExpress::Error const & error)
+{
+  m_message.CallCompletionHandler(error);
+}
+
+void RpcServerEventHandler::AsyncProcessOneWay(
+    ServerMessage message)
+{
+  message.CallCompletionHandler(AsioExpress::Error());
+}
+
+void RpcServerEventHandler::AsyncProcessMessage(
+    ServerMessage message)
+{
+  RpcFrame::Kind kind = RpcFrame::Message;
+  RpcFrame::CallId id = 0;
+  if (!RpcFrame::Decode(*message.GetDataBuffer(), kind, id) || kind == RpcFrame::Reply)
+  {
+    message.CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortBadFrame));
+    return;
+  }
+
+  if (kind == RpcFrame::Message)
+    AsyncProcessOneWay(message);
+  else
+    AsyncProcessRequest(RpcRequest(message, id));
+}
+
+DataBufferPointer RpcServerEventHandler::OneWay(DataBuffer const & message)
+{
+  return RpcFrame::Encode(RpcFrame::Message, 0, message);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,75 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "AsioExpress/ClientServer/ServerEventHandler.hpp"
+#include "AsioExpress/ClientServer/ServerMessage.hpp"
+#include "AsioExpress/ClientServer/RpcFrame.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A call from an RpcMessagePortClient. The data buffer holds the request
+/// without its header.
+///
+class RpcRequest
+{
+public:
+  RpcRequest(ServerMessage message, RpcFrame::CallId id);
+
+  DataBufferPointer GetDataBuffer() const;
+
+  MessagePortId GetMessagePortId() const;
+
+  ServerConnection GetConnection() const;
+
+  /// Sends the reply back to the caller.
+  void AsyncReply(
+      DataBufferPointer reply,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Completes the request so the connection can go on to its next
+  /// message. This does not have to wait for the reply to be sent.
+  ///
+  void CallCompletionHandler(AsioExpress::Error const & error);
+
+private:
+  RpcRequest & operator=(RpcRequest const &);
+
+  ServerMessage       m_message;
+  RpcFrame::CallId    m_id;
+};
+
+///
+/// The event handler of a server whose clients are RpcMessagePortClients.
+/// The requests go to AsyncProcessRequest() and the one-way messages to
+/// AsyncProcessOneWay(), both without their headers; a message that is not
+/// a frame fails with ErrorCode::MessagePortBadFrame.
+///
+class RpcServerEventHandler : public ServerEventHandler
+{
+public:
+  virtual void AsyncProcessRequest(
+      AsioExpress::MessagePort::RpcRequest request) = 0;
+
+  /// By default one-way messages are ignored.
+  virtual void AsyncProcessOneWay(
+      AsioExpress::MessagePort::ServerMessage message);
+
+  virtual void AsyncProcessMessage(
+      AsioExpress::MessagePort::ServerMessage message);
+
+  ///
+  /// Frames a one-way message to send to a client with
+  /// ServerInterface::AsyncSend().
+  ///
+  static DataBufferPointer OneWay(DataBuffer const & message);
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,88 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+/// A message and the port to send it to.
+typedef std::pair<MessagePortId, DataBufferPointer> SendItem;
+typedef std::vector<SendItem> SendList;
+
+struct SendFailure
+{
+  SendFailure(std::size_t position, MessagePortId id, AsioExpress::Error error) :
+    position(position),
+    id(id),
+    error(error)
+  {
+  }
+
+  /// Where the message is in the list it was sent from.
+  std::size_t           position;
+  MessagePortId         id;
+  AsioExpress::Error    error;
+};
+
+///
+/// Reports how each message of a list sent at once went. Only the messages
+/// that failed are listed; every other message was sent, or was dropped
+/// because its port had disconnected, as a single send would be.
+///
+class SendManyResult
+{
+public:
+  typedef std::vector<SendFailure> FailureList;
+
+  SendManyResult() :
+    m_itemCount(0)
+  {
+  }
+
+  /// The number of messages in the list.
+  std::size_t GetItemCount() const
+  {
+    return m_itemCount;
+  }
+
+  FailureList const & GetFailures() const
+  {
+    return m_failures;
+  }
+
+  bool IsComplete() const
+  {
+    return m_failures.empty();
+  }
+
+  void SetItemCount(std::size_t count)
+  {
+    m_itemCount = count;
+  }
+
+  void AddFailure(std::size_t position, MessagePortId id, AsioExpress::Error error)
+  {
+    m_failures.push_back(SendFailure(position, id, error));
+  }
+
+private:
+  std::size_t   m_itemCount;
+  FailureList   m_failures;
+};
+
+typedef boost::shared_ptr<SendManyResult> SendManyResultPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
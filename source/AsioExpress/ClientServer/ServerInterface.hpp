@@ -9,6 +9,10 @@
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 #include "AsioExpress/ClientServer/MessagePortId.hpp"
+#include "AsioExpress/ClientServer/ConnectionListener.hpp"
+#include "AsioExpress/ClientServer/BroadcastResult.hpp"
+#include "AsioExpress/ClientServer/SendManyResult.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -30,9 +34,53 @@ public:
   virtual void AsyncBroadcast(
       DataBufferPointer buffer, 
       AsioExpress::CompletionHandler completionHandler) = 0;
+
+  ///
+  /// Sends the message to every port at once. The completion handler is
+  /// called when every send has completed or when the timeout passes. The
+  /// ports that failed or had not finished are listed in the result and
+  /// the handler then gets a MessagePortBroadcastIncomplete error. A
+  /// timeout of zero waits for every send.
+  ///
+  virtual void AsyncBroadcast(
+      DataBufferPointer buffer, 
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler) = 0;
+
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      AsioExpress::CompletionHandler completionHandler) = 0;
+
+  ///
+  /// Sends each message of the list to its port. The messages for one port
+  /// go out together, in the order they are listed, and the completion
+  /// handler is called once, when every message has been sent. The
+  /// messages that failed are listed in the result and the handler then
+  /// gets a MessagePortSendIncomplete error.
+  ///
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      SendManyResultPointer result,
+      AsioExpress::CompletionHandler completionHandler) = 0;
   
   virtual std::string GetAddress(MessagePortId id) const = 0;
 
+  ///
+  /// Gets the traffic of the port's connection. Returns false if there is
+  /// no such port.
+  ///
+  virtual bool GetStatistics(
+      MessagePortId id, 
+      PortStatistics & statistics) const = 0;
+
+  ///
+  /// Tells the listener about the ports already connected and then about
+  /// every port connected and disconnected. The server only holds a weak
+  /// reference to the listener.
+  ///
+  virtual void AddListener(ConnectionListenerPointer listener) = 0;
+
   virtual ~ServerInterface() {}
 };
 
@@ -48,6 +48,13 @@ public:
       DataBufferPointer buffer,
       H completionHandler);
 
+  template<typename H>
+  void AsyncBroadcast(
+      DataBufferPointer buffer,
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      H completionHandler);
+
   void CallCompletionHandler(AsioExpress::Error const & error);
 
 private:
@@ -104,6 +111,16 @@ void ServerMessage::AsyncBroadcast(
   connection.GetServer()->AsyncBroadcast(buffer, completionHandler);
 }
 
+template<typename H>
+void ServerMessage::AsyncBroadcast(
+    DataBufferPointer buffer,
+    BroadcastResultPointer result,
+    unsigned int timeoutMilliseconds,
+    H completionHandler)
+{
+  connection.GetServer()->AsyncBroadcast(buffer, result, timeoutMilliseconds, completionHandler);
+}
+
 inline void ServerMessage::CallCompletionHandler(
     AsioExpress::Error const & error)
 {
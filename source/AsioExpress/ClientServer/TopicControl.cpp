@@ -0,0 +1,63 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <string.h>
+
+#include "AsioExpress/ClientServer/TopicControl.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+namespace
+{
+  char const Marker[] = { '\0', 'T', 'O', 'P', 'I', 'C' };
+  DataBuffer::SizeType const MarkerSize = sizeof(Marker);
+  DataBuffer::SizeType const HeaderSize = MarkerSize + 1;
+}
+
+DataBufferPointer TopicControl::MakeSubscribe(std::string const & topic)
+{
+  return Make(Subscribe, topic);
+}
+
+DataBufferPointer TopicControl::MakeUnsubscribe(std::string const & topic)
+{
+  return Make(Unsubscribe, topic);
+}
+
+bool TopicControl::Parse(
+    DataBuffer const & message,
+    Operation & operation,
+    std::string & topic)
+{
+  if (message.Size() < HeaderSize || message.Get()[0] != '\0')
+    return false;
+
+  if (memcmp(message.Get(), Marker, MarkerSize) != 0)
+    return false;
+
+  char op = message.Get()[MarkerSize];
+  if (op != Subscribe && op != Unsubscribe)
+    return false;
+
+  operation = static_cast<Operation>(op);
+  topic.assign(message.Get() + HeaderSize, message.Size() - HeaderSize);
+  return true;
+}
+
+DataBufferPointer TopicControl::Make(Operation operation, std::string const & topic)
+{
+  DataBufferPointer message(new DataBuffer(HeaderSize + topic.size()));
+  memcpy(message->Get(), Marker, MarkerSize);
+  message->Get()[MarkerSize] = static_cast<char>(operation);
+  if (!topic.empty())
+    memcpy(message->Get() + HeaderSize, topic.data(), topic.size());
+  return message;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
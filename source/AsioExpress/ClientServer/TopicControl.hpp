@@ -0,0 +1,50 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The control messages a client sends to subscribe to a server's topics.
+/// A control message starts with a marker that begins with a zero byte,
+/// followed by the operation and the topic. A server with topics enabled
+/// acts on control messages itself; they never reach its event handler.
+///
+class TopicControl
+{
+public:
+  enum Operation
+  {
+    Subscribe = 'S',
+    Unsubscribe = 'U'
+  };
+
+  /// Makes the message that subscribes the sender to the topic.
+  static DataBufferPointer MakeSubscribe(std::string const & topic);
+
+  /// Makes the message that ends the sender's subscription to the topic.
+  static DataBufferPointer MakeUnsubscribe(std::string const & topic);
+
+  ///
+  /// Reads a control message. Returns false if the message is not one,
+  /// which is all it costs an ordinary message.
+  ///
+  static bool Parse(
+      DataBuffer const & message,
+      Operation & operation,
+      std::string & topic);
+
+private:
+  static DataBufferPointer Make(Operation operation, std::string const & topic);
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,79 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/WeightedStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+WeightedStrategy::WeightedStrategy() :
+  m_now(0)
+{
+}
+
+void WeightedStrategy::Add(MessagePortId id)
+{
+  if (m_ports.find(id) != m_ports.end())
+    return;
+
+  // A new port takes its turn now rather than catching up on the turns it
+  // missed.
+  Port & port = m_ports[id];
+  port.weight = 1;
+  Schedule(port, id, m_now);
+}
+
+void WeightedStrategy::Remove(MessagePortId id)
+{
+  PortMap::iterator port = m_ports.find(id);
+  if (port == m_ports.end())
+    return;
+
+  m_turns.erase(port->second.turn);
+  m_ports.erase(port);
+}
+
+MessagePortId WeightedStrategy::Select(std::string const &)
+{
+  if (m_turns.empty())
+    return InvalidMessagePortId;
+
+  Turn turn = *m_turns.begin();
+  m_now = turn.due;
+
+  Port & port = m_ports[turn.id];
+  m_turns.erase(port.turn);
+  Schedule(port, turn.id, turn.due + Stride / port.weight);
+
+  return turn.id;
+}
+
+void WeightedStrategy::SetWeight(MessagePortId id, unsigned weight)
+{
+  CHECK(weight > 0);
+  CHECK(weight <= Stride);
+
+  PortMap::iterator port = m_ports.find(id);
+  if (port == m_ports.end())
+    return;
+
+  port->second.weight = weight;
+}
+
+void WeightedStrategy::Schedule(
+    Port & port,
+    MessagePortId id,
+    boost::uint64_t due)
+{
+  Turn turn;
+  turn.due = due;
+  turn.id = id;
+  port.turn = m_turns.insert(turn).first;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,71 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <set>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Hands the messages to the ports in proportion to their weights, spread
+/// evenly rather than in bursts. Ports start with a weight of one.
+///
+class WeightedStrategy : public DispatchStrategy
+{
+public:
+  WeightedStrategy();
+
+  virtual void Add(MessagePortId id);
+
+  virtual void Remove(MessagePortId id);
+
+  virtual MessagePortId Select(std::string const & key);
+
+  /// Sets the port's weight, which must be from one to 2^20.
+  virtual void SetWeight(MessagePortId id, unsigned weight);
+
+private:
+  // Each port is due again a stride after it is chosen; the stride is
+  // shorter for heavier ports.
+  static boost::uint64_t const Stride = 1 << 20;
+
+  struct Turn
+  {
+    bool operator<(Turn const & that) const
+    {
+      if (due != that.due)
+        return due < that.due;
+      return id < that.id;
+    }
+
+    boost::uint64_t   due;
+    MessagePortId     id;
+  };
+
+  struct Port
+  {
+    std::set<Turn>::iterator  turn;
+    unsigned                  weight;
+  };
+
+  typedef std::set<Turn> TurnSet;
+  typedef boost::unordered_map<MessagePortId, Port> PortMap;
+
+  void Schedule(Port & port, MessagePortId id, boost::uint64_t due);
+
+  TurnSet           m_turns;
+  PortMap           m_ports;
+  boost::uint64_t   m_now;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,273 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ClientServer/private/AdmissionControl.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+AdmissionControl::AdmissionControl(boost::asio::io_service & ioService) :
+  m_ioService(ioService),
+  m_isRunning(false),
+  m_run(0),
+  m_isSignalled(false),
+  m_isDraining(false),
+  m_lagMilliseconds(0),
+  m_connections(0),
+  m_pendingMessages(0),
+  m_rejectedConnections(0),
+  m_shedMessages(0),
+  m_drainedMessages(0),
+  m_timer(ioService)
+{
+}
+
+void AdmissionControl::SetPolicy(AdmissionPolicy const & policy)
+{
+  CHECK(policy.checkIntervalMilliseconds > 0);
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_policy = policy;
+}
+
+void AdmissionControl::Start()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  m_isSignalled = false;
+  m_isDraining = false;
+  m_lagMilliseconds = 0;
+
+  if (m_isRunning || (m_policy.maxLagMilliseconds == 0 && !m_policy.isOverloaded))
+    return;
+
+  m_isRunning = true;
+  StartTimer();
+}
+
+void AdmissionControl::Stop()
+{
+  AsioExpress::CompletionHandler waiter;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_isRunning = false;
+    ++m_run;
+    m_timer.cancel();
+    waiter = TakeWaiter();
+  }
+
+  if (waiter)
+  {
+    m_ioService.post(boost::asio::detail::bind_handler(
+      waiter,
+      AsioExpress::Error(boost::asio::error::operation_aborted)));
+  }
+}
+
+void AdmissionControl::AsyncWaitToAccept(
+    AsioExpress::CompletionHandler completionHandler)
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_policy.connectionAction == AdmissionPolicy::PauseAccepting && !CanAccept())
+    {
+      m_waiter = completionHandler;
+      return;
+    }
+  }
+
+  m_ioService.post(boost::asio::detail::bind_handler(
+    completionHandler,
+    AsioExpress::Error()));
+}
+
+bool AdmissionControl::AdmitConnection()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  // A paused server has already waited for room.
+  if (m_policy.connectionAction == AdmissionPolicy::RejectConnections && !CanAccept())
+  {
+    ++m_rejectedConnections;
+    return false;
+  }
+
+  ++m_connections;
+  return true;
+}
+
+void AdmissionControl::ConnectionClosed()
+{
+  AsioExpress::CompletionHandler waiter;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    --m_connections;
+    if (CanAccept())
+      waiter = TakeWaiter();
+  }
+
+  if (waiter)
+    m_ioService.post(boost::asio::detail::bind_handler(waiter, AsioExpress::Error()));
+}
+
+bool AdmissionControl::BeginMessage()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  if (m_isDraining)
+  {
+    ++m_drainedMessages;
+    return false;
+  }
+
+  bool isFull = m_policy.maxPendingMessages > 0 &&
+    m_pendingMessages >= m_policy.maxPendingMessages;
+  if (isFull || m_isSignalled)
+  {
+    ++m_shedMessages;
+    return false;
+  }
+
+  ++m_pendingMessages;
+  return true;
+}
+
+void AdmissionControl::EndMessage()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  --m_pendingMessages;
+}
+
+void AdmissionControl::BeginDrain()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_isDraining = true;
+  m_drainedMessages = 0;
+}
+
+bool AdmissionControl::IsDraining() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_isDraining;
+}
+
+unsigned int AdmissionControl::GetDrainedMessages() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_drainedMessages;
+}
+
+bool AdmissionControl::IsOverloaded() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_isSignalled;
+}
+
+unsigned int AdmissionControl::GetConnections() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_connections;
+}
+
+unsigned int AdmissionControl::GetPendingMessages() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_pendingMessages;
+}
+
+unsigned int AdmissionControl::GetLagMilliseconds() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_lagMilliseconds;
+}
+
+unsigned int AdmissionControl::GetRejectedConnections() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_rejectedConnections;
+}
+
+unsigned int AdmissionControl::GetShedMessages() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_shedMessages;
+}
+
+bool AdmissionControl::CanAccept() const
+{
+  bool isFull = m_policy.maxConnections > 0 &&
+    m_connections >= m_policy.maxConnections;
+  return !isFull && !m_isSignalled;
+}
+
+AsioExpress::CompletionHandler AdmissionControl::TakeWaiter()
+{
+  AsioExpress::CompletionHandler waiter;
+  waiter.swap(m_waiter);
+  return waiter;
+}
+
+void AdmissionControl::StartTimer()
+{
+  m_timer.expires_from_now(boost::posix_time::milliseconds(m_policy.checkIntervalMilliseconds));
+  m_timer.async_wait(boost::bind(&AdmissionControl::TimerExpired, shared_from_this(), m_run, _1));
+}
+
+void AdmissionControl::TimerExpired(
+    unsigned int run,
+    boost::system::error_code const & error)
+{
+  if (error)
+    return;
+
+  boost::posix_time::ptime now = boost::asio::deadline_timer::traits_type::now();
+
+  // Read the application's signal without holding the lock.
+  AdmissionPolicy::OverloadSignal isOverloaded;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (run != m_run)
+      return;
+    isOverloaded = m_policy.isOverloaded;
+  }
+  bool isSignalled = isOverloaded && isOverloaded();
+
+  AsioExpress::CompletionHandler waiter;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (run != m_run)
+      return;
+
+    // How late the timer runs is how long handlers wait in the io_service's
+    // queue.
+    boost::posix_time::time_duration late = now - m_timer.expires_at();
+    unsigned int sample = late.is_negative() ? 0 : static_cast<unsigned int>(late.total_milliseconds());
+
+    // The lag rises at once but falls off gradually, so shedding does not
+    // stop on the first quick turn of the queue.
+    if (sample >= m_lagMilliseconds)
+      m_lagMilliseconds = sample;
+    else
+      m_lagMilliseconds = (3 * m_lagMilliseconds + sample) / 4;
+
+    m_isSignalled = isSignalled ||
+      (m_policy.maxLagMilliseconds > 0 && m_lagMilliseconds > m_policy.maxLagMilliseconds);
+
+    if (CanAccept())
+      waiter = TakeWaiter();
+
+    StartTimer();
+  }
+
+  if (waiter)
+    m_ioService.post(boost::asio::detail::bind_handler(waiter, AsioExpress::Error()));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,113 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/ClientServer/AdmissionPolicy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Counts a server's connections and the messages in its event handler,
+/// and decides whether it takes on more. The overload signals are sampled
+/// by a timer every check interval rather than on each message, and the
+/// timer only runs when there is a signal to sample.
+///
+class AdmissionControl : public boost::enable_shared_from_this<AdmissionControl>
+{
+public:
+  explicit AdmissionControl(boost::asio::io_service & ioService);
+
+  /// Sets the policy. Call this before Start().
+  void SetPolicy(AdmissionPolicy const & policy);
+
+  void Start();
+
+  /// Stops sampling and aborts an accept that is waiting.
+  void Stop();
+
+  ///
+  /// Calls the handler, through the io_service, once the server may accept
+  /// another connection. Unless the policy pauses accepting this is at once.
+  ///
+  void AsyncWaitToAccept(AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Counts an accepted connection. Returns false if the connection should
+  /// be closed instead.
+  ///
+  bool AdmitConnection();
+
+  void ConnectionClosed();
+
+  ///
+  /// Counts a message passed to the event handler. Returns false if the
+  /// message should be failed as busy instead, or dropped when draining.
+  ///
+  bool BeginMessage();
+
+  void EndMessage();
+
+  ///
+  /// Refuses every message from now on so the server can finish the ones
+  /// it has. Start() takes messages again.
+  ///
+  void BeginDrain();
+
+  bool IsDraining() const;
+
+  /// Gets the number of messages refused since the drain began.
+  unsigned int GetDrainedMessages() const;
+
+  bool IsOverloaded() const;
+
+  unsigned int GetConnections() const;
+
+  unsigned int GetPendingMessages() const;
+
+  unsigned int GetLagMilliseconds() const;
+
+  unsigned int GetRejectedConnections() const;
+
+  unsigned int GetShedMessages() const;
+
+private:
+  // These require the lock to be held.
+  bool CanAccept() const;
+  AsioExpress::CompletionHandler TakeWaiter();
+
+  void StartTimer();
+  void TimerExpired(
+      unsigned int run,
+      boost::system::error_code const & error);
+
+  boost::asio::io_service &         m_ioService;
+  mutable boost::mutex              m_mutex;
+  AdmissionPolicy                   m_policy;
+  bool                              m_isRunning;
+  unsigned int                      m_run;
+  bool                              m_isSignalled;
+  bool                              m_isDraining;
+  unsigned int                      m_lagMilliseconds;
+  unsigned int                      m_connections;
+  unsigned int                      m_pendingMessages;
+  unsigned int                      m_rejectedConnections;
+  unsigned int                      m_shedMessages;
+  unsigned int                      m_drainedMessages;
+  AsioExpress::CompletionHandler    m_waiter;
+  boost::asio::deadline_timer       m_timer;
+};
+
+typedef boost::shared_ptr<AdmissionControl> AdmissionControlPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -5,62 +5,192 @@
 
 #pragma once
 
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/Timer/StandardTimer.hpp"
 #include "AsioExpress/ClientServer/MessagePortId.hpp"
+#include "AsioExpress/ClientServer/BroadcastResult.hpp"
 #include "AsioExpress/ClientServer/private/AsyncSendable.hpp"
-#include "AsioExpress/Coroutine.hpp"
-#include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
 
 namespace AsioExpress {
 namespace MessagePort {
 
-class BroadcastProcessor : private AsioExpress::Coroutine
+///
+/// Sends one buffer to a list of ports. Every send is started at once, so a
+/// slow port does not hold up the ports after it. The completion handler is
+/// called when the last send completes or when the timeout passes, if that
+/// is first. Failures are only reported when a result is given; otherwise
+/// they are ignored, although the sends are still waited for.
+///
+class BroadcastProcessor
 {
 public:
-  typedef std::vector<MessagePortId> MessagePortIdList;
-  typedef boost::shared_ptr<MessagePortIdList> MessagePortIdListPointer;
-
   BroadcastProcessor(
       boost::asio::io_service& ioService,
       AsyncSendablePointer sender,
-      MessagePortIdList const & messagePortIdList,
+      MessagePortIdList & messagePortIdList,
       DataBufferPointer buffer,
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
       AsioExpress::CompletionHandler completionHandler) :
-    m_ioService(&ioService),
-    m_sender(sender),
-    m_messagePortIdList(new MessagePortIdList(messagePortIdList)),
-    m_index(0),
-    m_buffer(buffer),
-    m_completionHandler(completionHandler)
+    m_broadcast(new Broadcast(ioService))
+  {
+    // The id list is taken rather than copied.
+    m_broadcast->ids.swap(messagePortIdList);
+    m_broadcast->isSent.resize(m_broadcast->ids.size(), false);
+    m_broadcast->remaining = m_broadcast->ids.size();
+    m_broadcast->sender = sender;
+    m_broadcast->buffer = buffer;
+    m_broadcast->result = result;
+    m_broadcast->completionHandler = completionHandler;
+
+    if (result)
+      result->SetRecipientCount(m_broadcast->ids.size());
+
+    if (timeoutMilliseconds > 0 && !m_broadcast->ids.empty())
+      m_broadcast->timer.reset(new StandardTimer(ioService, timeoutMilliseconds));
+  }
+
+  void operator()()
   {
+    BroadcastPointer broadcast = m_broadcast;
+
+    if (broadcast->ids.empty())
+    {
+      CallCompletionHandler(
+        *broadcast->ioService,
+        broadcast->completionHandler,
+        AsioExpress::Error());
+      return;
+    }
+
+    if (broadcast->timer)
+    {
+      boost::mutex::scoped_lock lock(broadcast->mutex);
+      broadcast->timer->AsyncWait(boost::bind(&BroadcastProcessor::Timeout, broadcast, _1));
+    }
+
+    // A send may complete before the next one is started, so the lock is
+    // not held here.
+    MessagePortIdList::size_type count = broadcast->ids.size();
+    for (MessagePortIdList::size_type index = 0; index < count; ++index)
+    {
+      broadcast->sender->AsyncSend(
+        broadcast->ids[index],
+        broadcast->buffer,
+        boost::bind(&BroadcastProcessor::SendComplete, broadcast, index, _1));
+    }
   }
 
-  void operator()(AsioExpress::Error error = AsioExpress::Error())
+private:
+  struct Broadcast
   {
-    // We will ignore any send errors but we will wait for all sends to
-    // complete nonetheless.
+    Broadcast(boost::asio::io_service & ioService) :
+      ioService(&ioService),
+      remaining(0)
+    {
+    }
+
+    boost::mutex                      mutex;
+    boost::asio::io_service *         ioService;
+    AsyncSendablePointer              sender;
+    MessagePortIdList                 ids;
+    std::vector<bool>                 isSent;
+    MessagePortIdList::size_type      remaining;
+    DataBufferPointer                 buffer;
+    BroadcastResultPointer            result;
+    TimerPointer                      timer;
+    AsioExpress::CompletionHandler    completionHandler;
+  };
+
+  typedef boost::shared_ptr<Broadcast> BroadcastPointer;
 
-    REENTER(this)
+  static void SendComplete(
+      BroadcastPointer broadcast,
+      MessagePortIdList::size_type index,
+      AsioExpress::Error error)
+  {
+    AsioExpress::CompletionHandler completionHandler;
+    AsioExpress::Error result;
     {
-      for(; m_index < m_messagePortIdList->size(); ++m_index)
+      boost::mutex::scoped_lock lock(broadcast->mutex);
+
+      // Sends that complete after the timeout have already been reported.
+      if (!broadcast->completionHandler)
+        return;
+
+      broadcast->isSent[index] = true;
+      if (error && broadcast->result)
+        broadcast->result->AddFailure(broadcast->ids[index], error);
+
+      if (--broadcast->remaining > 0)
+        return;
+
+      result = Finish(*broadcast, completionHandler);
+    }
+
+    CallCompletionHandler(*broadcast->ioService, completionHandler, result);
+  }
+
+  static void Timeout(
+      BroadcastPointer broadcast,
+      AsioExpress::Error error)
+  {
+    if (error)
+      return;
+
+    AsioExpress::CompletionHandler completionHandler;
+    AsioExpress::Error result;
+    {
+      boost::mutex::scoped_lock lock(broadcast->mutex);
+
+      if (!broadcast->completionHandler)
+        return;
+
+      if (broadcast->result)
       {
-        YIELD
-          m_sender->AsyncSend(m_messagePortIdList->at(m_index), m_buffer, *this);
+        MessagePortIdList::size_type count = broadcast->ids.size();
+        for (MessagePortIdList::size_type index = 0; index < count; ++index)
+        {
+          if (!broadcast->isSent[index])
+          {
+            broadcast->result->AddFailure(
+              broadcast->ids[index],
+              AsioExpress::Error(ErrorCode::MessagePortBroadcastTimeout));
+          }
+        }
       }
 
-      CallCompletionHandler(*m_ioService, m_completionHandler, AsioExpress::Error());
-      m_completionHandler = 0;
-   }
+      result = Finish(*broadcast, completionHandler);
+    }
+
+    CallCompletionHandler(*broadcast->ioService, completionHandler, result);
   }
 
-private:
-    boost::asio::io_service*          m_ioService;
-    AsyncSendablePointer              m_sender;
-    MessagePortIdListPointer          m_messagePortIdList;
-    MessagePortIdList::size_type      m_index;
-    DataBufferPointer                 m_buffer;
-    AsioExpress::CompletionHandler    m_completionHandler;
+  // Takes the completion handler and works out the error to call it with.
+  // Called with the broadcast locked.
+  static AsioExpress::Error Finish(
+      Broadcast & broadcast,
+      AsioExpress::CompletionHandler & completionHandler)
+  {
+    completionHandler.swap(broadcast.completionHandler);
+
+    if (broadcast.timer)
+      broadcast.timer->Stop();
+
+    if (broadcast.result && !broadcast.result->IsComplete())
+      return AsioExpress::Error(ErrorCode::MessagePortBroadcastIncomplete);
+
+    return AsioExpress::Error();
+  }
+
+  BroadcastPointer    m_broadcast;
 };
 
 } // namespace MessagePort
@@ -13,6 +13,7 @@
 #include "AsioExpress/ClientServer/ClientMessage.hpp"
 #include "AsioExpress/ClientServer/private/ClientEvents.hpp"
 #include "AsioExpress/ClientServer/private/MessagePortManager.hpp"
+#include "AsioExpress/ClientServer/private/MessageWindow.hpp"
 #include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
 
 namespace AsioExpress {
@@ -22,7 +23,7 @@ template<typename MessagePort>
 class Client : private AsioExpress::Coroutine
 {
 public:
-  typedef typename MessagePort::EndPointType EndPointType; 
+  typedef typename MessagePort::EndPointType EndPointType;
   typedef MessagePortManager<MessagePort> MessagePortManagerType;
   typedef boost::shared_ptr<MessagePortManagerType> MessagePortManagerPointer;
 
@@ -31,17 +32,19 @@ public:
       ClientInterfacePointer messagePortClient,
       ClientEventsPointer clientEvents,
       EndPointType endPoint,
-      MessagePortManagerPointer messagePortManager);
+      MessagePortManagerPointer messagePortManager,
+      unsigned int windowSize,
+      bool isOrderedWindow);
 
   void operator()(
       AsioExpress::Error error = AsioExpress::Error());
 
 private:
   typedef boost::shared_ptr<MessagePort> MessagePortPointer;
-  typedef boost::shared_ptr<ClientEventHandler> ClientEventHandlerPointer; 
-  typedef boost::shared_ptr<bool> BoolPointer;
+  typedef boost::shared_ptr<ClientEventHandler> ClientEventHandlerPointer;
 
   Client & operator=(Client const &);
+  void MessageCompleted(AsioExpress::Error error);
   void Disconnect(AsioExpress::Error error);
 
   boost::asio::io_service &           m_ioService;
@@ -50,9 +53,11 @@ private:
   EndPointType                        m_endPoint;
   MessagePortManagerPointer           m_messagePortManager;
   MessagePortPointer                  m_messagePort;
+  StrandPointer                       m_strand;
+  MessageWindowPointer                m_window;
   MessagePortId                       m_messagePortId;
+  unsigned int                        m_sequence;
   DataBufferPointer                   m_buffer;
-  BoolPointer                         m_useErrorHandler;
 };
 
 template<typename MessagePort>
@@ -61,52 +66,39 @@ Client<MessagePort>::Client(
     ClientInterfacePointer messagePortClient,
     ClientEventsPointer clientEvents,
     EndPointType endPoint,
-    MessagePortManagerPointer messagePortManager) :
+    MessagePortManagerPointer messagePortManager,
+    unsigned int windowSize,
+    bool isOrderedWindow) :
   m_ioService(ioService),
   m_messagePortClient(messagePortClient),
   m_clientEvents(clientEvents),
   m_endPoint(endPoint),
   m_messagePortManager(messagePortManager),
+  m_strand(new boost::asio::io_service::strand(ioService)),
+  m_window(new MessageWindow(ioService, windowSize, isOrderedWindow)),
   m_messagePortId(0),
-  m_buffer(new DataBuffer),
-  m_useErrorHandler(new bool(false))
+  m_sequence(0)
 {
 }
 
 template<typename MessagePort>
 void Client<MessagePort>::operator()(AsioExpress::Error error)
 {
-  if (*m_useErrorHandler && error)
-  {
-    *m_useErrorHandler = false;
-
-    error = m_clientEvents->HandleMessageError(
-              ClientMessage(
-                  ClientConnection(
-                    m_ioService,
-                    m_messagePortId, 
-                    m_messagePortClient), 
-                  m_buffer, 
-                  0),
-              error);
-  }
-
-  if (error)
-  {
-    Disconnect(error);
-    return;
-  }
-
   REENTER (this)
   {
     // Create a new socket for the next incoming connection.
     m_messagePort.reset(new MessagePort(m_ioService));
 
-    YIELD m_messagePort->AsyncConnect(m_endPoint, *this);
+    YIELD m_messagePort->AsyncConnect(m_endPoint, m_strand->wrap(*this));
+    if (error)
+    {
+      Disconnect(error);
+      return;
+    }
 
     m_messagePort->SetMessagePortOptions();
 
-    m_messagePortId = m_messagePortManager->Add(m_messagePort);
+    m_messagePortId = m_messagePortManager->Add(m_messagePort, m_strand);
 
     error = m_clientEvents->HandleConnected(
       ClientConnection(m_ioService, m_messagePortId, m_messagePortClient));
@@ -115,34 +107,92 @@ void Client<MessagePort>::operator()(AsioExpress::Error error)
       Disconnect(error);
       return;
     }
-    
-    // Process incoming messages.
+
+    // Process incoming messages. Up to the window size of them are in the
+    // event handler at once.
     for(;;)
     {
       // Receive message
+      m_buffer = m_window->GetBuffer();
       YIELD
-        m_messagePort->AsyncReceive(m_buffer, *this);
+        m_messagePort->AsyncReceive(m_buffer, m_strand->wrap(*this));
+      if (error)
+      {
+        Disconnect(error);
+        return;
+      }
 
-      YIELD 
+      // A child coroutine waits for the event handler to complete the
+      // message while the parent goes on to receive the next one.
+      m_sequence = m_window->Begin();
+      FORK Client(*this)();
+      if (IsChild())
       {
-        *m_useErrorHandler = true;
-
-        m_clientEvents->HandleMessage(
-          ClientMessage(
-              ClientConnection(
-                m_ioService,
-                m_messagePortId, 
-                m_messagePortClient), 
-              m_buffer, 
-              *this));
+        YIELD
+        {
+          m_clientEvents->HandleMessage(
+            ClientMessage(
+                ClientConnection(
+                  m_ioService,
+                  m_messagePortId,
+                  m_messagePortClient),
+                m_buffer,
+                m_strand->wrap(*this)));
+        }
+        MessageCompleted(error);
+        return;
       }
+
+      m_buffer.reset();
+      if (m_window->IsFull())
+      {
+        YIELD m_window->AsyncWaitForSlot(m_strand->wrap(*this));
+        if (error)
+          return;
+      }
+    }
+  }
+}
+
+template<typename MessagePort>
+void Client<MessagePort>::MessageCompleted(AsioExpress::Error error)
+{
+  MessageWindow::CompletionList ready;
+  m_window->Complete(m_sequence, m_buffer, error, ready);
+
+  MessageWindow::CompletionList::const_iterator  it = ready.begin();
+  MessageWindow::CompletionList::const_iterator end = ready.end();
+  for (; it != end; ++it)
+  {
+    if (!it->error)
+      continue;
+
+    error = m_clientEvents->HandleMessageError(
+              ClientMessage(
+                  ClientConnection(
+                    m_ioService,
+                    m_messagePortId,
+                    m_messagePortClient),
+                  it->buffer,
+                  0),
+              it->error);
+    if (error)
+    {
+      Disconnect(error);
+      return;
     }
   }
+
+  m_window->Recycle(ready);
 }
 
 template<typename MessagePort>
 void Client<MessagePort>::Disconnect(AsioExpress::Error error)
 {
+  // Either the receive loop or a failed message may disconnect first.
+  if (!m_window->Close())
+    return;
+
   m_messagePortManager->Remove(m_messagePortId);
   m_messagePort.reset();
   m_clientEvents->HandleDisconnected(
@@ -30,6 +30,10 @@ public:
   virtual AsioExpress::Error HandleMessageError(
     ClientMessage message,
     AsioExpress::Error error) = 0;
+
+  virtual void HandleReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds) = 0;
 };
 
 typedef boost::shared_ptr<ClientEvents> ClientEventsPointer;
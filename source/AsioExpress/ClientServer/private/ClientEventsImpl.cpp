@@ -64,5 +64,16 @@ AsioExpress::Error ClientEventsImpl::HandleMessageError(
   ASIOEXPRESS_CATCH_ERROR_AND_DO(return error)
 }
 
+void ClientEventsImpl::HandleReconnecting(
+  ClientConnection connection,
+  unsigned int delayMilliseconds)
+{
+  try
+  {
+    m_eventHandler->ClientReconnecting(connection, delayMilliseconds);
+  }
+  ASIOEXPRESS_CATCH_ERROR_AND_DO(m_eventHandler->ConnectionError(connection, error))
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
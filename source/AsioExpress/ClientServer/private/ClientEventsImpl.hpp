@@ -33,6 +33,10 @@ public:
     ClientMessage message,
     AsioExpress::Error error);
 
+  virtual void HandleReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds);
+
 private:
   ClientEventHandlerPointer         m_eventHandler;
 };
@@ -0,0 +1,130 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/private/ClientPool.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+ClientPool::ClientPool(
+    DispatchStrategyPointer strategy,
+    unsigned int size) :
+  m_strategy(strategy),
+  m_size(size),
+  m_next(0)
+{
+  CHECK(strategy);
+  CHECK(size > 0);
+}
+
+void ClientPool::Connected(unsigned int index)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_strategy->Add(index);
+}
+
+void ClientPool::Disconnected(unsigned int index)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_strategy->Remove(index);
+}
+
+unsigned int ClientPool::Select(std::string const & key)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  MessagePortId id = m_strategy->Select(key);
+  if (id != InvalidMessagePortId)
+    return static_cast<unsigned int>(id);
+
+  unsigned int index = m_next;
+  m_next = (m_next + 1) % m_size;
+  return index;
+}
+
+void ClientPool::Completed(unsigned int index)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_strategy->Completed(index);
+}
+
+unsigned int ClientPool::GetSize() const
+{
+  return m_size;
+}
+
+ClientPoolSendHandler::ClientPoolSendHandler(
+    ClientPoolPointer pool,
+    unsigned int index,
+    AsioExpress::CompletionHandler completionHandler) :
+  m_pool(pool),
+  m_index(index),
+  m_completionHandler(completionHandler)
+{
+}
+
+void ClientPoolSendHandler::operator()(AsioExpress::Error error)
+{
+  m_pool->Completed(m_index);
+  m_completionHandler(error);
+}
+
+ClientPoolEventHandler::ClientPoolEventHandler(
+    ClientEventHandlerPointer eventHandler,
+    ClientPoolPointer pool,
+    unsigned int index) :
+  m_eventHandler(eventHandler),
+  m_pool(pool),
+  m_index(index)
+{
+}
+
+void ClientPoolEventHandler::ClientConnected(
+    ClientConnection connection)
+{
+  // Added first so that the handler's own sends may use the connection.
+  m_pool->Connected(m_index);
+  m_eventHandler->ClientConnected(connection);
+}
+
+void ClientPoolEventHandler::ClientDisconnected(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  m_pool->Disconnected(m_index);
+  m_eventHandler->ClientDisconnected(connection, error);
+}
+
+void ClientPoolEventHandler::AsyncProcessMessage(
+    ClientMessage message)
+{
+  m_eventHandler->AsyncProcessMessage(message);
+}
+
+AsioExpress::Error ClientPoolEventHandler::ConnectionError(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->ConnectionError(connection, error);
+}
+
+AsioExpress::Error ClientPoolEventHandler::MessageError(
+    ClientMessage message,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->MessageError(message, error);
+}
+
+void ClientPoolEventHandler::ClientReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds)
+{
+  m_eventHandler->ClientReconnecting(connection, delayMilliseconds);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
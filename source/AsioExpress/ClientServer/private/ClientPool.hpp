@@ -0,0 +1,116 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/ClientServer/ClientEventHandler.hpp"
+#include "AsioExpress/ClientServer/DispatchStrategy.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Chooses which of a pool's connections gets the next message. The
+/// connections are numbered from zero and handed to the strategy by number
+/// while they are connected.
+///
+class ClientPool
+{
+public:
+  ClientPool(DispatchStrategyPointer strategy, unsigned int size);
+
+  void Connected(unsigned int index);
+
+  void Disconnected(unsigned int index);
+
+  ///
+  /// Chooses the connection for the next message. While none are connected
+  /// the connections take turns, so the message is held or failed just as
+  /// a single client would.
+  ///
+  unsigned int Select(std::string const & key);
+
+  void Completed(unsigned int index);
+
+  unsigned int GetSize() const;
+
+private:
+  boost::mutex                  m_mutex;
+  DispatchStrategyPointer       m_strategy;
+  unsigned int                  m_size;
+  unsigned int                  m_next;
+};
+
+typedef boost::shared_ptr<ClientPool> ClientPoolPointer;
+
+///
+/// Tells the pool a send on one of its connections has completed before
+/// completing it.
+///
+class ClientPoolSendHandler
+{
+public:
+  ClientPoolSendHandler(
+      ClientPoolPointer pool,
+      unsigned int index,
+      AsioExpress::CompletionHandler completionHandler);
+
+  void operator()(AsioExpress::Error error);
+
+private:
+  ClientPoolPointer                 m_pool;
+  unsigned int                      m_index;
+  AsioExpress::CompletionHandler    m_completionHandler;
+};
+
+///
+/// The event handler of one of the pool's connections. It keeps the pool
+/// up to date with the connection and passes the events on to the handler
+/// the connections share.
+///
+class ClientPoolEventHandler : public ClientEventHandler
+{
+public:
+  ClientPoolEventHandler(
+      ClientEventHandlerPointer eventHandler,
+      ClientPoolPointer pool,
+      unsigned int index);
+
+  virtual void ClientConnected(
+      ClientConnection connection);
+
+  virtual void ClientDisconnected(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual void AsyncProcessMessage(
+      ClientMessage message);
+
+  virtual AsioExpress::Error ConnectionError(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual AsioExpress::Error MessageError(
+      ClientMessage message,
+      AsioExpress::Error error);
+
+  virtual void ClientReconnecting(
+      ClientConnection connection,
+      unsigned int delayMilliseconds);
+
+private:
+  ClientEventHandlerPointer     m_eventHandler;
+  ClientPoolPointer             m_pool;
+  unsigned int                  m_index;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
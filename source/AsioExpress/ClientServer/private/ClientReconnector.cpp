@@ -0,0 +1,282 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Tcp/ErrorCodes.hpp"
+#include "AsioExpress/Timer/StandardTimer.hpp"
+#include "AsioExpress/ClientServer/private/ClientReconnector.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+ClientReconnector::ResendHandler::ResendHandler(
+    ClientReconnectorPointer reconnector,
+    PendingSend const & send) :
+  m_reconnector(reconnector),
+  m_send(send)
+{
+}
+
+void ClientReconnector::ResendHandler::operator()(AsioExpress::Error error)
+{
+  // Only a lost connection is worth another try; any other error, such as
+  // a send timeout or a message that is too large, would just recur.
+  if (!error || !IsConnectionLost(error))
+  {
+    m_send.completionHandler(error);
+    return;
+  }
+
+  // Posted, since the send may have failed while the reconnector is locked.
+  m_reconnector->m_ioService.post(boost::bind(
+    &ClientReconnector::SendFailed,
+    m_reconnector,
+    m_send,
+    error));
+}
+
+ClientReconnector::ClientReconnector(
+    boost::asio::io_service & ioService,
+    ReconnectPolicy const & policy,
+    ClientEventsPointer clientEvents,
+    SendFunction send,
+    ConnectFunction connect,
+    unsigned int seed) :
+  m_ioService(ioService),
+  m_policy(policy),
+  m_clientEvents(clientEvents),
+  m_send(send),
+  m_connect(connect),
+  m_timer(new StandardTimer(ioService)),
+  m_random(seed),
+  m_isRunning(false),
+  m_isConnected(false),
+  m_attempt(0)
+{
+  CHECK(policy.initialDelayMilliseconds > 0);
+  CHECK(policy.maxDelayMilliseconds >= policy.initialDelayMilliseconds);
+  CHECK(policy.maxSendAttempts > 0);
+}
+
+void ClientReconnector::Start()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_isRunning = true;
+  m_attempt = 0;
+}
+
+void ClientReconnector::Stop()
+{
+  PendingSendList pending;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_isRunning = false;
+    m_timer->Stop();
+    pending.swap(m_pending);
+  }
+
+  PendingSendList::const_iterator  it = pending.begin();
+  PendingSendList::const_iterator end = pending.end();
+  for (; it != end; ++it)
+  {
+    m_ioService.post(boost::asio::detail::bind_handler(
+      it->completionHandler,
+      AsioExpress::Error(boost::asio::error::operation_aborted)));
+  }
+}
+
+void ClientReconnector::AsyncSend(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  AsyncSend(PendingSend(buffer, completionHandler));
+}
+
+bool ClientReconnector::IsConnectionLost(AsioExpress::Error const & error)
+{
+  boost::system::error_code const ec(error.GetErrorCode());
+
+  return ec == Ipc::ErrorCode::Disconnected
+    || ec == Ipc::ErrorCode::LostConnection
+    || ec == Tcp::ErrorCode::LostConnection
+    || ec == boost::asio::error::eof
+    || ec == boost::asio::error::connection_reset
+    || ec == boost::asio::error::connection_aborted
+    || ec == boost::asio::error::operation_aborted
+    || ec == boost::asio::error::broken_pipe
+    || ec == boost::asio::error::not_connected;
+}
+
+void ClientReconnector::AsyncSend(PendingSend const & send)
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_isConnected)
+    {
+      Hold(send);
+      return;
+    }
+  }
+
+  if (!Send(send))
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    Hold(send);
+  }
+}
+
+AsioExpress::Error ClientReconnector::HandleConnected(
+  ClientConnection connection)
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_attempt = 0;
+
+    // The held messages go first, in the order they were sent. Sends are
+    // only let through directly once they are all on their way.
+    while (!m_pending.empty() && Send(m_pending.front()))
+      m_pending.pop_front();
+
+    // If the connection has already gone the rest wait for the next one.
+    m_isConnected = m_pending.empty();
+  }
+
+  return m_clientEvents->HandleConnected(connection);
+}
+
+void ClientReconnector::HandleDisconnected(
+  ClientConnection connection,
+  AsioExpress::Error error)
+{
+  m_clientEvents->HandleDisconnected(connection, error);
+
+  unsigned int delay = 0;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_isConnected = false;
+
+    if (!m_isRunning)
+      return;
+
+    delay = NextDelay();
+    m_timer->AsyncWait(delay, boost::bind(&ClientReconnector::TimerExpired, shared_from_this(), _1));
+  }
+
+  HandleReconnecting(connection, delay);
+}
+
+void ClientReconnector::HandleMessage(
+  ClientMessage message)
+{
+  m_clientEvents->HandleMessage(message);
+}
+
+AsioExpress::Error ClientReconnector::HandleMessageError(
+  ClientMessage message,
+  AsioExpress::Error error)
+{
+  return m_clientEvents->HandleMessageError(message, error);
+}
+
+void ClientReconnector::HandleReconnecting(
+  ClientConnection connection,
+  unsigned int delayMilliseconds)
+{
+  m_clientEvents->HandleReconnecting(connection, delayMilliseconds);
+}
+
+unsigned int ClientReconnector::GetBackoff() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return Backoff();
+}
+
+bool ClientReconnector::Send(PendingSend const & send)
+{
+  PendingSend attempt(send);
+  ++attempt.attempts;
+
+  return m_send(
+    send.buffer,
+    ResendHandler(shared_from_this(), attempt));
+}
+
+void ClientReconnector::Hold(PendingSend const & send)
+{
+  if (m_pending.size() >= m_policy.maxBufferedMessages)
+  {
+    m_ioService.post(boost::asio::detail::bind_handler(
+      send.completionHandler,
+      AsioExpress::Error(ErrorCode::MessagePortSendBufferFull)));
+    return;
+  }
+
+  m_pending.push_back(send);
+}
+
+void ClientReconnector::SendFailed(
+    PendingSend send,
+    AsioExpress::Error error)
+{
+  bool isRunning = false;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    isRunning = m_isRunning;
+  }
+
+  // Once the application has disconnected, or the message has used up its
+  // attempts, the failure is reported.
+  if (!isRunning || send.attempts >= m_policy.maxSendAttempts)
+  {
+    send.completionHandler(error);
+    return;
+  }
+
+  AsyncSend(send);
+}
+
+void ClientReconnector::TimerExpired(AsioExpress::Error error)
+{
+  if (error)
+    return;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_isRunning)
+      return;
+  }
+
+  m_connect();
+}
+
+unsigned int ClientReconnector::Backoff() const
+{
+  unsigned int backoff = m_policy.initialDelayMilliseconds;
+  for (unsigned int i = 0; i < m_attempt && backoff < m_policy.maxDelayMilliseconds; ++i)
+    backoff = std::min(backoff, m_policy.maxDelayMilliseconds / 2) * 2;
+
+  return std::min(backoff, m_policy.maxDelayMilliseconds);
+}
+
+unsigned int ClientReconnector::NextDelay()
+{
+  unsigned int backoff = Backoff();
+  if (backoff < m_policy.maxDelayMilliseconds)
+    ++m_attempt;
+
+  // Up to half the wait is left out at random.
+  unsigned int spread = backoff / 2;
+  return backoff - m_random() % (spread + 1);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,155 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <deque>
+
+#include <boost/asio.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/Timer/Timer.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/ClientServer/ReconnectPolicy.hpp"
+#include "AsioExpress/ClientServer/private/ClientEvents.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Reconnects a client that has lost its connection. It sits between the
+/// client and the application's events: when the client disconnects it
+/// waits out the backoff and connects again, and when the client connects
+/// it first sends the messages held while it was away.
+///
+/// A send that fails because the connection dropped is held and sent again
+/// after reconnecting, so a message may be delivered twice but is not lost
+/// while there is room to hold it and attempts remain. Any other send error
+/// is reported to the caller straight away.
+///
+class ClientReconnector :
+  public ClientEvents,
+  public boost::enable_shared_from_this<ClientReconnector>
+{
+public:
+  /// Sends on the current connection; returns false if there is none.
+  typedef boost::function<bool (DataBufferPointer, AsioExpress::CompletionHandler)> SendFunction;
+
+  typedef boost::function<void ()> ConnectFunction;
+
+  ClientReconnector(
+      boost::asio::io_service & ioService,
+      ReconnectPolicy const & policy,
+      ClientEventsPointer clientEvents,
+      SendFunction send,
+      ConnectFunction connect,
+      unsigned int seed);
+
+  /// Called when the application connects; reconnecting is enabled.
+  void Start();
+
+  ///
+  /// Called when the application disconnects. Reconnecting stops and the
+  /// held messages complete with an operation_aborted error.
+  ///
+  void Stop();
+
+  void AsyncSend(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual AsioExpress::Error HandleConnected(
+    ClientConnection connection);
+
+  virtual void HandleDisconnected(
+    ClientConnection connection,
+    AsioExpress::Error error);
+
+  virtual void HandleMessage(
+    ClientMessage message);
+
+  virtual AsioExpress::Error HandleMessageError(
+    ClientMessage message,
+    AsioExpress::Error error);
+
+  virtual void HandleReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds);
+
+  /// The wait before the next attempt, before any is left out.
+  unsigned int GetBackoff() const;
+
+private:
+  typedef boost::shared_ptr<ClientReconnector> ClientReconnectorPointer;
+
+  struct PendingSend
+  {
+    PendingSend(
+        DataBufferPointer buffer,
+        AsioExpress::CompletionHandler completionHandler) :
+      buffer(buffer),
+      completionHandler(completionHandler),
+      attempts(0)
+    {
+    }
+
+    DataBufferPointer                 buffer;
+    AsioExpress::CompletionHandler    completionHandler;
+    unsigned int                      attempts;
+  };
+
+  typedef std::deque<PendingSend> PendingSendList;
+
+  // Completes a send, or hands it back to be held if it failed.
+  class ResendHandler
+  {
+  public:
+    ResendHandler(
+        ClientReconnectorPointer reconnector,
+        PendingSend const & send);
+
+    void operator()(AsioExpress::Error error);
+
+  private:
+    ClientReconnectorPointer          m_reconnector;
+    PendingSend                       m_send;
+  };
+
+  ClientReconnector & operator=(ClientReconnector const &);
+
+  static bool IsConnectionLost(AsioExpress::Error const & error);
+
+  void AsyncSend(PendingSend const & send);
+  bool Send(PendingSend const & send);
+  void Hold(PendingSend const & send);
+  void SendFailed(PendingSend send, AsioExpress::Error error);
+  void TimerExpired(AsioExpress::Error error);
+
+  // These require the lock to be held.
+  unsigned int Backoff() const;
+  unsigned int NextDelay();
+
+  boost::asio::io_service &         m_ioService;
+  ReconnectPolicy                   m_policy;
+  ClientEventsPointer               m_clientEvents;
+  SendFunction                      m_send;
+  ConnectFunction                   m_connect;
+  TimerPointer                      m_timer;
+  mutable boost::mutex              m_mutex;
+  boost::random::mt19937            m_random;
+  bool                              m_isRunning;
+  bool                              m_isConnected;
+  unsigned int                      m_attempt;
+  PendingSendList                   m_pending;
+};
+
+typedef boost::shared_ptr<ClientReconnector> ClientReconnectorPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,586 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/Timer/StandardTimer.hpp"
+#include "AsioExpress/ClientServer/private/FailoverClient.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+namespace
+{
+  // The reply times the hedging delay is taken from.
+  std::size_t const MaxSamples = 128;
+  std::size_t const MinHedgeSamples = 20;
+
+  // The hedged requests whose second reply is still to be dropped.
+  std::size_t const MaxHedged = 1024;
+}
+
+FailoverClient::FailoverClient(boost::asio::io_service & ioService) :
+  m_ioService(ioService),
+  m_isHedging(false),
+  m_isRunning(false),
+  m_healthCheckMilliseconds(0),
+  m_healthCheckTimer(new StandardTimer(ioService)),
+  m_nextSample(0)
+{
+}
+
+void FailoverClient::AddEndPoint(ClientInterfacePointer client)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_endPoints.push_back(EndPoint(client));
+}
+
+void FailoverClient::SetReplyKey(ReplyKeyFunction replyKey)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_replyKey = replyKey;
+}
+
+void FailoverClient::SetHedging(bool isHedging)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_isHedging = isHedging;
+}
+
+void FailoverClient::Start(unsigned int healthCheckMilliseconds)
+{
+  CHECK(healthCheckMilliseconds > 0);
+
+  ClientList clients;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    CHECK(!m_endPoints.empty());
+
+    m_isRunning = true;
+    m_healthCheckMilliseconds = healthCheckMilliseconds;
+    clients = StartConnecting();
+    m_healthCheckTimer->AsyncWait(
+      m_healthCheckMilliseconds,
+      boost::bind(&FailoverClient::HealthCheck, shared_from_this(), _1));
+  }
+
+  for (std::size_t i = 0; i < clients.size(); ++i)
+    clients[i]->Connect();
+}
+
+void FailoverClient::Stop()
+{
+  RequestMap requests;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_isRunning = false;
+    m_healthCheckTimer->Stop();
+    requests.swap(m_requests);
+  }
+
+  RequestMap::const_iterator  it = requests.begin();
+  RequestMap::const_iterator end = requests.end();
+  for (; it != end; ++it)
+  {
+    if (it->second->hedgeTimer)
+      it->second->hedgeTimer->Stop();
+
+    m_ioService.post(boost::asio::detail::bind_handler(
+      it->second->completionHandler,
+      AsioExpress::Error(boost::asio::error::operation_aborted)));
+  }
+}
+
+void FailoverClient::AsyncSend(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  SendMessage(
+    buffer,
+    completionHandler,
+    IndexList(),
+    AsioExpress::Error(ErrorCode::MessagePortNoEndPoint));
+}
+
+void FailoverClient::AsyncRequest(
+    std::string const & key,
+    DataBufferPointer request,
+    DataBufferPointer reply,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  RequestPointer pending(new Request(request, reply, completionHandler));
+  SendList sends;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    CHECK(m_replyKey);
+    CHECK(m_requests.find(key) == m_requests.end());
+
+    if (!Attempt(pending, sends))
+    {
+      m_ioService.post(boost::asio::detail::bind_handler(
+        completionHandler,
+        AsioExpress::Error(ErrorCode::MessagePortNoEndPoint)));
+      return;
+    }
+
+    // A reply left over from an earlier request with the same key is no
+    // longer dropped; it would be taken for this one's.
+    m_hedged.erase(key);
+    m_requests[key] = pending;
+
+    unsigned int delay = m_isHedging ? HedgeDelay() : 0;
+    if (delay > 0)
+    {
+      pending->hedgeTimer.reset(new StandardTimer(m_ioService));
+      pending->hedgeTimer->AsyncWait(
+        delay,
+        boost::bind(&FailoverClient::Hedge, shared_from_this(), key, pending, _1));
+    }
+  }
+
+  SendRequest(key, pending, sends);
+}
+
+std::string FailoverClient::GetAddress() const
+{
+  ClientInterfacePointer client;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    int best = Best(IndexList());
+    if (best >= 0)
+      client = m_endPoints[best].client;
+  }
+
+  return client ? client->GetAddress() : std::string();
+}
+
+int FailoverClient::GetBest() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return Best(IndexList());
+}
+
+unsigned int FailoverClient::GetLatency(unsigned int index) const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  CHECK(index < m_endPoints.size());
+  return m_endPoints[index].latency;
+}
+
+unsigned int FailoverClient::GetHedgeDelay() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return HedgeDelay();
+}
+
+void FailoverClient::Connected(unsigned int index)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  CHECK(index < m_endPoints.size());
+
+  EndPoint & endPoint = m_endPoints[index];
+  if (endPoint.state == Connecting)
+    AddSample(index, Clock::now() - endPoint.connectStart, false);
+
+  endPoint.state = Up;
+}
+
+bool FailoverClient::Disconnected(
+    unsigned int index,
+    AsioExpress::Error error)
+{
+  typedef std::pair<std::string, RequestPointer> Resend;
+  std::vector<Resend> resends;
+  SendList sends;
+  bool wasConnected = false;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    CHECK(index < m_endPoints.size());
+
+    wasConnected = m_endPoints[index].state == Up;
+    m_endPoints[index].state = Down;
+
+    // Requests left waiting on nothing but this end point fail over now
+    // rather than when their sends complete.
+    RequestMap::iterator it = m_requests.begin();
+    while (it != m_requests.end())
+    {
+      RequestMap::iterator request = it++;
+      if (request->second->attempts.erase(index) == 0 || !request->second->attempts.empty())
+        continue;
+
+      std::size_t sent = sends.size();
+      Failover(request->first, request->second, error, sends);
+      if (sends.size() > sent)
+        resends.push_back(Resend(request->first, request->second));
+    }
+  }
+
+  for (std::size_t i = 0; i < resends.size(); ++i)
+    SendRequest(resends[i].first, resends[i].second, SendList(1, sends[i]));
+
+  return wasConnected;
+}
+
+bool FailoverClient::Replied(
+    unsigned int index,
+    DataBuffer const & message)
+{
+  ReplyKeyFunction replyKey;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    replyKey = m_replyKey;
+  }
+
+  if (!replyKey)
+    return false;
+
+  std::string key = replyKey(message);
+
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  RequestMap::iterator request = m_requests.find(key);
+  if (request == m_requests.end())
+  {
+    // The slower answer to a hedged request is dropped.
+    return m_hedged.erase(key) > 0;
+  }
+
+  RequestPointer pending = request->second;
+  AttemptMap::const_iterator attempt = pending->attempts.find(index);
+  if (attempt != pending->attempts.end())
+    AddSample(index, Clock::now() - attempt->second, true);
+
+  if (pending->attempts.size() > 1)
+    Remember(key);
+
+  *pending->reply = message;
+  Finish(key, pending, AsioExpress::Error());
+  return true;
+}
+
+void FailoverClient::SendMessage(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler,
+    IndexList tried,
+    AsioExpress::Error lastError)
+{
+  ClientInterfacePointer client;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    int best = Best(tried);
+    if (best >= 0)
+    {
+      tried.push_back(best);
+      client = m_endPoints[best].client;
+    }
+  }
+
+  if (!client)
+  {
+    m_ioService.post(boost::asio::detail::bind_handler(completionHandler, lastError));
+    return;
+  }
+
+  client->AsyncSend(
+    buffer,
+    boost::bind(&FailoverClient::MessageSent, shared_from_this(), buffer, completionHandler, tried, _1));
+}
+
+void FailoverClient::MessageSent(
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler,
+    IndexList tried,
+    AsioExpress::Error error)
+{
+  bool isRunning = false;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    isRunning = m_isRunning;
+  }
+
+  if (!error || !isRunning)
+  {
+    completionHandler(error);
+    return;
+  }
+
+  SendMessage(buffer, completionHandler, tried, error);
+}
+
+void FailoverClient::SendRequest(
+    std::string const & key,
+    RequestPointer request,
+    SendList const & sends)
+{
+  SendList::const_iterator  it = sends.begin();
+  SendList::const_iterator end = sends.end();
+  for (; it != end; ++it)
+  {
+    it->client->AsyncSend(
+      request->request,
+      boost::bind(&FailoverClient::RequestSent, shared_from_this(), key, request, it->index, _1));
+  }
+}
+
+void FailoverClient::RequestSent(
+    std::string key,
+    RequestPointer request,
+    unsigned int index,
+    AsioExpress::Error error)
+{
+  if (!error)
+    return;
+
+  SendList sends;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    RequestMap::iterator pending = m_requests.find(key);
+    if (pending == m_requests.end() || pending->second != request)
+      return;
+
+    if (request->attempts.erase(index) == 0 || !request->attempts.empty())
+      return;
+
+    Failover(key, request, error, sends);
+  }
+
+  SendRequest(key, request, sends);
+}
+
+void FailoverClient::Hedge(
+    std::string key,
+    RequestPointer request,
+    AsioExpress::Error error)
+{
+  if (error)
+    return;
+
+  SendList sends;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    RequestMap::iterator pending = m_requests.find(key);
+    if (pending == m_requests.end() || pending->second != request)
+      return;
+
+    Attempt(request, sends);
+  }
+
+  SendRequest(key, request, sends);
+}
+
+void FailoverClient::HealthCheck(AsioExpress::Error error)
+{
+  if (error)
+    return;
+
+  ClientList clients;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_isRunning)
+      return;
+
+    clients = StartConnecting();
+    m_healthCheckTimer->AsyncWait(
+      m_healthCheckMilliseconds,
+      boost::bind(&FailoverClient::HealthCheck, shared_from_this(), _1));
+  }
+
+  for (std::size_t i = 0; i < clients.size(); ++i)
+    clients[i]->Connect();
+}
+
+int FailoverClient::Best(IndexList const & excluded) const
+{
+  // Ties go to the end point listed first.
+  int best = -1;
+  for (std::size_t i = 0; i < m_endPoints.size(); ++i)
+  {
+    if (m_endPoints[i].state != Up)
+      continue;
+    if (std::find(excluded.begin(), excluded.end(), i) != excluded.end())
+      continue;
+    if (best < 0 || m_endPoints[i].latency < m_endPoints[best].latency)
+      best = static_cast<int>(i);
+  }
+
+  return best;
+}
+
+unsigned int FailoverClient::HedgeDelay() const
+{
+  if (m_samples.size() < MinHedgeSamples)
+    return 0;
+
+  std::vector<unsigned int> samples(m_samples);
+  std::vector<unsigned int>::iterator p95 = samples.begin() + samples.size() * 95 / 100;
+  std::nth_element(samples.begin(), p95, samples.end());
+
+  return std::max(1u, (*p95 + 999) / 1000);
+}
+
+bool FailoverClient::Attempt(
+    RequestPointer request,
+    SendList & sends)
+{
+  int best = Best(request->tried);
+  if (best < 0)
+    return false;
+
+  request->tried.push_back(best);
+  request->attempts[best] = Clock::now();
+  sends.push_back(Send(m_endPoints[best].client, best));
+  return true;
+}
+
+void FailoverClient::Failover(
+    std::string const & key,
+    RequestPointer request,
+    AsioExpress::Error error,
+    SendList & sends)
+{
+  if (!Attempt(request, sends))
+    Finish(key, request, error);
+}
+
+void FailoverClient::Finish(
+    std::string const & key,
+    RequestPointer request,
+    AsioExpress::Error error)
+{
+  if (request->hedgeTimer)
+    request->hedgeTimer->Stop();
+
+  m_requests.erase(key);
+  m_ioService.post(boost::asio::detail::bind_handler(request->completionHandler, error));
+}
+
+void FailoverClient::Remember(std::string const & key)
+{
+  if (!m_hedged.insert(key).second)
+    return;
+
+  m_hedgedOrder.push_back(key);
+  while (m_hedgedOrder.size() > MaxHedged)
+  {
+    m_hedged.erase(m_hedgedOrder.front());
+    m_hedgedOrder.pop_front();
+  }
+}
+
+FailoverClient::ClientList FailoverClient::StartConnecting()
+{
+  ClientList clients;
+  for (std::size_t i = 0; i < m_endPoints.size(); ++i)
+  {
+    EndPoint & endPoint = m_endPoints[i];
+    if (endPoint.state != Down)
+      continue;
+
+    endPoint.state = Connecting;
+    endPoint.connectStart = Clock::now();
+    clients.push_back(endPoint.client);
+  }
+
+  return clients;
+}
+
+void FailoverClient::AddSample(
+    unsigned int index,
+    Clock::duration elapsed,
+    bool isReply)
+{
+  unsigned int sample = static_cast<unsigned int>(std::max<boost::int_least64_t>(1,
+    boost::chrono::duration_cast<boost::chrono::microseconds>(elapsed).count()));
+
+  // Smoothed as TCP smooths its round trip time.
+  EndPoint & endPoint = m_endPoints[index];
+  if (endPoint.latency == 0)
+    endPoint.latency = sample;
+  else
+    endPoint.latency = endPoint.latency - endPoint.latency / 8 + sample / 8;
+
+  if (!isReply)
+    return;
+
+  if (m_samples.size() < MaxSamples)
+    m_samples.push_back(sample);
+  else
+    m_samples[m_nextSample] = sample;
+  m_nextSample = (m_nextSample + 1) % MaxSamples;
+}
+
+FailoverEventHandler::FailoverEventHandler(
+    ClientEventHandlerPointer eventHandler,
+    FailoverClientPointer failoverClient,
+    unsigned int index) :
+  m_eventHandler(eventHandler),
+  m_failoverClient(failoverClient),
+  m_index(index)
+{
+}
+
+void FailoverEventHandler::ClientConnected(
+    ClientConnection connection)
+{
+  FailoverClientPointer failoverClient = m_failoverClient.lock();
+  if (failoverClient)
+    failoverClient->Connected(m_index);
+
+  m_eventHandler->ClientConnected(connection);
+}
+
+void FailoverEventHandler::ClientDisconnected(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  FailoverClientPointer failoverClient = m_failoverClient.lock();
+  if (failoverClient && !failoverClient->Disconnected(m_index, error))
+    return;
+
+  m_eventHandler->ClientDisconnected(connection, error);
+}
+
+void FailoverEventHandler::AsyncProcessMessage(
+    ClientMessage message)
+{
+  FailoverClientPointer failoverClient = m_failoverClient.lock();
+  if (failoverClient && failoverClient->Replied(m_index, *message.GetDataBuffer()))
+  {
+    message.CallCompletionHandler(AsioExpress::Error());
+    return;
+  }
+
+  m_eventHandler->AsyncProcessMessage(message);
+}
+
+AsioExpress::Error FailoverEventHandler::ConnectionError(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->ConnectionError(connection, error);
+}
+
+AsioExpress::Error FailoverEventHandler::MessageError(
+    ClientMessage message,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->MessageError(message, error);
+}
+
+void FailoverEventHandler::ClientReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds)
+{
+  m_eventHandler->ClientReconnecting(connection, delayMilliseconds);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
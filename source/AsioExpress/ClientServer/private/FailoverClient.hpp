@@ -0,0 +1,262 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/chrono.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/Timer/Timer.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/ClientServer/ClientEventHandler.hpp"
+#include "AsioExpress/ClientServer/ClientInterface.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Sends through whichever of several equivalent end points answers
+/// fastest. The end points that are not connected are tried again at each
+/// health check, and a message whose connection fails is sent again to the
+/// next best end point.
+///
+/// Requests are matched to their replies by a key the application takes
+/// from each message. With hedging on, a request that has had no reply
+/// within the 95th percentile of the replies seen so far is also sent to
+/// the next best end point, and the first reply to arrive is taken.
+///
+class FailoverClient : public boost::enable_shared_from_this<FailoverClient>
+{
+public:
+  typedef boost::function<std::string (DataBuffer const &)> ReplyKeyFunction;
+
+  explicit FailoverClient(boost::asio::io_service & ioService);
+
+  /// Adds the client of the next end point. Call this before Start().
+  void AddEndPoint(ClientInterfacePointer client);
+
+  void SetReplyKey(ReplyKeyFunction replyKey);
+
+  void SetHedging(bool isHedging);
+
+  /// Connects the end points and checks them at the given interval.
+  void Start(unsigned int healthCheckMilliseconds);
+
+  /// Stops the health checks; requests waiting for a reply are aborted.
+  void Stop();
+
+  void AsyncSend(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends a request and completes once the message with the same reply
+  /// key arrives, having copied it into the reply buffer.
+  ///
+  void AsyncRequest(
+      std::string const & key,
+      DataBufferPointer request,
+      DataBufferPointer reply,
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Gets the address of the best end point, if any is connected.
+  std::string GetAddress() const;
+
+  /// Gets the best connected end point, or -1 if there are none.
+  int GetBest() const;
+
+  /// Gets the end point's smoothed latency in microseconds.
+  unsigned int GetLatency(unsigned int index) const;
+
+  /// Gets the wait before a request is hedged, or zero until enough
+  /// replies have been seen.
+  unsigned int GetHedgeDelay() const;
+
+  void Connected(unsigned int index);
+
+  /// Returns false if the end point had not connected.
+  bool Disconnected(unsigned int index, AsioExpress::Error error);
+
+  /// Returns true if the message was the reply to a request.
+  bool Replied(unsigned int index, DataBuffer const & message);
+
+private:
+  typedef boost::chrono::steady_clock Clock;
+
+  enum State
+  {
+    Down,
+    Connecting,
+    Up
+  };
+
+  struct EndPoint
+  {
+    explicit EndPoint(ClientInterfacePointer client) :
+      client(client),
+      state(Down),
+      latency(0)
+    {
+    }
+
+    ClientInterfacePointer    client;
+    State                     state;
+    Clock::time_point         connectStart;
+    unsigned int              latency;
+  };
+
+  typedef std::vector<EndPoint> EndPointList;
+  typedef std::vector<ClientInterfacePointer> ClientList;
+  typedef std::vector<unsigned int> IndexList;
+  typedef std::map<unsigned int, Clock::time_point> AttemptMap;
+
+  struct Request
+  {
+    Request(
+        DataBufferPointer request,
+        DataBufferPointer reply,
+        AsioExpress::CompletionHandler completionHandler) :
+      request(request),
+      reply(reply),
+      completionHandler(completionHandler)
+    {
+    }
+
+    DataBufferPointer                 request;
+    DataBufferPointer                 reply;
+    AsioExpress::CompletionHandler    completionHandler;
+    IndexList                         tried;
+    AttemptMap                        attempts;
+    TimerPointer                      hedgeTimer;
+  };
+
+  typedef boost::shared_ptr<Request> RequestPointer;
+  typedef std::map<std::string, RequestPointer> RequestMap;
+
+  struct Send
+  {
+    Send(ClientInterfacePointer client, unsigned int index) :
+      client(client),
+      index(index)
+    {
+    }
+
+    ClientInterfacePointer    client;
+    unsigned int              index;
+  };
+
+  typedef std::vector<Send> SendList;
+
+  FailoverClient & operator=(FailoverClient const &);
+
+  void SendMessage(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler,
+      IndexList tried,
+      AsioExpress::Error lastError);
+
+  void MessageSent(
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler,
+      IndexList tried,
+      AsioExpress::Error error);
+
+  void SendRequest(
+      std::string const & key,
+      RequestPointer request,
+      SendList const & sends);
+
+  void RequestSent(
+      std::string key,
+      RequestPointer request,
+      unsigned int index,
+      AsioExpress::Error error);
+
+  void Hedge(std::string key, RequestPointer request, AsioExpress::Error error);
+
+  void HealthCheck(AsioExpress::Error error);
+
+  // These require the lock to be held.
+  int Best(IndexList const & excluded) const;
+  unsigned int HedgeDelay() const;
+  bool Attempt(RequestPointer request, SendList & sends);
+  void Failover(std::string const & key, RequestPointer request, AsioExpress::Error error, SendList & sends);
+  void Finish(std::string const & key, RequestPointer request, AsioExpress::Error error);
+  void Remember(std::string const & key);
+  ClientList StartConnecting();
+  void AddSample(unsigned int index, Clock::duration elapsed, bool isReply);
+
+  boost::asio::io_service &           m_ioService;
+  mutable boost::mutex                m_mutex;
+  EndPointList                        m_endPoints;
+  ReplyKeyFunction                    m_replyKey;
+  bool                                m_isHedging;
+  bool                                m_isRunning;
+  unsigned int                        m_healthCheckMilliseconds;
+  TimerPointer                        m_healthCheckTimer;
+  RequestMap                          m_requests;
+  std::vector<unsigned int>           m_samples;
+  std::size_t                         m_nextSample;
+  std::set<std::string>               m_hedged;
+  std::deque<std::string>             m_hedgedOrder;
+};
+
+typedef boost::shared_ptr<FailoverClient> FailoverClientPointer;
+
+///
+/// The event handler of one of the end points. Replies to requests are
+/// taken by the failover client; the other events are passed on to the
+/// handler the end points share, except that the disconnects of health
+/// checks that could not connect are left out.
+///
+class FailoverEventHandler : public ClientEventHandler
+{
+public:
+  FailoverEventHandler(
+      ClientEventHandlerPointer eventHandler,
+      FailoverClientPointer failoverClient,
+      unsigned int index);
+
+  virtual void ClientConnected(
+      ClientConnection connection);
+
+  virtual void ClientDisconnected(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual void AsyncProcessMessage(
+      ClientMessage message);
+
+  virtual AsioExpress::Error ConnectionError(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual AsioExpress::Error MessageError(
+      ClientMessage message,
+      AsioExpress::Error error);
+
+  virtual void ClientReconnecting(
+      ClientConnection connection,
+      unsigned int delayMilliseconds);
+
+private:
+  ClientEventHandlerPointer             m_eventHandler;
+  boost::weak_ptr<FailoverClient>       m_failoverClient;
+  unsigned int                          m_index;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,200 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include "AsioExpressError/Check.hpp"
+#include "AsioExpress/ClientServer/private/FairScheduler.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+FairScheduler::FairScheduler(
+    boost::asio::io_service & ioService,
+    unsigned int concurrency,
+    unsigned int quantum) :
+  m_ioService(ioService),
+  m_concurrency(concurrency),
+  m_quantum(quantum),
+  m_isStopped(false),
+  m_running(0),
+  m_waiting(0)
+{
+  CHECK(concurrency > 0);
+  CHECK(quantum > 0);
+}
+
+void FairScheduler::Start()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_isStopped = false;
+}
+
+void FairScheduler::Stop()
+{
+  HandlerList aborted;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    m_isStopped = true;
+
+    FlowMap::iterator  it = m_flows.begin();
+    FlowMap::iterator end = m_flows.end();
+    for (; it != end; ++it)
+    {
+      std::deque<Waiter>::const_iterator  waiter = it->second.waiters.begin();
+      std::deque<Waiter>::const_iterator waiters = it->second.waiters.end();
+      for (; waiter != waiters; ++waiter)
+        aborted.push_back(waiter->completionHandler);
+    }
+
+    m_flows.clear();
+    m_active.clear();
+    m_waiting = 0;
+  }
+
+  Post(aborted, AsioExpress::Error(boost::asio::error::operation_aborted));
+}
+
+void FairScheduler::SetWeight(MessagePortId id, unsigned int weight)
+{
+  CHECK(weight > 0);
+
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  if (weight == DefaultWeight)
+    m_weights.erase(id);
+  else
+    m_weights[id] = weight;
+}
+
+unsigned int FairScheduler::GetWeight(MessagePortId id) const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return FindWeight(id);
+}
+
+void FairScheduler::AsyncWaitForTurn(
+    MessagePortId id,
+    std::size_t size,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  HandlerList ready;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_isStopped)
+    {
+      ready.push_back(completionHandler);
+    }
+    else
+    {
+      Flow & flow = m_flows[id];
+      if (flow.waiters.empty())
+        m_active.push_back(id);
+
+      // Every message costs something, so a turn always ends.
+      flow.waiters.push_back(Waiter(std::max<std::size_t>(size, 1), completionHandler));
+      ++m_waiting;
+
+      Dispatch(ready);
+      Post(ready, AsioExpress::Error());
+      return;
+    }
+  }
+
+  Post(ready, AsioExpress::Error(boost::asio::error::operation_aborted));
+}
+
+void FairScheduler::EndTurn()
+{
+  HandlerList ready;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_running > 0)
+      --m_running;
+
+    Dispatch(ready);
+  }
+
+  Post(ready, AsioExpress::Error());
+}
+
+unsigned int FairScheduler::GetWaitingMessages() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_waiting;
+}
+
+void FairScheduler::Connected(MessagePortId)
+{
+}
+
+void FairScheduler::Disconnected(MessagePortId id)
+{
+  // Messages still waiting keep their turns; only the weight goes.
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_weights.erase(id);
+}
+
+void FairScheduler::Dispatch(HandlerList & ready)
+{
+  while (m_running < m_concurrency && !m_active.empty())
+  {
+    MessagePortId id = m_active.front();
+    Flow & flow = m_flows[id];
+
+    if (!flow.isInTurn)
+    {
+      flow.deficit += static_cast<boost::uint64_t>(m_quantum) * FindWeight(id);
+      flow.isInTurn = true;
+    }
+
+    Waiter & next = flow.waiters.front();
+    if (next.size > flow.deficit)
+    {
+      // The turn is over; what is left of the allowance is kept for the
+      // connection's next turn.
+      flow.isInTurn = false;
+      m_active.pop_front();
+      m_active.push_back(id);
+      continue;
+    }
+
+    flow.deficit -= next.size;
+    ready.push_back(next.completionHandler);
+    flow.waiters.pop_front();
+    --m_waiting;
+    ++m_running;
+
+    if (flow.waiters.empty())
+    {
+      m_active.pop_front();
+      m_flows.erase(id);
+    }
+  }
+}
+
+unsigned int FairScheduler::FindWeight(MessagePortId id) const
+{
+  WeightMap::const_iterator weight = m_weights.find(id);
+  if (weight == m_weights.end())
+    return DefaultWeight;
+  return weight->second;
+}
+
+void FairScheduler::Post(HandlerList const & ready, AsioExpress::Error error)
+{
+  HandlerList::const_iterator  it = ready.begin();
+  HandlerList::const_iterator end = ready.end();
+  for (; it != end; ++it)
+    m_ioService.post(boost::asio::detail::bind_handler(*it, error));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
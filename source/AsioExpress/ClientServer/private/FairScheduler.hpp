@@ -0,0 +1,131 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/ClientServer/ConnectionListener.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Shares a server's event handler among its connections by deficit round
+/// robin. Up to the concurrency given messages are in the handler at once
+/// and the rest wait with their connection. The connections with messages
+/// waiting take turns; each turn adds the connection's weight times the
+/// quantum to its allowance, and it passes its messages to the handler
+/// while their sizes fit the allowance. A connection sending many messages
+/// thus gets its share and no more, and one sending few waits at most a
+/// round for its turn. A connection's allowance is dropped once it has
+/// nothing waiting, so it cannot be saved up.
+///
+class FairScheduler : public ConnectionListener
+{
+public:
+  enum { DefaultWeight = 1 };
+
+  FairScheduler(
+      boost::asio::io_service & ioService,
+      unsigned int concurrency,
+      unsigned int quantum);
+
+  void Start();
+
+  /// Aborts the messages waiting for their turn.
+  void Stop();
+
+  /// Sets the connection's share of the handler; the default is one.
+  void SetWeight(MessagePortId id, unsigned int weight);
+
+  unsigned int GetWeight(MessagePortId id) const;
+
+  ///
+  /// Calls the handler, through the io_service, when it is the message's
+  /// turn in the event handler. The handler gets operation_aborted if the
+  /// scheduler is stopped first.
+  ///
+  void AsyncWaitForTurn(
+      MessagePortId id,
+      std::size_t size,
+      AsioExpress::CompletionHandler completionHandler);
+
+  /// Ends a message's turn once the event handler has completed it.
+  void EndTurn();
+
+  /// Gets the number of messages waiting for their turn.
+  unsigned int GetWaitingMessages() const;
+
+  virtual void Connected(MessagePortId id);
+
+  virtual void Disconnected(MessagePortId id);
+
+private:
+  typedef std::vector<AsioExpress::CompletionHandler> HandlerList;
+
+  struct Waiter
+  {
+    Waiter(
+        std::size_t size,
+        AsioExpress::CompletionHandler completionHandler) :
+      size(size),
+      completionHandler(completionHandler)
+    {
+    }
+
+    std::size_t                       size;
+    AsioExpress::CompletionHandler    completionHandler;
+  };
+
+  struct Flow
+  {
+    Flow() :
+      deficit(0),
+      isInTurn(false)
+    {
+    }
+
+    std::deque<Waiter>    waiters;
+    boost::uint64_t       deficit;
+    bool                  isInTurn;
+  };
+
+  typedef boost::unordered_map<MessagePortId, Flow> FlowMap;
+  typedef boost::unordered_map<MessagePortId, unsigned int> WeightMap;
+
+  FairScheduler(FairScheduler const &);
+  FairScheduler & operator=(FairScheduler const &);
+
+  // These require the lock to be held.
+  void Dispatch(HandlerList & ready);
+  unsigned int FindWeight(MessagePortId id) const;
+
+  void Post(HandlerList const & ready, AsioExpress::Error error);
+
+  boost::asio::io_service &     m_ioService;
+  mutable boost::mutex          m_mutex;
+  unsigned int                  m_concurrency;
+  unsigned int                  m_quantum;
+  bool                          m_isStopped;
+  unsigned int                  m_running;
+  unsigned int                  m_waiting;
+  FlowMap                       m_flows;
+  std::deque<MessagePortId>     m_active;
+  WeightMap                     m_weights;
+};
+
+typedef boost::shared_ptr<FairScheduler> FairSchedulerPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -7,8 +7,12 @@
 
 #include <string>
 
+#include <ctime>
+
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 
@@ -17,7 +21,7 @@
 #include "AsioExpress/ClientServer/private/ClientEvents.hpp"
 #include "AsioExpress/ClientServer/private/MessagePortManager.hpp"
 #include "AsioExpress/ClientServer/private/Client.hpp"
-#include "AsioExpress/ClientServer/private/ClientEventsImpl.hpp"
+#include "AsioExpress/ClientServer/private/ClientReconnector.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -33,23 +37,9 @@ public:
   InternalMessagePortClient(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ClientEventHandler * eventHandler);
+    ClientEventsPointer clientEvents);
 
-//  virtual void Connect();
-virtual void Connect()
-{
-  if (m_isShutDown)
-    return;
-
-  ClientType client(
-    m_ioService, 
-    this->shared_from_this(),
-    m_clientEvents,
-    m_endPoint, 
-    m_messagePortManager);
-  
-  client();
-}
+  virtual void Connect();
 
   virtual void Disconnect();
 
@@ -60,21 +50,36 @@ virtual void Connect()
       AsioExpress::CompletionHandler completionHandler);
 
   virtual std::string GetAddress() const;
+
+  virtual bool GetStatistics(PortStatistics & statistics) const;
+
+  void SetMessageWindow(unsigned int size, bool isOrdered);
+
+  void SetReconnectPolicy(ReconnectPolicy const & policy);
  
 private:
   typedef MessagePortManager<MessagePort> MessagePortManagerType;
   typedef boost::shared_ptr<MessagePortManagerType> MessagePortManagerPointer;
   typedef Client<MessagePort> ClientType;
 
+  typedef boost::weak_ptr<InternalMessagePortClient> WeakPointer;
+
   InternalMessagePortClient & operator=(InternalMessagePortClient const &);
 
+  void ConnectClient();
+
+  static void Reconnect(WeakPointer client);
+
   void AsyncSendCompleted(AsioExpress::Error error);
 
   boost::asio::io_service &           m_ioService;
   EndPointType                        m_endPoint;
   MessagePortManagerPointer           m_messagePortManager;
   ClientEventsPointer                 m_clientEvents;
+  ClientReconnectorPointer            m_reconnector;
   bool                                m_isShutDown;
+  unsigned int                        m_windowSize;
+  bool                                m_isOrderedWindow;
 };
 
 WIN_DISABLE_WARNINGS_BEGIN(4355)
@@ -82,35 +87,37 @@ template<typename MessagePort>
 InternalMessagePortClient<MessagePort>::InternalMessagePortClient(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ClientEventHandler * eventHandler) :
+    ClientEventsPointer clientEvents) :
   m_ioService(ioService),
   m_endPoint(endPoint),
   m_messagePortManager(new MessagePortManagerType(ioService)),
-  m_clientEvents(new ClientEventsImpl(eventHandler)),
-  m_isShutDown(false)
+  m_clientEvents(clientEvents),
+  m_isShutDown(false),
+  m_windowSize(1),
+  m_isOrderedWindow(false)
 {
 }
 WIN_DISABLE_WARNINGS_END
 
-//template<typename MessagePort>
-//void InternalMessagePortClient<MessagePort>::Connect()
-//{
-//  if (m_isShutDown)
-//    return;
-//
-//  ClientType client(
-//    m_ioService, 
-//    shared_from_this(),
-//    m_clientEvents,
-//    m_endPoint, 
-//    m_messagePortManager);
-//  
-//  client();
-//}
+template<typename MessagePort>
+void InternalMessagePortClient<MessagePort>::Connect()
+{
+  if (m_isShutDown)
+    return;
+
+  if (m_reconnector)
+    m_reconnector->Start();
+
+  ConnectClient();
+}
 
 template<typename MessagePort>
 void InternalMessagePortClient<MessagePort>::Disconnect()
 {
+  // A disconnect asked for by the application is not reconnected.
+  if (m_reconnector)
+    m_reconnector->Stop();
+
   // Message port manager should only contain one connection.
   m_messagePortManager->RemoveAll();
 }
@@ -127,7 +134,10 @@ void InternalMessagePortClient<MessagePort>::AsyncSend(
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
 {
-  m_messagePortManager->AsyncSend(buffer, completionHandler);
+  if (m_reconnector && !m_isShutDown)
+    m_reconnector->AsyncSend(buffer, completionHandler);
+  else
+    m_messagePortManager->AsyncSend(buffer, completionHandler);
 }
 
 template<typename MessagePort>
@@ -136,5 +146,67 @@ std::string InternalMessagePortClient<MessagePort>::GetAddress() const
     return m_messagePortManager->GetAddress();
 }
 
+template<typename MessagePort>
+bool InternalMessagePortClient<MessagePort>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  return m_messagePortManager->GetStatistics(statistics);
+}
+
+template<typename MessagePort>
+void InternalMessagePortClient<MessagePort>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  CHECK(size > 0);
+  m_windowSize = size;
+  m_isOrderedWindow = isOrdered;
+}
+
+template<typename MessagePort>
+void InternalMessagePortClient<MessagePort>::SetReconnectPolicy(
+    ReconnectPolicy const & policy)
+{
+  // Each client draws its own waits so that clients dropped together
+  // spread out their reconnects.
+  unsigned int seed = static_cast<unsigned int>(std::time(0)) ^ 
+    static_cast<unsigned int>(reinterpret_cast<std::size_t>(this));
+
+  m_reconnector.reset(new ClientReconnector(
+    m_ioService,
+    policy,
+    m_clientEvents,
+    boost::bind(&MessagePortManagerType::TryAsyncSend, m_messagePortManager, _1, _2),
+    boost::bind(&InternalMessagePortClient::Reconnect, WeakPointer(this->shared_from_this())),
+    seed));
+}
+
+template<typename MessagePort>
+void InternalMessagePortClient<MessagePort>::ConnectClient()
+{
+  ClientEventsPointer clientEvents = m_clientEvents;
+  if (m_reconnector)
+    clientEvents = m_reconnector;
+
+  ClientType client(
+    m_ioService, 
+    this->shared_from_this(),
+    clientEvents,
+    m_endPoint, 
+    m_messagePortManager,
+    m_windowSize,
+    m_isOrderedWindow);
+  
+  client();
+}
+
+template<typename MessagePort>
+void InternalMessagePortClient<MessagePort>::Reconnect(WeakPointer client)
+{
+  boost::shared_ptr<InternalMessagePortClient> lockedClient = client.lock();
+  if (lockedClient && !lockedClient->m_isShutDown)
+    lockedClient->ConnectClient();
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
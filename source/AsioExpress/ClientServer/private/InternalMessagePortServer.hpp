@@ -9,15 +9,19 @@
 
 #include <boost/asio.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 
 #include "AsioExpress/ClientServer/ServerEventHandler.hpp"
 #include "AsioExpress/ClientServer/ClientInterface.hpp"
 #include "AsioExpress/ClientServer/private/ServerEvents.hpp"
+#include "AsioExpress/ClientServer/private/AdmissionControl.hpp"
+#include "AsioExpress/ClientServer/private/FairScheduler.hpp"
+#include "AsioExpress/ClientServer/private/TopicIndex.hpp"
 #include "AsioExpress/ClientServer/private/MessagePortManager.hpp"
 #include "AsioExpress/ClientServer/private/Server.hpp"
-#include "AsioExpress/ClientServer/private/ServerEventsImpl.hpp"
+#include "AsioExpress/ClientServer/private/ServerDrain.hpp"
 #include "AsioExpress/ClientServer/private/BroadcastProcessor.hpp"
 
 namespace AsioExpress {
@@ -34,12 +38,17 @@ public:
   InternalMessagePortServer(
     boost::asio::io_service& ioService,
     EndPointType endPoint,
-    ServerEventHandler * eventHandler);
+    ServerEventsPointer serverEvents);
 
   virtual void Start();
 
   virtual void Stop();
 
+  void AsyncStop(
+      unsigned int deadlineMilliseconds,
+      DrainResultPointer result,
+      AsioExpress::CompletionHandler completionHandler);
+
   virtual void GetIds(MessagePortIdList & list) const;
 
   virtual void AsyncSend(
@@ -51,8 +60,56 @@ public:
       DataBufferPointer buffer, 
       AsioExpress::CompletionHandler completionHandler);
 
+  virtual void AsyncBroadcast(
+      DataBufferPointer buffer, 
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      AsioExpress::CompletionHandler completionHandler);
+
+  virtual void AsyncSendMany(
+      SendList const & list, 
+      SendManyResultPointer result,
+      AsioExpress::CompletionHandler completionHandler);
+
   virtual std::string GetAddress(MessagePortId id) const;
 
+  virtual bool GetStatistics(
+      MessagePortId id, 
+      PortStatistics & statistics) const;
+
+  virtual void AddListener(ConnectionListenerPointer listener);
+
+  bool Subscribe(MessagePortId id, std::string const & topic);
+
+  bool Unsubscribe(MessagePortId id, std::string const & topic);
+
+  void AsyncPublish(
+      std::string const & topic,
+      DataBufferPointer buffer, 
+      BroadcastResultPointer result,
+      unsigned int timeoutMilliseconds,
+      AsioExpress::CompletionHandler completionHandler);
+
+  std::size_t GetTopicCount() const;
+
+  void EnableTopics();
+
+  void SetMessageWindow(unsigned int size, bool isOrdered);
+
+  void SetAdmissionPolicy(AdmissionPolicy const & policy);
+
+  AdmissionControlPointer GetAdmissionControl() const;
+
+  void SetFairScheduling(unsigned int concurrency, unsigned int quantum);
+
+  void SetConnectionWeight(MessagePortId id, unsigned int weight);
+
+  void SetBackpressure(BackpressurePointer backpressure);
+
 private:
   typedef boost::shared_ptr<MessagePortAcceptor> MessagePortAcceptorPointer;
   typedef typename MessagePortAcceptor::MessagePortType MessagePortType;
@@ -62,11 +119,23 @@ private:
 
   InternalMessagePortServer & operator=(InternalMessagePortServer const &);
 
+  MessagePortAcceptorPointer GetAcceptor() const;
+
+  void CloseAcceptor();
+
   boost::asio::io_service &           m_ioService;
   EndPointType                        m_endPoint;
   MessagePortManagerPointer           m_messagePortManager;
+  mutable boost::mutex                m_acceptorMutex;
   MessagePortAcceptorPointer          m_acceptor;
+  TopicIndexPointer                   m_topics;
   ServerEventsPointer                 m_serverEvents;
+  AdmissionControlPointer             m_admission;
+  FairSchedulerPointer                m_scheduler;
+  BackpressurePointer                 m_backpressure;
+  unsigned int                        m_windowSize;
+  bool                                m_isOrderedWindow;
+  bool                                m_isTopicControlEnabled;
 };
 
 WIN_DISABLE_WARNINGS_BEGIN(4355)
@@ -74,26 +143,45 @@ template<typename MessagePortAcceptor>
 InternalMessagePortServer<MessagePortAcceptor>::InternalMessagePortServer(
     boost::asio::io_service & ioService,
     EndPointType endPoint,
-    ServerEventHandler * eventHandler) :
+    ServerEventsPointer serverEvents) :
   m_ioService(ioService),
   m_endPoint(endPoint),
   m_messagePortManager(new MessagePortManagerType(ioService)),
-  m_serverEvents(new ServerEventsImpl(eventHandler))
+  m_topics(new TopicIndex),
+  m_serverEvents(serverEvents),
+  m_admission(new AdmissionControl(ioService)),
+  m_windowSize(1),
+  m_isOrderedWindow(false),
+  m_isTopicControlEnabled(false)
 {
+  m_messagePortManager->AddListener(m_topics);
 }
 WIN_DISABLE_WARNINGS_END
 
 template<typename MessagePortAcceptor>
 void InternalMessagePortServer<MessagePortAcceptor>::Start()
 {
-  m_acceptor.reset(new MessagePortAcceptor(m_ioService, m_endPoint));
+  MessagePortAcceptorPointer acceptor(new MessagePortAcceptor(m_ioService, m_endPoint));
+  {
+    boost::mutex::scoped_lock lock(m_acceptorMutex);
+    m_acceptor = acceptor;
+  }
+
+  m_admission->Start();
+  if (m_scheduler)
+    m_scheduler->Start();
 
   ServerType server(
     m_ioService,
     this->shared_from_this(),
     m_serverEvents,
-    m_acceptor, 
-    m_messagePortManager);
+    acceptor, 
+    m_messagePortManager,
+    m_admission,
+    m_scheduler,
+    m_backpressure,
+    m_windowSize,
+    m_isOrderedWindow);
 
   server();
 }
@@ -101,12 +189,34 @@ void InternalMessagePortServer<MessagePortAcceptor>::Start()
 template<typename MessagePortAcceptor>
 void InternalMessagePortServer<MessagePortAcceptor>::Stop()
 {
+  m_admission->Stop();
+  if (m_scheduler)
+    m_scheduler->Stop();
+  if (m_backpressure)
+    m_backpressure->Cancel();
   m_messagePortManager->RemoveAll();
-  if (m_acceptor) 
-  {
-    m_acceptor->Close();
-    m_acceptor.reset();
-  }
+  CloseAcceptor();
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AsyncStop(
+    unsigned int deadlineMilliseconds,
+    DrainResultPointer result,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_admission->Stop();
+  CloseAcceptor();
+
+  ServerDrain<MessagePortManagerPointer> drain(
+    m_ioService,
+    m_messagePortManager,
+    m_admission,
+    m_scheduler,
+    m_backpressure,
+    deadlineMilliseconds,
+    result,
+    completionHandler);
+  drain();
 }
 
 template<typename MessagePortAcceptor>
@@ -129,18 +239,55 @@ template<typename MessagePortAcceptor>
 void InternalMessagePortServer<MessagePortAcceptor>::AsyncBroadcast(
     DataBufferPointer buffer, 
     AsioExpress::CompletionHandler completionHandler)
+{
+  AsyncBroadcast(buffer, BroadcastResultPointer(), 0, completionHandler);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AsyncBroadcast(
+    DataBufferPointer buffer, 
+    BroadcastResultPointer result,
+    unsigned int timeoutMilliseconds,
+    AsioExpress::CompletionHandler completionHandler)
 {
   MessagePortIdList idList;
-  m_messagePortManager->GetIds(idList);
+
+  // Transports with a broadcast channel deliver the message to all their 
+  // subscribed ports with a single write. The rest get their own copy.
+  MessagePortAcceptorPointer acceptor = GetAcceptor();
+  if (acceptor && acceptor->PublishBroadcast(buffer))
+    m_messagePortManager->GetUnsubscribedIds(idList);
+  else
+    m_messagePortManager->GetIds(idList);
+
   BroadcastProcessor proc(
     m_ioService,
     m_messagePortManager, 
     idList, 
     buffer, 
+    result,
+    timeoutMilliseconds,
     completionHandler);
   proc();
 }
 
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AsyncSendMany(
+    SendList const & list, 
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_messagePortManager->AsyncSendMany(list, SendManyResultPointer(), completionHandler);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AsyncSendMany(
+    SendList const & list, 
+    SendManyResultPointer result,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  m_messagePortManager->AsyncSendMany(list, result, completionHandler);
+}
+
 template<typename MessagePortAcceptor>
 std::string InternalMessagePortServer<MessagePortAcceptor>::GetAddress(
     MessagePortId id) const
@@ -148,5 +295,157 @@ std::string InternalMessagePortServer<MessagePortAcceptor>::GetAddress(
     return m_messagePortManager->GetAddress(id);
 }
 
+template<typename MessagePortAcceptor>
+bool InternalMessagePortServer<MessagePortAcceptor>::GetStatistics(
+    MessagePortId id, 
+    PortStatistics & statistics) const
+{
+  return m_messagePortManager->GetStatistics(id, statistics);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AddListener(
+    ConnectionListenerPointer listener)
+{
+  m_messagePortManager->AddListener(listener);
+}
+
+template<typename MessagePortAcceptor>
+bool InternalMessagePortServer<MessagePortAcceptor>::Subscribe(
+    MessagePortId id,
+    std::string const & topic)
+{
+  if (!m_topics->Subscribe(id, topic))
+    return false;
+
+  // A port that has gone already will not be told it has disconnected.
+  if (!m_messagePortManager->IsConnected(id))
+  {
+    m_topics->Unsubscribe(id, topic);
+    return false;
+  }
+
+  return true;
+}
+
+template<typename MessagePortAcceptor>
+bool InternalMessagePortServer<MessagePortAcceptor>::Unsubscribe(
+    MessagePortId id,
+    std::string const & topic)
+{
+  return m_topics->Unsubscribe(id, topic);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::AsyncPublish(
+    std::string const & topic,
+    DataBufferPointer buffer, 
+    BroadcastResultPointer result,
+    unsigned int timeoutMilliseconds,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  MessagePortIdList idList;
+  m_topics->GetSubscribers(topic, idList);
+
+  BroadcastProcessor proc(
+    m_ioService,
+    m_messagePortManager, 
+    idList, 
+    buffer, 
+    result,
+    timeoutMilliseconds,
+    completionHandler);
+  proc();
+}
+
+template<typename MessagePortAcceptor>
+std::size_t InternalMessagePortServer<MessagePortAcceptor>::GetTopicCount() const
+{
+  return m_topics->GetTopicCount();
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::EnableTopics()
+{
+  if (m_isTopicControlEnabled)
+    return;
+
+  // The control messages are only looked for once asked, so an ordinary
+  // message that happens to look like one is never taken.
+  m_serverEvents.reset(new TopicServerEvents(m_serverEvents, m_topics));
+  m_isTopicControlEnabled = true;
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::SetMessageWindow(
+    unsigned int size,
+    bool isOrdered)
+{
+  CHECK(size > 0);
+  m_windowSize = size;
+  m_isOrderedWindow = isOrdered;
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::SetAdmissionPolicy(
+    AdmissionPolicy const & policy)
+{
+  m_admission->SetPolicy(policy);
+}
+
+template<typename MessagePortAcceptor>
+AdmissionControlPointer 
+InternalMessagePortServer<MessagePortAcceptor>::GetAdmissionControl() const
+{
+  return m_admission;
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::SetFairScheduling(
+    unsigned int concurrency,
+    unsigned int quantum)
+{
+  CHECK_MSG(!m_scheduler, "Fair scheduling is already set.");
+  m_scheduler.reset(new FairScheduler(m_ioService, concurrency, quantum));
+  m_messagePortManager->AddListener(m_scheduler);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::SetConnectionWeight(
+    MessagePortId id,
+    unsigned int weight)
+{
+  CHECK_MSG(m_scheduler, "Fair scheduling is not set.");
+  m_scheduler->SetWeight(id, weight);
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::SetBackpressure(
+    BackpressurePointer backpressure)
+{
+  m_backpressure = backpressure;
+}
+
+template<typename MessagePortAcceptor>
+typename InternalMessagePortServer<MessagePortAcceptor>::MessagePortAcceptorPointer
+InternalMessagePortServer<MessagePortAcceptor>::GetAcceptor() const
+{
+  boost::mutex::scoped_lock lock(m_acceptorMutex);
+  return m_acceptor;
+}
+
+template<typename MessagePortAcceptor>
+void InternalMessagePortServer<MessagePortAcceptor>::CloseAcceptor()
+{
+  MessagePortAcceptorPointer acceptor;
+  {
+    boost::mutex::scoped_lock lock(m_acceptorMutex);
+    acceptor.swap(m_acceptor);
+  }
+
+  if (acceptor) 
+    acceptor->Close();
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
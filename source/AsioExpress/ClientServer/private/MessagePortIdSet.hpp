@@ -0,0 +1,85 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A set of port ids packed in an array, for choosing one by position.
+/// Adding and removing cost the same however many ids there are; removing
+/// moves the last id into the gap.
+///
+class MessagePortIdSet
+{
+public:
+  bool Add(MessagePortId id)
+  {
+    if (!m_positions.insert(PositionMap::value_type(id, m_ids.size())).second)
+      return false;
+
+    m_ids.push_back(id);
+    return true;
+  }
+
+  bool Remove(MessagePortId id)
+  {
+    PositionMap::iterator removed = m_positions.find(id);
+    if (removed == m_positions.end())
+      return false;
+
+    std::size_t position = removed->second;
+    m_positions.erase(removed);
+
+    if (position != m_ids.size() - 1)
+    {
+      m_ids[position] = m_ids.back();
+      m_positions[m_ids[position]] = position;
+    }
+    m_ids.pop_back();
+    return true;
+  }
+
+  bool Contains(MessagePortId id) const
+  {
+    return m_positions.find(id) != m_positions.end();
+  }
+
+  bool Empty() const
+  {
+    return m_ids.empty();
+  }
+
+  std::size_t Size() const
+  {
+    return m_ids.size();
+  }
+
+  MessagePortId operator[](std::size_t position) const
+  {
+    return m_ids[position];
+  }
+
+  void GetIds(MessagePortIdList & list) const
+  {
+    list.insert(list.end(), m_ids.begin(), m_ids.end());
+  }
+
+private:
+  typedef boost::unordered_map<MessagePortId, std::size_t> PositionMap;
+
+  std::vector<MessagePortId>  m_ids;
+  PositionMap                 m_positions;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
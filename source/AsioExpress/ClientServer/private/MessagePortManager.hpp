@@ -5,16 +5,91 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include "AsioExpressError/Check.hpp"
 #include "AsioExpress/ClientServer/MessagePortId.hpp"
+#include "AsioExpress/ClientServer/ConnectionListener.hpp"
+#include "AsioExpress/ClientServer/SendManyResult.hpp"
 #include "AsioExpress/ClientServer/private/AsyncSendable.hpp"
+#include "AsioExpress/ClientServer/private/SendManyProcessor.hpp"
+#include "AsioExpress/MessagePort/SendBatch.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
+typedef boost::shared_ptr<boost::asio::io_service::strand> StrandPointer;
+
+// Starts a send on a port from the port's strand.
+template<typename MessagePortPointer>
+class MessagePortSend
+{
+public:
+  MessagePortSend(
+      MessagePortPointer messagePort,
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler) :
+    m_messagePort(messagePort),
+    m_buffer(buffer),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()()
+  {
+    m_messagePort->AsyncSend(m_buffer, m_completionHandler);
+  }
+
+private:
+  MessagePortPointer                m_messagePort;
+  DataBufferPointer                 m_buffer;
+  AsioExpress::CompletionHandler    m_completionHandler;
+};
+
+// Starts a batch send on a port from the port's strand.
+template<typename MessagePortPointer>
+class MessagePortSendBatch
+{
+public:
+  MessagePortSendBatch(
+      MessagePortPointer messagePort,
+      DataBufferListPointer batch,
+      AsioExpress::CompletionHandler completionHandler) :
+    m_messagePort(messagePort),
+    m_batch(batch),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()()
+  {
+    m_messagePort->AsyncSendBatch(m_batch, m_completionHandler);
+  }
+
+private:
+  MessagePortPointer                m_messagePort;
+  DataBufferListPointer             m_batch;
+  AsioExpress::CompletionHandler    m_completionHandler;
+};
+
+///
+/// The connected message ports, by id. The ports are kept packed in an
+/// array and found through a slot table, so looking up an id costs the
+/// same however many ports there are. Each id carries its slot's
+/// generation; once a port is removed its id no longer matches anything,
+/// even after the slot is reused. Lookups share the table's lock, so sends
+/// from different threads do not wait for each other. A port added with a
+/// strand is only sent to and disconnected from that strand.
+///
 template<typename MessagePort>
 class MessagePortManager : public AsyncSendable
 {
@@ -22,138 +97,459 @@ public:
   typedef boost::shared_ptr<MessagePort> MessagePortPointer;
 
   MessagePortManager(boost::asio::io_service& ioService);
-  
+
   virtual ~MessagePortManager() {};
 
-  MessagePortId Add(MessagePortPointer messagePort);
+  MessagePortId Add(
+      MessagePortPointer messagePort,
+      StrandPointer strand = StrandPointer());
 
   void Remove(MessagePortId id);
 
   void RemoveAll();
 
+  ///
+  /// Closes the sending half of every port once its queued sends are
+  /// written, so the peers see the end of the stream and close in turn.
+  ///
+  void ShutdownSendAll();
+
   void GetIds(MessagePortIdList & list) const;
 
+  /// Gets the ids of the ports that do not read the broadcast channel.
+  void GetUnsubscribedIds(MessagePortIdList & list) const;
+
   void AsyncSend(
-      DataBufferPointer buffer, 
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends on the only port, as AsyncSend does, but returns false without
+  /// calling the completion handler if there is no port.
+  ///
+  bool TryAsyncSend(
+      DataBufferPointer buffer,
       AsioExpress::CompletionHandler completionHandler);
 
   virtual void AsyncSend(
-      MessagePortId id, 
-      DataBufferPointer buffer, 
+      MessagePortId id,
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Sends each message to its port. The messages for a port are sent to
+  /// it as one batch, in the order they are listed, and the ports are all
+  /// found under one lock. The completion handler is called once, when
+  /// every batch has completed.
+  ///
+  void AsyncSendMany(
+      SendList const & list,
+      SendManyResultPointer result,
       AsioExpress::CompletionHandler completionHandler);
 
   virtual std::string GetAddress(MessagePortId id) const;
-    
+
   virtual std::string GetAddress() const;
 
+  bool IsConnected(MessagePortId id) const;
+
+  /// Gets the port's traffic. Returns false if there is no such port.
+  bool GetStatistics(MessagePortId id, PortStatistics & statistics) const;
+
+  /// Gets the only port's traffic, as GetAddress does.
+  bool GetStatistics(PortStatistics & statistics) const;
+
+  ///
+  /// Gets the traffic of every port the manager has held, including those
+  /// since removed. The send queues are those of the current ports.
+  ///
+  void GetTotalStatistics(PortStatistics & statistics) const;
+
+  /// Reports the ports added and removed to the listener until it expires.
+  void AddListener(ConnectionListenerPointer listener);
+
 private:
-  typedef std::map<MessagePortId, MessagePortPointer> MessagePortMap;
+  // An id is a slot index in the low bits and the slot's generation, never
+  // zero, in the high bits; valid ids are always positive.
+  static unsigned const IndexBits = 20;
+  static unsigned const MaxSlots = 1u << IndexBits;
+  static unsigned const MaxGeneration = (1u << (31 - IndexBits)) - 1;
+
+  // Freed slots wait in line behind this many others before being reused,
+  // so an id only comes round again after millions of connections.
+  static unsigned const MinFreeSlots = 1024;
+
+  static unsigned const Free = ~0u;
+
+  struct Slot
+  {
+    Slot() :
+      generation(1),
+      position(Free)
+    {
+    }
+
+    unsigned  generation;
+    unsigned  position;
+  };
+
+  struct Entry
+  {
+    Entry() :
+      id(0)
+    {
+    }
+
+    Entry(MessagePortId id, MessagePortPointer messagePort, StrandPointer strand) :
+      id(id),
+      messagePort(messagePort),
+      strand(strand)
+    {
+    }
+
+    MessagePortId       id;
+    MessagePortPointer  messagePort;
+    StrandPointer       strand;
+  };
+
+  // The messages of a list that go to one port.
+  struct PortBatch
+  {
+    PortBatch(Entry const & entry) :
+      entry(entry),
+      buffers(new DataBufferList),
+      positions(new SendManyProcessor::PositionList)
+    {
+    }
+
+    Entry                                   entry;
+    DataBufferListPointer                   buffers;
+    SendManyProcessor::PositionListPointer  positions;
+  };
+
+  typedef std::vector<Entry> EntryList;
+  typedef std::vector<boost::weak_ptr<ConnectionListener> > ListenerList;
+
+  MessagePortManager(MessagePortManager const &);
+  MessagePortManager & operator=(MessagePortManager const &);
+
+  static unsigned GetIndex(MessagePortId id);
+
+  // Requires the lock to be held. Returns zero for stale and invalid ids.
+  Slot const * FindSlot(MessagePortId id) const;
+
+  // Requires the lock to be held exclusively.
+  void FreeSlot(MessagePortId id);
+
+  bool Find(MessagePortId id, Entry & entry) const;
 
-  boost::asio::io_service*  m_ioService;
-  MessagePortId             m_currentId;
-  MessagePortMap            m_messagePortMap;
+  // Finds the only port of a client.
+  bool FindOnly(Entry & entry) const;
+
+  // Requires the lock to be held exclusively, so listeners hear of each
+  // port in the order it was added and removed.
+  void Notify(MessagePortId id, bool isConnected);
+
+  // Requires the lock to be held exclusively.
+  void AddClosedStatistics(Entry const & entry);
+
+  void AsyncSend(
+      Entry const & entry,
+      DataBufferPointer buffer,
+      AsioExpress::CompletionHandler completionHandler);
+
+  boost::asio::io_service*      m_ioService;
+  mutable boost::shared_mutex   m_mutex;
+  std::vector<Slot>             m_slots;
+  std::deque<unsigned>          m_freeSlots;
+  EntryList                     m_entries;
+  ListenerList                  m_listeners;
+  PortStatistics                m_closedStatistics;
 };
 
 template<typename MessagePort>
 MessagePortManager<MessagePort>::MessagePortManager(boost::asio::io_service& ioService) :
-  m_ioService(&ioService),
-  m_currentId(0) 
+  m_ioService(&ioService)
 {
 }
 
 template<typename MessagePort>
 MessagePortId
-MessagePortManager<MessagePort>::Add(MessagePortPointer messagePort)
+MessagePortManager<MessagePort>::Add(
+    MessagePortPointer messagePort,
+    StrandPointer strand)
 {
-  ++m_currentId;
-  if (m_currentId < 0)
-    m_currentId = 1;
-  m_messagePortMap[m_currentId] = messagePort;
-  return m_currentId;
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  unsigned index;
+  if (m_freeSlots.size() > MinFreeSlots || 
+      (!m_freeSlots.empty() && m_slots.size() == MaxSlots))
+  {
+    index = m_freeSlots.front();
+    m_freeSlots.pop_front();
+  }
+  else
+  {
+    CHECK_MSG(m_slots.size() < MaxSlots, "Too many message ports.");
+    index = static_cast<unsigned>(m_slots.size());
+    m_slots.push_back(Slot());
+  }
+
+  Slot & slot = m_slots[index];
+  MessagePortId id = static_cast<MessagePortId>((slot.generation << IndexBits) | index);
+
+  slot.position = static_cast<unsigned>(m_entries.size());
+  m_entries.push_back(Entry(id, messagePort, strand));
+
+  Notify(id, true);
+
+  return id;
 }
 
 template<typename MessagePort>
 void MessagePortManager<MessagePort>::Remove(MessagePortId id)
 {
-  m_messagePortMap.erase(id);
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  Slot const * slot = FindSlot(id);
+  if (slot == 0)
+    return;
+
+  AddClosedStatistics(m_entries[slot->position]);
+
+  // The last entry fills the gap so the entries stay packed.
+  unsigned position = slot->position;
+  if (position != m_entries.size() - 1)
+  {
+    m_entries[position] = m_entries.back();
+    m_slots[GetIndex(m_entries[position].id)].position = position;
+  }
+  m_entries.pop_back();
+
+  FreeSlot(id);
+  Notify(id, false);
 }
 
 template<typename MessagePort>
 void MessagePortManager<MessagePort>::RemoveAll()
 {
-  typename MessagePortMap::iterator  it = m_messagePortMap.begin();
-  typename MessagePortMap::iterator end = m_messagePortMap.end();
+  EntryList entries;
+  {
+    boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+    entries.swap(m_entries);
+
+    typename EntryList::const_iterator  it = entries.begin();
+    typename EntryList::const_iterator end = entries.end();
+    for(; it != end; ++it)
+    {
+      AddClosedStatistics(*it);
+      FreeSlot(it->id);
+      Notify(it->id, false);
+    }
+  }
+
+  typename EntryList::iterator  it = entries.begin();
+  typename EntryList::iterator end = entries.end();
+  for(; it != end; ++it)
+  {
+    if (it->strand)
+      it->strand->dispatch(boost::bind(&MessagePort::Disconnect, it->messagePort));
+    else
+      it->messagePort->Disconnect();
+  }
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::ShutdownSendAll()
+{
+  EntryList entries;
+  {
+    boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+    entries = m_entries;
+  }
+
+  typename EntryList::iterator  it = entries.begin();
+  typename EntryList::iterator end = entries.end();
   for(; it != end; ++it)
   {
-    it->second->Disconnect();
+    if (it->strand)
+      it->strand->dispatch(boost::bind(&MessagePort::ShutdownSend, it->messagePort));
+    else
+      it->messagePort->ShutdownSend();
   }
-  m_messagePortMap.clear();
 }
 
 template<typename MessagePort>
 void MessagePortManager<MessagePort>::GetIds(MessagePortIdList & list) const
 {
-  typename MessagePortMap::const_iterator  it = m_messagePortMap.begin();
-  typename MessagePortMap::const_iterator end = m_messagePortMap.end();
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  list.reserve(list.size() + m_entries.size());
+
+  typename EntryList::const_iterator  it = m_entries.begin();
+  typename EntryList::const_iterator end = m_entries.end();
 
   for(; it != end; ++it)
   {
-    list.push_back(it->first);
+    list.push_back(it->id);
+  }
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::GetUnsubscribedIds(MessagePortIdList & list) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  typename EntryList::const_iterator  it = m_entries.begin();
+  typename EntryList::const_iterator end = m_entries.end();
+
+  for(; it != end; ++it)
+  {
+    if (!it->messagePort->IsBroadcastSubscriber())
+      list.push_back(it->id);
   }
 }
 
 template<typename MessagePort>
 void MessagePortManager<MessagePort>::AsyncSend(
-    DataBufferPointer buffer, 
+    DataBufferPointer buffer,
     AsioExpress::CompletionHandler completionHandler)
 {
-  if (m_messagePortMap.size() > 0)
+  Entry entry;
+  if (FindOnly(entry))
   {
-    CHECK(m_messagePortMap.size() == 1);  
-    typename MessagePortMap::iterator messagePortIterator = m_messagePortMap.begin();
-    messagePortIterator->second->AsyncSend(buffer, completionHandler);
+    AsyncSend(entry, buffer, completionHandler);
   }
   else
   {
-    // We don't consider this an error. The message port is allowed to be 
+    // We don't consider this an error. The message port is allowed to be
     // disconnected. The application will receive the disconnect notification.
     m_ioService->post(boost::asio::detail::bind_handler(completionHandler, AsioExpress::Error()));
   }
 }
 
 template<typename MessagePort>
-void MessagePortManager<MessagePort>::AsyncSend(
-    MessagePortId id, 
-    DataBufferPointer buffer, 
+bool MessagePortManager<MessagePort>::TryAsyncSend(
+    DataBufferPointer buffer,
     AsioExpress::CompletionHandler completionHandler)
 {
-  typename MessagePortMap::iterator messagePortIterator = m_messagePortMap.find(id);
+  Entry entry;
+  if (!FindOnly(entry))
+    return false;
+
+  AsyncSend(entry, buffer, completionHandler);
+  return true;
+}
 
-  if (messagePortIterator != m_messagePortMap.end())
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::AsyncSend(
+    MessagePortId id,
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  Entry entry;
+  if (Find(id, entry))
   {
-    messagePortIterator->second->AsyncSend(buffer, completionHandler);
+    AsyncSend(entry, buffer, completionHandler);
   }
   else
   {
-    // We don't consider this an error. The message port is allowed to be 
+    // We don't consider this an error. The message port is allowed to be
     // disconnected. The application will receive the disconnect notification.
     m_ioService->post(boost::asio::detail::bind_handler(completionHandler, AsioExpress::Error()));
   }
 }
 
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::AsyncSendMany(
+    SendList const & list,
+    SendManyResultPointer result,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  if (result)
+    result->SetItemCount(list.size());
+
+  // Sorting by id, then position, groups each port's messages in order.
+  typedef std::pair<MessagePortId, std::size_t> Key;
+  std::vector<Key> keys;
+  keys.reserve(list.size());
+  for (std::size_t position = 0; position < list.size(); ++position)
+    keys.push_back(Key(list[position].first, position));
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<PortBatch> batches;
+  {
+    boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+    std::vector<Key>::const_iterator it = keys.begin();
+    while (it != keys.end())
+    {
+      std::vector<Key>::const_iterator next = it + 1;
+      while (next != keys.end() && next->first == it->first)
+        ++next;
+
+      // Messages to a port that has disconnected are dropped, as they are
+      // by AsyncSend.
+      Slot const * slot = FindSlot(it->first);
+      if (slot != 0)
+      {
+        batches.push_back(PortBatch(m_entries[slot->position]));
+        PortBatch & batch = batches.back();
+        batch.buffers->reserve(next - it);
+        batch.positions->reserve(next - it);
+        for (; it != next; ++it)
+        {
+          batch.buffers->push_back(list[it->second].second);
+          batch.positions->push_back(it->second);
+        }
+      }
+
+      it = next;
+    }
+  }
+
+  if (batches.empty())
+  {
+    m_ioService->post(boost::asio::detail::bind_handler(completionHandler, AsioExpress::Error()));
+    return;
+  }
+
+  SendManyProcessor processor(*m_ioService, result, batches.size(), completionHandler);
+
+  typename std::vector<PortBatch>::const_iterator  it = batches.begin();
+  typename std::vector<PortBatch>::const_iterator end = batches.end();
+  for (; it != end; ++it)
+  {
+    AsioExpress::CompletionHandler batchHandler =
+      processor.GetBatchHandler(it->entry.id, it->positions);
+
+    if (it->entry.strand)
+    {
+      it->entry.strand->dispatch(MessagePortSendBatch<MessagePortPointer>(
+        it->entry.messagePort,
+        it->buffers,
+        batchHandler));
+    }
+    else
+    {
+      it->entry.messagePort->AsyncSendBatch(it->buffers, batchHandler);
+    }
+  }
+}
+
 template<typename MessagePort>
 std::string  MessagePortManager<MessagePort>::GetAddress(
     MessagePortId id) const
 {
   std::string address;
-  
-  typename MessagePortMap::const_iterator messagePortIterator = m_messagePortMap.find(id);
 
-  if (messagePortIterator != m_messagePortMap.end())
+  Entry entry;
+  if (Find(id, entry))
   {
-    address = messagePortIterator->second->GetAddress();
+    address = entry.messagePort->GetAddress();
   }
-  
+
   return address;
 }
 
@@ -161,16 +557,195 @@ template<typename MessagePort>
 std::string MessagePortManager<MessagePort>::GetAddress() const
 {
   std::string address;
-  
-  if (m_messagePortMap.size() > 0)
+
+  Entry entry;
+  if (FindOnly(entry))
   {
-    CHECK(m_messagePortMap.size() == 1);  
-    typename MessagePortMap::const_iterator messagePortIterator = m_messagePortMap.begin();
-    address = messagePortIterator->second->GetAddress();
+    address = entry.messagePort->GetAddress();
   }
-    
+
   return address;
 }
 
+template<typename MessagePort>
+bool MessagePortManager<MessagePort>::IsConnected(MessagePortId id) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  return FindSlot(id) != 0;
+}
+
+template<typename MessagePort>
+bool MessagePortManager<MessagePort>::GetStatistics(
+    MessagePortId id,
+    PortStatistics & statistics) const
+{
+  Entry entry;
+  if (!Find(id, entry))
+    return false;
+
+  entry.messagePort->GetStatistics(statistics);
+  return true;
+}
+
+template<typename MessagePort>
+bool MessagePortManager<MessagePort>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  Entry entry;
+  if (!FindOnly(entry))
+    return false;
+
+  entry.messagePort->GetStatistics(statistics);
+  return true;
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::GetTotalStatistics(
+    PortStatistics & statistics) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  statistics = m_closedStatistics;
+
+  typename EntryList::const_iterator  it = m_entries.begin();
+  typename EntryList::const_iterator end = m_entries.end();
+  for(; it != end; ++it)
+  {
+    PortStatistics portStatistics;
+    it->messagePort->GetStatistics(portStatistics);
+    statistics.Add(portStatistics);
+  }
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::AddListener(
+    ConnectionListenerPointer listener)
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  m_listeners.push_back(listener);
+
+  typename EntryList::const_iterator  it = m_entries.begin();
+  typename EntryList::const_iterator end = m_entries.end();
+  for(; it != end; ++it)
+  {
+    listener->Connected(it->id);
+  }
+}
+
+template<typename MessagePort>
+unsigned MessagePortManager<MessagePort>::GetIndex(MessagePortId id)
+{
+  return static_cast<unsigned>(id) & (MaxSlots - 1);
+}
+
+template<typename MessagePort>
+typename MessagePortManager<MessagePort>::Slot const *
+MessagePortManager<MessagePort>::FindSlot(MessagePortId id) const
+{
+  unsigned index = GetIndex(id);
+  if (index >= m_slots.size())
+    return 0;
+
+  Slot const & slot = m_slots[index];
+  if (slot.position == Free || (static_cast<unsigned>(id) >> IndexBits) != slot.generation)
+    return 0;
+
+  return &slot;
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::FreeSlot(MessagePortId id)
+{
+  unsigned index = GetIndex(id);
+  Slot & slot = m_slots[index];
+
+  slot.position = Free;
+  slot.generation = slot.generation % MaxGeneration + 1;
+  m_freeSlots.push_back(index);
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::Notify(
+    MessagePortId id,
+    bool isConnected)
+{
+  typename ListenerList::iterator it = m_listeners.begin();
+  while (it != m_listeners.end())
+  {
+    ConnectionListenerPointer listener = it->lock();
+    if (!listener)
+    {
+      it = m_listeners.erase(it);
+      continue;
+    }
+
+    if (isConnected)
+      listener->Connected(id);
+    else
+      listener->Disconnected(id);
+    ++it;
+  }
+}
+
+template<typename MessagePort>
+bool MessagePortManager<MessagePort>::Find(
+    MessagePortId id,
+    Entry & entry) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  Slot const * slot = FindSlot(id);
+  if (slot == 0)
+    return false;
+
+  entry = m_entries[slot->position];
+  return true;
+}
+
+template<typename MessagePort>
+bool MessagePortManager<MessagePort>::FindOnly(Entry & entry) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  if (m_entries.empty())
+    return false;
+
+  CHECK(m_entries.size() == 1);
+  entry = m_entries.front();
+  return true;
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::AddClosedStatistics(Entry const & entry)
+{
+  PortStatistics statistics;
+  entry.messagePort->GetStatistics(statistics);
+
+  // Whatever a closed port still had queued will not be sent.
+  statistics.sendQueueDepth = 0;
+  statistics.sendQueueBytes = 0;
+  m_closedStatistics.Add(statistics);
+}
+
+template<typename MessagePort>
+void MessagePortManager<MessagePort>::AsyncSend(
+    Entry const & entry,
+    DataBufferPointer buffer,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  if (entry.strand)
+  {
+    entry.strand->dispatch(MessagePortSend<MessagePortPointer>(
+      entry.messagePort,
+      buffer,
+      completionHandler));
+  }
+  else
+  {
+    entry.messagePort->AsyncSend(buffer, completionHandler);
+  }
+}
+
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -0,0 +1,172 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpress/ClientServer/private/MessageWindow.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+MessageWindow::MessageWindow(
+    boost::asio::io_service & ioService,
+    unsigned int size,
+    bool isOrdered) :
+  m_ioService(&ioService),
+  m_size(size),
+  m_isOrdered(isOrdered),
+  m_isClosed(false),
+  m_inFlight(0),
+  m_nextSequence(0),
+  m_firstSequence(0)
+{
+  CHECK(size > 0);
+}
+
+DataBufferPointer MessageWindow::GetBuffer()
+{
+  // Copies of a completed message may live on briefly in the handlers
+  // that delivered its completion, so the pool is searched for a buffer
+  // that is free by now.
+  BufferList::iterator  it = m_pool.begin();
+  BufferList::iterator end = m_pool.end();
+  for (; it != end; ++it)
+  {
+    if (it->unique())
+    {
+      DataBufferPointer buffer;
+      buffer.swap(*it);
+      *it = m_pool.back();
+      m_pool.pop_back();
+      return buffer;
+    }
+  }
+
+  return DataBufferPointer(new DataBuffer);
+}
+
+unsigned int MessageWindow::Begin()
+{
+  ++m_inFlight;
+  if (m_isOrdered)
+    m_slots.push_back(Slot());
+
+  return m_nextSequence++;
+}
+
+bool MessageWindow::IsFull() const
+{
+  return m_inFlight >= m_size;
+}
+
+void MessageWindow::AsyncWaitForSlot(AsioExpress::CompletionHandler completionHandler)
+{
+  m_waiter = completionHandler;
+
+  if (m_isClosed)
+    WakeWaiter(AsioExpress::Error(boost::asio::error::operation_aborted));
+  else if (!IsFull())
+    WakeWaiter(AsioExpress::Error());
+}
+
+void MessageWindow::Complete(
+    unsigned int sequence,
+    DataBufferPointer & buffer,
+    AsioExpress::Error error,
+    CompletionList & ready)
+{
+  if (m_isClosed)
+    return;
+
+  if (m_isOrdered)
+  {
+    Slot & slot = m_slots[sequence - m_firstSequence];
+    slot.isComplete = true;
+    slot.completion.buffer.swap(buffer);
+    slot.completion.error = error;
+
+    while (!m_slots.empty() && m_slots.front().isComplete)
+    {
+      ready.push_back(m_slots.front().completion);
+      m_slots.pop_front();
+      ++m_firstSequence;
+      --m_inFlight;
+    }
+  }
+  else
+  {
+    ready.push_back(Completion(DataBufferPointer(), error));
+    ready.back().buffer.swap(buffer);
+    --m_inFlight;
+  }
+
+  if (!IsFull())
+    WakeWaiter(AsioExpress::Error());
+}
+
+void MessageWindow::Recycle(CompletionList & completions)
+{
+  CompletionList::iterator  it = completions.begin();
+  CompletionList::iterator end = completions.end();
+  for (; it != end; ++it)
+  {
+    if (it->buffer)
+      Pool(it->buffer);
+    it->buffer.reset();
+  }
+}
+
+bool MessageWindow::Close()
+{
+  if (m_isClosed)
+    return false;
+
+  m_isClosed = true;
+  m_slots.clear();
+  m_pool.clear();
+  WakeWaiter(AsioExpress::Error(boost::asio::error::operation_aborted));
+  return true;
+}
+
+bool MessageWindow::IsClosed() const
+{
+  return m_isClosed;
+}
+
+void MessageWindow::Pool(DataBufferPointer buffer)
+{
+  if (m_pool.size() < m_size)
+  {
+    m_pool.push_back(buffer);
+    return;
+  }
+
+  // A buffer a handler has held on to gives up its place.
+  BufferList::iterator  it = m_pool.begin();
+  BufferList::iterator end = m_pool.end();
+  for (; it != end; ++it)
+  {
+    if (!it->unique())
+    {
+      *it = buffer;
+      return;
+    }
+  }
+}
+
+void MessageWindow::WakeWaiter(AsioExpress::Error error)
+{
+  if (!m_waiter)
+    return;
+
+  AsioExpress::CompletionHandler waiter;
+  waiter.swap(m_waiter);
+
+  // Posted, since the receive loop must not resume inside a completion.
+  m_ioService->post(boost::asio::detail::bind_handler(waiter, error));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,125 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Tracks the messages a connection has handed to its event handler and
+/// not yet had completed. Up to the window size may be in the handler at
+/// once; the receive loop waits for a slot when the window is full. When
+/// the window is ordered, a completion is held back until every message
+/// received before it has completed. Receive buffers are kept in a pool and
+/// reused once nothing else refers to them.
+///
+/// A window belongs to one connection and is only used from its strand.
+///
+class MessageWindow
+{
+public:
+  struct Completion
+  {
+    Completion(DataBufferPointer buffer, AsioExpress::Error error) :
+      buffer(buffer),
+      error(error)
+    {
+    }
+
+    DataBufferPointer     buffer;
+    AsioExpress::Error    error;
+  };
+
+  typedef std::vector<Completion> CompletionList;
+
+  MessageWindow(
+      boost::asio::io_service & ioService,
+      unsigned int size,
+      bool isOrdered);
+
+  /// Gets a buffer to receive the next message into.
+  DataBufferPointer GetBuffer();
+
+  /// Counts a received message as in flight and returns its sequence number.
+  unsigned int Begin();
+
+  bool IsFull() const;
+
+  ///
+  /// Calls the handler, through the io_service, once a message completes
+  /// and frees a slot. If the window is closed first the handler gets an
+  /// operation_aborted error.
+  ///
+  void AsyncWaitForSlot(AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Records that the handler has completed a message, taking the message's
+  /// buffer. The completions now ready to be acted on are added to the list
+  /// in the order they should be handled. Nothing is added once the window
+  /// is closed.
+  ///
+  void Complete(
+      unsigned int sequence,
+      DataBufferPointer & buffer,
+      AsioExpress::Error error,
+      CompletionList & ready);
+
+  ///
+  /// Returns the buffers of the completions to the pool. A buffer is only
+  /// reused once nothing else refers to it.
+  ///
+  void Recycle(CompletionList & completions);
+
+  /// Closes the window. Returns false if it was already closed.
+  bool Close();
+
+  bool IsClosed() const;
+
+private:
+  struct Slot
+  {
+    Slot() :
+      isComplete(false),
+      completion(DataBufferPointer(), AsioExpress::Error())
+    {
+    }
+
+    bool          isComplete;
+    Completion    completion;
+  };
+
+  typedef std::deque<Slot> SlotList;
+  typedef std::vector<DataBufferPointer> BufferList;
+
+  void Pool(DataBufferPointer buffer);
+
+  void WakeWaiter(AsioExpress::Error error);
+
+  boost::asio::io_service *         m_ioService;
+  unsigned int                      m_size;
+  bool                              m_isOrdered;
+  bool                              m_isClosed;
+  unsigned int                      m_inFlight;
+  unsigned int                      m_nextSequence;
+  unsigned int                      m_firstSequence;
+  SlotList                          m_slots;
+  BufferList                        m_pool;
+  AsioExpress::CompletionHandler    m_waiter;
+};
+
+typedef boost::shared_ptr<MessageWindow> MessageWindowPointer;
+
+} // namespace MessagePort
+} // namespace AsioExpress
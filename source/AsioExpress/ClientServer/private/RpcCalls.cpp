@@ -0,0 +1,269 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/ClientServer/private/RpcCalls.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+unsigned const RpcCalls::IndexBits;
+unsigned const RpcCalls::MaxCalls;
+unsigned const RpcCalls::MaxGeneration;
+
+RpcCalls::RpcCalls(boost::asio::io_service & ioService) :
+  m_ioService(ioService),
+  m_wheel(boost::asio::use_service<TimingWheelService>(ioService)),
+  m_outstanding(0)
+{
+}
+
+RpcCalls::CallId RpcCalls::Begin(
+    DataBufferPointer reply,
+    AsioExpress::CompletionHandler completionHandler,
+    unsigned int timeoutMilliseconds)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  std::size_t index = m_slots.size();
+  if (!m_free.empty())
+  {
+    index = m_free.back();
+    m_free.pop_back();
+  }
+  else if (index < MaxCalls)
+  {
+    m_slots.push_back(Slot());
+  }
+  else
+  {
+    m_ioService.post(boost::asio::detail::bind_handler(
+      completionHandler,
+      AsioExpress::Error(ErrorCode::MessagePortCallLimit)));
+    return 0;
+  }
+
+  Slot & slot = m_slots[index];
+  slot.isInUse = true;
+  slot.reply = reply;
+  slot.completionHandler = completionHandler;
+  ++m_outstanding;
+
+  CallId id = static_cast<CallId>(slot.generation) << IndexBits | static_cast<CallId>(index);
+
+  // The wheel never holds its own lock while it calls back, so scheduling
+  // with the calls locked cannot deadlock.
+  if (timeoutMilliseconds > 0)
+  {
+    Tick ticks = (static_cast<Tick>(timeoutMilliseconds) + TimingWheelService::TickMilliseconds - 1) /
+      TimingWheelService::TickMilliseconds;
+    m_wheel.Schedule(
+      m_wheel.GetTick() + ticks,
+      boost::bind(&RpcCalls::DeadlinePassed, boost::weak_ptr<RpcCalls>(shared_from_this()), id, _1));
+  }
+
+  return id;
+}
+
+bool RpcCalls::Complete(CallId id, DataBuffer const & reply)
+{
+  AsioExpress::CompletionHandler completionHandler;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    std::size_t index = 0;
+    if (!Find(id, index))
+      return false;
+
+    if (m_slots[index].reply)
+      *m_slots[index].reply = reply;
+
+    completionHandler = Release(index);
+  }
+
+  m_ioService.post(boost::asio::detail::bind_handler(
+    completionHandler,
+    AsioExpress::Error()));
+  return true;
+}
+
+void RpcCalls::Fail(CallId id, AsioExpress::Error error)
+{
+  AsioExpress::CompletionHandler completionHandler;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    std::size_t index = 0;
+    if (!Find(id, index))
+      return;
+
+    completionHandler = Release(index);
+  }
+
+  m_ioService.post(boost::asio::detail::bind_handler(completionHandler, error));
+}
+
+void RpcCalls::RequestSent(CallId id, AsioExpress::Error error)
+{
+  if (error)
+    Fail(id, error);
+}
+
+void RpcCalls::FailAll(AsioExpress::Error error)
+{
+  std::vector<AsioExpress::CompletionHandler> completionHandlers;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    for (std::size_t index = 0; index < m_slots.size(); ++index)
+    {
+      if (m_slots[index].isInUse)
+        completionHandlers.push_back(Release(index));
+    }
+  }
+
+  for (std::size_t i = 0; i < completionHandlers.size(); ++i)
+    m_ioService.post(boost::asio::detail::bind_handler(completionHandlers[i], error));
+}
+
+std::size_t RpcCalls::GetOutstanding() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_outstanding;
+}
+
+bool RpcCalls::Find(CallId id, std::size_t & index) const
+{
+  index = id & (MaxCalls - 1);
+  unsigned int generation = id >> IndexBits;
+
+  return index < m_slots.size() &&
+    m_slots[index].isInUse &&
+    m_slots[index].generation == generation;
+}
+
+AsioExpress::CompletionHandler RpcCalls::Release(std::size_t index)
+{
+  Slot & slot = m_slots[index];
+
+  AsioExpress::CompletionHandler completionHandler;
+  completionHandler.swap(slot.completionHandler);
+
+  // The new generation makes the call's id, and any deadline still on the
+  // wheel for it, refer to nothing.
+  slot.isInUse = false;
+  slot.reply.reset();
+  slot.generation = slot.generation % MaxGeneration + 1;
+  m_free.push_back(index);
+  --m_outstanding;
+
+  return completionHandler;
+}
+
+RpcCalls::Tick RpcCalls::DeadlinePassed(
+    boost::weak_ptr<RpcCalls> calls,
+    CallId id,
+    Tick)
+{
+  RpcCallsPointer pointer = calls.lock();
+  if (!pointer)
+    return 0;
+
+  AsioExpress::CompletionHandler completionHandler;
+  {
+    boost::mutex::scoped_lock lock(pointer->m_mutex);
+
+    // A call that has completed has a new generation and is not found.
+    std::size_t index = 0;
+    if (!pointer->Find(id, index))
+      return 0;
+
+    completionHandler = pointer->Release(index);
+  }
+
+  completionHandler(AsioExpress::Error(ErrorCode::MessagePortCallTimeout));
+  return 0;
+}
+
+RpcClientEventHandler::RpcClientEventHandler(
+    ClientEventHandlerPointer eventHandler,
+    RpcCallsPointer calls) :
+  m_eventHandler(eventHandler),
+  m_calls(calls)
+{
+}
+
+void RpcClientEventHandler::ClientConnected(
+    ClientConnection connection)
+{
+  m_eventHandler->ClientConnected(connection);
+}
+
+void RpcClientEventHandler::ClientDisconnected(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  RpcCallsPointer calls = m_calls.lock();
+  if (calls)
+  {
+    calls->FailAll(error ?
+      error : AsioExpress::Error(boost::asio::error::operation_aborted));
+  }
+
+  m_eventHandler->ClientDisconnected(connection, error);
+}
+
+void RpcClientEventHandler::AsyncProcessMessage(
+    ClientMessage message)
+{
+  RpcFrame::Kind kind = RpcFrame::Message;
+  RpcFrame::CallId id = 0;
+  if (!RpcFrame::Decode(*message.GetDataBuffer(), kind, id) || kind == RpcFrame::Request)
+  {
+    message.CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortBadFrame));
+    return;
+  }
+
+  if (kind == RpcFrame::Message)
+  {
+    m_eventHandler->AsyncProcessMessage(message);
+    return;
+  }
+
+  // A reply that comes after its call has timed out is dropped.
+  RpcCallsPointer calls = m_calls.lock();
+  if (calls)
+    calls->Complete(id, *message.GetDataBuffer());
+
+  message.CallCompletionHandler(AsioExpress::Error());
+}
+
+AsioExpress::Error RpcClientEventHandler::ConnectionError(
+    ClientConnection connection,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->ConnectionError(connection, error);
+}
+
+AsioExpress::Error RpcClientEventHandler::MessageError(
+    ClientMessage message,
+    AsioExpress::Error error)
+{
+  return m_eventHandler->MessageError(message, error);
+}
+
+void RpcClientEventHandler::ClientReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds)
+{
+  m_eventHandler->ClientReconnecting(connection, delayMilliseconds);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
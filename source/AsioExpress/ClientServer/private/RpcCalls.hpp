@@ -0,0 +1,147 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/TimingWheelService.hpp"
+#include "AsioExpress/ClientServer/ClientEventHandler.hpp"
+#include "AsioExpress/ClientServer/RpcFrame.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The calls waiting for their replies on one connection. A call's id is
+/// its slot in a table with the slot's generation, so a reply finds its
+/// call without a search and a reply to a call that has already completed
+/// finds nothing. Deadlines are kept on the io_service's timing wheel, so
+/// they are rounded up to a whole tick of it.
+///
+class RpcCalls : public boost::enable_shared_from_this<RpcCalls>
+{
+public:
+  typedef RpcFrame::CallId CallId;
+
+  explicit RpcCalls(boost::asio::io_service & ioService);
+
+  ///
+  /// Starts a call and returns its id. If there are too many calls waiting
+  /// the completion handler is called with an error and zero is returned.
+  /// A timeout of zero means the call has no deadline.
+  ///
+  CallId Begin(
+      DataBufferPointer reply,
+      AsioExpress::CompletionHandler completionHandler,
+      unsigned int timeoutMilliseconds);
+
+  ///
+  /// Copies the reply to the call and completes it. Returns false if the
+  /// call has already completed.
+  ///
+  bool Complete(CallId id, DataBuffer const & reply);
+
+  /// Completes the call with the error, if it has not already completed.
+  void Fail(CallId id, AsioExpress::Error error);
+
+  /// Fails the call if its request could not be sent.
+  void RequestSent(CallId id, AsioExpress::Error error);
+
+  /// Completes all the calls waiting with the error.
+  void FailAll(AsioExpress::Error error);
+
+  std::size_t GetOutstanding() const;
+
+private:
+  typedef TimingWheelService::Tick Tick;
+
+  // An id is a slot index in the low bits and the slot's generation, never
+  // zero, in the high bits.
+  static unsigned const IndexBits = 20;
+  static unsigned const MaxCalls = 1u << IndexBits;
+  static unsigned const MaxGeneration = (1u << (32 - IndexBits)) - 1;
+
+  struct Slot
+  {
+    Slot() :
+      generation(1),
+      isInUse(false)
+    {
+    }
+
+    unsigned int                      generation;
+    bool                              isInUse;
+    DataBufferPointer                 reply;
+    AsioExpress::CompletionHandler    completionHandler;
+  };
+
+  // These require the lock to be held.
+  bool Find(CallId id, std::size_t & index) const;
+  AsioExpress::CompletionHandler Release(std::size_t index);
+
+  // The wheel only holds on to the calls weakly, so a deadline does not
+  // keep the client's calls alive.
+  static Tick DeadlinePassed(boost::weak_ptr<RpcCalls> calls, CallId id, Tick now);
+
+  boost::asio::io_service &       m_ioService;
+  TimingWheelService &            m_wheel;
+  mutable boost::mutex            m_mutex;
+  std::vector<Slot>               m_slots;
+  std::vector<std::size_t>        m_free;
+  std::size_t                     m_outstanding;
+};
+
+typedef boost::shared_ptr<RpcCalls> RpcCallsPointer;
+
+///
+/// The event handler of an RPC client's connection. Replies complete their
+/// calls and one-way messages are passed on without their header. The
+/// calls still waiting when the connection is lost fail with its error.
+///
+class RpcClientEventHandler : public ClientEventHandler
+{
+public:
+  RpcClientEventHandler(
+      ClientEventHandlerPointer eventHandler,
+      RpcCallsPointer calls);
+
+  virtual void ClientConnected(
+      ClientConnection connection);
+
+  virtual void ClientDisconnected(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual void AsyncProcessMessage(
+      ClientMessage message);
+
+  virtual AsioExpress::Error ConnectionError(
+      ClientConnection connection,
+      AsioExpress::Error error);
+
+  virtual AsioExpress::Error MessageError(
+      ClientMessage message,
+      AsioExpress::Error error);
+
+  virtual void ClientReconnecting(
+      ClientConnection connection,
+      unsigned int delayMilliseconds);
+
+private:
+  ClientEventHandlerPointer       m_eventHandler;
+  boost::weak_ptr<RpcCalls>       m_calls;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
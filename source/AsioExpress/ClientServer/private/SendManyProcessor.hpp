@@ -0,0 +1,104 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/ClientServer/MessagePortId.hpp"
+#include "AsioExpress/ClientServer/SendManyResult.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Completes a list of messages sent as one batch per port. Each batch
+/// completes as a whole, so every message in it shares its error. The
+/// completion handler is called once, after the last batch. Failures are
+/// only reported when a result is given, as for a broadcast.
+///
+class SendManyProcessor
+{
+public:
+  /// The positions in the list of a batch's messages.
+  typedef std::vector<std::size_t> PositionList;
+  typedef boost::shared_ptr<PositionList> PositionListPointer;
+
+  SendManyProcessor(
+      boost::asio::io_service & ioService,
+      SendManyResultPointer result,
+      std::size_t batchCount,
+      AsioExpress::CompletionHandler completionHandler) :
+    m_sendMany(new SendMany(ioService))
+  {
+    m_sendMany->remaining = batchCount;
+    m_sendMany->result = result;
+    m_sendMany->completionHandler = completionHandler;
+  }
+
+  /// Gets the completion handler of the batch sent to the port.
+  AsioExpress::CompletionHandler GetBatchHandler(
+      MessagePortId id,
+      PositionListPointer positions) const
+  {
+    return boost::bind(&SendManyProcessor::BatchComplete, m_sendMany, id, positions, _1);
+  }
+
+private:
+  struct SendMany
+  {
+    SendMany(boost::asio::io_service & ioService) :
+      ioService(&ioService),
+      remaining(0)
+    {
+    }
+
+    boost::mutex                      mutex;
+    boost::asio::io_service *         ioService;
+    std::size_t                       remaining;
+    SendManyResultPointer             result;
+    AsioExpress::CompletionHandler    completionHandler;
+  };
+
+  typedef boost::shared_ptr<SendMany> SendManyPointer;
+
+  static void BatchComplete(
+      SendManyPointer sendMany,
+      MessagePortId id,
+      PositionListPointer positions,
+      AsioExpress::Error error)
+  {
+    AsioExpress::Error result;
+    {
+      boost::mutex::scoped_lock lock(sendMany->mutex);
+
+      if (error && sendMany->result)
+      {
+        PositionList::const_iterator  it = positions->begin();
+        PositionList::const_iterator end = positions->end();
+        for (; it != end; ++it)
+          sendMany->result->AddFailure(*it, id, error);
+      }
+
+      if (--sendMany->remaining > 0)
+        return;
+
+      if (sendMany->result && !sendMany->result->IsComplete())
+        result = AsioExpress::Error(ErrorCode::MessagePortSendIncomplete);
+    }
+
+    CallCompletionHandler(*sendMany->ioService, sendMany->completionHandler, result);
+  }
+
+  SendManyPointer   m_sendMany;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -6,13 +6,19 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
 
 #include "AsioExpressError/CommonErrorCodes.hpp"
 #include "AsioExpress/Coroutine.hpp"
 #include "AsioExpress/Error.hpp"
 #include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/EventHandling/Backpressure.hpp"
 #include "AsioExpress/ClientServer/ServerMessage.hpp"
 #include "AsioExpress/ClientServer/ServerEventHandler.hpp"
+#include "AsioExpress/ClientServer/private/AdmissionControl.hpp"
+#include "AsioExpress/ClientServer/private/FairScheduler.hpp"
+#include "AsioExpress/ClientServer/private/MessagePortManager.hpp"
+#include "AsioExpress/ClientServer/private/MessageWindow.hpp"
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 #include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
 
@@ -33,7 +39,12 @@ public:
       ServerInterfacePointer messagePortServer,
       ServerEventsPointer serverEvents,
       MessagePortAcceptorPointer acceptor,
-      MessagePortManagerPointer messagePortManager);
+      MessagePortManagerPointer messagePortManager,
+      AdmissionControlPointer admission,
+      FairSchedulerPointer scheduler,
+      BackpressurePointer backpressure,
+      unsigned int windowSize,
+      bool isOrderedWindow);
   
   void operator()(
       AsioExpress::Error error = AsioExpress::Error());
@@ -43,6 +54,7 @@ private:
   typedef boost::shared_ptr<MessagePort> MessagePortPointer;
 
   Server & operator=(Server const &);
+  void MessageCompleted(AsioExpress::Error error);
   void Disconnect(AsioExpress::Error error);
 
   boost::asio::io_service &           m_ioService;
@@ -50,8 +62,16 @@ private:
   ServerEventsPointer                 m_serverEvents;
   MessagePortManagerPointer           m_messagePortManager;
   MessagePortAcceptorPointer          m_acceptor;
+  AdmissionControlPointer             m_admission;
+  FairSchedulerPointer                m_scheduler;
+  BackpressurePointer                 m_backpressure;
   MessagePortPointer                  m_messagePort;
+  StrandPointer                       m_strand;
+  unsigned int                        m_windowSize;
+  bool                                m_isOrderedWindow;
+  MessageWindowPointer                m_window;
   MessagePortId                       m_messagePortId;
+  unsigned int                        m_sequence;
   DataBufferPointer                   m_buffer;
 };
 
@@ -61,13 +81,24 @@ Server<MessagePortAcceptor>::Server(
     ServerInterfacePointer messagePortServer,
     ServerEventsPointer serverEvents,
     MessagePortAcceptorPointer acceptor,
-    MessagePortManagerPointer messagePortManager) :
+    MessagePortManagerPointer messagePortManager,
+    AdmissionControlPointer admission,
+    FairSchedulerPointer scheduler,
+    BackpressurePointer backpressure,
+    unsigned int windowSize,
+    bool isOrderedWindow) :
   m_ioService(ioService),
   m_messagePortServer(messagePortServer),
   m_serverEvents(serverEvents),
   m_messagePortManager(messagePortManager),
   m_acceptor(acceptor),
-  m_messagePortId(0)
+  m_admission(admission),
+  m_scheduler(scheduler),
+  m_backpressure(backpressure),
+  m_windowSize(windowSize),
+  m_isOrderedWindow(isOrderedWindow),
+  m_messagePortId(0),
+  m_sequence(0)
 {
 }
 
@@ -80,6 +111,12 @@ void Server<MessagePortAcceptor>::operator()(
     // Loop to accept incoming connections.
     do
     {
+      // A server that pauses accepting waits here while it is over its
+      // limits, leaving new connections in the listen backlog.
+      YIELD m_admission->AsyncWaitToAccept(*this);
+      if (error)
+        return;
+
       // Create a new socket for the next incoming connection.
       m_messagePort.reset(new MessagePort(m_ioService));
 
@@ -110,6 +147,14 @@ void Server<MessagePortAcceptor>::operator()(
       // Sockets require us to do some initialization after the connect.
       m_messagePort->SetMessagePortOptions();
 
+      // Otherwise a connection over the limits is closed as soon as it is
+      // accepted.
+      if (!m_admission->AdmitConnection())
+      {
+        m_messagePort->Disconnect();
+        continue;
+      }
+
       // We "FORK" by cloning a new server coroutine to handle the connection.
       // After forking we have a parent coroutine and a child coroutine. Both
       // parent and child continue execution at the following line. They can
@@ -121,8 +166,14 @@ void Server<MessagePortAcceptor>::operator()(
       // The child exits the loop and processes the connection.
     } while (IsParent());
 
+    // From here on the connection runs on its own strand. Its receives,
+    // sends and events are serialized while other connections use the rest
+    // of the threads running the io_service.
+    m_strand.reset(new boost::asio::io_service::strand(m_ioService));
+    m_window.reset(new MessageWindow(m_ioService, m_windowSize, m_isOrderedWindow));
+    YIELD m_strand->post(*this);
 
-    m_messagePortId = m_messagePortManager->Add(m_messagePort);
+    m_messagePortId = m_messagePortManager->Add(m_messagePort, m_strand);
 
     error = m_serverEvents->HandleConnected(
       ServerConnection(m_ioService, m_messagePortId, m_messagePortServer));
@@ -132,57 +183,150 @@ void Server<MessagePortAcceptor>::operator()(
       return;
     }
 
-    m_buffer.reset(new DataBuffer());
-
-    // Process incoming messages.
+    // Process incoming messages. Up to the window size of them are in the
+    // event handler at once.
     for(;;)
     {
+      // While the queues downstream of the event handler are too full the
+      // connection is not read, so TCP flow control pushes back on the
+      // client.
+      if (m_backpressure && m_backpressure->IsPaused())
+      {
+        YIELD m_backpressure->AsyncWaitUntilResumed(m_strand->wrap(*this));
+        if (error)
+        {
+          Disconnect(error);
+          return;
+        }
+      }
+
       // Receive message
+      m_buffer = m_window->GetBuffer();
       YIELD 
-        m_messagePort->AsyncReceive(m_buffer, *this);
+        m_messagePort->AsyncReceive(m_buffer, m_strand->wrap(*this));
+
+      // A failed message may have closed the connection meanwhile.
+      if (m_window->IsClosed())
+        return;
+
       if (error)
       {
         Disconnect(error);
         return;
       }
 
-      YIELD 
+      // A child coroutine waits for the event handler to complete the
+      // message while the parent goes on to receive the next one.
+      m_sequence = m_window->Begin();
+      FORK Server(*this)();
+      if (IsChild())
       {
-        m_serverEvents->HandleMessage(
-          ServerMessage(
-            ServerConnection(
-              m_ioService,
+        // When the server is busy the message fails at once rather than
+        // waiting its turn in the event handler. A draining server drops
+        // it; the connection is about to close.
+        if (m_admission->BeginMessage())
+        {
+          // With fair scheduling the message then waits for its
+          // connection's turn. A message aborted by a stopping server is
+          // dropped.
+          if (m_scheduler)
+          {
+            YIELD m_scheduler->AsyncWaitForTurn(
               m_messagePortId, 
-              m_messagePortServer), 
-            m_buffer, 
-            *this));
+              m_buffer->Size(), 
+              m_strand->wrap(*this));
+            if (error)
+            {
+              m_admission->EndMessage();
+              MessageCompleted(AsioExpress::Error());
+              return;
+            }
+          }
+
+          YIELD 
+          {
+            m_serverEvents->HandleMessage(
+              ServerMessage(
+                ServerConnection(
+                  m_ioService,
+                  m_messagePortId, 
+                  m_messagePortServer), 
+                m_buffer, 
+                m_strand->wrap(*this)));
+          }
+          if (m_scheduler)
+            m_scheduler->EndTurn();
+          m_admission->EndMessage();
+        }
+        else if (!m_admission->IsDraining())
+        {
+          error = AsioExpress::Error(AsioExpress::ErrorCode::MessagePortServerBusy);
+        }
+        MessageCompleted(error);
+        return;
       }
-      if (error)
+
+      m_buffer.reset();
+      if (m_window->IsFull())
       {
-        error = m_serverEvents->HandleMessageError(
-                  ServerMessage(
-                    ServerConnection(
-                      m_ioService,
-                      m_messagePortId, 
-                      m_messagePortServer), 
-                    m_buffer, 
-                    0),
-                  error);
-        if (error)
-        {
-          Disconnect(error);
+        YIELD m_window->AsyncWaitForSlot(m_strand->wrap(*this));
+
+        // The slot may have been freed by a message that then failed and
+        // closed the connection.
+        if (error || m_window->IsClosed())
           return;
-        }
       }
     }
   }
 }
 
+template<typename MessagePortAcceptor>
+void Server<MessagePortAcceptor>::MessageCompleted(AsioExpress::Error error)
+{
+  MessageWindow::CompletionList ready;
+  m_window->Complete(m_sequence, m_buffer, error, ready);
+
+  MessageWindow::CompletionList::const_iterator  it = ready.begin();
+  MessageWindow::CompletionList::const_iterator end = ready.end();
+  for (; it != end; ++it)
+  {
+    if (!it->error)
+      continue;
+
+    error = m_serverEvents->HandleMessageError(
+              ServerMessage(
+                ServerConnection(
+                  m_ioService,
+                  m_messagePortId, 
+                  m_messagePortServer), 
+                it->buffer, 
+                0),
+              it->error);
+    if (error)
+    {
+      Disconnect(error);
+      return;
+    }
+  }
+
+  m_window->Recycle(ready);
+}
+
 template<typename MessagePortAcceptor>
 void Server<MessagePortAcceptor>::Disconnect(AsioExpress::Error error)
 {
+  // Either the receive loop or a failed message may disconnect first.
+  if (m_window && !m_window->Close())
+    return;
+
   m_messagePortManager->Remove(m_messagePortId);
+
+  // The receive loop and every message in the window hold the port, so it
+  // is closed here rather than when the last of them lets go. A receive
+  // still waiting then ends with an error.
+  m_strand->dispatch(boost::bind(&MessagePort::Disconnect, m_messagePort));
   m_messagePort.reset();
+  m_admission->ConnectionClosed();
   m_serverEvents->HandleDisconnected(
     ServerConnection(m_ioService, m_messagePortId, m_messagePortServer),
     error);
@@ -0,0 +1,162 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/Coroutine.hpp"
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/Timer/StandardTimer.hpp"
+#include "AsioExpress/EventHandling/Backpressure.hpp"
+#include "AsioExpress/ClientServer/DrainResult.hpp"
+#include "AsioExpress/ClientServer/private/AdmissionControl.hpp"
+#include "AsioExpress/ClientServer/private/FairScheduler.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
+#include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Stops a server's connections gracefully. New messages are refused while
+/// the event handler finishes the ones it has and their replies are sent.
+/// Then each connection's sending half is closed and the peers are given
+/// the chance to close in turn. Whatever is left at the deadline is closed
+/// by force. The server's acceptor is closed before the drain starts.
+///
+/// Connections paused by the server's backpressure cannot see their peers
+/// hang up, so they are closed along with the sending halves. The fair
+/// scheduler, if any, is stopped before the rest are closed by force.
+///
+template<typename MessagePortManagerPointer>
+class ServerDrain : private AsioExpress::Coroutine
+{
+public:
+  ServerDrain(
+      boost::asio::io_service & ioService,
+      MessagePortManagerPointer messagePortManager,
+      AdmissionControlPointer admission,
+      FairSchedulerPointer scheduler,
+      BackpressurePointer backpressure,
+      unsigned int deadlineMilliseconds,
+      DrainResultPointer result,
+      AsioExpress::CompletionHandler completionHandler) :
+    m_ioService(ioService),
+    m_messagePortManager(messagePortManager),
+    m_admission(admission),
+    m_scheduler(scheduler),
+    m_backpressure(backpressure),
+    m_timer(new StandardTimer(ioService)),
+    m_deadline(
+      boost::posix_time::microsec_clock::universal_time() + 
+      boost::posix_time::milliseconds(deadlineMilliseconds)),
+    m_result(result),
+    m_completionHandler(completionHandler),
+    m_startSent(0),
+    m_startConnections(0)
+  {
+  }
+
+  void operator()(AsioExpress::Error error = AsioExpress::Error())
+  {
+    REENTER (this)
+    {
+      m_admission->BeginDrain();
+      {
+        PortStatistics statistics;
+        m_messagePortManager->GetTotalStatistics(statistics);
+        m_startSent = statistics.messagesSent;
+        m_startConnections = m_admission->GetConnections();
+      }
+
+      // Let the event handler finish its messages and the sends go out.
+      while (!IsFlushed() && !IsExpired())
+      {
+        YIELD m_timer->AsyncWait(PollMilliseconds, *this);
+      }
+
+      // Close the sending halves and wait for the peers to hang up.
+      if (!IsExpired())
+      {
+        m_messagePortManager->ShutdownSendAll();
+        if (m_backpressure)
+          m_backpressure->Cancel();
+        while (m_admission->GetConnections() > 0 && !IsExpired())
+        {
+          YIELD m_timer->AsyncWait(PollMilliseconds, *this);
+        }
+      }
+
+      Finish();
+    }
+  }
+
+private:
+  static unsigned int const PollMilliseconds = 10;
+
+  ServerDrain & operator=(ServerDrain const &);
+
+  bool IsExpired() const
+  {
+    return boost::posix_time::microsec_clock::universal_time() >= m_deadline;
+  }
+
+  bool IsFlushed() const
+  {
+    if (m_admission->GetPendingMessages() > 0)
+      return false;
+
+    PortStatistics statistics;
+    m_messagePortManager->GetTotalStatistics(statistics);
+    return statistics.sendQueueDepth == 0;
+  }
+
+  void Finish()
+  {
+    PortStatistics statistics;
+    m_messagePortManager->GetTotalStatistics(statistics);
+    unsigned int forced = m_admission->GetConnections();
+
+    if (m_result)
+    {
+      m_result->messagesFlushed = statistics.messagesSent - m_startSent;
+      m_result->messagesDropped = 
+        m_admission->GetDrainedMessages() + 
+        m_admission->GetPendingMessages() +
+        statistics.sendQueueDepth;
+      m_result->connectionsForced = forced;
+      m_result->connectionsClosed = 
+        m_startConnections > forced ? m_startConnections - forced : 0;
+    }
+
+    // Connections still waiting on the scheduler or the backpressure would
+    // never see their ports removed.
+    if (m_scheduler)
+      m_scheduler->Stop();
+    if (m_backpressure)
+      m_backpressure->Cancel();
+    m_messagePortManager->RemoveAll();
+
+    CallCompletionHandler(m_ioService, m_completionHandler, AsioExpress::Error());
+  }
+
+  boost::asio::io_service &         m_ioService;
+  MessagePortManagerPointer         m_messagePortManager;
+  AdmissionControlPointer           m_admission;
+  FairSchedulerPointer              m_scheduler;
+  BackpressurePointer               m_backpressure;
+  TimerPointer                      m_timer;
+  boost::posix_time::ptime          m_deadline;
+  DrainResultPointer                m_result;
+  AsioExpress::CompletionHandler    m_completionHandler;
+  boost::uint64_t                   m_startSent;
+  unsigned int                      m_startConnections;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
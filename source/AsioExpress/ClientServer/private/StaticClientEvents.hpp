@@ -0,0 +1,105 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpressError/CatchMacros.hpp"
+#include "AsioExpress/ClientServer/private/ClientEvents.hpp"
+#include "AsioExpress/ClientServer/private/ClientEventsImpl.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Passes a client's events to an event handler whose type is known at
+/// compile time. The handler has the member functions of
+/// ClientEventHandler but need not derive from it; the calls are made
+/// directly and may be inlined.
+///
+template<typename Handler>
+class StaticClientEvents : public ClientEvents
+{
+public:
+  StaticClientEvents(Handler * eventHandler) :
+    m_eventHandler(eventHandler)
+  {
+  }
+
+  virtual AsioExpress::Error HandleConnected(
+    ClientConnection connection)
+  {
+    try
+    {
+      m_eventHandler->ClientConnected(connection);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(return error)
+
+    return AsioExpress::Error();
+  }
+
+  virtual void HandleDisconnected(
+    ClientConnection connection, 
+    AsioExpress::Error error)
+  {
+    try
+    {
+      m_eventHandler->ClientDisconnected(connection, error);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(m_eventHandler->ConnectionError(connection, error))
+  }
+
+  virtual void HandleMessage(
+    ClientMessage message)
+  {
+    try
+    {
+      m_eventHandler->AsyncProcessMessage(message);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(message.CallCompletionHandler(error))
+  }
+
+  virtual AsioExpress::Error HandleMessageError(
+    ClientMessage message,
+    AsioExpress::Error error)
+  {
+    try
+    {
+      return m_eventHandler->MessageError(message, error);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(return error)
+  }
+
+  virtual void HandleReconnecting(
+    ClientConnection connection,
+    unsigned int delayMilliseconds)
+  {
+    try
+    {
+      m_eventHandler->ClientReconnecting(connection, delayMilliseconds);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(m_eventHandler->ConnectionError(connection, error))
+  }
+
+private:
+  boost::shared_ptr<Handler>    m_eventHandler;
+};
+
+/// Makes the events of a client whose handler type is given.
+template<typename Handler>
+ClientEventsPointer MakeClientEvents(Handler * eventHandler)
+{
+  return ClientEventsPointer(new StaticClientEvents<Handler>(eventHandler));
+}
+
+/// Handlers only known by the ClientEventHandler interface are called through it.
+inline ClientEventsPointer MakeClientEvents(ClientEventHandler * eventHandler)
+{
+  return ClientEventsPointer(new ClientEventsImpl(eventHandler));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
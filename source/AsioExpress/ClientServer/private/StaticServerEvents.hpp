@@ -0,0 +1,94 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpressError/CatchMacros.hpp"
+#include "AsioExpress/ClientServer/private/ServerEvents.hpp"
+#include "AsioExpress/ClientServer/private/ServerEventsImpl.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// Passes a server's events to an event handler whose type is known at
+/// compile time. The handler has the member functions of
+/// ServerEventHandler but need not derive from it; the calls are made
+/// directly and may be inlined.
+///
+template<typename Handler>
+class StaticServerEvents : public ServerEvents
+{
+public:
+  StaticServerEvents(Handler * eventHandler) :
+    m_eventHandler(eventHandler)
+  {
+  }
+
+  virtual AsioExpress::Error HandleConnected(
+    ServerConnection connection)
+  {
+    try
+    {
+      m_eventHandler->ClientConnected(connection);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(return error)
+
+    return AsioExpress::Error();
+  }
+
+  virtual void HandleDisconnected(
+    ServerConnection connection,
+    AsioExpress::Error error)
+  {
+    try
+    {
+      m_eventHandler->ClientDisconnected(connection, error);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(m_eventHandler->ConnectionError(connection, error))
+  }
+
+  virtual void HandleMessage(
+    ServerMessage message)
+  {
+    try
+    {
+      m_eventHandler->AsyncProcessMessage(message);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(message.CallCompletionHandler(error))
+  }
+
+  virtual AsioExpress::Error HandleMessageError(
+    ServerMessage message,
+    AsioExpress::Error error)
+  {
+    try
+    {
+      return m_eventHandler->MessageError(message, error);
+    }
+    ASIOEXPRESS_CATCH_ERROR_AND_DO(return error)
+  }
+
+private:
+  boost::shared_ptr<Handler>    m_eventHandler;
+};
+
+/// Makes the events of a server whose handler type is given.
+template<typename Handler>
+ServerEventsPointer MakeServerEvents(Handler * eventHandler)
+{
+  return ServerEventsPointer(new StaticServerEvents<Handler>(eventHandler));
+}
+
+/// Handlers only known by the ServerEventHandler interface are called through it.
+inline ServerEventsPointer MakeServerEvents(ServerEventHandler * eventHandler)
+{
+  return ServerEventsPointer(new ServerEventsImpl(eventHandler));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,147 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include <boost/thread/locks.hpp>
+
+#include "AsioExpress/ClientServer/TopicControl.hpp"
+#include "AsioExpress/ClientServer/private/TopicIndex.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+bool TopicIndex::Subscribe(MessagePortId id, std::string const & topic)
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  if (!m_subscribers[topic].Add(id))
+    return false;
+
+  m_topics[id].push_back(topic);
+  return true;
+}
+
+bool TopicIndex::Unsubscribe(MessagePortId id, std::string const & topic)
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  TopicListMap::iterator topics = m_topics.find(id);
+  if (topics == m_topics.end())
+    return false;
+
+  TopicList::iterator it = std::find(topics->second.begin(), topics->second.end(), topic);
+  if (it == topics->second.end())
+    return false;
+
+  *it = topics->second.back();
+  topics->second.pop_back();
+  if (topics->second.empty())
+    m_topics.erase(topics);
+
+  Remove(id, topic);
+  return true;
+}
+
+void TopicIndex::GetSubscribers(
+    std::string const & topic,
+    MessagePortIdList & list) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+
+  SubscriberMap::const_iterator subscribers = m_subscribers.find(topic);
+  if (subscribers != m_subscribers.end())
+    subscribers->second.GetIds(list);
+}
+
+std::size_t TopicIndex::GetTopicCount() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_mutex);
+  return m_subscribers.size();
+}
+
+void TopicIndex::Connected(MessagePortId)
+{
+}
+
+void TopicIndex::Disconnected(MessagePortId id)
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+
+  TopicListMap::iterator topics = m_topics.find(id);
+  if (topics == m_topics.end())
+    return;
+
+  TopicList::const_iterator  it = topics->second.begin();
+  TopicList::const_iterator end = topics->second.end();
+  for (; it != end; ++it)
+    Remove(id, *it);
+
+  m_topics.erase(topics);
+}
+
+void TopicIndex::Remove(MessagePortId id, std::string const & topic)
+{
+  // A topic is dropped with its last subscriber.
+  SubscriberMap::iterator subscribers = m_subscribers.find(topic);
+  if (subscribers == m_subscribers.end())
+    return;
+
+  subscribers->second.Remove(id);
+  if (subscribers->second.Empty())
+    m_subscribers.erase(subscribers);
+}
+
+TopicServerEvents::TopicServerEvents(
+    ServerEventsPointer serverEvents,
+    TopicIndexPointer topics) :
+  m_serverEvents(serverEvents),
+  m_topics(topics)
+{
+}
+
+AsioExpress::Error TopicServerEvents::HandleConnected(
+  ServerConnection connection)
+{
+  return m_serverEvents->HandleConnected(connection);
+}
+
+void TopicServerEvents::HandleDisconnected(
+  ServerConnection connection,
+  AsioExpress::Error error)
+{
+  m_serverEvents->HandleDisconnected(connection, error);
+}
+
+void TopicServerEvents::HandleMessage(
+  ServerMessage message)
+{
+  TopicControl::Operation operation;
+  std::string topic;
+  if (!TopicControl::Parse(*message.GetDataBuffer(), operation, topic))
+  {
+    m_serverEvents->HandleMessage(message);
+    return;
+  }
+
+  if (operation == TopicControl::Subscribe)
+    m_topics->Subscribe(message.GetMessagePortId(), topic);
+  else
+    m_topics->Unsubscribe(message.GetMessagePortId(), topic);
+
+  message.CallCompletionHandler(AsioExpress::Error());
+}
+
+AsioExpress::Error TopicServerEvents::HandleMessageError(
+  ServerMessage message,
+  AsioExpress::Error error)
+{
+  return m_serverEvents->HandleMessageError(message, error);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,92 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "AsioExpress/ClientServer/ConnectionListener.hpp"
+#include "AsioExpress/ClientServer/private/MessagePortIdSet.hpp"
+#include "AsioExpress/ClientServer/private/ServerEvents.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A server's topics and the ports subscribed to each. A publish finds its
+/// subscribers by the topic alone, and subscribing and unsubscribing cost
+/// the same however many topics and ports there are. The index listens to
+/// the server's ports so a port's subscriptions end with its connection.
+///
+class TopicIndex : public ConnectionListener
+{
+public:
+  /// Returns false if the port was already subscribed.
+  bool Subscribe(MessagePortId id, std::string const & topic);
+
+  /// Returns false if the port was not subscribed.
+  bool Unsubscribe(MessagePortId id, std::string const & topic);
+
+  /// Adds the ports subscribed to the topic to the list.
+  void GetSubscribers(std::string const & topic, MessagePortIdList & list) const;
+
+  std::size_t GetTopicCount() const;
+
+  virtual void Connected(MessagePortId id);
+
+  virtual void Disconnected(MessagePortId id);
+
+private:
+  typedef std::vector<std::string> TopicList;
+  typedef boost::unordered_map<std::string, MessagePortIdSet> SubscriberMap;
+  typedef boost::unordered_map<MessagePortId, TopicList> TopicListMap;
+
+  // Requires the lock to be held exclusively.
+  void Remove(MessagePortId id, std::string const & topic);
+
+  mutable boost::shared_mutex   m_mutex;
+  SubscriberMap                 m_subscribers;
+  TopicListMap                  m_topics;
+};
+
+typedef boost::shared_ptr<TopicIndex> TopicIndexPointer;
+
+///
+/// Takes a server's topic control messages out of its events and keeps
+/// the topic index from them. Every other event is passed on.
+///
+class TopicServerEvents : public ServerEvents
+{
+public:
+  TopicServerEvents(
+      ServerEventsPointer serverEvents,
+      TopicIndexPointer topics);
+
+  virtual AsioExpress::Error HandleConnected(
+    ServerConnection connection);
+
+  virtual void HandleDisconnected(
+    ServerConnection connection,
+    AsioExpress::Error error);
+
+  virtual void HandleMessage(
+    ServerMessage message);
+
+  virtual AsioExpress::Error HandleMessageError(
+    ServerMessage message,
+    AsioExpress::Error error);
+
+private:
+  ServerEventsPointer   m_serverEvents;
+  TopicIndexPointer     m_topics;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -33,6 +33,26 @@ std::string ErrorCategoryImpl::message(int ev) const
       return "Timed out waiting to receive an event from the resource cache.";
     case ErrorCode::MessagePortAcceptorError:
       return "Error returned by the message port acceptor.";
+    case ErrorCode::MessagePortBroadcastTimeout:
+      return "Timed out waiting to send a broadcast message.";
+    case ErrorCode::MessagePortBroadcastIncomplete:
+      return "The broadcast message was not sent to every message port.";
+    case ErrorCode::MessagePortSendBufferFull:
+      return "Too many messages are waiting for the client to reconnect.";
+    case ErrorCode::MessagePortNoEndPoint:
+      return "None of the client's end points is connected.";
+    case ErrorCode::MessagePortCallTimeout:
+      return "The call had no reply before its deadline.";
+    case ErrorCode::MessagePortCallLimit:
+      return "Too many calls are waiting for replies.";
+    case ErrorCode::MessagePortBadFrame:
+      return "The message is not a valid frame.";
+    case ErrorCode::MessagePortServerBusy:
+      return "The server is too busy to handle the message.";
+    case ErrorCode::MessagePortUnknownMessageType:
+      return "No handler is registered for the message's type.";
+    case ErrorCode::MessagePortSendIncomplete:
+      return "Not every message of the batch was sent.";
   }
 
   return "Unknown Error";
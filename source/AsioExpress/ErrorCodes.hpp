@@ -19,6 +19,16 @@ namespace ErrorCode
     UniqueEventTimeout,
     ResourceCacheTimeout,
     MessagePortAcceptorError,
+    MessagePortBroadcastTimeout,
+    MessagePortBroadcastIncomplete,
+    MessagePortSendBufferFull,
+    MessagePortNoEndPoint,
+    MessagePortCallTimeout,
+    MessagePortCallLimit,
+    MessagePortBadFrame,
+    MessagePortServerBusy,
+    MessagePortUnknownMessageType,
+    MessagePortSendIncomplete,
   };
 
   // implicit conversion helper function
@@ -0,0 +1,98 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpressError/Check.hpp"
+#include "AsioExpress/EventHandling/Backpressure.hpp"
+
+namespace AsioExpress {
+
+Backpressure::Backpressure(
+    boost::asio::io_service & ioService,
+    SizeType highWatermark,
+    SizeType lowWatermark) :
+  m_ioService(ioService),
+  m_highWatermark(highWatermark),
+  m_lowWatermark(lowWatermark),
+  m_level(0),
+  m_isPaused(false)
+{
+  CHECK(highWatermark > 0);
+  CHECK(lowWatermark < highWatermark);
+}
+
+void Backpressure::Add(SizeType count)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  m_level += count;
+  if (m_level >= m_highWatermark)
+    m_isPaused = true;
+}
+
+void Backpressure::Remove(SizeType count)
+{
+  HandlerList resumed;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    m_level = count < m_level ? m_level - count : 0;
+    if (!m_isPaused || m_level > m_lowWatermark)
+      return;
+
+    m_isPaused = false;
+    resumed.swap(m_waiters);
+  }
+
+  Post(resumed, AsioExpress::Error());
+}
+
+Backpressure::SizeType Backpressure::GetLevel() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_level;
+}
+
+bool Backpressure::IsPaused() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_isPaused;
+}
+
+void Backpressure::AsyncWaitUntilResumed(AsioExpress::CompletionHandler completionHandler)
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_isPaused)
+    {
+      m_waiters.push_back(completionHandler);
+      return;
+    }
+  }
+
+  m_ioService.post(boost::asio::detail::bind_handler(completionHandler, AsioExpress::Error()));
+}
+
+void Backpressure::Cancel()
+{
+  HandlerList aborted;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    aborted.swap(m_waiters);
+  }
+
+  Post(aborted, AsioExpress::Error(boost::asio::error::operation_aborted));
+}
+
+void Backpressure::Post(HandlerList const & handlers, AsioExpress::Error error)
+{
+  HandlerList::const_iterator  it = handlers.begin();
+  HandlerList::const_iterator end = handlers.end();
+  for (; it != end; ++it)
+    m_ioService.post(boost::asio::detail::bind_handler(*it, error));
+}
+
+} // namespace AsioExpress
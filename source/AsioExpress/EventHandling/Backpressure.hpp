@@ -0,0 +1,78 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+
+namespace AsioExpress {
+
+///
+/// Carries the fill level of downstream queues back to their producers.
+/// Queues add their waiting events to the level and remove them as they are
+/// taken. Once the level reaches the high watermark the producers are
+/// paused, and they are resumed when it falls back to the low watermark.
+/// The gap between the two keeps the producers from pausing and resuming on
+/// every event. A server given a backpressure stops reading its connections
+/// while it is paused, so TCP flow control pushes back on the clients.
+///
+/// The level may be changed from any thread.
+///
+class Backpressure
+{
+public:
+  typedef std::size_t SizeType;
+
+  Backpressure(
+      boost::asio::io_service & ioService,
+      SizeType highWatermark,
+      SizeType lowWatermark);
+
+  void Add(SizeType count = 1);
+
+  void Remove(SizeType count = 1);
+
+  SizeType GetLevel() const;
+
+  bool IsPaused() const;
+
+  ///
+  /// Calls the handler, through the io_service, once the producers may go
+  /// on: at once if they are not paused, otherwise when they are resumed.
+  ///
+  void AsyncWaitUntilResumed(AsioExpress::CompletionHandler completionHandler);
+
+  ///
+  /// Completes every wait with operation_aborted. Later waits are not
+  /// affected.
+  ///
+  void Cancel();
+
+private:
+  typedef std::vector<AsioExpress::CompletionHandler> HandlerList;
+
+  Backpressure(Backpressure const &);
+  Backpressure & operator=(Backpressure const &);
+
+  void Post(HandlerList const & handlers, AsioExpress::Error error);
+
+  boost::asio::io_service &     m_ioService;
+  mutable boost::mutex          m_mutex;
+  SizeType                      m_highWatermark;
+  SizeType                      m_lowWatermark;
+  SizeType                      m_level;
+  bool                          m_isPaused;
+  HandlerList                   m_waiters;
+};
+
+typedef boost::shared_ptr<Backpressure> BackpressurePointer;
+
+} // namespace AsioExpress
@@ -16,6 +16,7 @@
 #include "AsioExpressError/CallStack.hpp"
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/EventHandling/Backpressure.hpp"
 #include "AsioExpress/Timer/Timer.hpp"
 
 #undef max 
@@ -89,6 +90,18 @@ public:
   ///
   void Cancel();
 
+  ///
+  /// Adds the events waiting in this queue to the level of the given
+  /// backpressure, so their producers are paused while it is too full.
+  ///
+  void SetBackpressure(BackpressurePointer const & backpressure);
+
+  ///
+  /// Gets the number of events waiting to be received, including those
+  /// waiting for room in the queue.
+  ///
+  SizeType GetSize() const;
+
   ///
   /// This method cancels all pending operations on the event queue. If
   /// AsyncWait or AsyncAdd is called on a queue that has been shut down,
@@ -139,6 +152,7 @@ private:
   WaitingEvents         m_waitingEvents;
   bool                  m_isShutDown;
   SizeType              m_maxSize;
+  BackpressurePointer   m_backpressure;
 };
 
 template<typename Event>
@@ -171,6 +185,8 @@ void EventQueue<Event>::AsyncWait(
     typename RegisteredEvents::iterator  it = m_registeredEvents.begin();
     *event = *it;
     m_registeredEvents.erase(it);
+    if (m_backpressure)
+      m_backpressure->Remove();
     completionHandler(Error());
 
     // move waiting event to registered event
@@ -223,11 +239,15 @@ void EventQueue<Event>::AsyncAdd(
   {
       // Add event and this completion hander to the following queue.
       m_waitingEvents.push_back(WaitingEvent(event,completionHandler));
+      if (m_backpressure)
+        m_backpressure->Add();
       return;
   }
 
   // No handler found so we put it in the event queue.
   m_registeredEvents.push_back(event);
+  if (m_backpressure)
+    m_backpressure->Add();
   completionHandler(Error());
 }
 
@@ -243,9 +263,32 @@ void EventQueue<Event>::Cancel()
   }
 }
 
+template<typename Event>
+void EventQueue<Event>::SetBackpressure(BackpressurePointer const & backpressure)
+{
+  if (m_backpressure)
+    m_backpressure->Remove(GetSize());
+
+  m_backpressure = backpressure;
+
+  if (m_backpressure)
+    m_backpressure->Add(GetSize());
+}
+
+template<typename Event>
+typename EventQueue<Event>::SizeType EventQueue<Event>::GetSize() const
+{
+  return m_registeredEvents.size() + m_waitingEvents.size();
+}
+
 template<typename Event>
 void EventQueue<Event>::ShutDown()
 {
+  // The events left in the queue will not be received, so they no longer
+  // hold their producers back.
+  if (m_backpressure && !m_isShutDown)
+    m_backpressure->Remove(GetSize());
+
   // Indicate that this queue is canceled.
   m_isShutDown = true;
   
@@ -138,6 +138,24 @@ public:
         eventQueue->AsyncAdd(event, completionHandler);
     }
 
+    ///
+    /// Call this method to pause the producers given the backpressure while
+    /// too many events are waiting for a task. The events waiting in this
+    /// pool are added to its level.
+    ///
+    void SetBackpressure(BackpressurePointer const & backpressure)
+    {
+        eventQueue->SetBackpressure(backpressure);
+    }
+
+    ///
+    /// Gets the number of events waiting for a task.
+    ///
+    SizeType GetQueueSize() const
+    {
+        return eventQueue->GetSize();
+    }
+
     ///
     /// Unit testing method allows events to be manually read and handled by
     /// the task pool.
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -20,18 +21,21 @@ public:
 
   DataBuffer() :
     m_size(0),
+    m_capacity(0),
     m_data(0)
   {
   }
 
   explicit DataBuffer(SizeType size) :
     m_size(size),
+    m_capacity(size),
     m_data(new char[size])
   {
   }
 
   DataBuffer(std::string const & str) :
     m_size(0),
+    m_capacity(0),
     m_data(0)
   {
     Assign(str.c_str(), str.size());
@@ -39,6 +43,7 @@ public:
 
   DataBuffer(DataBuffer const & b) :
     m_size(0),
+    m_capacity(0),
     m_data(0)
   {
       Assign(b.m_data, b.m_size);
@@ -46,7 +51,7 @@ public:
 
   ~DataBuffer()
   {
-    delete [] m_data;
+    Release();
   }
 
   DataBuffer & operator=(DataBuffer const & b)
@@ -67,12 +72,21 @@ public:
     return m_size;
   }
 
+  ///
+  /// Memory the buffer owns is kept when it shrinks, so a buffer used for
+  /// one message after another only allocates when a message is larger
+  /// than any before it. The contents are not kept.
+  ///
   void Resize(SizeType newSize)
   {
-    if (newSize == m_size)
-        return;
-    delete [] m_data;
+    if (newSize <= m_capacity && !m_owner)
+    {
+      m_size = newSize;
+      return;
+    }
+    Release();
     m_size = newSize;
+    m_capacity = newSize;
     m_data = new char [newSize];
   }
 
@@ -82,15 +96,73 @@ public:
       memcpy(m_data, newData, newSize);
   }
 
+  ///
+  /// Refers the buffer to memory that it does not own instead of copying it.
+  /// The owner is released, rather than the memory deleted, when the buffer
+  /// is next resized, assigned or destroyed.
+  ///
+  void Attach(char *data, SizeType size, boost::shared_ptr<void> owner)
+  {
+    Release();
+    m_size = size;
+    m_data = data;
+    m_owner = owner;
+  }
+
+  ///
+  /// Drops the given number of bytes from the front of the buffer, as when
+  /// a header has been read. Attached memory is not moved; the buffer just
+  /// refers to less of it.
+  ///
+  void Consume(SizeType count)
+  {
+    if (count > m_size)
+      count = m_size;
+
+    if (m_owner)
+      m_data += count;
+    else
+      memmove(m_data, m_data + count, m_size - count);
+
+    m_size -= count;
+  }
+
+  bool IsAttached() const
+  {
+    return m_owner.get() != 0;
+  }
+
+  ///
+  /// Exchanges the contents of the buffers without copying them.
+  ///
+  void Swap(DataBuffer & other)
+  {
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_data, other.m_data);
+    m_owner.swap(other.m_owner);
+  }
+
   bool operator==(DataBuffer const &other) const
   {
     return (m_size == other.m_size) && memcmp(m_data, other.m_data, m_size)==0;
   }
 
 private:
+  void Release()
+  {
+    if (m_owner)
+      m_owner.reset();
+    else
+      delete [] m_data;
+    m_data = 0;
+    m_capacity = 0;
+  }
 
-  SizeType   m_size;
-  char *     m_data;
+  SizeType                  m_size;
+  SizeType                  m_capacity;
+  char *                    m_data;
+  boost::shared_ptr<void>   m_owner;
 };
 
 typedef boost::shared_ptr<DataBuffer> DataBufferPointer;
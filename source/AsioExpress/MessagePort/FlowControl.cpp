@@ -0,0 +1,174 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include "AsioExpressError/Check.hpp"
+#include "AsioExpress/MessagePort/FlowControl.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+FlowControl::FlowControl(FlowControlSettings const & settings) :
+  m_settings(settings),
+  m_grantThreshold(std::max(1u, settings.credits / 2)),
+  m_credits(0),
+  m_ungranted(settings.credits),
+  m_isItemHeld(false),
+  m_isWaiting(false),
+  m_isAborted(false)
+{
+  // The peer starts with nothing until it is granted every credit.
+  CHECK(settings.credits > 0);
+}
+
+boost::uint32_t FlowControl::GetCost(DataBuffer const & buffer) const
+{
+  if (m_settings.unit == FlowControlSettings::ByteCredits)
+    return static_cast<boost::uint32_t>(buffer.Size());
+  return 1;
+}
+
+FlowControl::Action FlowControl::BeginSend(
+    SendQueue::Item const & item,
+    boost::uint32_t & grant)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  grant = 0;
+  if (m_isAborted)
+    return SendItem;
+
+  if (m_credits > 0)
+  {
+    m_credits -= GetCost(item);
+    grant = m_ungranted;
+    m_ungranted = 0;
+    return SendItem;
+  }
+
+  m_heldItem = item;
+  m_isItemHeld = true;
+
+  // The peer may be waiting for this grant before it can send the credits
+  // the item is waiting for.
+  if (m_ungranted >= m_grantThreshold)
+  {
+    grant = m_ungranted;
+    m_ungranted = 0;
+    return SendGrant;
+  }
+
+  m_isWaiting = true;
+  return Wait;
+}
+
+bool FlowControl::TakeHeldItem(SendQueue::Item & item)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  if (!m_isItemHeld)
+    return false;
+
+  item = m_heldItem;
+  m_heldItem = SendQueue::Item();
+  m_isItemHeld = false;
+  return true;
+}
+
+bool FlowControl::TakeWaitingSend()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  bool isWaiting = m_isWaiting;
+  m_isWaiting = false;
+  return isWaiting;
+}
+
+bool FlowControl::AddCredits(boost::uint32_t credits)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  m_credits += credits;
+  if (!m_isWaiting || m_credits <= 0)
+    return false;
+
+  m_isWaiting = false;
+  return true;
+}
+
+bool FlowControl::Received(boost::uint32_t cost)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  m_ungranted += cost;
+  if (!m_isWaiting || m_ungranted < m_grantThreshold)
+    return false;
+
+  m_isWaiting = false;
+  return true;
+}
+
+bool FlowControl::IsGrantDue() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return !m_isAborted && m_ungranted >= m_grantThreshold;
+}
+
+boost::uint32_t FlowControl::TakeGrant()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  boost::uint32_t grant = m_ungranted;
+  m_ungranted = 0;
+  return grant;
+}
+
+bool FlowControl::Abort(boost::asio::io_service & ioService, AsioExpress::Error error)
+{
+  SendQueue::Item item;
+  bool isItemHeld = false;
+  bool isWaiting = false;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    m_isAborted = true;
+    isItemHeld = m_isItemHeld;
+    item = m_heldItem;
+    m_heldItem = SendQueue::Item();
+    m_isItemHeld = false;
+    isWaiting = m_isWaiting;
+    m_isWaiting = false;
+  }
+
+  if (isItemHeld)
+    ioService.post(boost::asio::detail::bind_handler(item.completionHandler, error));
+
+  return isWaiting;
+}
+
+boost::int64_t FlowControl::GetCredits() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_credits;
+}
+
+boost::uint32_t FlowControl::GetCost(SendQueue::Item const & item) const
+{
+  if (!item.batch)
+    return GetCost(*item.dataBuffer);
+
+  boost::uint32_t cost = 0;
+  DataBufferList::const_iterator  it = item.batch->begin();
+  DataBufferList::const_iterator end = item.batch->end();
+  for (; it != end; ++it)
+    cost += GetCost(**it);
+  return cost;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,129 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/SendQueue.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+struct FlowControlSettings
+{
+  /// What a credit is good for.
+  enum Unit
+  {
+    MessageCredits,
+    ByteCredits
+  };
+
+  FlowControlSettings() :
+    credits(0),
+    unit(MessageCredits)
+  {
+  }
+
+  /// The credits granted to the peer; zero turns flow control off.
+  unsigned int    credits;
+  Unit            unit;
+};
+
+///
+/// Keeps the credits of one connection's flow control. The peer may only
+/// send while it holds credits this end has granted, and this end only
+/// while it holds credits granted by the peer. A message uses up one credit,
+/// or one per byte, when it is sent, and the receiver grants it back when
+/// the message has been received. Grants go along with the messages being
+/// sent, or on their own once half the credits are waiting to be granted.
+///
+/// A send without credits is held here, with the port's send side, until
+/// the peer grants more. Any send may take the port's last credit, so a
+/// message larger than the byte credits is still sent.
+///
+class FlowControl
+{
+public:
+  /// What the owner of the port's send side is to do with an item.
+  enum Action
+  {
+    SendItem,
+
+    /// Send the grant due first; the item is held.
+    SendGrant,
+
+    /// Wait for credits; the item and the send side are held.
+    Wait
+  };
+
+  explicit FlowControl(FlowControlSettings const & settings);
+
+  boost::uint32_t GetCost(DataBuffer const & buffer) const;
+
+  ///
+  /// Decides what the owner of the send side does with the item. The grant
+  /// to send with it, or on its own, is taken.
+  ///
+  Action BeginSend(SendQueue::Item const & item, boost::uint32_t & grant);
+
+  /// Takes the item held for credits, if there is one.
+  bool TakeHeldItem(SendQueue::Item & item);
+
+  /// Takes the send side from a send waiting for credits.
+  bool TakeWaitingSend();
+
+  /// Returns true when a waiting send is to go on.
+  bool AddCredits(boost::uint32_t credits);
+
+  ///
+  /// Counts the cost of a received message as due to be granted back.
+  /// Returns true when a waiting send is to go on, to send the grant.
+  ///
+  bool Received(boost::uint32_t cost);
+
+  bool IsGrantDue() const;
+
+  boost::uint32_t TakeGrant();
+
+  ///
+  /// Fails the item held for credits, and lets every later send go ahead
+  /// without credits, to fail with the closed connection. Returns true when
+  /// a send was waiting, which is to go on.
+  ///
+  bool Abort(boost::asio::io_service & ioService, AsioExpress::Error error);
+
+  boost::int64_t GetCredits() const;
+
+private:
+  FlowControl(FlowControl const &);
+  FlowControl & operator=(FlowControl const &);
+
+  boost::uint32_t GetCost(SendQueue::Item const & item) const;
+
+  mutable boost::mutex      m_mutex;
+  FlowControlSettings       m_settings;
+  boost::uint32_t           m_grantThreshold;
+  boost::int64_t            m_credits;
+  boost::uint32_t           m_ungranted;
+  bool                      m_isItemHeld;
+  bool                      m_isWaiting;
+  bool                      m_isAborted;
+  SendQueue::Item           m_heldItem;
+};
+
+typedef boost::shared_ptr<FlowControl> FlowControlPointer;
+
+/// Called with the credits the peer grants.
+typedef boost::function<void (boost::uint32_t)> CreditFunction;
+
+} // namespace MessagePort
+} // namespace AsioExpress
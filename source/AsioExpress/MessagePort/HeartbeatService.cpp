@@ -0,0 +1,249 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+boost::asio::io_service::id HeartbeatService::id;
+int const HeartbeatService::TickMilliseconds;
+
+namespace
+{
+  // The progress tick of a deadline with nothing waiting on it.
+  boost::uint64_t const NotWaiting = ~static_cast<boost::uint64_t>(0);
+
+  boost::uint64_t Shorter(boost::uint64_t shortest, boost::uint64_t ticks)
+  {
+    if (shortest == 0 || (ticks != 0 && ticks < shortest))
+      return ticks;
+    return shortest;
+  }
+}
+
+Heartbeat::Heartbeat(
+    Tick pingTicks,
+    Tick timeoutTicks,
+    Tick sendTicks,
+    Tick receiveTicks,
+    Tick idleTicks,
+    Function ping,
+    Function timeout,
+    DeadlineFunction expired) :
+  m_sent(false),
+  m_received(false),
+  m_isReceiving(false),
+  m_sendsStarted(0),
+  m_sendsCompleted(0),
+  m_receivesCompleted(0),
+  m_isStopped(false),
+  m_ping(ping),
+  m_timeout(timeout),
+  m_expired(expired),
+  m_pingTicks(pingTicks),
+  m_timeoutTicks(timeoutTicks),
+  m_sendTicks(sendTicks),
+  m_receiveTicks(receiveTicks),
+  m_idleTicks(idleTicks),
+  m_checkTicks(0),
+  m_lastSent(0),
+  m_lastReceived(0),
+  m_lastSendProgress(NotWaiting),
+  m_lastReceiveProgress(NotWaiting),
+  m_lastActivity(0),
+  m_sendsStartedSeen(0),
+  m_sendsCompletedSeen(0),
+  m_receivesCompletedSeen(0)
+{
+  //
+  // Traffic is only noticed when the heartbeat is checked, so checking a
+  // few times per interval keeps pings, timeouts and deadlines close to
+  // the intervals asked for.
+  //
+  Tick shortest = pingTicks;
+  shortest = Shorter(shortest, timeoutTicks);
+  shortest = Shorter(shortest, sendTicks);
+  shortest = Shorter(shortest, receiveTicks);
+  shortest = Shorter(shortest, idleTicks);
+
+  m_checkTicks = std::max<Tick>(1, shortest / 4);
+}
+
+void Heartbeat::Stop()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  m_isStopped = true;
+  m_ping = 0;
+  m_timeout = 0;
+  m_expired = 0;
+}
+
+bool Heartbeat::Check(Tick now)
+{
+  // The functions are called once the lock is released, so they can take
+  // their own locks without ordering them against this one.
+  FunctionList due;
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_isStopped)
+      return false;
+
+    if (m_received.exchange(false, boost::memory_order_relaxed))
+      m_lastReceived = now;
+
+    if (m_sent.exchange(false, boost::memory_order_relaxed))
+      m_lastSent = now;
+
+    if (m_timeoutTicks != 0 && now - m_lastReceived >= m_timeoutTicks)
+    {
+      m_lastReceived = now;
+      due.push_back(m_timeout);
+    }
+
+    if (m_pingTicks != 0 && now - m_lastSent >= m_pingTicks)
+    {
+      m_lastSent = now;
+      due.push_back(m_ping);
+    }
+
+    CheckDeadlines(now, due);
+  }
+
+  FunctionList::const_iterator  it = due.begin();
+  FunctionList::const_iterator end = due.end();
+  for (; it != end; ++it)
+    (*it)();
+
+  return true;
+}
+
+void Heartbeat::CheckDeadlines(Tick now, FunctionList & due)
+{
+  boost::uint64_t sendsStarted = m_sendsStarted.load(boost::memory_order_relaxed);
+  boost::uint64_t sendsCompleted = m_sendsCompleted.load(boost::memory_order_relaxed);
+  boost::uint64_t receivesCompleted = m_receivesCompleted.load(boost::memory_order_relaxed);
+  bool isReceiving = m_isReceiving.load(boost::memory_order_relaxed);
+
+  // Pings are not messages, so they do not keep a connection from idling.
+  if (sendsStarted != m_sendsStartedSeen || receivesCompleted != m_receivesCompletedSeen)
+    m_lastActivity = now;
+
+  //
+  // A deadline runs from the check that first sees an operation waiting,
+  // or that sees one complete while others wait, so it expires no sooner
+  // than asked for and at most a check later.
+  //
+  if (sendsCompleted >= sendsStarted)
+    m_lastSendProgress = NotWaiting;
+  else if (sendsCompleted != m_sendsCompletedSeen || m_lastSendProgress == NotWaiting)
+    m_lastSendProgress = now;
+
+  if (!isReceiving)
+    m_lastReceiveProgress = NotWaiting;
+  else if (receivesCompleted != m_receivesCompletedSeen || m_lastReceiveProgress == NotWaiting)
+    m_lastReceiveProgress = now;
+
+  m_sendsStartedSeen = sendsStarted;
+  m_sendsCompletedSeen = sendsCompleted;
+  m_receivesCompletedSeen = receivesCompleted;
+
+  if (m_sendTicks != 0 && m_lastSendProgress != NotWaiting && now - m_lastSendProgress >= m_sendTicks)
+  {
+    m_lastSendProgress = now;
+    due.push_back(boost::bind(m_expired, SendDeadline));
+  }
+
+  if (m_receiveTicks != 0 && m_lastReceiveProgress != NotWaiting && now - m_lastReceiveProgress >= m_receiveTicks)
+  {
+    m_lastReceiveProgress = now;
+    due.push_back(boost::bind(m_expired, ReceiveDeadline));
+  }
+
+  if (m_idleTicks != 0 && now - m_lastActivity >= m_idleTicks)
+  {
+    m_lastActivity = now;
+    due.push_back(boost::bind(m_expired, IdleDeadline));
+  }
+}
+
+bool Heartbeat::IsScheduled() const
+{
+  return m_pingTicks != 0 || m_timeoutTicks != 0 ||
+    m_sendTicks != 0 || m_receiveTicks != 0 || m_idleTicks != 0;
+}
+
+HeartbeatService::HeartbeatService(boost::asio::io_service & ioService) :
+  boost::asio::io_service::service(ioService),
+  m_wheel(boost::asio::use_service<TimingWheelService>(ioService))
+{
+}
+
+HeartbeatPointer HeartbeatService::Start(
+    int pingMilliseconds,
+    int timeoutMilliseconds,
+    Heartbeat::Function ping,
+    Heartbeat::Function timeout)
+{
+  HeartbeatSettings settings;
+  settings.pingInterval = pingMilliseconds;
+  settings.pingTimeout = timeoutMilliseconds;
+
+  return Start(settings, ping, timeout, Heartbeat::DeadlineFunction());
+}
+
+HeartbeatPointer HeartbeatService::Start(
+    HeartbeatSettings const & settings,
+    Heartbeat::Function ping,
+    Heartbeat::Function timeout,
+    Heartbeat::DeadlineFunction expired)
+{
+  HeartbeatPointer heartbeat(new Heartbeat(
+    TimingWheelService::ToTicks(settings.pingInterval),
+    TimingWheelService::ToTicks(settings.pingTimeout),
+    TimingWheelService::ToTicks(settings.sendTimeout),
+    TimingWheelService::ToTicks(settings.receiveTimeout),
+    TimingWheelService::ToTicks(settings.idleTimeout),
+    ping,
+    timeout,
+    expired));
+
+  if (!heartbeat->IsScheduled())
+    return heartbeat;
+
+  Heartbeat::Tick now = m_wheel.GetTick();
+  heartbeat->m_lastSent = now;
+  heartbeat->m_lastReceived = now;
+  heartbeat->m_lastActivity = now;
+  m_wheel.Schedule(
+    now + heartbeat->m_checkTicks,
+    boost::bind(&HeartbeatService::Check, heartbeat, _1));
+
+  return heartbeat;
+}
+
+void HeartbeatService::shutdown_service()
+{
+  // The heartbeats are released with the timing wheel.
+}
+
+Heartbeat::Tick HeartbeatService::Check(HeartbeatPointer heartbeat, Heartbeat::Tick now)
+{
+  if (!heartbeat->Check(now))
+    return 0;
+
+  return now + heartbeat->m_checkTicks;
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
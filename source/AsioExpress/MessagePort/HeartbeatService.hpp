@@ -0,0 +1,231 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/MessagePort/TimingWheelService.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+class HeartbeatService;
+
+///
+/// What a heartbeat watches for, in milliseconds; zero disables each one.
+///
+struct HeartbeatSettings
+{
+  HeartbeatSettings() :
+    pingInterval(0),
+    pingTimeout(0),
+    sendTimeout(0),
+    receiveTimeout(0),
+    idleTimeout(0)
+  {
+  }
+
+  /// A ping is sent when nothing has been sent for this long.
+  int   pingInterval;
+
+  /// The peer is lost when nothing, not even a ping, is heard for this long.
+  int   pingTimeout;
+
+  /// A send that waits this long without any send completing has expired.
+  int   sendTimeout;
+
+  /// A receive that waits this long for a message has expired.
+  int   receiveTimeout;
+
+  /// A connection with no messages either way for this long is idle.
+  int   idleTimeout;
+};
+
+///
+/// The liveness state of one connection. The transport reports traffic by
+/// calling Sent() and Received(), and its sends and receives by the
+/// Started() and Completed() calls, which only set a flag or count; the
+/// heartbeat service samples them on its own schedule, so there is no
+/// clock read or timer per message. Deadlines are only as precise as the
+/// service's checks, which are a few per shortest interval.
+///
+class Heartbeat
+{
+public:
+  typedef boost::function<void ()> Function;
+
+  enum Deadline
+  {
+    SendDeadline,
+    ReceiveDeadline,
+    IdleDeadline
+  };
+
+  typedef boost::function<void (Deadline)> DeadlineFunction;
+
+  /// Records outgoing traffic; a connection that is sending needs no ping.
+  void Sent()
+  {
+    m_sent.store(true, boost::memory_order_relaxed);
+  }
+
+  /// Records incoming traffic, which shows the peer is alive.
+  void Received()
+  {
+    m_received.store(true, boost::memory_order_relaxed);
+  }
+
+  /// Records a message send, which is outgoing traffic.
+  void SendStarted()
+  {
+    m_sent.store(true, boost::memory_order_relaxed);
+    m_sendsStarted.fetch_add(1, boost::memory_order_relaxed);
+  }
+
+  void SendCompleted()
+  {
+    m_sendsCompleted.fetch_add(1, boost::memory_order_relaxed);
+  }
+
+  /// Records a message receive; the peer has from now to be heard from.
+  void ReceiveStarted()
+  {
+    m_received.store(true, boost::memory_order_relaxed);
+    m_isReceiving.store(true, boost::memory_order_relaxed);
+  }
+
+  void ReceiveCompleted()
+  {
+    m_isReceiving.store(false, boost::memory_order_relaxed);
+    m_receivesCompleted.fetch_add(1, boost::memory_order_relaxed);
+  }
+
+  ///
+  /// Stops the heartbeat and releases its functions. Once this returns none
+  /// of them is called again, but a call the service has already begun may
+  /// still be running, and work a function has posted, such as a TCP port's
+  /// ping on its strand, still runs.
+  ///
+  void Stop();
+
+private:
+  friend class HeartbeatService;
+
+  typedef TimingWheelService::Tick Tick;
+
+  Heartbeat(
+      Tick pingTicks,
+      Tick timeoutTicks,
+      Tick sendTicks,
+      Tick receiveTicks,
+      Tick idleTicks,
+      Function ping,
+      Function timeout,
+      DeadlineFunction expired);
+
+  Heartbeat(Heartbeat const &);
+  Heartbeat & operator=(Heartbeat const &);
+
+  typedef std::vector<Function> FunctionList;
+
+  // Returns false once the heartbeat has been stopped.
+  bool Check(Tick now);
+
+  // Requires the heartbeat to be locked. Adds the functions that are due.
+  void CheckDeadlines(Tick now, FunctionList & due);
+
+  bool IsScheduled() const;
+
+  boost::atomic<bool>               m_sent;
+  boost::atomic<bool>               m_received;
+  boost::atomic<bool>               m_isReceiving;
+  boost::atomic<boost::uint64_t>    m_sendsStarted;
+  boost::atomic<boost::uint64_t>    m_sendsCompleted;
+  boost::atomic<boost::uint64_t>    m_receivesCompleted;
+
+  boost::mutex          m_mutex;
+  bool                  m_isStopped;
+  Function              m_ping;
+  Function              m_timeout;
+  DeadlineFunction      m_expired;
+
+  // only used by the service
+  Tick                  m_pingTicks;
+  Tick                  m_timeoutTicks;
+  Tick                  m_sendTicks;
+  Tick                  m_receiveTicks;
+  Tick                  m_idleTicks;
+  Tick                  m_checkTicks;
+  Tick                  m_lastSent;
+  Tick                  m_lastReceived;
+  Tick                  m_lastSendProgress;
+  Tick                  m_lastReceiveProgress;
+  Tick                  m_lastActivity;
+  boost::uint64_t       m_sendsStartedSeen;
+  boost::uint64_t       m_sendsCompletedSeen;
+  boost::uint64_t       m_receivesCompletedSeen;
+};
+
+typedef boost::shared_ptr<Heartbeat> HeartbeatPointer;
+
+///
+/// Pings idle connections, detects dead peers and expires the deadlines of
+/// sends, receives and idle connections for every message port on an
+/// io_service. The heartbeats are checked on the io_service's timing wheel,
+/// so the cost does not depend on the number of connections and the timer
+/// only runs while there is something on the wheel.
+///
+class HeartbeatService : public boost::asio::io_service::service
+{
+public:
+  static boost::asio::io_service::id id;
+
+  /// The resolution of the wheel; intervals are rounded up to a whole tick.
+  static int const TickMilliseconds = TimingWheelService::TickMilliseconds;
+
+  explicit HeartbeatService(boost::asio::io_service & ioService);
+
+  ///
+  /// Starts a heartbeat. The ping function is called when nothing has been
+  /// sent for pingMilliseconds and the timeout function each time nothing
+  /// has been received for timeoutMilliseconds; zero disables either one.
+  /// Both are called from the io_service, without the heartbeat locked, so
+  /// they may stop it.
+  ///
+  HeartbeatPointer Start(
+      int pingMilliseconds,
+      int timeoutMilliseconds,
+      Heartbeat::Function ping,
+      Heartbeat::Function timeout);
+
+  ///
+  /// Starts a heartbeat that also has deadlines. The expired function is
+  /// called with the deadline that passed, each time it passes, and is
+  /// called from the io_service as the others are.
+  ///
+  HeartbeatPointer Start(
+      HeartbeatSettings const & settings,
+      Heartbeat::Function ping,
+      Heartbeat::Function timeout,
+      Heartbeat::DeadlineFunction expired);
+
+private:
+  virtual void shutdown_service();
+
+  static Heartbeat::Tick Check(HeartbeatPointer heartbeat, Heartbeat::Tick now);
+
+  TimingWheelService &          m_wheel;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
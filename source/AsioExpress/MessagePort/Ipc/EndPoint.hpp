@@ -15,6 +15,11 @@ namespace Ipc {
 class EndPoint
 {
 public:
+  static int const DefaultConnectTimeoutMilliseconds = 8000;
+  static std::size_t const DefaultBroadcastBytes = 8 * 1024 * 1024;
+  static int const DefaultPingIntervalMilliseconds = 10000;
+  static int const DefaultPingTimeoutMilliseconds = 25000;
+
   EndPoint(
       std::string messagePortName,
       std::size_t maxNumMsg = 100,
@@ -23,7 +28,11 @@ public:
     m_messagePortName(messagePortName),
     m_maxNumMsg(maxNumMsg),
     m_maxMsgSize(maxMsgSize),
-    m_permissions(permissions)
+    m_permissions(permissions),
+    m_connectTimeout(DefaultConnectTimeoutMilliseconds),
+    m_broadcastBytes(DefaultBroadcastBytes),
+    m_pingInterval(DefaultPingIntervalMilliseconds),
+    m_pingTimeout(DefaultPingTimeoutMilliseconds)
   {
   }
 
@@ -31,7 +40,11 @@ public:
       std::string messagePortName,
       boost::interprocess::permissions permissions) :
     m_messagePortName(messagePortName),
-    m_permissions(permissions)
+    m_permissions(permissions),
+    m_connectTimeout(DefaultConnectTimeoutMilliseconds),
+    m_broadcastBytes(DefaultBroadcastBytes),
+    m_pingInterval(DefaultPingIntervalMilliseconds),
+    m_pingTimeout(DefaultPingTimeoutMilliseconds)
   {
   }
 
@@ -39,7 +52,11 @@ public:
     m_messagePortName(ep.m_messagePortName),
     m_maxNumMsg(ep.m_maxNumMsg),
     m_maxMsgSize(ep.m_maxMsgSize),
-    m_permissions(ep.m_permissions)
+    m_permissions(ep.m_permissions),
+    m_connectTimeout(ep.m_connectTimeout),
+    m_broadcastBytes(ep.m_broadcastBytes),
+    m_pingInterval(ep.m_pingInterval),
+    m_pingTimeout(ep.m_pingTimeout)
   {
   }
 
@@ -49,7 +66,11 @@ public:
       this->m_messagePortName == that.m_messagePortName &&
       this->m_maxNumMsg == that.m_maxNumMsg &&
       this->m_maxMsgSize == that.m_maxMsgSize &&
-      this->m_permissions.get_permissions() == that.m_permissions.get_permissions();
+      this->m_permissions.get_permissions() == that.m_permissions.get_permissions() &&
+      this->m_connectTimeout == that.m_connectTimeout &&
+      this->m_broadcastBytes == that.m_broadcastBytes &&
+      this->m_pingInterval == that.m_pingInterval &&
+      this->m_pingTimeout == that.m_pingTimeout;
   }
 
   inline const std::string& GetEndPoint() const
@@ -72,11 +93,65 @@ public:
     return m_permissions;
   }
 
+  ///
+  /// Sets how long a connect waits for the acceptor to acknowledge it.
+  ///
+  inline void SetConnectTimeout(int milliseconds)
+  {
+    m_connectTimeout = milliseconds;
+  }
+
+  inline int GetConnectTimeout() const
+  {
+    return m_connectTimeout;
+  }
+
+  ///
+  /// Sets the size of the shared memory ring an acceptor uses to broadcast
+  /// messages to its clients. Zero disables the ring and broadcasts are sent
+  /// through each client's message queue instead.
+  ///
+  inline void SetBroadcastBytes(std::size_t bytes)
+  {
+    m_broadcastBytes = bytes;
+  }
+
+  inline std::size_t GetBroadcastBytes() const
+  {
+    return m_broadcastBytes;
+  }
+
+  ///
+  /// Sets how long a connection may be idle before a ping is sent, and how
+  /// long a receive waits without hearing from the peer before the
+  /// connection is considered lost. Zero disables either one. The timeout
+  /// must be longer than the ping interval used by the peer.
+  ///
+  inline void SetHeartbeat(int pingIntervalMilliseconds, int pingTimeoutMilliseconds)
+  {
+    m_pingInterval = pingIntervalMilliseconds;
+    m_pingTimeout = pingTimeoutMilliseconds;
+  }
+
+  inline int GetPingInterval() const
+  {
+    return m_pingInterval;
+  }
+
+  inline int GetPingTimeout() const
+  {
+    return m_pingTimeout;
+  }
+
 private:
   std::string                       m_messagePortName;
   std::size_t                       m_maxNumMsg;
   std::size_t                       m_maxMsgSize;
   boost::interprocess::permissions  m_permissions;
+  int                               m_connectTimeout;
+  std::size_t                       m_broadcastBytes;
+  int                               m_pingInterval;
+  int                               m_pingTimeout;
 };
 
 } // namespace Ipc
@@ -24,6 +24,7 @@ namespace ErrorCode
     TimeOutExpired,
     MessageQueueSendFailed,
     LostConnection,
+    BroadcastOverrun,
  };
 
   // implicit conversion helper function
@@ -47,6 +47,9 @@ std::string ErrorCategoryImpl::message(int ev) const
 
     case ErrorCode::LostConnection:
       return "Lost connection with peer.";
+
+    case ErrorCode::BroadcastOverrun:
+      return "Broadcast messages were overwritten before they were read.";
   }
 
   return "Unknown Error";
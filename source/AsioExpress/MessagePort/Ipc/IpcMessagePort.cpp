@@ -12,6 +12,8 @@
 #include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandConnect.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandReceive.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcConstants.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -19,7 +21,9 @@ namespace Ipc {
 
 
 MessagePort::MessagePort(boost::asio::io_service & ioService) :
-  m_ioService(ioService)
+  m_ioService(ioService),
+  m_isBroadcastSubscriber(false),
+  m_counters(new PortCounters)
 {
 }
 
@@ -32,6 +36,14 @@ MessagePort::~MessagePort()
 
 void MessagePort::Disconnect()
 {
+  // The heartbeat calls into the threads so it is stopped first.
+  //
+  if (m_heartbeat)
+  {
+    m_heartbeat->Stop();
+    m_heartbeat.reset();
+  }
+
   // Before allowing a disconnect, make sure any threads are completed.
   //
   if (m_receiveThread)
@@ -49,22 +61,24 @@ void MessagePort::Disconnect()
 
   if ( m_sendMessageQueue )
   {
-    m_recvMessageQueue.reset();
+    m_sendMessageQueue.reset();
   }
 
   // Delete the queues from the system
   //
   if ( !m_sendMessageQueueName.empty() )
   {
-    boost::interprocess::message_queue::remove(m_sendMessageQueueName.c_str());
+    RemoveConnectionQueue(m_sendMessageQueueName);
     m_sendMessageQueueName = "";
   }
 
   if ( !m_recvMessageQueueName.empty() )
   {
-    boost::interprocess::message_queue::remove(m_recvMessageQueueName.c_str());
+    RemoveConnectionQueue(m_recvMessageQueueName);
     m_recvMessageQueueName = "";
   }
+
+  m_isBroadcastSubscriber = false;
 }
 
 
@@ -100,13 +114,19 @@ void MessagePort::AsyncSend(
     return;
   }
 
+  if (m_heartbeat)
+    m_heartbeat->Sent();
+
+  AsioExpress::CompletionHandler countingHandler = 
+    CountingSendHandler<AsioExpress::CompletionHandler>(m_counters, buffer, completionHandler);
+
   try
   {
     // Send the message or fail if queue is full
     m_sendThread->AsyncSend(
       buffer,
       0,
-      completionHandler);
+      countingHandler);
   }
   catch(AsioExpress::CommonException const & e)
   {
@@ -115,8 +135,26 @@ void MessagePort::AsyncSend(
     // being active)
     Disconnect();
     // Call completion handler as it will not get called if exception is thrown
-    AsioExpress::CallCompletionHandler(m_ioService, completionHandler, e.GetError());
+    AsioExpress::CallCompletionHandler(m_ioService, countingHandler, e.GetError());
+  }
+}
+
+void MessagePort::AsyncSendBatch(
+    AsioExpress::MessagePort::DataBufferListPointer batch,
+    AsioExpress::CompletionHandler completionHandler)
+{
+  if (batch->empty())
+  {
+    AsioExpress::CallCompletionHandler(m_ioService, completionHandler, AsioExpress::Error());
+    return;
   }
+
+  SendBatchHandler batchHandler(batch->size(), completionHandler);
+
+  AsioExpress::MessagePort::DataBufferList::const_iterator  it = batch->begin();
+  AsioExpress::MessagePort::DataBufferList::const_iterator end = batch->end();
+  for (; it != end; ++it)
+    AsyncSend(*it, batchHandler);
 }
 
 void MessagePort::AsyncReceive(
@@ -140,7 +178,10 @@ void MessagePort::AsyncReceive(
                     m_receiveThread,
                     m_recvMessageQueue,
                     buffer,
-                    completionHandler,
+                    CountingReceiveHandler<AsioExpress::CompletionHandler>(
+                      m_counters, 
+                      buffer, 
+                      completionHandler),
                     0)();
 }
 
@@ -155,8 +196,10 @@ AsioExpress::Error MessagePort::SetupWithMessageQueues(const std::string& sendQu
     m_recvMessageQueueName = recvQueue;    
     m_sendMessageQueue.reset(new boost::interprocess::message_queue(boost::interprocess::open_only, m_sendMessageQueueName.c_str()));
     m_recvMessageQueue.reset(new boost::interprocess::message_queue(boost::interprocess::open_only, m_recvMessageQueueName.c_str()));
-    m_receiveThread.reset(new IpcReceiveThread(m_ioService, m_recvMessageQueue, IpcReceiveThread::EnablePing));
-    m_sendThread.reset(new IpcSendThread(m_ioService, m_sendMessageQueue, IpcSendThread::EnablePing));
+    m_receiveThread.reset(new IpcReceiveThread(m_ioService, m_recvMessageQueue, IpcReceiveThread::EnablePing, 
+        IpcBlobPoolPointer(new IpcBlobPool(m_recvMessageQueueName, BlobPoolBytes))));
+    m_sendThread.reset(new IpcSendThread(m_ioService, m_sendMessageQueue, IpcSendThread::EnablePing, 
+        IpcBlobPoolPointer(new IpcBlobPool(m_sendMessageQueueName, BlobPoolBytes))));
   }
   catch(boost::interprocess::interprocess_exception& ex) 
   {
@@ -170,10 +213,31 @@ AsioExpress::Error MessagePort::SetupWithMessageQueues(const std::string& sendQu
   return AsioExpress::Error();
 }
 
+void MessagePort::StartHeartbeat(EndPoint const & endPoint)
+{
+  m_heartbeat = boost::asio::use_service<HeartbeatService>(m_ioService).Start(
+    endPoint.GetPingInterval(),
+    endPoint.GetPingTimeout(),
+    boost::bind(&IpcSendThread::SendPing, m_sendThread),
+    boost::bind(&IpcReceiveThread::PingTimeout, m_receiveThread));
+
+  m_receiveThread->AttachHeartbeat(m_heartbeat);
+}
+
 void MessagePort::SetMessagePortOptions()
 {
 }
 
+void MessagePort::ShutdownSend()
+{
+  Disconnect();
+}
+
+void MessagePort::GetStatistics(PortStatistics & statistics) const
+{
+  m_counters->Get(statistics);
+}
+
 } // namespace Ipc
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -9,7 +9,17 @@
 #include "AsioExpress/MessagePort/Ipc/MessagePortAcceptor.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandAccept.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandConnect.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
 #include "private/IpcSysMessage.hpp"
+#include "AsioExpress/Platform/DebugMessage.hpp"
+
+namespace
+{
+  // Sweeping lists every shared memory object on the system, so accepts
+  // repeat it at most this often.
+  boost::posix_time::time_duration const SweepInterval =
+    boost::posix_time::seconds(30);
+}
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -26,18 +36,10 @@ MessagePortAcceptor::MessagePortAcceptor(
   boost::interprocess::message_queue::remove(endPoint.GetEndPoint().c_str());
 
 
-  // Clear all client/server message queues for this endpoint to avoid stale queues
-  // due to client crashes
-  std::string name;
-  for ( int i = IpcCommandConnect::LowConnectionId;
-        i <= IpcCommandConnect::HighConnectionId;
-        i++ )
-  {
-    name = m_endPoint.GetEndPoint() + "#Server#" + IntToString(i);
-    boost::interprocess::message_queue::remove(name.c_str());
-    name = m_endPoint.GetEndPoint() + "#Client#" + IntToString(i);
-    boost::interprocess::message_queue::remove(name.c_str());
-  }
+  // Clear client/server message queues for this endpoint left behind by 
+  // processes that have crashed
+  RemoveOrphanedQueues(m_endPoint.GetEndPoint());
+  m_lastSweepTime = boost::posix_time::microsec_clock::universal_time();
 
 
   // Create our acceptor message queue
@@ -49,6 +51,26 @@ MessagePortAcceptor::MessagePortAcceptor(
     endPoint.GetPermissions()));
 
   m_receiveThread.reset(new IpcReceiveThread(ioService, m_messageQueue, IpcReceiveThread::DisablePing));
+
+  // Create the ring broadcasts are written to. Without it broadcasts are 
+  // still sent through each client's message queue.
+  if ( endPoint.GetBroadcastBytes() > 0 )
+  {
+    try
+    {
+      m_broadcastRing = IpcBroadcastRing::Create(
+        endPoint.GetEndPoint(),
+        endPoint.GetBroadcastBytes(),
+        endPoint.GetPermissions());
+    }
+    catch(boost::interprocess::interprocess_exception &)
+    {
+#ifdef DEBUG_IPC
+      DebugMessage("MessagePortAcceptor: Unable to create broadcast ring!\n");
+#endif
+      IpcBroadcastRing::Remove(endPoint.GetEndPoint());
+    }
+  }
 }
 
 
@@ -66,6 +88,13 @@ void MessagePortAcceptor::Close()
   // Ok now we can destroy the queue
   m_messageQueue.reset();
   boost::interprocess::message_queue::remove(m_endPoint.GetEndPoint().c_str());
+
+  // Subscribers keep their own mapping of the ring until they disconnect.
+  if (m_broadcastRing)
+  {
+    m_broadcastRing.reset();
+    IpcBroadcastRing::Remove(m_endPoint.GetEndPoint());
+  }
 }
 
 
@@ -73,9 +102,27 @@ void MessagePortAcceptor::AsyncAccept(
     MessagePort & messagePort,
     AsioExpress::CompletionHandler completionHandler)
 {
+  boost::posix_time::ptime const now(
+    boost::posix_time::microsec_clock::universal_time());
+
+  if ( now - m_lastSweepTime >= SweepInterval )
+  {
+    RemoveOrphanedQueues(m_endPoint.GetEndPoint());
+    m_lastSweepTime = now;
+  }
+
   IpcCommandAccept(*this, messagePort, completionHandler)();
 }
 
+
+bool MessagePortAcceptor::PublishBroadcast(DataBufferPointer buffer)
+{
+  if ( !m_broadcastRing )
+    return false;
+
+  return m_broadcastRing->Publish(*buffer);
+}
+
 } // namespace Ipc
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -14,6 +14,9 @@
 #include "AsioExpress/MessagePort/Ipc/private/MessageQueuePointer.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcReceiveThread.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSendThread.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
+#include "AsioExpress/MessagePort/SendBatch.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -40,6 +43,15 @@ public:
       AsioExpress::MessagePort::DataBufferPointer buffer,
       AsioExpress::CompletionHandler completionHandler);
 
+  ///
+  /// Sends the messages of the batch in order. A message queue takes one
+  /// message at a time, so each is sent on its own; the handler is called
+  /// once, after the last.
+  ///
+  void AsyncSendBatch(
+      AsioExpress::MessagePort::DataBufferListPointer batch,
+      AsioExpress::CompletionHandler completionHandler);
+
   void AsyncReceive(
       AsioExpress::MessagePort::DataBufferPointer buffer,
       AsioExpress::CompletionHandler completionHandler);
@@ -48,15 +60,25 @@ public:
 
   void Disconnect();
 
+  ///
+  /// IPC queues cannot be half closed, so once its sends are written the
+  /// port is simply disconnected.
+  ///
+  void ShutdownSend();
+
   void SetMessagePortOptions();
 
+  void GetStatistics(PortStatistics & statistics) const;
+
   inline bool IsConnected() const               { return m_sendMessageQueue != 0; }
+  inline bool IsBroadcastSubscriber() const     { return m_isBroadcastSubscriber; }
   inline const std::string& GetLocalID() const  { return m_recvMessageQueueName; }
   inline const std::string& GetRemoteID() const { return m_sendMessageQueueName; }
 
 private:
   MessagePort & operator=(MessagePort const &);
   AsioExpress::Error SetupWithMessageQueues(const std::string& sendQueue, const std::string& recvQueue);
+  void StartHeartbeat(EndPoint const & endPoint);
 
 private:
   boost::asio::io_service &               m_ioService;
@@ -66,6 +88,9 @@ private:
   std::string                             m_recvMessageQueueName;
   IpcReceiveThreadPointer                 m_receiveThread;
   IpcSendThreadPointer                    m_sendThread;
+  bool                                    m_isBroadcastSubscriber;
+  HeartbeatPointer                        m_heartbeat;
+  PortCountersPointer                     m_counters;
 };
 
 
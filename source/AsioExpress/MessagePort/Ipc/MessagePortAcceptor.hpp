@@ -6,11 +6,13 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/interprocess/ipc/message_queue.hpp>
 #include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/MessageQueuePointer.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcReceiveThread.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBroadcastRing.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -38,15 +40,24 @@ public:
 
   void Close();
 
+  ///
+  /// Writes a message once to the shared memory ring read by every
+  /// subscribed message port. Returns false if the acceptor has no ring or
+  /// the message is too large for it, in which case the caller must send it
+  /// to each port instead.
+  ///
+  bool PublishBroadcast(DataBufferPointer buffer);
+
 private:
   MessagePortAcceptor & operator=(MessagePortAcceptor const &);
-  inline static std::string IntToString(int n)   { std::stringstream ss; std::string str; ss << n; ss >> str; return str; }
 
 private:
   boost::asio::io_service &               m_ioService;
   EndPoint                                m_endPoint;
   MessageQueuePointer                     m_messageQueue;
   IpcReceiveThreadPointer                 m_receiveThread;
+  IpcBroadcastRingPointer                 m_broadcastRing;
+  boost::posix_time::ptime                m_lastSweepTime;
 };
 
 
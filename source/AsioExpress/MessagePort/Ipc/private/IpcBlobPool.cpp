@@ -0,0 +1,200 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpressConfig/config.hpp"
+
+#include <ctime>
+#include <new>
+
+#include <boost/random.hpp>
+
+#include "AsioExpress/Platform/DebugMessage.hpp"
+#include "AsioExpress/Platform/GetClockCount.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
+
+namespace
+{
+  char const BlobMagic[8] = { 'A', 'E', 'x', 'B', 'l', 'o', 'b', '1' };
+  char const * const PoolHeaderName = "PoolHeader";
+}
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+IpcBlobPool::IpcBlobPool(std::string const & queueName, std::size_t segmentSize) :
+  m_segmentName(GetSegmentName(queueName)),
+  m_segmentSize(segmentSize),
+  m_header(0)
+{
+}
+
+void IpcBlobPool::Remove(std::string const & queueName)
+{
+  boost::interprocess::shared_memory_object::remove(
+    GetSegmentName(queueName).c_str());
+}
+
+bool IpcBlobPool::Store(DataBuffer const & payload, DataBuffer & descriptor)
+{
+  if (!m_segment)
+    Create();
+
+  void * block = m_segment->allocate(
+    sizeof(BlockHeader) + payload.Size(),
+    std::nothrow);
+
+  if (block == 0)
+    return false;
+
+  // Generation zero marks a block that has been released.
+  if (++m_header->generation == 0)
+    ++m_header->generation;
+
+  BlockHeader * blockHeader = static_cast<BlockHeader *>(block);
+  blockHeader->generation = m_header->generation;
+  blockHeader->reserved = 0;
+  memcpy(blockHeader + 1, payload.Get(), payload.Size());
+
+  Descriptor d;
+  memcpy(d.magic, BlobMagic, sizeof(d.magic));
+  d.token = m_header->token;
+  d.offset = m_segment->get_handle_from_address(block);
+  d.length = payload.Size();
+  d.generation = blockHeader->generation;
+  d.reserved = 0;
+
+  descriptor.Assign(reinterpret_cast<char const *>(&d), sizeof(d));
+
+  return true;
+}
+
+bool IpcBlobPool::Release(DataBuffer const & descriptor)
+{
+  boost::uint64_t length;
+  BlockHeader * blockHeader = Find(descriptor.Get(), descriptor.Size(), length);
+  if (blockHeader == 0)
+    return false;
+
+  BlockRelease release(m_segment);
+  release(blockHeader);
+
+  return true;
+}
+
+bool IpcBlobPool::Load(char const * message, std::size_t size, DataBuffer & target)
+{
+  boost::uint64_t length;
+  BlockHeader * blockHeader = Find(message, size, length);
+  if (blockHeader == 0)
+    return false;
+
+  target.Attach(
+    reinterpret_cast<char *>(blockHeader + 1),
+    static_cast<DataBuffer::SizeType>(length),
+    boost::shared_ptr<void>(blockHeader, BlockRelease(m_segment)));
+
+  return true;
+}
+
+std::size_t IpcBlobPool::MaxPayloadSize() const
+{
+  return m_segmentSize - sizeof(PoolHeader) - sizeof(BlockHeader);
+}
+
+std::string IpcBlobPool::GetSegmentName(std::string const & queueName)
+{
+  return queueName + "#Blob";
+}
+
+void IpcBlobPool::Create()
+{
+#ifdef DEBUG_IPC
+  DebugMessage("IpcBlobPool: Creating shared memory blob pool.\n");
+#endif
+
+  // A segment of the same name can only be left over from a crashed process.
+  boost::interprocess::shared_memory_object::remove(m_segmentName.c_str());
+
+  m_segment.reset(new Segment(
+    boost::interprocess::create_only,
+    m_segmentName.c_str(),
+    m_segmentSize));
+
+  boost::mt19937 rng(
+    static_cast<boost::uint32_t>(std::time(0)) ^ GetClockCount() ^
+    static_cast<boost::uint32_t>(reinterpret_cast<std::size_t>(m_segment->get_address())));
+
+  m_header = m_segment->construct<PoolHeader>(PoolHeaderName)();
+  m_header->token = (static_cast<boost::uint64_t>(rng()) << 32) | rng();
+  m_header->generation = 0;
+}
+
+IpcBlobPool::BlockHeader * IpcBlobPool::Find(
+    char const * message, 
+    std::size_t size, 
+    boost::uint64_t & length)
+{
+  if (size != sizeof(Descriptor) || memcmp(message, BlobMagic, sizeof(BlobMagic)) != 0)
+    return 0;
+
+  if (!m_segment && !Open())
+    return 0;
+
+  Descriptor d;
+  memcpy(&d, message, sizeof(d));
+
+  if (d.token != m_header->token)
+    return 0;
+
+  // Each subtraction is checked first, so a corrupt offset or length cannot
+  // wrap around and pass.
+  boost::uint64_t const segmentSize = m_segment->get_size();
+  if (d.offset > segmentSize - sizeof(BlockHeader) ||
+      d.length > segmentSize - sizeof(BlockHeader) - d.offset)
+  {
+    return 0;
+  }
+
+  BlockHeader * blockHeader = static_cast<BlockHeader *>(
+    m_segment->get_address_from_handle(
+      static_cast<Segment::handle_t>(d.offset)));
+
+  if (blockHeader->generation != d.generation)
+    return 0;
+
+  length = d.length;
+  return blockHeader;
+}
+
+bool IpcBlobPool::Open()
+{
+  try
+  {
+    SegmentPointer segment(new Segment(
+      boost::interprocess::open_only,
+      m_segmentName.c_str()));
+
+    PoolHeader * header = segment->find<PoolHeader>(PoolHeaderName).first;
+    if (header == 0)
+      return false;
+
+    m_segment = segment;
+    m_header = header;
+  }
+  catch(boost::interprocess::interprocess_exception &)
+  {
+    // No pool exists so this is not one of our descriptors.
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,128 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+///
+/// A shared memory segment used to pass large messages out-of-band. The
+/// sending side copies the payload into the segment and sends only a small
+/// descriptor through the message queue. The receiving side attaches its data
+/// buffer directly to the payload and the memory is reclaimed once that
+/// buffer lets go of it.
+///
+/// Each pool is named after the message queue it accompanies. The sender
+/// creates the segment the first time it is needed and the receiver opens it
+/// when the first descriptor arrives.
+///
+class IpcBlobPool
+{
+public:
+  typedef boost::interprocess::managed_shared_memory Segment;
+  typedef boost::shared_ptr<Segment> SegmentPointer;
+
+  IpcBlobPool(std::string const & queueName, std::size_t segmentSize);
+
+  /// Removes the shared memory segment associated with a message queue.
+  static void Remove(std::string const & queueName);
+
+  ///
+  /// Copies the payload into the pool and encodes a descriptor for it.
+  /// Returns false if the pool does not have room for the payload.
+  ///
+  bool Store(DataBuffer const & payload, DataBuffer & descriptor);
+
+  ///
+  /// Frees a payload whose descriptor could not be delivered. Returns false
+  /// if the descriptor is not for a payload in this pool.
+  ///
+  bool Release(DataBuffer const & descriptor);
+
+  ///
+  /// If the message is a descriptor for a payload in this pool, attaches the
+  /// target buffer to the payload in place and returns true.
+  ///
+  bool Load(char const * message, std::size_t size, DataBuffer & target);
+
+  /// Returns the largest payload the pool could ever hold.
+  std::size_t MaxPayloadSize() const;
+
+private:
+  IpcBlobPool(IpcBlobPool const &);
+  IpcBlobPool & operator=(IpcBlobPool const &);
+
+  struct PoolHeader
+  {
+    boost::uint64_t   token;
+    boost::uint32_t   generation;
+  };
+
+  struct BlockHeader
+  {
+    boost::uint32_t   generation;
+    boost::uint32_t   reserved;
+  };
+
+  struct Descriptor
+  {
+    char              magic[8];
+    boost::uint64_t   token;
+    boost::uint64_t   offset;
+    boost::uint64_t   length;
+    boost::uint32_t   generation;
+    boost::uint32_t   reserved;
+  };
+
+  class BlockRelease
+  {
+  public:
+    BlockRelease(SegmentPointer segment) :
+      m_segment(segment)
+    {
+    }
+
+    void operator()(void * block)
+    {
+      static_cast<BlockHeader *>(block)->generation = 0;
+      m_segment->deallocate(block);
+    }
+
+  private:
+    SegmentPointer m_segment;
+  };
+
+  static std::string GetSegmentName(std::string const & queueName);
+
+  void Create();
+  bool Open();
+
+  ///
+  /// Checks a message is a descriptor for a payload in this pool and
+  /// returns the payload's block, or zero if it is not.
+  ///
+  BlockHeader * Find(char const * message, std::size_t size, boost::uint64_t & length);
+
+  std::string     m_segmentName;
+  std::size_t     m_segmentSize;
+  SegmentPointer  m_segment;
+  PoolHeader *    m_header;
+};
+
+typedef boost::shared_ptr<IpcBlobPool> IpcBlobPoolPointer;
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
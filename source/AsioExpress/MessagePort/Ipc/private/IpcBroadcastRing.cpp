@@ -0,0 +1,293 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpressConfig/config.hpp"
+
+#include <new>
+
+#include <boost/static_assert.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+#include "AsioExpress/Platform/DebugMessage.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBroadcastRing.hpp"
+
+// The positions live in shared memory, so they must not depend on a lock
+// private to one process.
+BOOST_STATIC_ASSERT(BOOST_ATOMIC_INT64_LOCK_FREE == 2);
+
+namespace
+{
+  boost::uint32_t const RingMagic = 0x41457842; // "AExB"
+  boost::uint32_t const PaddingFlag = 1;
+  std::size_t const MinimumCapacity = 1024;
+
+  // Keep the data area aligned for the record headers.
+  std::size_t Align(std::size_t size)
+  {
+    return (size + 7) & ~static_cast<std::size_t>(7);
+  }
+}
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+IpcBroadcastRing::IpcBroadcastRing() :
+  m_header(0)
+{
+}
+
+IpcBroadcastRingPointer IpcBroadcastRing::Create(
+    std::string const & endPoint,
+    std::size_t capacity,
+    boost::interprocess::permissions permissions)
+{
+#ifdef DEBUG_IPC
+  DebugMessage("IpcBroadcastRing: Creating shared memory broadcast ring.\n");
+#endif
+
+  using namespace boost::interprocess;
+
+  // A ring of the same name can only be left over from a crashed process.
+  Remove(endPoint);
+
+  // Half the capacity must be a whole number of records.
+  capacity &= ~static_cast<std::size_t>(15);
+  if (capacity < MinimumCapacity)
+    capacity = MinimumCapacity;
+
+  std::string const name(GetSegmentName(endPoint));
+
+  shared_memory_object memory(create_only, name.c_str(), read_write, permissions);
+  memory.truncate(static_cast<offset_t>(Align(sizeof(Header)) + capacity));
+  mapped_region region(memory, read_write);
+
+  IpcBroadcastRingPointer ring(new IpcBroadcastRing);
+  ring->m_memory.swap(memory);
+  ring->m_region.swap(region);
+
+  Header * header = new (ring->m_region.get_address()) Header;
+  header->capacity = capacity;
+  header->writePosition.store(0);
+  header->oldestPosition.store(0);
+  header->magic = RingMagic;
+  header->reserved = 0;
+
+  ring->m_header = header;
+
+  return ring;
+}
+
+IpcBroadcastRingPointer IpcBroadcastRing::Open(
+    std::string const & endPoint)
+{
+  using namespace boost::interprocess;
+
+  std::string const name(GetSegmentName(endPoint));
+
+  shared_memory_object memory(open_only, name.c_str(), read_write);
+  mapped_region region(memory, read_write);
+
+  Header * header = static_cast<Header *>(region.get_address());
+
+  if ( region.get_size() < Align(sizeof(Header))
+       || header->magic != RingMagic
+       || region.get_size() < Align(sizeof(Header)) + header->capacity )
+  {
+    throw interprocess_exception("Broadcast ring is not valid.");
+  }
+
+  IpcBroadcastRingPointer ring(new IpcBroadcastRing);
+  ring->m_memory.swap(memory);
+  ring->m_region.swap(region);
+  ring->m_header = header;
+
+  return ring;
+}
+
+void IpcBroadcastRing::Remove(std::string const & endPoint)
+{
+  boost::interprocess::shared_memory_object::remove(
+    GetSegmentName(endPoint).c_str());
+}
+
+std::size_t IpcBroadcastRing::MaxPayloadSize() const
+{
+  // A record never wraps, so the padding written before it can be nearly as
+  // large as the record itself.
+  return static_cast<std::size_t>(m_header->capacity / 2) - sizeof(RecordHeader);
+}
+
+bool IpcBroadcastRing::Publish(DataBuffer const & payload)
+{
+  if (payload.Size() > MaxPayloadSize())
+    return false;
+
+  {
+    boost::mutex::scoped_lock lock(m_publishMutex);
+
+    Position const capacity = m_header->capacity;
+    Position const recordSize = RecordSize(payload.Size());
+    Position const start = m_header->writePosition.load(boost::memory_order_relaxed);
+    Position const offset = start % capacity;
+    Position const padding = (capacity - offset < recordSize) ? capacity - offset : 0;
+    Position const end = start + padding + recordSize;
+
+    //
+    // Retire the oldest records until the new one fits. Readers check the
+    // oldest position again after copying a record so they can tell when it
+    // was overwritten underneath them.
+    //
+
+    Position oldest = m_header->oldestPosition.load(boost::memory_order_relaxed);
+    while (end - oldest > capacity)
+    {
+      RecordHeader const * record = reinterpret_cast<RecordHeader const *>(
+        Data() + oldest % capacity);
+
+      if (record->flags & PaddingFlag)
+        oldest += capacity - oldest % capacity;
+      else
+        oldest += RecordSize(record->length);
+    }
+    m_header->oldestPosition.store(oldest, boost::memory_order_relaxed);
+    boost::atomics::atomic_thread_fence(boost::memory_order_seq_cst);
+
+    if (padding > 0)
+    {
+      RecordHeader * pad = reinterpret_cast<RecordHeader *>(Data() + offset);
+      pad->length = 0;
+      pad->flags = PaddingFlag;
+    }
+
+    RecordHeader * record = reinterpret_cast<RecordHeader *>(
+      Data() + (start + padding) % capacity);
+    record->length = static_cast<boost::uint32_t>(payload.Size());
+    record->flags = 0;
+    memcpy(record + 1, payload.Get(), payload.Size());
+
+    m_header->writePosition.store(end, boost::memory_order_release);
+  }
+
+  Notify();
+
+  return true;
+}
+
+IpcBroadcastRing::Position IpcBroadcastRing::GetWritePosition() const
+{
+  return m_header->writePosition.load(boost::memory_order_acquire);
+}
+
+IpcBroadcastRing::ReadResult IpcBroadcastRing::Read(
+    Position & cursor,
+    DataBuffer & target) const
+{
+  Position const capacity = m_header->capacity;
+
+  for (;;)
+  {
+    Position const write = m_header->writePosition.load(boost::memory_order_acquire);
+    if (cursor == write)
+      return Empty;
+
+    Position const oldest = m_header->oldestPosition.load(boost::memory_order_acquire);
+    if (cursor < oldest || cursor > write)
+    {
+      cursor = oldest;
+      return Overrun;
+    }
+
+    Position const offset = cursor % capacity;
+    RecordHeader record = *reinterpret_cast<RecordHeader const *>(Data() + offset);
+
+    bool const isPadding = (record.flags & PaddingFlag) != 0;
+    // A torn or overwritten header must not send the copy past the end of
+    // the ring.
+    bool const isValid = isPadding
+      || ( record.length <= MaxPayloadSize()
+           && offset + sizeof(RecordHeader) + record.length <= capacity );
+
+    if (!isPadding && isValid)
+    {
+      target.Resize(record.length);
+      memcpy(target.Get(), Data() + offset + sizeof(RecordHeader), record.length);
+    }
+
+    // If the writer retired this record while we were copying it, what we
+    // copied cannot be trusted.
+    boost::atomics::atomic_thread_fence(boost::memory_order_acquire);
+    if (m_header->oldestPosition.load(boost::memory_order_relaxed) > cursor)
+    {
+      cursor = m_header->oldestPosition.load(boost::memory_order_acquire);
+      return Overrun;
+    }
+
+    if (!isValid)
+    {
+      cursor = write;
+      return Overrun;
+    }
+
+    if (isPadding)
+    {
+      cursor += capacity - offset;
+      continue;
+    }
+
+    cursor += RecordSize(record.length);
+    return Message;
+  }
+}
+
+IpcBroadcastRing::Position IpcBroadcastRing::Wait(
+    Position position,
+    boost::posix_time::ptime const & expiryTime) const
+{
+  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    lock(m_header->mutex);
+
+  if (m_header->writePosition.load(boost::memory_order_acquire) == position)
+    (void)m_header->condition.timed_wait(lock, expiryTime);
+
+  return m_header->writePosition.load(boost::memory_order_acquire);
+}
+
+void IpcBroadcastRing::Notify() const
+{
+  // Readers also wake up periodically on their own, so rather than risk
+  // blocking the writer on a lock held by a crashed reader we give up on the
+  // notification after a short wait.
+  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
+    lock(
+      m_header->mutex,
+      boost::posix_time::microsec_clock::universal_time()
+        + boost::posix_time::milliseconds(10));
+
+  if (lock)
+    m_header->condition.notify_all();
+}
+
+std::string IpcBroadcastRing::GetSegmentName(std::string const & endPoint)
+{
+  return endPoint + "#Broadcast";
+}
+
+std::size_t IpcBroadcastRing::RecordSize(std::size_t length)
+{
+  return Align(sizeof(RecordHeader) + length);
+}
+
+char * IpcBroadcastRing::Data() const
+{
+  return static_cast<char *>(m_region.get_address()) + Align(sizeof(Header));
+}
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
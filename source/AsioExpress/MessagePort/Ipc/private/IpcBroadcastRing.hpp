@@ -0,0 +1,129 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/permissions.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+///
+/// A single-writer, multi-reader ring of messages in shared memory. The
+/// acceptor writes each broadcast into the ring once and every subscribed
+/// message port reads it from its own cursor, so the cost of a broadcast does
+/// not grow with the number of subscribers.
+///
+/// The writer never waits for readers. A reader that falls more than the ring
+/// capacity behind finds its cursor has been overwritten; it is told so and
+/// resumes from the oldest message still in the ring.
+///
+class IpcBroadcastRing
+{
+public:
+  typedef boost::uint64_t Position;
+
+  enum ReadResult
+  {
+    Empty,
+    Message,
+    Overrun
+  };
+
+  /// Creates the ring, replacing any left over from a crashed process.
+  static boost::shared_ptr<IpcBroadcastRing> Create(
+      std::string const & endPoint,
+      std::size_t capacity,
+      boost::interprocess::permissions permissions);
+
+  /// Opens an existing ring for reading.
+  static boost::shared_ptr<IpcBroadcastRing> Open(
+      std::string const & endPoint);
+
+  /// Removes the ring associated with an acceptor.
+  static void Remove(std::string const & endPoint);
+
+  /// Returns the largest message the ring will accept.
+  std::size_t MaxPayloadSize() const;
+
+  ///
+  /// Writes a message to the ring and wakes any waiting readers. Returns
+  /// false if the message is too large for the ring.
+  ///
+  bool Publish(DataBuffer const & payload);
+
+  /// Returns the position the next message will be written at.
+  Position GetWritePosition() const;
+
+  ///
+  /// Reads the message at the cursor and advances the cursor past it. If the
+  /// message was overwritten the cursor is moved to the oldest message left.
+  ///
+  ReadResult Read(Position & cursor, DataBuffer & target) const;
+
+  ///
+  /// Waits until the write position moves past the position given, the ring
+  /// is notified or the expiry time is reached. Returns the current write
+  /// position.
+  ///
+  Position Wait(Position position, boost::posix_time::ptime const & expiryTime) const;
+
+  /// Wakes all readers waiting on the ring.
+  void Notify() const;
+
+private:
+  IpcBroadcastRing(IpcBroadcastRing const &);
+  IpcBroadcastRing & operator=(IpcBroadcastRing const &);
+
+  struct Header
+  {
+    boost::uint32_t                               magic;
+    boost::uint32_t                               reserved;
+    boost::uint64_t                               capacity;
+    boost::atomic<Position>                       writePosition;
+    boost::atomic<Position>                       oldestPosition;
+    boost::interprocess::interprocess_mutex       mutex;
+    boost::interprocess::interprocess_condition   condition;
+  };
+
+  struct RecordHeader
+  {
+    boost::uint32_t   length;
+    boost::uint32_t   flags;
+  };
+
+  IpcBroadcastRing();
+
+  static std::string GetSegmentName(std::string const & endPoint);
+
+  static std::size_t RecordSize(std::size_t length);
+
+  char * Data() const;
+
+  boost::interprocess::shared_memory_object   m_memory;
+  boost::interprocess::mapped_region          m_region;
+  Header *                                    m_header;
+  boost::mutex                                m_publishMutex;
+};
+
+typedef boost::shared_ptr<IpcBroadcastRing> IpcBroadcastRingPointer;
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -7,6 +7,8 @@
 
 #include "AsioExpressConfig/config.hpp"
 
+#include <sstream>
+
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandAccept.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandReceive.hpp"
@@ -56,7 +58,7 @@ void IpcCommandAccept::operator() (AsioExpress::Error e)
       IpcSysMessage msg;
       msg.Decode(m_tempBuffer->Get());
       
-      if ( msg.GetMessageType() != IpcSysMessage::MSG_CONNECT || msg.GetNumParams() != 2 )
+      if ( msg.GetMessageType() != IpcSysMessage::MSG_CONNECT || msg.GetNumParams() < 2 )
       {
 #ifdef DEBUG_IPC
         DebugMessage("IpcCommandAccept: Invalid CONNECT command recieved!\n");
@@ -87,10 +89,21 @@ void IpcCommandAccept::operator() (AsioExpress::Error e)
       }
 
       //
-      // Step 4 - Send a connection ACK and return success
+      // Step 4 - Send a connection ACK and return success. Clients that 
+      //          subscribe to broadcasts are told where in the ring to start.
       //
 
       IpcSysMessage msgack(IpcSysMessage::MSG_CONNECT_ACK);
+
+      if ( msg.GetParam(2) == IpcSysMessage::MSG_BROADCAST && m_acceptor.m_broadcastRing )
+      {
+        std::ostringstream position;
+        position << m_acceptor.m_broadcastRing->GetWritePosition();
+        msgack.AddParam(position.str());
+        m_messagePort.m_isBroadcastSubscriber = true;
+      }
+
+      m_tempBuffer->Resize(msgack.RequiredEncodeBufferSize());
       int len = msgack.Encode(m_tempBuffer->Get());
       
       try 
@@ -117,6 +130,8 @@ void IpcCommandAccept::operator() (AsioExpress::Error e)
           "MessagePort::AsyncAccept(): Unable to send to client's receive queue.");
         return;
       }
+
+      m_messagePort.StartHeartbeat(m_acceptor.m_endPoint);
     }
 
     CallCompletionHandler(AsioExpress::Error());
@@ -7,20 +7,17 @@
 
 #include "AsioExpressConfig/config.hpp"
 
-#include <boost/random.hpp>
+#include <sstream>
 
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandConnect.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcCommandReceive.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcConstants.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
 #include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
 #include "AsioExpress/Platform/DebugMessage.hpp"
 
-namespace
-{
-  boost::mt19937 rng(static_cast<boost::uint32_t>(std::time(0)));
-}
-
 namespace AsioExpress {
 namespace MessagePort {
 namespace Ipc {
@@ -40,49 +37,22 @@ void IpcCommandConnect::operator() (AsioExpress::Error e)
     // C2360: initialization of 'serverQueueName' is skipped by 'case' label
     {
 #ifdef DEBUG_IPC
-      DebugMessage("IpcCommandConnect: Finding new message queue ID.\n");
+      DebugMessage("IpcCommandConnect: Naming new message queues.\n");
 #endif
 
       m_messagePort.Disconnect();
 
       //
-      // Step 1 - Find a valid message queue name that is not in use
+      // Step 1 - Name the message queues after this process. Queues of the 
+      //          same name can only be left over from a crashed process that
+      //          had the same process id.
       //
 
       std::string clientQueueName;
       std::string serverQueueName;
-      bool finished = false;
-
-      while ( !finished )
-      {
-        boost::uniform_int<> connectionIdRange(LowConnectionId, HighConnectionId);
-        boost::variate_generator<boost::mt19937&, boost::uniform_int<> > randomNumber(rng, connectionIdRange);
-        std::string id = IntToString(randomNumber());
-
-        clientQueueName = m_endPoint.GetEndPoint() + "#Client#" + id;
-        serverQueueName = m_endPoint.GetEndPoint() + "#Server#" + id;
-
-        // Check that the queue doesn't already exist
-
-        try {
-          boost::interprocess::message_queue mq1(boost::interprocess::open_only, clientQueueName.c_str());
-          // No exception thrown - this queue already exists. Try again.
-          continue;
-        }
-        catch(boost::interprocess::interprocess_exception&) {
-          // Couldn't open queue, so it doesn't exist. We can proceed.
-        }
-
-        try {
-          boost::interprocess::message_queue mq1(boost::interprocess::open_only, serverQueueName.c_str());
-          // No exception thrown - this queue already exists. Try again.
-          continue;
-        }
-        catch(boost::interprocess::interprocess_exception&) {
-          // Couldn't open queue, so it doesn't exist. We can proceed.
-          finished = true;
-        }
-      }
+      MakeConnectionQueueNames(m_endPoint.GetEndPoint(), clientQueueName, serverQueueName);
+      RemoveConnectionQueue(clientQueueName);
+      RemoveConnectionQueue(serverQueueName);
 
       //
       // Step 2 - Create the message queues for client & server
@@ -106,8 +76,10 @@ void IpcCommandConnect::operator() (AsioExpress::Error e)
             m_endPoint.GetMaxNumMsg(),
             m_endPoint.GetMaxMsgSize(),
             m_endPoint.GetPermissions()));
-        m_messagePort.m_receiveThread.reset(new IpcReceiveThread(m_messagePort.m_ioService, m_messagePort.m_recvMessageQueue, IpcReceiveThread::EnablePing));
-        m_messagePort.m_sendThread.reset(new IpcSendThread(m_messagePort.m_ioService, m_messagePort.m_sendMessageQueue, IpcSendThread::EnablePing));
+        m_messagePort.m_receiveThread.reset(new IpcReceiveThread(m_messagePort.m_ioService, m_messagePort.m_recvMessageQueue, IpcReceiveThread::EnablePing,
+            IpcBlobPoolPointer(new IpcBlobPool(m_messagePort.m_recvMessageQueueName, BlobPoolBytes))));
+        m_messagePort.m_sendThread.reset(new IpcSendThread(m_messagePort.m_ioService, m_messagePort.m_sendMessageQueue, IpcSendThread::EnablePing,
+            IpcBlobPoolPointer(new IpcBlobPool(m_messagePort.m_sendMessageQueueName, BlobPoolBytes))));
       }
       catch(boost::interprocess::interprocess_exception& ex)
       {
@@ -133,6 +105,7 @@ void IpcCommandConnect::operator() (AsioExpress::Error e)
         IpcSysMessage msg(IpcSysMessage::MSG_CONNECT);
         msg.AddParam(m_messagePort.m_recvMessageQueueName);
         msg.AddParam(m_messagePort.m_sendMessageQueueName);
+        msg.AddParam(IpcSysMessage::MSG_BROADCAST);
 
         char buf[1024];
         int len = msg.Encode(buf);
@@ -178,7 +151,7 @@ void IpcCommandConnect::operator() (AsioExpress::Error e)
                         m_messagePort.m_recvMessageQueue,
                         m_dataBuffer,
                         *this,
-                        8000)();
+                        m_endPoint.GetConnectTimeout())();
 
     //
     // Step 5 - Validate the connection acknowledgement
@@ -200,11 +173,44 @@ void IpcCommandConnect::operator() (AsioExpress::Error e)
       return;
     }
 
+    //
+    // Step 6 - If the server has a broadcast ring, read broadcasts from it
+    //          starting at the position it gave us
+    //
+
+    if ( msg2.GetNumParams() > 0 )
+    {
+      IpcBroadcastRing::Position cursor = 0;
+      std::istringstream position(msg2.GetParam(0));
+      position >> cursor;
+
+      try
+      {
+        m_messagePort.m_receiveThread->AttachBroadcastRing(
+          IpcBroadcastRing::Open(m_endPoint.GetEndPoint()),
+          cursor);
+      }
+      catch(boost::interprocess::interprocess_exception &ex)
+      {
+#ifdef DEBUG_IPC
+        DebugMessage("IpcCommandConnect: Unable to open broadcast ring!\n");
+#endif
+        m_messagePort.Disconnect();
+        AsioExpress::Error err(
+          boost::system::error_code(ex.get_native_error(), boost::system::get_system_category()),
+          "MessagePort::AsyncConnect(): Unable to open server broadcast ring.");
+        m_messagePort.m_ioService.post(boost::asio::detail::bind_handler(m_completionHandler, err));
+        return;
+      }
+    }
+
     // Success
 #ifdef DEBUG_IPC
       DebugMessage("IpcCommandConnect: Connected.\n");
 #endif
 
+    m_messagePort.StartHeartbeat(m_endPoint);
+
     m_messagePort.m_ioService.post(boost::asio::detail::bind_handler(m_completionHandler, AsioExpress::Error()));
   }
 }
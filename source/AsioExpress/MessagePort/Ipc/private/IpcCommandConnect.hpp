@@ -17,9 +17,6 @@ namespace Ipc {
 class IpcCommandConnect : private AsioExpress::Coroutine
 {
 public:
-  static int const LowConnectionId = 1;
-  static int const HighConnectionId = 99;
-
   inline IpcCommandConnect(const EndPoint& endPoint, MessagePort& messagePort, AsioExpress::CompletionHandler completionHandler)
     : m_endPoint(endPoint),
       m_messagePort(messagePort),
@@ -30,9 +27,6 @@ public:
 
   void operator() (AsioExpress::Error e = AsioExpress::Error());
 
-private:
-inline static std::string IntToString(int n)   { std::stringstream ss; std::string str; ss << n; ss >> str; return str; }
-
 private:
   IpcCommandConnect & operator=(IpcCommandConnect const &);
 
@@ -5,12 +5,16 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace AsioExpress {
 namespace MessagePort {
 namespace Ipc {
 
-int const PingRateSeconds = 10;
-int const PingTimeoutSeconds = 25;
+// Messages of at least this size, or too large for the message queue, are
+// passed through a shared memory blob pool instead of the queue itself.
+std::size_t const BlobThresholdBytes = 64 * 1024;
+std::size_t const BlobPoolBytes = 64 * 1024 * 1024;
 
 } // namespace Ipc
 } // namespace MessagePort
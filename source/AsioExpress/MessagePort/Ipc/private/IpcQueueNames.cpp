@@ -0,0 +1,141 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include "AsioExpressConfig/config.hpp"
+
+#include <sstream>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/interprocess/ipc/message_queue.hpp>
+
+#include "AsioExpress/Platform/DebugMessage.hpp"
+#include "AsioExpress/Platform/Process.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
+
+namespace
+{
+  char const * const ClientTag = "#Client#";
+  char const * const ServerTag = "#Server#";
+  char const * const BlobTag = "#Blob";
+
+  boost::mutex    connectionCounterMutex;
+  unsigned int    connectionCounter = 0;
+
+  bool StartsWith(std::string const & name, std::string const & prefix)
+  {
+    return name.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  bool IsDigits(std::string const & text)
+  {
+    return !text.empty() && 
+      text.find_first_not_of("0123456789") == std::string::npos;
+  }
+
+  ///
+  /// Parses the connection id that follows the client or server tag. Ids have
+  /// the form <processId>-<counter>. Ids made only of digits were used
+  /// before process ids were recorded and are reported with a process id of
+  /// zero.
+  ///
+  bool ParseConnectionId(std::string const & id, unsigned int & processId)
+  {
+    std::string::size_type separator = id.find('-');
+
+    if (separator == std::string::npos)
+    {
+      processId = 0;
+      return IsDigits(id);
+    }
+
+    std::string process(id.substr(0, separator));
+    if (!IsDigits(process) || !IsDigits(id.substr(separator + 1)))
+      return false;
+
+    std::istringstream(process) >> processId;
+    return true;
+  }
+}
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+void MakeConnectionQueueNames(
+    std::string const & endPoint,
+    std::string & clientQueueName,
+    std::string & serverQueueName)
+{
+  unsigned int counter;
+  {
+    boost::mutex::scoped_lock lock(connectionCounterMutex);
+    counter = ++connectionCounter;
+  }
+
+  std::ostringstream id;
+  id << GetOwnProcessId() << '-' << counter;
+
+  clientQueueName = endPoint + ClientTag + id.str();
+  serverQueueName = endPoint + ServerTag + id.str();
+}
+
+void RemoveConnectionQueue(std::string const & queueName)
+{
+  boost::interprocess::message_queue::remove(queueName.c_str());
+  IpcBlobPool::Remove(queueName);
+}
+
+void RemoveOrphanedQueues(std::string const & endPoint)
+{
+  std::vector<std::string> names;
+  GetSharedMemoryNames(names);
+
+  std::string const clientPrefix(endPoint + ClientTag);
+  std::string const serverPrefix(endPoint + ServerTag);
+  std::string const blobTag(BlobTag);
+
+  for (std::vector<std::string>::const_iterator 
+         name = names.begin(), end = names.end(); 
+       name != end; 
+       ++name)
+  {
+    std::string id;
+    if (StartsWith(*name, clientPrefix))
+      id = name->substr(clientPrefix.size());
+    else if (StartsWith(*name, serverPrefix))
+      id = name->substr(serverPrefix.size());
+    else
+      continue;
+
+    bool isBlobPool = 
+      id.size() > blobTag.size() &&
+      id.compare(id.size() - blobTag.size(), blobTag.size(), blobTag) == 0;
+    if (isBlobPool)
+      id.erase(id.size() - blobTag.size());
+
+    unsigned int processId;
+    if (!ParseConnectionId(id, processId))
+      continue;
+
+    if (processId != 0 && IsProcessRunning(processId))
+      continue;
+
+#ifdef DEBUG_IPC
+    DebugMessage("RemoveOrphanedQueues: Removing orphaned message queue.\n");
+#endif
+
+    if (isBlobPool)
+      boost::interprocess::shared_memory_object::remove(name->c_str());
+    else
+      boost::interprocess::message_queue::remove(name->c_str());
+  }
+}
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
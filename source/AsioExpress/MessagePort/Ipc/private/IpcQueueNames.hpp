@@ -0,0 +1,38 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+
+namespace AsioExpress {
+namespace MessagePort {
+namespace Ipc {
+
+///
+/// Builds the names of the client and server queues for a new connection to
+/// an end point. The names hold the id of the connecting process and a
+/// per-process counter, so they are unique without probing for free names
+/// and the process that owns them can be found later.
+///
+void MakeConnectionQueueNames(
+    std::string const & endPoint,
+    std::string & clientQueueName,
+    std::string & serverQueueName);
+
+///
+/// Removes a connection queue along with its shared memory blob pool.
+///
+void RemoveConnectionQueue(std::string const & queueName);
+
+///
+/// Removes the connection queues of an end point whose owning process no
+/// longer exists, such as those left behind when a process crashes.
+///
+void RemoveOrphanedQueues(std::string const & endPoint);
+
+} // namespace Ipc
+} // namespace MessagePort
+} // namespace AsioExpress
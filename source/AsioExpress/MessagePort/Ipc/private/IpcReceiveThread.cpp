@@ -13,7 +13,6 @@
 #include "AsioExpressError/CatchMacros.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcReceiveThread.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
-#include "AsioExpress/MessagePort/Ipc/private/IpcConstants.hpp"
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 
 namespace AsioExpress {
@@ -24,14 +23,19 @@ WIN_DISABLE_WARNINGS_BEGIN(4355)
 IpcReceiveThread::IpcReceiveThread(
     boost::asio::io_service & ioService,
     MessageQueuePointer messageQueue,
-    PingMode pingMode) :
+    PingMode pingMode,
+    IpcBlobPoolPointer blobPool) :
   m_ioService(ioService),
   m_messageQueue(messageQueue),
+  m_blobPool(blobPool),
   m_isReceiving(false),
   m_isCanceled(false),
   m_isClosing(false),
+  m_isPeerLost(false),
   m_alertThrown(false),
   m_pingMode(pingMode),
+  m_broadcastCursor(0),
+  m_doorbellPending(false),
   m_thread(boost::bind(&IpcReceiveThread::ReceiveFunction, this))
 {
 }
@@ -84,12 +88,14 @@ void IpcReceiveThread::AsyncReceive(
 void IpcReceiveThread::CancelReceive()
 {
   m_isCanceled = true;
+  Wake();
 }
 
 void IpcReceiveThread::Close()
 {
   m_isCanceled = true;
   m_isClosing = true;
+  Wake();
 
   // notify thread of state change
   {
@@ -99,6 +105,42 @@ void IpcReceiveThread::Close()
   }
 
   m_thread.join();
+
+  if (m_broadcastRing)
+  {
+    m_broadcastRing->Notify();
+    if (m_broadcastThread.joinable())
+      m_broadcastThread.join();
+  }
+}
+
+void IpcReceiveThread::AttachBroadcastRing(
+    IpcBroadcastRingPointer broadcastRing,
+    IpcBroadcastRing::Position cursor)
+{
+  boost::mutex::scoped_lock lock(m_alertMutex);
+
+  m_broadcastRing = broadcastRing;
+  m_broadcastCursor = cursor;
+
+  boost::thread(boost::bind(&IpcReceiveThread::BroadcastFunction, this)).swap(m_broadcastThread);
+}
+
+void IpcReceiveThread::AttachHeartbeat(HeartbeatPointer heartbeat)
+{
+  boost::mutex::scoped_lock lock(m_alertMutex);
+
+  m_heartbeat = heartbeat;
+}
+
+void IpcReceiveThread::PingTimeout()
+{
+  // Only a receive in progress is waiting to hear from the peer.
+  if (m_pingMode == DisablePing || ! m_isReceiving)
+    return;
+
+  m_isPeerLost = true;
+  Wake();
 }
 
 void IpcReceiveThread::ReceiveFunction()
@@ -124,10 +166,11 @@ void IpcReceiveThread::ReceiveFunction()
 
 void IpcReceiveThread::Receive()
 {
+  m_isPeerLost = false;
   m_isReceiving = true;
 
   bool hasTimeout = (m_parameters.maxMilliseconds > 0);
-  boost::posix_time::ptime expiryTime;
+  boost::posix_time::ptime expiryTime(boost::posix_time::pos_infin);
   
   if ( hasTimeout )
   {
@@ -136,16 +179,17 @@ void IpcReceiveThread::Receive()
         + boost::posix_time::milliseconds(m_parameters.maxMilliseconds);
   }
   
+  // The peer has until the heartbeat's timeout from now to be heard from.
   ResetPingTimeout();
   
-  // Now continuously call the timed receive
+  // Wait for a message. Cancelling, closing and losing the peer all post a
+  // wake message to the queue, so the wait only needs to end at the expiry
+  // time.
 
   unsigned int priority;
   std::size_t recvSize;
   DataBuffer tempBuffer(m_messageQueue->get_max_msg_size());
 
-  boost::posix_time::ptime nextTimeout;
-
   for (;;)
   {
     if (m_isCanceled)
@@ -156,12 +200,16 @@ void IpcReceiveThread::Receive()
       break;
     }
 
-    nextTimeout 
-      = boost::posix_time::microsec_clock::universal_time() 
-        + boost::posix_time::milliseconds(1000);
+    if (m_isPeerLost)
+    {
+      CallCompletionHandler(
+        ErrorCode::LostConnection,
+        "IpcReceiveThread: No ping message received.");
+      break;
+    }
 
-    if ( hasTimeout && nextTimeout > expiryTime )
-      nextTimeout = expiryTime;
+    if (m_broadcastRing && ReceiveBroadcast())
+      break;
 
     try 
     {
@@ -170,7 +218,7 @@ void IpcReceiveThread::Receive()
         tempBuffer.Size(), 
         recvSize, 
         priority, 
-        nextTimeout);
+        expiryTime);
 
       if ( successful && priority == IpcSysMessage::SYS_MSG_PRIORITY )
       {
@@ -185,6 +233,14 @@ void IpcReceiveThread::Receive()
           ResetPingTimeout();          
           continue;
         }
+
+        if ( msg.GetMessageType() == IpcSysMessage::MSG_BROADCAST
+             || msg.GetMessageType() == IpcSysMessage::MSG_WAKE )
+        {
+          // The broadcast ring and the flags are checked at the top of the
+          // loop.
+          continue;
+        }
       }
       
       if ( successful )
@@ -194,14 +250,20 @@ void IpcReceiveThread::Receive()
         // Successful receive, copy to buffer and post callback with no error
 
         *(m_parameters.priority) = priority;
-        m_parameters.dataBuffer->Resize(recvSize);
-        memcpy(m_parameters.dataBuffer->Get(), tempBuffer.Get(), recvSize);
+
+        // Large messages are read in place from the shared memory pool.
+        if ( !m_blobPool 
+             || !m_blobPool->Load(tempBuffer.Get(), recvSize, *m_parameters.dataBuffer) )
+        {
+          m_parameters.dataBuffer->Resize(recvSize);
+          memcpy(m_parameters.dataBuffer->Get(), tempBuffer.Get(), recvSize);
+        }
 
         CallCompletionHandler(AsioExpress::Error());
         break;
       }
       
-      if ( !successful && hasTimeout && expiryTime <= nextTimeout )
+      if ( !successful && hasTimeout )
       {
         // Our overall timeout period elapsed
 
@@ -211,16 +273,6 @@ void IpcReceiveThread::Receive()
         break;
       }
       
-      if ( !successful && PingTimeout() )
-      {
-        // Our overall timeout period elapsed
-
-        CallCompletionHandler(
-          ErrorCode::LostConnection,
-          "IpcReceiveThread: No ping message received.");
-        break;
-      }
-      
     }
     catch(boost::interprocess::interprocess_exception &ex) 
     {    
@@ -233,6 +285,106 @@ void IpcReceiveThread::Receive()
   }    
 }
 
+bool IpcReceiveThread::ReceiveBroadcast()
+{
+  // Once the ring is empty the doorbell is rearmed and the ring checked once
+  // more, so a broadcast written in between is not missed.
+  for (int attempt = 0; attempt < 2; ++attempt)
+  {
+    switch (m_broadcastRing->Read(m_broadcastCursor, *m_parameters.dataBuffer))
+    {
+      case IpcBroadcastRing::Message:
+        ResetPingTimeout();
+        *(m_parameters.priority) = 0;
+        CallCompletionHandler(AsioExpress::Error());
+        return true;
+
+      case IpcBroadcastRing::Overrun:
+        CallCompletionHandler(
+          ErrorCode::BroadcastOverrun,
+          "IpcReceiveThread: Broadcast messages were overwritten before they were read.");
+        return true;
+
+      case IpcBroadcastRing::Empty:
+        break;
+    }
+
+    boost::mutex::scoped_lock lock(m_doorbellMutex);
+    m_doorbellPending = false;
+  }
+
+  return false;
+}
+
+void IpcReceiveThread::BroadcastFunction()
+{
+  // Waits for the acceptor to write to the ring and wakes the receive thread
+  // by posting a doorbell message to our own queue.
+
+  IpcBroadcastRing::Position seen = m_broadcastCursor;
+
+  while (! m_isClosing)
+  {
+    IpcBroadcastRing::Position position = m_broadcastRing->Wait(
+      seen,
+      boost::posix_time::microsec_clock::universal_time() 
+        + boost::posix_time::milliseconds(1000));
+
+    if (position != seen)
+    {
+      seen = position;
+      RingDoorbell();
+    }
+  }
+}
+
+void IpcReceiveThread::RingDoorbell()
+{
+  {
+    boost::mutex::scoped_lock lock(m_doorbellMutex);
+    if (m_doorbellPending)
+      return;
+    m_doorbellPending = true;
+  }
+
+  IpcSysMessage msg(IpcSysMessage::MSG_BROADCAST);
+  DataBuffer dataBuffer(msg.RequiredEncodeBufferSize());
+  (void)msg.Encode(dataBuffer.Get());
+
+  try
+  {
+    // If the queue is full the receive thread is not waiting on it anyway.
+    (void)m_messageQueue->try_send(
+      dataBuffer.Get(),
+      dataBuffer.Size(),
+      IpcSysMessage::SYS_MSG_PRIORITY);
+  }
+  catch(boost::interprocess::interprocess_exception &)
+  {
+    // ignore any error
+  }
+}
+
+void IpcReceiveThread::Wake()
+{
+  IpcSysMessage msg(IpcSysMessage::MSG_WAKE);
+  DataBuffer dataBuffer(msg.RequiredEncodeBufferSize());
+  (void)msg.Encode(dataBuffer.Get());
+
+  try
+  {
+    // If the queue is full the receive thread is not waiting on it anyway.
+    (void)m_messageQueue->try_send(
+      dataBuffer.Get(),
+      dataBuffer.Size(),
+      IpcSysMessage::SYS_MSG_PRIORITY);
+  }
+  catch(boost::interprocess::interprocess_exception &)
+  {
+    // ignore any error
+  }
+}
+
 void IpcReceiveThread::CallCompletionHandler(
     boost::system::error_code errorCode,
     std::string message)
@@ -255,20 +407,8 @@ void IpcReceiveThread::CallCompletionHandler(
 
 void IpcReceiveThread::ResetPingTimeout()
 {
-  if (m_pingMode == DisablePing)
-    return;
-    
-  m_pingTimeout 
-      = boost::posix_time::microsec_clock::universal_time() 
-        + boost::posix_time::seconds(PingTimeoutSeconds);
-}
-
-bool IpcReceiveThread::PingTimeout()
-{
-  if (m_pingMode == DisablePing)
-    return false; 
-  
-  return boost::posix_time::microsec_clock::universal_time() > m_pingTimeout;
+  if (m_heartbeat)
+    m_heartbeat->Received();
 }
 
 } // namespace Ipc
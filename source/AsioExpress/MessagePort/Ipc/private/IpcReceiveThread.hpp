@@ -8,6 +8,9 @@
 #include <boost/thread.hpp>
 
 #include "AsioExpress/MessagePort/Ipc/private/MessageQueuePointer.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBroadcastRing.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -25,7 +28,8 @@ public:
   IpcReceiveThread(
       boost::asio::io_service & ioService,
       MessageQueuePointer messageQueue,
-      PingMode pingMode);
+      PingMode pingMode,
+      IpcBlobPoolPointer blobPool = IpcBlobPoolPointer());
 
   ~IpcReceiveThread();
 
@@ -39,6 +43,27 @@ public:
 
   void Close();
 
+  ///
+  /// Also receives the messages broadcast through the acceptor's ring,
+  /// starting from the cursor given. Must be called while no receive is in
+  /// progress.
+  ///
+  void AttachBroadcastRing(
+      IpcBroadcastRingPointer broadcastRing,
+      IpcBroadcastRing::Position cursor);
+
+  ///
+  /// Reports every message received, pings included, to the heartbeat. Must
+  /// be called while no receive is in progress.
+  ///
+  void AttachHeartbeat(HeartbeatPointer heartbeat);
+
+  ///
+  /// Ends the receive in progress, if any, with a lost connection error.
+  /// Called by the heartbeat service when the peer has gone quiet.
+  ///
+  void PingTimeout();
+
 private:
   IpcReceiveThread(IpcReceiveThread const & );
   IpcReceiveThread & operator=(IpcReceiveThread const &);
@@ -55,6 +80,14 @@ private:
 
   void Receive();
 
+  bool ReceiveBroadcast();
+
+  void BroadcastFunction();
+
+  void RingDoorbell();
+
+  void Wake();
+
   void CallCompletionHandler(
     boost::system::error_code errorCode,
     std::string message);
@@ -63,23 +96,29 @@ private:
     AsioExpress::Error err);
   
   void ResetPingTimeout();
-  
-  bool PingTimeout();
 
   boost::asio::io_service &   m_ioService;
   MessageQueuePointer         m_messageQueue;
+  IpcBlobPoolPointer          m_blobPool;
 
   bool                        m_isReceiving; // only set by thread function
   bool                        m_isCanceled;  // only read by thread function
   bool                        m_isClosing;   // only read by thread function
+  bool                        m_isPeerLost;  // only read by thread function
 
   ReceiveParameters           m_parameters;
 
   boost::mutex                m_alertMutex;
   boost::condition_variable   m_alert;
   bool                        m_alertThrown;
-  boost::posix_time::ptime    m_pingTimeout;
   PingMode                    m_pingMode;
+  HeartbeatPointer            m_heartbeat;
+
+  IpcBroadcastRingPointer     m_broadcastRing;
+  IpcBroadcastRing::Position  m_broadcastCursor; // only used by thread function
+  boost::mutex                m_doorbellMutex;
+  bool                        m_doorbellPending;
+  boost::thread               m_broadcastThread;
 
   boost::thread               m_thread;
 };
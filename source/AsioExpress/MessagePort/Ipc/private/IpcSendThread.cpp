@@ -5,8 +5,6 @@
 
 #include "AsioExpress/pch.hpp"
 
-#include <boost/chrono.hpp>
-
 #include "AsioExpressConfig/config.hpp"
 #include "AsioExpressError/CatchMacros.hpp"
 #include "AsioExpress/Platform/DebugMessage.hpp"
@@ -23,12 +21,15 @@ WIN_DISABLE_WARNINGS_BEGIN(4355)
 IpcSendThread::IpcSendThread(
     boost::asio::io_service & ioService,
     MessageQueuePointer messageQueue,
-    PingMode pingMode) :
+    PingMode pingMode,
+    IpcBlobPoolPointer blobPool) :
   m_ioService(ioService),
   m_messageQueue(messageQueue),
+  m_blobPool(blobPool),
   m_isClosing(false),
   m_sendFailed(false),
   m_alertThrown(false),
+  m_pingRequested(false),
   m_pingMode(pingMode),
   m_thread(boost::bind(&IpcSendThread::SendFunction, this))
 {
@@ -92,38 +93,45 @@ void IpcSendThread::Close()
   m_thread.join();
 }
 
+void IpcSendThread::SendPing()
+{
+  if (m_pingMode == DisablePing)
+    return;
+
+  // notify thread of state change
+  {
+    boost::mutex::scoped_lock lock(m_alertMutex);
+    m_pingRequested = true;
+    m_alert.notify_one();
+  }
+}
+
 void IpcSendThread::SendFunction()
 {
   boost::unique_lock<boost::mutex> alertLock(m_alertMutex);
-  
-  ResetPingTime();
  
   while(! m_isClosing)
   {
     if (m_alertThrown)
     {
-      ResetPingTime();
-      
       Send();          
 
       m_alertThrown = false;
     }
-    else if (IsPingTime())
+    else if (m_pingRequested)
     {      
 #ifdef DEBUG_IPC
       DebugMessage("IpcSendThread: Sending ping on idle connection.\n");
 #endif
-      ResetPingTime();      
-
       SendSystemMessage(IpcSysMessage::MSG_PING);      
     }
 
-    boost::chrono::system_clock::time_point now(
-        boost::chrono::system_clock::now());
+    m_pingRequested = false;
 
-    m_alert.wait_until(
-            alertLock, 
-            now + (m_pingTime - now));
+    // The heartbeat service decides when to ping, so there is nothing to
+    // do until we are alerted.
+    while (! m_alertThrown && ! m_pingRequested)
+      m_alert.wait(alertLock);
   }
 
   Send();
@@ -179,6 +187,14 @@ void IpcSendThread::Send(SendParameters const & parameters)
   // "boost::interprocess_exception::library_error" error is not helpful
   size_t messageSize = parameters.dataBuffer->Size();
   size_t maxMessageSize = m_messageQueue->get_max_msg_size();
+
+  // Large messages are passed out-of-band through shared memory.
+  if (m_blobPool && (messageSize > maxMessageSize || messageSize >= BlobThresholdBytes))
+  {
+    SendBlob(parameters);
+    return;
+  }
+
   if (messageSize > maxMessageSize)
   {
 #ifdef DEBUG_IPC
@@ -214,6 +230,53 @@ void IpcSendThread::Send(SendParameters const & parameters)
     AsioExpress::Error());
 }
 
+void IpcSendThread::SendBlob(SendParameters const & parameters)
+{
+  size_t messageSize = parameters.dataBuffer->Size();
+  size_t maxPayloadSize = m_blobPool->MaxPayloadSize();
+  if (messageSize > maxPayloadSize)
+  {
+    std::stringstream ss;
+    ss << "MessagePort::AsyncSend(): Message size " << messageSize
+        << " greater than maximum allowed message size " << maxPayloadSize;
+    CallCompletionHandler(parameters.completionHandler,
+        ErrorCode::MessageQueueSendFailed, ss.str());
+    return;
+  }
+
+  DataBuffer descriptor;
+  if (!m_blobPool->Store(*parameters.dataBuffer, descriptor))
+  {
+#ifdef DEBUG_IPC
+    DebugMessage("IpcSendThread::SendBlob: Blob pool is full!\n");
+#endif
+    CallCompletionHandler(
+      parameters.completionHandler,
+      ErrorCode::MessageQueueFull,
+      "MessagePort::AsyncSend(): Recipient's shared memory pool is full.");
+    return;
+  }
+
+  bool successful = m_messageQueue->try_send(
+    descriptor.Get(), 
+    descriptor.Size(), 
+    parameters.priority);
+
+  if (!successful)
+  {
+    m_blobPool->Release(descriptor);
+    CallCompletionHandler(
+      parameters.completionHandler,
+      ErrorCode::MessageQueueFull,
+      "MessagePort::AsyncSend(): Recipient's message queue is full.");
+    return;
+  }
+
+  CallCompletionHandler(
+    parameters.completionHandler,
+    AsioExpress::Error());
+}
+
 void IpcSendThread::TestSend(DataBufferPointer dataBuffer,
     AsioExpress::CompletionHandler completionHandler)
 {
@@ -265,22 +328,6 @@ void IpcSendThread::SendSystemMessage(char const * systemMessage)
   }    
 }
 
-void IpcSendThread::ResetPingTime()
-{
-  if (m_pingMode == DisablePing)
-    return;
-  
-  m_pingTime = boost::chrono::system_clock::now() + boost::chrono::seconds(PingRateSeconds);
-}
-
-bool IpcSendThread::IsPingTime()
-{
-  if (m_pingMode == DisablePing)
-    return false; 
-  
-  return boost::chrono::system_clock::now() >= m_pingTime;
-}
-
 } // namespace Ipc
 } // namespace MessagePort
 } // namespace AsioExpress
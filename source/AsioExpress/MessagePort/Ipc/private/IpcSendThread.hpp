@@ -8,6 +8,7 @@
 #include <boost/thread.hpp>
 
 #include "AsioExpress/MessagePort/Ipc/private/MessageQueuePointer.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -25,7 +26,8 @@ public:
   IpcSendThread(
       boost::asio::io_service & ioService,
       MessageQueuePointer messageQueue,
-      PingMode pingMode);
+      PingMode pingMode,
+      IpcBlobPoolPointer blobPool = IpcBlobPoolPointer());
 
   ~IpcSendThread();
 
@@ -36,6 +38,12 @@ public:
 
   void Close();
 
+  ///
+  /// Sends a ping unless the connection is closing. Called by the heartbeat
+  /// service when nothing has been sent for a while.
+  ///
+  void SendPing();
+
   /* NOTE: use only for testing */
   void TestSend(DataBufferPointer dataBuffer,
       AsioExpress::CompletionHandler completionHandler);
@@ -68,6 +76,8 @@ private:
 
   void Send(SendParameters const & parameters);
 
+  void SendBlob(SendParameters const & parameters);
+
   void CallCompletionHandlers(
     SendQueue::iterator parameters,
     SendQueue::iterator end,
@@ -83,13 +93,10 @@ private:
     AsioExpress::Error error);
   
   void SendSystemMessage(char const * systemMessage);
-  
-  void ResetPingTime();
-  
-  bool IsPingTime();
 
   boost::asio::io_service &                 m_ioService;
   MessageQueuePointer                       m_messageQueue;
+  IpcBlobPoolPointer                        m_blobPool;
 
   // only read by thread function
   bool                                      m_isClosing;
@@ -104,7 +111,7 @@ private:
   boost::mutex                              m_alertMutex;
   boost::condition_variable                 m_alert;
   bool                                      m_alertThrown;
-  boost::chrono::system_clock::time_point   m_pingTime;
+  bool                                      m_pingRequested;
   PingMode                                  m_pingMode;
 
   boost::thread                             m_thread;
@@ -19,6 +19,8 @@ char const * const IpcSysMessage::MSG_CONNECT      = "CONNECT";
 char const * const IpcSysMessage::MSG_CONNECT_ACK  = "CONN-ACK";
 char const * const IpcSysMessage::MSG_DISCONNECT   = "DISCONN";
 char const * const IpcSysMessage::MSG_PING         = "PING";
+char const * const IpcSysMessage::MSG_BROADCAST    = "BCAST";
+char const * const IpcSysMessage::MSG_WAKE         = "WAKE";
 
 
 const std::string& IpcSysMessage::GetParam(int idx) const
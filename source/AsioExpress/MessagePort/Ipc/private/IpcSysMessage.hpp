@@ -14,12 +14,14 @@ namespace Ipc {
 class IpcSysMessage
 {
 public:
-  static size_t const MaxMessageSize = 100;
+  static size_t const MaxMessageSize = 512;
   static size_t const MaxNumberOfMessages = 100;
   static char const * const MSG_CONNECT;
   static char const * const MSG_CONNECT_ACK;
   static char const * const MSG_DISCONNECT;
   static char const * const MSG_PING;
+  static char const * const MSG_BROADCAST;
+  static char const * const MSG_WAKE;
 
   static const unsigned int SYS_MSG_PRIORITY = 10;
 
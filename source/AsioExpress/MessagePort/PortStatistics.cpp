@@ -0,0 +1,168 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+namespace
+{
+  boost::posix_time::ptime const Epoch(boost::gregorian::date(1970, 1, 1));
+}
+
+PortStatistics::PortStatistics() :
+  messagesSent(0),
+  bytesSent(0),
+  messagesReceived(0),
+  bytesReceived(0),
+  sendQueueDepth(0),
+  sendQueueBytes(0)
+{
+  for (int i = 0; i < LatencyBuckets; ++i)
+    sendLatency[i] = 0;
+}
+
+void PortStatistics::Add(PortStatistics const & other)
+{
+  messagesSent += other.messagesSent;
+  bytesSent += other.bytesSent;
+  messagesReceived += other.messagesReceived;
+  bytesReceived += other.bytesReceived;
+  sendQueueDepth += other.sendQueueDepth;
+  sendQueueBytes += other.sendQueueBytes;
+
+  if (lastActivity.is_not_a_date_time() ||
+      (!other.lastActivity.is_not_a_date_time() && other.lastActivity > lastActivity))
+  {
+    lastActivity = other.lastActivity;
+  }
+
+  for (int i = 0; i < LatencyBuckets; ++i)
+    sendLatency[i] += other.sendLatency[i];
+}
+
+boost::uint64_t PortStatistics::GetLatencyCount() const
+{
+  boost::uint64_t count = 0;
+  for (int i = 0; i < LatencyBuckets; ++i)
+    count += sendLatency[i];
+  return count;
+}
+
+boost::uint64_t PortStatistics::GetLatencyPercentile(double fraction) const
+{
+  return GetLatencyPercentile(sendLatency, fraction);
+}
+
+int PortStatistics::GetLatencyBucket(boost::uint64_t latency)
+{
+  // The bucket is the position of the latency's highest bit.
+  int bucket = 0;
+  while (latency > 1 && bucket < LatencyBuckets - 1)
+  {
+    latency >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+boost::uint64_t PortStatistics::GetLatencyPercentile(
+    boost::uint64_t const * latencies,
+    double fraction)
+{
+  boost::uint64_t count = 0;
+  for (int i = 0; i < LatencyBuckets; ++i)
+    count += latencies[i];
+  if (count == 0)
+    return 0;
+
+  boost::uint64_t wanted = static_cast<boost::uint64_t>(fraction * count + 0.5);
+  if (wanted == 0)
+    wanted = 1;
+
+  boost::uint64_t total = 0;
+  for (int i = 0; i < LatencyBuckets; ++i)
+  {
+    total += latencies[i];
+    if (total >= wanted)
+      return static_cast<boost::uint64_t>(1) << (i + 1);
+  }
+  return static_cast<boost::uint64_t>(1) << LatencyBuckets;
+}
+
+PortCounters::PortCounters() :
+  m_messagesSent(0),
+  m_bytesSent(0),
+  m_messagesReceived(0),
+  m_bytesReceived(0),
+  m_sendQueueDepth(0),
+  m_sendQueueBytes(0),
+  m_lastActivity(0)
+{
+  for (int i = 0; i < PortStatistics::LatencyBuckets; ++i)
+    m_sendLatency[i].store(0, boost::memory_order_relaxed);
+}
+
+PortCounters::Time PortCounters::Now()
+{
+  return (boost::posix_time::microsec_clock::universal_time() - Epoch).total_microseconds();
+}
+
+void PortCounters::SendStarted(std::size_t bytes)
+{
+  m_sendQueueDepth.fetch_add(1, boost::memory_order_relaxed);
+  m_sendQueueBytes.fetch_add(bytes, boost::memory_order_relaxed);
+}
+
+void PortCounters::SendCompleted(std::size_t bytes, Time started, bool isSent)
+{
+  m_sendQueueDepth.fetch_sub(1, boost::memory_order_relaxed);
+  m_sendQueueBytes.fetch_sub(bytes, boost::memory_order_relaxed);
+
+  if (!isSent)
+    return;
+
+  Time now = Now();
+  m_messagesSent.fetch_add(1, boost::memory_order_relaxed);
+  m_bytesSent.fetch_add(bytes, boost::memory_order_relaxed);
+  m_lastActivity.store(now, boost::memory_order_relaxed);
+
+  boost::uint64_t latency = now > started ? static_cast<boost::uint64_t>(now - started) : 0;
+  m_sendLatency[PortStatistics::GetLatencyBucket(latency)].fetch_add(1, boost::memory_order_relaxed);
+}
+
+void PortCounters::Received(std::size_t bytes)
+{
+  m_messagesReceived.fetch_add(1, boost::memory_order_relaxed);
+  m_bytesReceived.fetch_add(bytes, boost::memory_order_relaxed);
+  m_lastActivity.store(Now(), boost::memory_order_relaxed);
+}
+
+void PortCounters::Get(PortStatistics & statistics) const
+{
+  statistics.messagesSent = m_messagesSent.load(boost::memory_order_relaxed);
+  statistics.bytesSent = m_bytesSent.load(boost::memory_order_relaxed);
+  statistics.messagesReceived = m_messagesReceived.load(boost::memory_order_relaxed);
+  statistics.bytesReceived = m_bytesReceived.load(boost::memory_order_relaxed);
+  statistics.sendQueueDepth = m_sendQueueDepth.load(boost::memory_order_relaxed);
+  statistics.sendQueueBytes = m_sendQueueBytes.load(boost::memory_order_relaxed);
+
+  Time lastActivity = m_lastActivity.load(boost::memory_order_relaxed);
+  if (lastActivity == 0)
+    statistics.lastActivity = boost::posix_time::ptime();
+  else
+    statistics.lastActivity = Epoch + boost::posix_time::microseconds(lastActivity);
+
+  for (int i = 0; i < PortStatistics::LatencyBuckets; ++i)
+    statistics.sendLatency[i] = m_sendLatency[i].load(boost::memory_order_relaxed);
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
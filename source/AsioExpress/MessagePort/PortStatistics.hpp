@@ -0,0 +1,207 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "AsioExpress/Error.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/SendBatch.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// The traffic of one connection, as counted by its message port. Bytes
+/// are those of the messages; the transport's framing and pings are not
+/// counted. A send is queued from the time it is started until it
+/// completes, and its latency is that time. The latencies are counted in
+/// buckets: bucket i holds the sends that took from 2^i up to 2^(i+1)
+/// microseconds, with the first bucket also holding the quicker ones and
+/// the last the slower ones.
+///
+struct PortStatistics
+{
+  enum { LatencyBuckets = 24 };
+
+  PortStatistics();
+
+  /// Adds the traffic of another connection, as for a client with several.
+  void Add(PortStatistics const & other);
+
+  /// Gets the number of sends whose latency has been counted.
+  boost::uint64_t GetLatencyCount() const;
+
+  ///
+  /// Gets an upper bound, in microseconds, on the latency of the given
+  /// fraction of the sends, or zero if there have been none.
+  ///
+  boost::uint64_t GetLatencyPercentile(double fraction) const;
+
+  /// Gets the bucket that counts a latency of the given microseconds.
+  static int GetLatencyBucket(boost::uint64_t latency);
+
+  /// Gets the percentile of any latencies counted in these buckets.
+  static boost::uint64_t GetLatencyPercentile(
+      boost::uint64_t const * latencies,
+      double fraction);
+
+  boost::uint64_t               messagesSent;
+  boost::uint64_t               bytesSent;
+  boost::uint64_t               messagesReceived;
+  boost::uint64_t               bytesReceived;
+  boost::uint64_t               sendQueueDepth;
+  boost::uint64_t               sendQueueBytes;
+  boost::posix_time::ptime      lastActivity;
+  boost::uint64_t               sendLatency[LatencyBuckets];
+};
+
+///
+/// The counters a message port keeps as it sends and receives. They are
+/// updated without locks, from whichever thread completes the operation.
+///
+class PortCounters
+{
+public:
+  typedef boost::int64_t Time;
+
+  PortCounters();
+
+  /// Gets the time, in microseconds, to start a send from.
+  static Time Now();
+
+  void SendStarted(std::size_t bytes);
+
+  void SendCompleted(std::size_t bytes, Time started, bool isSent);
+
+  void Received(std::size_t bytes);
+
+  void Get(PortStatistics & statistics) const;
+
+private:
+  PortCounters(PortCounters const &);
+  PortCounters & operator=(PortCounters const &);
+
+  boost::atomic<boost::uint64_t>    m_messagesSent;
+  boost::atomic<boost::uint64_t>    m_bytesSent;
+  boost::atomic<boost::uint64_t>    m_messagesReceived;
+  boost::atomic<boost::uint64_t>    m_bytesReceived;
+  boost::atomic<boost::uint64_t>    m_sendQueueDepth;
+  boost::atomic<boost::uint64_t>    m_sendQueueBytes;
+  boost::atomic<boost::int64_t>     m_lastActivity;
+  boost::atomic<boost::uint64_t>    m_sendLatency[PortStatistics::LatencyBuckets];
+};
+
+typedef boost::shared_ptr<PortCounters> PortCountersPointer;
+
+///
+/// Counts a send when it completes and then calls the send's completion
+/// handler.
+///
+template<typename H>
+class CountingSendHandler
+{
+public:
+  CountingSendHandler(
+      PortCountersPointer counters,
+      DataBufferPointer buffer,
+      H completionHandler) :
+    m_counters(counters),
+    m_bytes(buffer ? buffer->Size() : 0),
+    m_started(PortCounters::Now()),
+    m_completionHandler(completionHandler)
+  {
+    m_counters->SendStarted(m_bytes);
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    m_counters->SendCompleted(m_bytes, m_started, !error);
+    m_completionHandler(error);
+  }
+
+private:
+  PortCountersPointer     m_counters;
+  std::size_t             m_bytes;
+  PortCounters::Time      m_started;
+  H                       m_completionHandler;
+};
+
+///
+/// Counts each message of a batch sent as one write, as a send of its own,
+/// and then calls the batch's completion handler.
+///
+template<typename H>
+class CountingBatchSendHandler
+{
+public:
+  CountingBatchSendHandler(
+      PortCountersPointer counters,
+      DataBufferListPointer batch,
+      H completionHandler) :
+    m_counters(counters),
+    m_batch(batch),
+    m_started(PortCounters::Now()),
+    m_completionHandler(completionHandler)
+  {
+    DataBufferList::const_iterator  it = m_batch->begin();
+    DataBufferList::const_iterator end = m_batch->end();
+    for (; it != end; ++it)
+      m_counters->SendStarted((*it)->Size());
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    DataBufferList::const_iterator  it = m_batch->begin();
+    DataBufferList::const_iterator end = m_batch->end();
+    for (; it != end; ++it)
+      m_counters->SendCompleted((*it)->Size(), m_started, !error);
+    m_completionHandler(error);
+  }
+
+private:
+  PortCountersPointer     m_counters;
+  DataBufferListPointer   m_batch;
+  PortCounters::Time      m_started;
+  H                       m_completionHandler;
+};
+
+///
+/// Counts a message once it has been received into the buffer and then
+/// calls the receive's completion handler.
+///
+template<typename H>
+class CountingReceiveHandler
+{
+public:
+  CountingReceiveHandler(
+      PortCountersPointer counters,
+      DataBufferPointer buffer,
+      H completionHandler) :
+    m_counters(counters),
+    m_buffer(buffer),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    if (!error)
+      m_counters->Received(m_buffer->Size());
+    m_completionHandler(error);
+  }
+
+private:
+  PortCountersPointer     m_counters;
+  DataBufferPointer       m_buffer;
+  H                       m_completionHandler;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
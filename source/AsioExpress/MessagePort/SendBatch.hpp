@@ -0,0 +1,74 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+/// The messages of a batch, sent to one port in this order.
+typedef std::vector<DataBufferPointer> DataBufferList;
+typedef boost::shared_ptr<DataBufferList> DataBufferListPointer;
+
+///
+/// Completes a batch whose messages are sent one at a time. The handler is
+/// called once, after the last of them completes, with the first error any
+/// of them had.
+///
+class SendBatchHandler
+{
+public:
+  SendBatchHandler(
+      std::size_t count,
+      AsioExpress::CompletionHandler completionHandler) :
+    m_state(new State(count, completionHandler))
+  {
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    {
+      boost::mutex::scoped_lock lock(m_state->mutex);
+
+      if (error && !m_state->error)
+        m_state->error = error;
+
+      if (--m_state->remaining > 0)
+        return;
+    }
+
+    m_state->completionHandler(m_state->error);
+  }
+
+private:
+  struct State
+  {
+    State(
+        std::size_t count,
+        AsioExpress::CompletionHandler completionHandler) :
+      remaining(count),
+      completionHandler(completionHandler)
+    {
+    }
+
+    boost::mutex                      mutex;
+    std::size_t                       remaining;
+    AsioExpress::Error                error;
+    AsioExpress::CompletionHandler    completionHandler;
+  };
+
+  boost::shared_ptr<State>  m_state;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -8,18 +8,29 @@
 #include <deque>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "AsioExpress/CompletionHandler.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/SendBatch.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
 
+///
+/// The messages waiting for a port's send in progress to complete. The
+/// queue also tracks whether a send is in progress, so ports may be sent
+/// to from any thread.
+///
 class SendQueue
 {
 public:
   struct Item
   {
+    Item()
+    {
+    }
+
     Item(
         AsioExpress::MessagePort::DataBufferPointer dataBuffer,
         AsioExpress::CompletionHandler completionHandler) :
@@ -28,45 +39,106 @@ public:
     {
     }
 
+    /// A batch is sent as one write and completes as one.
+    Item(
+        AsioExpress::MessagePort::DataBufferListPointer batch,
+        AsioExpress::CompletionHandler completionHandler) :
+      batch(batch),
+      completionHandler(completionHandler)
+    {
+    }
+
     AsioExpress::MessagePort::DataBufferPointer    dataBuffer;
+    AsioExpress::MessagePort::DataBufferListPointer batch;
     AsioExpress::CompletionHandler           completionHandler;
   };
 
+  SendQueue() :
+    m_isSending(false)
+  {
+  }
+
   bool Empty() const
   {
+    boost::mutex::scoped_lock lock(m_mutex);
     return m_queue.empty();
   }
 
-  void Push(Item item)
+  ///
+  /// Starts a send if none is in progress. Returns false if the port is
+  /// already sending.
+  ///
+  bool Start()
   {
-    m_queue.push_back(item);
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_isSending)
+      return false;
+
+    m_isSending = true;
+    return true;
   }
 
-  Item Top() const
+  ///
+  /// Queues the item behind the send in progress. Returns false without
+  /// queuing anything when no send is in progress; the send is started and
+  /// the caller sends the item itself.
+  ///
+  bool Push(Item const & item)
   {
-    return m_queue.front();
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (!m_isSending)
+    {
+      m_isSending = true;
+      return false;
+    }
+
+    m_queue.push_back(item);
+    return true;
   }
 
-  void Pop()
+  ///
+  /// Takes the next item to send once a send completes. Returns false,
+  /// ending the send in progress, when the queue is empty.
+  ///
+  bool Pop(Item & item)
   {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_queue.empty())
+    {
+      m_isSending = false;
+      return false;
+    }
+
+    item = m_queue.front();
     m_queue.pop_front();
+    return true;
   }
 
   void Error(boost::asio::io_service& ioService, AsioExpress::Error error)
   {
-    Queue::iterator  it = m_queue.begin();
-    Queue::iterator end = m_queue.end();
+    Queue queue;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      queue.swap(m_queue);
+    }
+
+    Queue::iterator  it = queue.begin();
+    Queue::iterator end = queue.end();
     for (; it != end; ++it)
     {
       ioService.post(boost::asio::detail::bind_handler(it->completionHandler, error));
     }
-    m_queue.clear();
   }
 
 private:
   typedef std::deque<Item> Queue;
 
-  Queue m_queue;
+  mutable boost::mutex  m_mutex;
+  bool                  m_isSending;
+  Queue                 m_queue;
 };
 
 typedef boost::shared_ptr<SendQueue> SendQueuePointer;
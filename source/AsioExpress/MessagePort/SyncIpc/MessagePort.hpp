@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <boost/interprocess/ipc/message_queue.hpp>
@@ -12,6 +14,7 @@
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
 
 #include "AsioExpress/MessagePort/SyncIpc/private/MessageQueuePointer.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/EndPoint.hpp"
 
 namespace AsioExpress {
@@ -26,6 +29,7 @@ public:
   typedef EndPoint EndPointType;
 
 public:
+  MessagePort();
   ~MessagePort();
 
   void Connect(
@@ -44,7 +48,19 @@ public:
   bool Receive(
       AsioExpress::MessagePort::DataBufferPointer buffer,
       int maxMilliseconds);
-  
+
+  ///
+  /// Waits up to maxMilliseconds (0 waits forever) for a message and then
+  /// takes up to maxMessages in total without waiting again. Buffers already
+  /// in the vector are reused and the vector is resized to the number of
+  /// messages received, which is returned; 0 means the wait timed out.
+  ///
+  std::size_t ReceiveMany(
+      std::vector<AsioExpress::MessagePort::DataBufferPointer> & buffers,
+      std::size_t maxMessages,
+      int maxMilliseconds);
+
+  /// Closes the connection, waking any thread blocked in a receive.
   void Disconnect();
 
   void SetMessagePortOptions();
@@ -59,13 +75,22 @@ private:
 
 private:
   void InternalDisconnect();
+
+  void WakeReceiver();
+
+  void SendBlob(AsioExpress::MessagePort::DataBufferPointer buffer);
   
   std::string                             m_sendMessageQueueName;
   std::string                             m_recvMessageQueueName;
   boost::mutex                            m_sendMutex;
   MessageQueuePointer                     m_sendMessageQueue;
+  Ipc::IpcBlobPoolPointer                 m_sendBlobPool;
   boost::mutex                            m_recvMutex;
   MessageQueuePointer                     m_recvMessageQueue;
+  Ipc::IpcBlobPoolPointer                 m_recvBlobPool;
+  AsioExpress::MessagePort::DataBuffer    m_recvBuffer;
+  std::string                             m_pendingSystemMessage;
+  int                                     m_pingTimeout;
 };
 
 } // namespace SyncIpc
@@ -11,6 +11,8 @@
 #include "AsioExpress/Platform/DebugMessage.hpp"
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcConstants.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/MessagePort.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/private/SyncIpcCommandReceive.hpp"
 
@@ -18,6 +20,11 @@ namespace AsioExpress {
 namespace MessagePort {
 namespace SyncIpc {
 
+MessagePort::MessagePort() :
+  m_pingTimeout(EndPoint::DefaultPingTimeoutMilliseconds)
+{
+}
+
 MessagePort::~MessagePort()
 {
   Disconnect();
@@ -26,6 +33,10 @@ MessagePort::~MessagePort()
 void MessagePort::Disconnect()
 {
   boost::mutex::scoped_lock sendLock(m_sendMutex);
+
+  // A receiving thread holds the receive lock while it waits.
+  WakeReceiver();
+
   boost::mutex::scoped_lock recvLock(m_recvMutex);
 
   InternalDisconnect();
@@ -67,6 +78,14 @@ void MessagePort::Send(
   // "boost::interprocess_exception::library_error" error is not helpful
   size_t messageSize = buffer->Size();
   size_t maxMessageSize = m_sendMessageQueue->get_max_msg_size();
+
+  // Large messages are passed out-of-band through shared memory.
+  if (messageSize > maxMessageSize || messageSize >= Ipc::BlobThresholdBytes)
+  {
+    SendBlob(buffer);
+    return;
+  }
+
   if (messageSize > maxMessageSize)
   {
 #ifdef DEBUG_IPC
@@ -111,6 +130,66 @@ void MessagePort::Send(
   }
 }
 
+void MessagePort::SendBlob(
+    AsioExpress::MessagePort::DataBufferPointer buffer)
+{
+  using namespace AsioExpress;
+
+  if ( !m_sendBlobPool )
+  {
+    m_sendBlobPool.reset(
+        new Ipc::IpcBlobPool(m_sendMessageQueueName, Ipc::BlobPoolBytes));
+  }
+
+  size_t messageSize = buffer->Size();
+  size_t maxPayloadSize = m_sendBlobPool->MaxPayloadSize();
+  if (messageSize > maxPayloadSize)
+  {
+    std::stringstream ss;
+    ss << "SyncIpc::MessagePort::Send(): Message size " << messageSize
+        << " greater than maximum allowed message size " << maxPayloadSize;
+    throw CommonException(
+        Error(AsioExpress::MessagePort::Ipc::ErrorCode::MessageQueueSendFailed,
+            ss.str()));
+  }
+
+  bool successful = false;
+  try
+  {
+    DataBuffer descriptor;
+    if (!m_sendBlobPool->Store(*buffer, descriptor))
+    {
+      throw CommonException(Error(
+        AsioExpress::MessagePort::Ipc::ErrorCode::MessageQueueFull,
+        "SyncIpc::MessagePort::Send(): Recipient's shared memory pool is full."));
+    }
+
+    successful = m_sendMessageQueue->try_send(
+      descriptor.Get(),
+      descriptor.Size(),
+      0);
+
+    if (!successful)
+      m_sendBlobPool->Release(descriptor);
+  }
+  catch (boost::interprocess::interprocess_exception & e)
+  {
+    std::stringstream ss;
+    ss << "SyncIpc::MessagePort::Send(): Interprocess exception: " << e.what();
+    throw CommonException(
+      Error(
+            AsioExpress::MessagePort::Ipc::ErrorCode::MessageQueueSendFailed,
+            ss.str()));
+  }
+
+  if (!successful)
+  {
+    throw CommonException(Error(
+      AsioExpress::MessagePort::Ipc::ErrorCode::MessageQueueFull,
+      "SyncIpc::MessagePort::Send(): Recipient's message queue is full."));
+  }
+}
+
 void MessagePort::TestSend(AsioExpress::MessagePort::DataBufferPointer buffer,
     MessageQueuePointer sendQueuePointer)
 {
@@ -140,6 +219,12 @@ bool MessagePort::Receive(
       "MessagePort::Receive(): No connection has been established."));
   }
 
+  if ( !m_recvBlobPool )
+  {
+    m_recvBlobPool.reset(
+        new IpcBlobPool(m_recvMessageQueueName, BlobPoolBytes));
+  }
+
   // Receive the next message & copy to the buffer
 
   return SyncIpcCommandReceive(
@@ -147,8 +232,48 @@ bool MessagePort::Receive(
                 m_sendMessageQueue,
                 m_recvMutex,
                 m_sendMutex,
+                *m_recvBlobPool,
+                m_recvBuffer,
+                m_pendingSystemMessage,
                 buffer,
-                maxMilliseconds);
+                maxMilliseconds,
+                m_pingTimeout);
+}
+
+std::size_t MessagePort::ReceiveMany(
+    std::vector<AsioExpress::MessagePort::DataBufferPointer> & buffers,
+    std::size_t maxMessages,
+    int maxMilliseconds)
+{
+  using namespace AsioExpress::MessagePort::Ipc;
+
+  // Check that we're connected
+
+  if ( !m_recvMessageQueue )
+  {
+    throw CommonException(Error(
+      AsioExpress::MessagePort::Ipc::ErrorCode::Disconnected,
+      "MessagePort::ReceiveMany(): No connection has been established."));
+  }
+
+  if ( !m_recvBlobPool )
+  {
+    m_recvBlobPool.reset(
+        new IpcBlobPool(m_recvMessageQueueName, BlobPoolBytes));
+  }
+
+  return SyncIpcCommandReceiveMany(
+                m_recvMessageQueue,
+                m_sendMessageQueue,
+                m_recvMutex,
+                m_sendMutex,
+                *m_recvBlobPool,
+                m_recvBuffer,
+                m_pendingSystemMessage,
+                buffers,
+                maxMessages,
+                maxMilliseconds,
+                m_pingTimeout);
 }
 
 
@@ -184,6 +309,33 @@ void MessagePort::SetMessagePortOptions()
 {
 }
 
+void MessagePort::WakeReceiver()
+{
+  using namespace AsioExpress::MessagePort::Ipc;
+
+  // Post a disconnect message to our own receive queue so a blocked receive
+  // returns at once instead of waiting out its timeout.
+  //
+  MessageQueuePointer recvMessageQueue(m_recvMessageQueue);
+  if (recvMessageQueue)
+  {
+    IpcSysMessage msg(IpcSysMessage::MSG_DISCONNECT);
+    DataBuffer dataBuffer(msg.RequiredEncodeBufferSize());
+    (void)msg.Encode(dataBuffer.Get());
+    try
+    {
+      (void)recvMessageQueue->try_send(
+        dataBuffer.Get(),
+        dataBuffer.Size(),
+        IpcSysMessage::SYS_MSG_PRIORITY);
+    }
+    catch(boost::interprocess::interprocess_exception &)
+    {
+      // ignore any error
+    }
+  }
+}
+
 void MessagePort::InternalDisconnect()
 {
   using namespace AsioExpress::MessagePort::Ipc;
@@ -220,17 +372,21 @@ void MessagePort::InternalDisconnect()
     m_sendMessageQueue.reset();
   }
 
+  m_sendBlobPool.reset();
+  m_recvBlobPool.reset();
+  m_pendingSystemMessage.clear();
+
   // Delete the queues from the system
   //
   if ( !m_sendMessageQueueName.empty() )
   {
-    boost::interprocess::message_queue::remove(m_sendMessageQueueName.c_str());
+    RemoveConnectionQueue(m_sendMessageQueueName);
     m_sendMessageQueueName.clear();
   }
 
   if ( !m_recvMessageQueueName.empty() )
   {
-    boost::interprocess::message_queue::remove(m_recvMessageQueueName.c_str());
+    RemoveConnectionQueue(m_recvMessageQueueName);
     m_recvMessageQueueName.clear();
   }
 }
@@ -7,96 +7,50 @@
 
 #include "AsioExpressConfig/config.hpp"
 
-#include <boost/random.hpp>
-
 #include "AsioExpress/Platform/DebugMessage.hpp"
 
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcQueueNames.hpp"
 
 #include "AsioExpress/MessagePort/SyncIpc/EndPoint.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/private/SyncIpcCommandConnect.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/private/SyncIpcCommandReceive.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/private/MessageQueuePointer.hpp"
 
-namespace
-{
-    boost::mt19937 rng(static_cast<boost::uint32_t>(std::time(0)));
-}
-
 namespace AsioExpress {
 namespace MessagePort {
 namespace SyncIpc {
 
 //TODO: This code is copied from IPC source and should be refactored.
 
-inline std::string IntToString(int n)
-{
-    std::ostringstream ss;
-    ss << n;
-    return ss.str();
-}
-
 void SyncIpcCommandConnect(
         EndPoint const & endPoint,
         MessagePort & messagePort)
 {
-    static int const LowConnectionId = 1;
-    static int const HighConnectionId = 99;
-
     using namespace AsioExpress::MessagePort::Ipc;
 
     AsioExpress::MessagePort::DataBufferPointer dataBuffer(
         new AsioExpress::MessagePort::DataBuffer);
 
 #ifdef DEBUG_IPC
-    DebugMessage("SyncIpcCommandConnect: Finding new message queue ID.\n");
+    DebugMessage("SyncIpcCommandConnect: Naming new message queues.\n");
 #endif
 
     messagePort.InternalDisconnect();
 
+    messagePort.m_pingTimeout = endPoint.GetPingTimeout();
+
     //
-    // Step 1 - Find a valid message queue name that is not in use
+    // Step 1 - Name the message queues after this process, clearing any
+    //          stale queues a crashed process with our id left behind.
     //
 
     std::string clientQueueName;
     std::string serverQueueName;
-    bool finished = false;
-
-    while (!finished)
-    {
-        boost::uniform_int<> connectionIdRange(LowConnectionId, HighConnectionId);
-        boost::variate_generator<boost::mt19937&, boost::uniform_int<> > randomNumber(rng, connectionIdRange);
-        std::string id = IntToString(randomNumber());
-
-        clientQueueName = endPoint.GetEndPoint() + "#Client#" + id;
-        serverQueueName = endPoint.GetEndPoint() + "#Server#" + id;
-
-        // Check that the queue doesn't already exist
-
-        try
-        {
-            boost::interprocess::message_queue mq1(boost::interprocess::open_only, clientQueueName.c_str());
-            // No exception thrown - this queue already exists. Try again.
-            continue;
-        }
-        catch (boost::interprocess::interprocess_exception&)
-        {
-            // Couldn't open queue, so it doesn't exist. We can proceed.
-        }
-
-        try
-        {
-            boost::interprocess::message_queue mq1(boost::interprocess::open_only, serverQueueName.c_str());
-            // No exception thrown - this queue already exists. Try again.
-            continue;
-        }
-        catch (boost::interprocess::interprocess_exception&)
-        {
-            // Couldn't open queue, so it doesn't exist. We can proceed.
-            finished = true;
-        }
-    }
+    MakeConnectionQueueNames(endPoint.GetEndPoint(), clientQueueName, serverQueueName);
+    RemoveConnectionQueue(clientQueueName);
+    RemoveConnectionQueue(serverQueueName);
 
     //
     // Step 2 - Create the message queues for client & server
@@ -185,7 +139,7 @@ void SyncIpcCommandConnect(
     bool receivedMessage = SyncIpcCommandReceive(
             messagePort.m_recvMessageQueue,
             dataBuffer,
-            5000);
+            endPoint.GetConnectTimeout());
     if (!receivedMessage)
     {
 #ifdef DEBUG_IPC
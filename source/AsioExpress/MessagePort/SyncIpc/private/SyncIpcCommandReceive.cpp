@@ -9,10 +9,8 @@
 
 #include "AsioExpressError/CommonException.hpp"
 #include "AsioExpress/Platform/DebugMessage.hpp"
-#include "AsioExpress/Platform/Sleep.hpp"
 #include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/Ipc/private/IpcSysMessage.hpp"
-#include "AsioExpress/MessagePort/Ipc/private/IpcConstants.hpp"
 #include "AsioExpress/MessagePort/SyncIpc/private/SyncIpcCommandReceive.hpp"
 
 namespace AsioExpress {
@@ -22,23 +20,37 @@ namespace SyncIpc {
 class PingTimer
 {
 public:
-    PingTimer()
+    PingTimer(int timeoutMilliseconds) :
+        timeout(timeoutMilliseconds)
     {
         Reset();
     }
 
     void Reset()
     {
+      if (timeout <= 0)
+      {
+        pingTimeout = boost::posix_time::pos_infin;
+        return;
+      }
+
       pingTimeout
           = boost::posix_time::microsec_clock::universal_time()
-            + boost::posix_time::seconds(Ipc::PingTimeoutSeconds);
+            + boost::posix_time::milliseconds(timeout);
     }
 
     bool Elapsed()
     {
-      return boost::posix_time::microsec_clock::universal_time() > pingTimeout;
+      return boost::posix_time::microsec_clock::universal_time() >= pingTimeout;
     }
+
+    boost::posix_time::ptime GetExpiryTime() const
+    {
+      return pingTimeout;
+    }
+
 private:
+    int                         timeout;
     boost::posix_time::ptime    pingTimeout;
 };
 
@@ -56,11 +68,11 @@ public:
       }
     }
 
-    boost::posix_time::ptime GetNextTimeout()
+    // Returns the time the next wait must end by: the expiry time or the
+    // limit given, whichever comes first.
+    boost::posix_time::ptime GetNextTimeout(boost::posix_time::ptime const & limit)
     {
-      nextTimeout
-        = boost::posix_time::microsec_clock::universal_time()
-          + boost::posix_time::milliseconds(1000);
+      nextTimeout = limit;
 
       if ( hasTimeout && nextTimeout > expiryTime )
         nextTimeout = expiryTime;
@@ -102,118 +114,173 @@ static void SendSystemMessage(
   }
 }
 
-static bool Receive(
+static void ThrowSystemMessageError(std::string const & messageType)
+{
+  using namespace AsioExpress::MessagePort::Ipc;
+
+  if ( messageType == IpcSysMessage::MSG_DISCONNECT )
+  {
+      // This is a disconnect message; return an error.
+#ifdef DEBUG_IPC
+      DebugMessage("SyncIpcCommandReceive: A disconnect message was received.\n");
+#endif
+      throw CommonException(Error(
+          ErrorCode::Disconnected,
+          "MessagePort::SyncIpc::Receive(): Connection was disconnected."));
+  }
+
+  throw CommonException(Error(
+      ErrorCode::Disconnected,
+      "MessagePort::SyncIpc::Receive(): Unknown IPC system message sent by peer."));
+}
+
+//
+// Blocks until the first message arrives and then takes any others already
+// queued without waiting again. The wait ends early only if the timeout or
+// the ping deadline is reached, or a disconnect message arrives; the port's
+// own Disconnect() posts one to wake us up.
+//
+static std::size_t Receive(
     MessageQueuePointer recvMessageQueue,
     MessageQueuePointer sendMessageQueue,
     boost::mutex & recvMutex,
     boost::mutex & sendMutex,
-    DataBufferPointer dataBuffer,
-    unsigned int priority,
-    int maxMilliseconds)
+    Ipc::IpcBlobPool & blobPool,
+    DataBuffer & receiveBuffer,
+    std::string & pendingSystemMessage,
+    DataBufferPointer const * dataBuffers,
+    std::size_t maxMessages,
+    int maxMilliseconds,
+    int pingTimeoutMilliseconds)
 {
   using namespace AsioExpress;
   using namespace AsioExpress::MessagePort::Ipc;
 
   ReceiveTimeout timeout(maxMilliseconds);
 
-  std::size_t recvSize = 0;
-  size_t maxMessageSize = recvMessageQueue->get_max_msg_size();
-
-  DataBuffer tempBuffer(maxMessageSize);
+  PingTimer pingTimer(pingTimeoutMilliseconds);
 
-  PingTimer pingTimer;
-
-  // Now continuously call the timed receive
+  std::size_t count = 0;
 
   for (;;)
   {
+    bool pinged = false;
+
     try
     {
-      bool successful(false);
-      {
-        boost::mutex::scoped_lock recvLock(recvMutex);
+      boost::mutex::scoped_lock recvLock(recvMutex);
 
-        successful = recvMessageQueue->timed_receive(
-                tempBuffer.Get(),
-                tempBuffer.Size(),
-                recvSize,
-                priority,
-                timeout.GetNextTimeout());
+      // A system message that ended the previous batch is reported now.
+      if ( !pendingSystemMessage.empty() )
+      {
+        std::string const messageType(pendingSystemMessage);
+        pendingSystemMessage.clear();
+        ThrowSystemMessageError(messageType);
       }
 
-      if ( successful && priority == IpcSysMessage::SYS_MSG_PRIORITY )
+      std::size_t maxMessageSize = recvMessageQueue->get_max_msg_size();
+      if ( receiveBuffer.Size() != maxMessageSize )
+        receiveBuffer.Resize(maxMessageSize);
+
+      while ( count < maxMessages )
       {
-        IpcSysMessage msg;
-        msg.Decode(tempBuffer.Get());
+        std::size_t recvSize = 0;
+        unsigned int priority = 0;
+        bool successful(false);
 
-        if ( msg.GetMessageType() == IpcSysMessage::MSG_PING )
+        if ( count == 0 )
         {
-  #ifdef DEBUG_IPC
-          DebugMessage("SyncIpcCommandReceive: Ping message received.\n");
-  #endif
-          pingTimer.Reset();
-
-          SendSystemMessage(sendMessageQueue, sendMutex, IpcSysMessage::MSG_PING);
-          continue;
+          successful = recvMessageQueue->timed_receive(
+                  receiveBuffer.Get(),
+                  receiveBuffer.Size(),
+                  recvSize,
+                  priority,
+                  timeout.GetNextTimeout(pingTimer.GetExpiryTime()));
         }
+        else
+        {
+          successful = recvMessageQueue->try_receive(
+                  receiveBuffer.Get(),
+                  receiveBuffer.Size(),
+                  recvSize,
+                  priority);
+        }
+
+        if ( !successful )
+          break;
 
-        if ( msg.GetMessageType() == IpcSysMessage::MSG_DISCONNECT )
+        if ( priority == IpcSysMessage::SYS_MSG_PRIORITY )
         {
-            // This is a disconnect message; return an error.
+          IpcSysMessage msg;
+          msg.Decode(receiveBuffer.Get());
+
+          if ( msg.GetMessageType() == IpcSysMessage::MSG_PING )
+          {
 #ifdef DEBUG_IPC
-            DebugMessage("SyncIpcCommandReceive: A disconnect message was received.\n");
+            DebugMessage("SyncIpcCommandReceive: Ping message received.\n");
 #endif
-            throw CommonException(Error(
-                ErrorCode::Disconnected,
-                "MessagePort::SyncIpc::Receive(): Connection was disconnected by peer."));
+            // Reply once the receive lock is released. While still waiting
+            // for the first message that has to be right away.
+            pinged = true;
+            if ( count == 0 )
+              break;
+            continue;
+          }
+
+          if ( count > 0 )
+          {
+            // Hand back what we have; the next call reports the message.
+            // It is kept with the port rather than put back on the queue,
+            // which the peer may have filled in the meantime.
+            pendingSystemMessage = msg.GetMessageType();
+            break;
+          }
+
+          ThrowSystemMessageError(msg.GetMessageType());
         }
 
-        throw CommonException(Error(
-            ErrorCode::Disconnected,
-            "MessagePort::SyncIpc::Receive(): Unknown IPC system message sent by peer."));
+        // Large messages are read in place from the shared memory pool.
+        DataBuffer & dataBuffer = *dataBuffers[count++];
+        if ( !blobPool.Load(receiveBuffer.Get(), recvSize, dataBuffer) )
+        {
+          dataBuffer.Resize(recvSize);
+          memcpy(dataBuffer.Get(), receiveBuffer.Get(), recvSize);
+        }
       }
+    }
+    catch(boost::interprocess::interprocess_exception &ex)
+    {
+      // Some kind of error
+      throw CommonException(Error(
+        boost::system::error_code(ex.get_native_error(), boost::system::get_system_category()),
+        "MessagePort::SyncIpc::Receive(): Message queue receive call failed."));
+    }
 
-      if ( successful )
-      {
-        // Successful receive, copy to buffer and post callback with no error
-
-        pingTimer.Reset();
-
-        dataBuffer->Resize(recvSize);
-        memcpy(dataBuffer->Get(), tempBuffer.Get(), recvSize);
-
-        break;
-      }
+    if ( pinged || count > 0 )
+      pingTimer.Reset();
 
-      if ( !successful && timeout.Elapsed() )
-      {
-        // Our overall timeout period elapsed
-        return false;
-      }
+    if ( pinged )
+      SendSystemMessage(sendMessageQueue, sendMutex, IpcSysMessage::MSG_PING);
 
-      if ( !successful && pingTimer.Elapsed() )
-      {
-        // Our overall timeout period elapsed
+    if ( count > 0 )
+      return count;
 
-        throw CommonException(Error(
-          ErrorCode::LostConnection,
-          "MessagePort::SyncIpc::Receive(): No ping message received."));
-        break;
-      }
+    if ( pinged )
+      continue;
 
-      // We need a sleep to force context switch.
-      AsioExpress::Sleep(20);
+    if ( timeout.Elapsed() )
+    {
+      // Our overall timeout period elapsed
+      return 0;
     }
-    catch(boost::interprocess::interprocess_exception &ex)
+
+    if ( pingTimer.Elapsed() )
     {
-      // Some kind of error
       throw CommonException(Error(
-        boost::system::error_code(ex.get_native_error(), boost::system::get_system_category()),
-        "MessagePort::SyncIpc::Receive(): Message queue receive call failed."));
+        ErrorCode::LostConnection,
+        "MessagePort::SyncIpc::Receive(): No ping message received."));
     }
   }
-
-  return true;
 }
 
 bool SyncIpcCommandReceive(
@@ -247,7 +314,7 @@ bool SyncIpcCommandReceive(
                 tempBuffer.Size(),
                 recvSize,
                 priority,
-                timeout.GetNextTimeout());
+                timeout.GetNextTimeout(boost::posix_time::pos_infin));
       }
 
       if ( successful && priority == IpcSysMessage::SYS_MSG_PRIORITY )
@@ -297,56 +364,71 @@ bool SyncIpcCommandReceive(
     MessageQueuePointer sendMessageQueue,
     boost::mutex & recvMutex,
     boost::mutex & sendMutex,
+    Ipc::IpcBlobPool & blobPool,
+    DataBuffer & receiveBuffer,
+    std::string & pendingSystemMessage,
     DataBufferPointer dataBuffer,
-    int maxMilliseconds)
+    int maxMilliseconds,
+    int pingTimeoutMilliseconds)
 {
-    using namespace AsioExpress;
-    using namespace AsioExpress::MessagePort::Ipc;
-
-    //
-    // Step 1 - Create a temporary MessagePortCommandReceiveThread instance to
-    //          do the actual receive in a new thread.
-    //
-
 #ifdef DEBUG_IPC
     DebugMessage("SyncIpcCommandReceive: Waiting to receive message.\n");
 #endif
 
-    unsigned int priority = 0;
-    if (! Receive(recvMessageQueue, sendMessageQueue, recvMutex, sendMutex, dataBuffer, priority, maxMilliseconds))
-        return false;
+    std::size_t count = Receive(
+        recvMessageQueue, sendMessageQueue, recvMutex, sendMutex, blobPool,
+        receiveBuffer, pendingSystemMessage, &dataBuffer, 1, maxMilliseconds,
+        pingTimeoutMilliseconds);
 
-    //
-    // Step 2 - If this is a standard message port, check for a disconnect message
-    //
+#ifdef DEBUG_IPC
+    if (count > 0)
+      DebugMessage("SyncIpcCommandReceive: Message received.\n");
+#endif
 
-    if (priority == IpcSysMessage::SYS_MSG_PRIORITY)
-    {
-        IpcSysMessage msg;
-        msg.Decode(dataBuffer->Get());
+    return count > 0;
+}
 
-        if (msg.GetMessageType() == IpcSysMessage::MSG_DISCONNECT)
-        {
-            // This is a disconnect message; return an error.
+std::size_t SyncIpcCommandReceiveMany(
+    MessageQueuePointer recvMessageQueue,
+    MessageQueuePointer sendMessageQueue,
+    boost::mutex & recvMutex,
+    boost::mutex & sendMutex,
+    Ipc::IpcBlobPool & blobPool,
+    DataBuffer & receiveBuffer,
+    std::string & pendingSystemMessage,
+    std::vector<DataBufferPointer> & dataBuffers,
+    std::size_t maxMessages,
+    int maxMilliseconds,
+    int pingTimeoutMilliseconds)
+{
+    if (maxMessages == 0)
+      return 0;
 
-#ifdef DEBUG_IPC
-            DebugMessage("SyncIpcCommandReceive: A disconnect message was received.\n");
-#endif
+    // Reuse the caller's buffers and only allocate the ones missing.
+    dataBuffers.resize(maxMessages);
+    for (std::size_t i = 0; i < maxMessages; ++i)
+    {
+      if (!dataBuffers[i])
+        dataBuffers[i].reset(new DataBuffer);
+    }
 
-            throw CommonException(Error(
-                    ErrorCode::Disconnected,
-                    "MessagePort::SyncIpc::Receive(): Connection was disconnected by peer."));
-        }
+    std::size_t count = 0;
+    try
+    {
+      count = Receive(
+          recvMessageQueue, sendMessageQueue, recvMutex, sendMutex, blobPool,
+          receiveBuffer, pendingSystemMessage, &dataBuffers[0], maxMessages,
+          maxMilliseconds, pingTimeoutMilliseconds);
+    }
+    catch(...)
+    {
+      dataBuffers.clear();
+      throw;
     }
 
-    //
-    // Step 3 - Receive was successful, invoke the callback.
-    //
-#ifdef DEBUG_IPC
-    DebugMessage("SyncIpcCommandReceive: Message received.\n");
-#endif
+    dataBuffers.resize(count);
 
-    return true;
+    return count;
 }
 
 } // namespace Ipc
@@ -5,10 +5,14 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <boost/thread.hpp>
 
 #include "AsioExpress/MessagePort/SyncIpc/private/MessageQueuePointer.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -24,8 +28,25 @@ bool SyncIpcCommandReceive(
     MessageQueuePointer sendMessageQueue,
     boost::mutex & recvMutex,
     boost::mutex & sendMutex,
+    Ipc::IpcBlobPool & blobPool,
+    DataBuffer & receiveBuffer,
+    std::string & pendingSystemMessage,
     DataBufferPointer dataBuffer,
-    int maxMilliseconds);
+    int maxMilliseconds,
+    int pingTimeoutMilliseconds);
+
+std::size_t SyncIpcCommandReceiveMany(
+    MessageQueuePointer recvMessageQueue,
+    MessageQueuePointer sendMessageQueue,
+    boost::mutex & recvMutex,
+    boost::mutex & sendMutex,
+    Ipc::IpcBlobPool & blobPool,
+    DataBuffer & receiveBuffer,
+    std::string & pendingSystemMessage,
+    std::vector<DataBufferPointer> & dataBuffers,
+    std::size_t maxMessages,
+    int maxMilliseconds,
+    int pingTimeoutMilliseconds);
 
 } // namespace SyncIpc
 } // namespace MessagePort
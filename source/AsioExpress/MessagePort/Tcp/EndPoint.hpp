@@ -9,6 +9,9 @@
 
 #include <string>
 
+#include "AsioExpress/MessagePort/FlowControl.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
+
 namespace AsioExpress {
 namespace MessagePort {
 namespace Tcp {
@@ -20,7 +23,12 @@ public:
       std::string address,
       std::string port) :
     m_address(address),
-    m_port(port)
+    m_port(port),
+    m_pingInterval(0),
+    m_pingTimeout(0),
+    m_sendTimeout(0),
+    m_receiveTimeout(0),
+    m_idleTimeout(0)
   {
   }
 
@@ -28,7 +36,14 @@ public:
   {
     return
         this->m_address == that.m_address &&
-        this->m_port == that.m_port;
+        this->m_port == that.m_port &&
+        this->m_pingInterval == that.m_pingInterval &&
+        this->m_pingTimeout == that.m_pingTimeout &&
+        this->m_sendTimeout == that.m_sendTimeout &&
+        this->m_receiveTimeout == that.m_receiveTimeout &&
+        this->m_idleTimeout == that.m_idleTimeout &&
+        this->m_flowControl.credits == that.m_flowControl.credits &&
+        this->m_flowControl.unit == that.m_flowControl.unit;
   }
 
   boost::asio::ip::tcp::endpoint const GetEndPoint(
@@ -42,9 +57,111 @@ public:
     return *iterator;
   }
 
+  ///
+  /// Sets how long a connection may be idle before a ping is sent, and how
+  /// long a receive waits without hearing from the peer before the
+  /// connection is closed as lost. Zero disables either one. Heartbeats are
+  /// off by default as peers built before them cannot read pings; enable
+  /// them on both ends.
+  ///
+  void SetHeartbeat(int pingIntervalMilliseconds, int pingTimeoutMilliseconds)
+  {
+    m_pingInterval = pingIntervalMilliseconds;
+    m_pingTimeout = pingTimeoutMilliseconds;
+  }
+
+  int GetPingInterval() const
+  {
+    return m_pingInterval;
+  }
+
+  int GetPingTimeout() const
+  {
+    return m_pingTimeout;
+  }
+
+  ///
+  /// Sets how long a send may wait without any send completing, and how
+  /// long a receive may wait for a message, before the connection is
+  /// closed. Pings do not count as messages. The receive in progress then
+  /// fails with a SendTimeout or ReceiveTimeout error. Zero disables either
+  /// one. On a server's end point they apply to every connection.
+  ///
+  void SetTimeouts(int sendMilliseconds, int receiveMilliseconds)
+  {
+    m_sendTimeout = sendMilliseconds;
+    m_receiveTimeout = receiveMilliseconds;
+  }
+
+  int GetSendTimeout() const
+  {
+    return m_sendTimeout;
+  }
+
+  int GetReceiveTimeout() const
+  {
+    return m_receiveTimeout;
+  }
+
+  ///
+  /// Sets how long a connection may go without a message either way
+  /// before it is closed with an IdleTimeout error. Zero, the default,
+  /// disables it. On a server's end point it applies to every connection.
+  ///
+  void SetIdleTimeout(int milliseconds)
+  {
+    m_idleTimeout = milliseconds;
+  }
+
+  int GetIdleTimeout() const
+  {
+    return m_idleTimeout;
+  }
+
+  ///
+  /// Sets the credits a connection grants its peer: how many messages, or
+  /// bytes, the peer may send before the ones it sent have been received.
+  /// Sends beyond them wait for the peer to receive more, so neither end
+  /// holds more than the credits of the other's messages. Zero, the
+  /// default, disables it. The peer must enable it too, as a port without
+  /// flow control grants no credits. Grants are read by AsyncReceive, so a
+  /// port sending under flow control must keep receiving.
+  ///
+  void SetFlowControl(
+      unsigned int credits, 
+      AsioExpress::MessagePort::FlowControlSettings::Unit unit = 
+        AsioExpress::MessagePort::FlowControlSettings::MessageCredits)
+  {
+    m_flowControl.credits = credits;
+    m_flowControl.unit = unit;
+  }
+
+  AsioExpress::MessagePort::FlowControlSettings GetFlowControlSettings() const
+  {
+    return m_flowControl;
+  }
+
+  /// Gets the heartbeat a connection to or from this end point has.
+  AsioExpress::MessagePort::HeartbeatSettings GetHeartbeatSettings() const
+  {
+    AsioExpress::MessagePort::HeartbeatSettings settings;
+    settings.pingInterval = m_pingInterval;
+    settings.pingTimeout = m_pingTimeout;
+    settings.sendTimeout = m_sendTimeout;
+    settings.receiveTimeout = m_receiveTimeout;
+    settings.idleTimeout = m_idleTimeout;
+    return settings;
+  }
+
 private:
   std::string m_address;
   std::string m_port;
+  int m_pingInterval;
+  int m_pingTimeout;
+  int m_sendTimeout;
+  int m_receiveTimeout;
+  int m_idleTimeout;
+  AsioExpress::MessagePort::FlowControlSettings m_flowControl;
 };
 
 } // namespace Tcp
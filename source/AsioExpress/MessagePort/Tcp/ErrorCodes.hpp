@@ -20,6 +20,10 @@ namespace ErrorCode
     ProtocolError = 1,
     WrongProtocolVersion,
     SocketInitializationFailed,
+    LostConnection,
+    SendTimeout,
+    ReceiveTimeout,
+    IdleTimeout,
   };
 
   // implicit conversion helper function
@@ -37,6 +37,18 @@ std::string ErrorCategoryImpl::message(int ev) const
 
     case ErrorCode::SocketInitializationFailed:
       return "Socket initialization failed.";
+
+    case ErrorCode::LostConnection:
+      return "Nothing was received from the peer within the ping timeout.";
+
+    case ErrorCode::SendTimeout:
+      return "A send did not complete within the send timeout.";
+
+    case ErrorCode::ReceiveTimeout:
+      return "No message was received within the receive timeout.";
+
+    case ErrorCode::IdleTimeout:
+      return "The connection was closed after being idle for the idle timeout.";
   }
 
   return "Unknown Error";
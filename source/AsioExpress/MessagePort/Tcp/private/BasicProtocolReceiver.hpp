@@ -7,12 +7,15 @@
 
 #include <boost/function.hpp>
 #include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
 
 #include "AsioExpress/Coroutine.hpp"
 #include "AsioExpress/CompletionHandler.hpp"
 
 #include "AsioExpress/MessagePort/Tcp/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/FlowControl.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
 #include "AsioExpress/MessagePort/Tcp/private/SocketPointer.hpp"
 #include "AsioExpress/MessagePort/Tcp/private/TcpProtocolConstants.hpp"
 #include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
@@ -27,7 +30,10 @@ class BasicProtocolReceiverCommand : private AsioExpress::Coroutine
 public:
   BasicProtocolReceiverCommand(
       AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
       AsioExpress::MessagePort::DataBufferPointer buffer,
+      AsioExpress::MessagePort::HeartbeatPointer heartbeat,
+      CreditFunction creditFunction,
       CompletionHandler completionHandler);
 
   void operator()(
@@ -49,23 +55,35 @@ private:
 
   typedef AsioExpress::MessagePort::DataBuffer::SizeType BufferSizeType;
   typedef boost::shared_ptr<BufferSizeType> BufferSizePointer; 
+  typedef boost::shared_ptr<boost::uint32_t> CreditsPointer; 
 
   AsioExpress::MessagePort::Tcp::SocketPointer   m_socket;
+  AsioExpress::MessagePort::Tcp::SocketStrandPointer m_strand;
   AsioExpress::MessagePort::DataBufferPointer    m_buffer;
   BufferSizePointer                         m_bufferSize;
   HeaderPointer                             m_header;
+  CreditsPointer                            m_credits;
+  AsioExpress::MessagePort::HeartbeatPointer     m_heartbeat;
+  CreditFunction                            m_creditFunction;
   CompletionHandler                         m_completionHandler;
 };
 
 template<typename CompletionHandler>
 BasicProtocolReceiverCommand<CompletionHandler>::BasicProtocolReceiverCommand(
       AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
       AsioExpress::MessagePort::DataBufferPointer buffer,
+      AsioExpress::MessagePort::HeartbeatPointer heartbeat,
+      CreditFunction creditFunction,
       CompletionHandler completionHandler) :
   m_socket(socket),
+  m_strand(strand),
   m_buffer(buffer),
   m_bufferSize(new BufferSizeType),
   m_header(new Header),
+  m_credits(new boost::uint32_t),
+  m_heartbeat(heartbeat),
+  m_creditFunction(creditFunction),
   m_completionHandler(completionHandler)
 {
 }
@@ -80,30 +98,52 @@ void BasicProtocolReceiverCommand<CompletionHandler>::operator()(
     return;
   }
 
+  // The socket is only read from the port's strand, so the reads cannot
+  // overlap a write starting or the socket closing.
   REENTER(this)
   {
-    // Receive the header from the socket.
-    YIELD 
+    // Receive the header from the socket. Pings are only a header, so we
+    // note the peer is alive and wait for the next one. Credits granted by
+    // the peer follow their header and are passed on.
+    do
     {
-      boost::asio::async_read(
-        *m_socket,
-        boost::asio::buffer(m_header.get(), sizeof(Header)), 
-        *this);
-    }
+      YIELD 
+      {
+        boost::asio::async_read(
+          *m_socket,
+          boost::asio::buffer(m_header.get(), sizeof(Header)), 
+          m_strand->wrap(*this));
+      }
 
-    // Receive the buffer size from the socket.
-    YIELD 
-    {
-      int memCheck = memcmp(
-        m_header->protocolHeader, 
-        ProtocolHeaderText, 
-        ProtocolHeaderSize);
-      if (memCheck != 0)
+      if (memcmp(m_header->protocolHeader, ProtocolHeaderText, ProtocolHeaderSize) != 0)
       {
         m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ErrorCode::ProtocolError));
         return;             
       }
 
+      if (m_heartbeat)
+        m_heartbeat->Received();
+
+      if (m_header->version == ProtocolVersionCredit)
+      {
+        YIELD 
+        {
+          boost::asio::async_read(
+            *m_socket,
+            boost::asio::buffer(m_credits.get(), sizeof(boost::uint32_t)), 
+            m_strand->wrap(*this));
+        }
+
+        if (m_creditFunction)
+          m_creditFunction(*m_credits);
+      }
+    }
+    while (m_header->version == ProtocolVersionPing 
+      || m_header->version == ProtocolVersionCredit);
+
+    // Receive the buffer size from the socket.
+    YIELD 
+    {
       if (m_header->version != ProtocolVersionBasic)
       {
         m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ErrorCode::WrongProtocolVersion));
@@ -113,7 +153,7 @@ void BasicProtocolReceiverCommand<CompletionHandler>::operator()(
       boost::asio::async_read(
         *m_socket,
         boost::asio::buffer(m_bufferSize.get(), sizeof(BufferSizeType)), 
-        *this);
+        m_strand->wrap(*this));
     }
 
     // Receive the buffer.
@@ -124,7 +164,7 @@ void BasicProtocolReceiverCommand<CompletionHandler>::operator()(
       boost::asio::async_read(
         *m_socket,
         boost::asio::buffer(m_buffer->Get(), m_buffer->Size()), 
-        *this);    
+        m_strand->wrap(*this));    
     }
 
     m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
@@ -137,11 +177,14 @@ public:
   template<typename CompletionHandler>
   void AsyncRun(
       AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
       AsioExpress::MessagePort::DataBufferPointer buffer,
+      AsioExpress::MessagePort::HeartbeatPointer heartbeat,
+      CreditFunction creditFunction,
       CompletionHandler completionHandler)
   {
-    BasicProtocolReceiverCommand<CompletionHandler>(
-      socket, buffer, completionHandler)();
+    strand->dispatch(BasicProtocolReceiverCommand<CompletionHandler>(
+      socket, strand, buffer, heartbeat, creditFunction, completionHandler));
   }
 };
 
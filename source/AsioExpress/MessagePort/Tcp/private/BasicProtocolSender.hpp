@@ -5,6 +5,10 @@
 
 #pragma once
 
+#include <vector>
+
+#include <boost/array.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/function.hpp>
 #include <boost/asio.hpp>
 
@@ -12,6 +16,7 @@
 #include "AsioExpress/CompletionHandler.hpp"
 
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/SendBatch.hpp"
 #include "AsioExpress/MessagePort/Tcp/private/SocketPointer.hpp"
 #include "AsioExpress/MessagePort/Tcp/private/TcpProtocolConstants.hpp"
 #include "AsioExpress/Yield.hpp" // Enable the pseudo-keywords REENTER, YIELD and FORK.
@@ -20,13 +25,45 @@ namespace AsioExpress {
 namespace MessagePort {
 namespace Tcp {
 
+#pragma pack(push)
+#pragma pack(1)
+struct CreditFrame
+{
+  explicit CreditFrame(boost::uint32_t credits) :
+    version(ProtocolVersionCredit),
+    credits(credits)
+  {
+    memcpy(
+      protocolHeader, 
+      ProtocolHeaderText, 
+      sizeof(protocolHeader));
+  }
+  char protocolHeader[ProtocolHeaderSize];
+  ProtocolVersionType version;
+  boost::uint32_t credits;
+};
+#pragma pack(pop)
+
+typedef boost::shared_ptr<CreditFrame> CreditFramePointer;
+
+// Gets the buffer of the credits granted ahead of a message, which is
+// empty when none are.
+inline boost::asio::const_buffer GetCreditBuffer(CreditFramePointer const & frame)
+{
+  if (!frame)
+    return boost::asio::const_buffer();
+  return boost::asio::buffer(frame.get(), sizeof(CreditFrame));
+}
+
 template<typename CompletionHandler>
 class BasicProtocolSenderCommand : private AsioExpress::Coroutine
 {
 public:
   BasicProtocolSenderCommand(
       AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
       AsioExpress::MessagePort::DataBufferPointer buffer,
+      boost::uint32_t grant,
       CompletionHandler completionHandler);
 
   void operator()(
@@ -55,19 +92,28 @@ private:
   #pragma pack(pop)
 
   AsioExpress::MessagePort::Tcp::SocketPointer   m_socket;
+  AsioExpress::MessagePort::Tcp::SocketStrandPointer m_strand;
   AsioExpress::MessagePort::DataBufferPointer    m_buffer;
+  boost::shared_ptr<Header>                 m_header;
+  CreditFramePointer                        m_credit;
   CompletionHandler                         m_completionHandler;
 };
 
 template<typename CompletionHandler>
 BasicProtocolSenderCommand<CompletionHandler>::BasicProtocolSenderCommand(
     AsioExpress::MessagePort::Tcp::SocketPointer socket,
+    AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
     AsioExpress::MessagePort::DataBufferPointer buffer,
+    boost::uint32_t grant,
     CompletionHandler completionHandler) :
   m_socket(socket),
+  m_strand(strand),
   m_buffer(buffer),
+  m_header(new Header(buffer->Size())),
   m_completionHandler(completionHandler)
 {
+  if (grant > 0)
+    m_credit.reset(new CreditFrame(grant));
 }
 
 template<typename CompletionHandler>
@@ -82,39 +128,314 @@ void BasicProtocolSenderCommand<CompletionHandler>::operator()(
 
   REENTER(this)
   {
-    // Send the buffer size.
+    // Send the buffer size and the buffer in one write, so the buffer is
+    // not held back by the Nagle algorithm until the size is acknowledged.
+    // Credits granted to the peer go ahead of them.
     YIELD 
     {
-      Header header(m_buffer->Size());
+      boost::array<boost::asio::const_buffer, 3> buffers = {{
+        GetCreditBuffer(m_credit),
+        boost::asio::buffer(m_header.get(), sizeof(Header)),
+        boost::asio::buffer(m_buffer->Get(), m_buffer->Size())
+      }};
+
+      boost::asio::async_write(
+        *m_socket,
+        buffers,
+        m_strand->wrap(*this));
+    }
+
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+  }
+}
+
+template<typename CompletionHandler>
+class BasicProtocolPingCommand : private AsioExpress::Coroutine
+{
+public:
+  BasicProtocolPingCommand(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      CompletionHandler completionHandler);
+
+  void operator()(
+    boost::system::error_code ec = boost::system::error_code(),
+    std::size_t length = 0);
+
+private:
+
+  #pragma pack(push)
+  #pragma pack(1)
+  struct Header
+  {
+    Header() :
+      version(ProtocolVersionPing)
+    {
+      memcpy(
+        protocolHeader, 
+        ProtocolHeaderText, 
+        sizeof(protocolHeader));
+    }
+    char protocolHeader[ProtocolHeaderSize];
+    ProtocolVersionType version;
+  };
+  #pragma pack(pop)
+
+  typedef boost::shared_ptr<Header> HeaderPointer;
+
+  AsioExpress::MessagePort::Tcp::SocketPointer   m_socket;
+  AsioExpress::MessagePort::Tcp::SocketStrandPointer m_strand;
+  HeaderPointer                             m_header;
+  CompletionHandler                         m_completionHandler;
+};
+
+template<typename CompletionHandler>
+BasicProtocolPingCommand<CompletionHandler>::BasicProtocolPingCommand(
+    AsioExpress::MessagePort::Tcp::SocketPointer socket,
+    AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+    CompletionHandler completionHandler) :
+  m_socket(socket),
+  m_strand(strand),
+  m_header(new Header),
+  m_completionHandler(completionHandler)
+{
+}
+
+template<typename CompletionHandler>
+void BasicProtocolPingCommand<CompletionHandler>::operator()(
+    boost::system::error_code ec, std::size_t)
+{
+  if (ec)
+  {
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+    return;
+  }
+
+  REENTER(this)
+  {
+    // A ping is a header with no message after it.
+    YIELD 
+      boost::asio::async_write(
+        *m_socket,
+        boost::asio::buffer(m_header.get(), sizeof(Header)), 
+        m_strand->wrap(*this));
+
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+  }
+}
+
+template<typename CompletionHandler>
+class BasicProtocolGrantCommand : private AsioExpress::Coroutine
+{
+public:
+  BasicProtocolGrantCommand(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      boost::uint32_t grant,
+      CompletionHandler completionHandler);
+
+  void operator()(
+    boost::system::error_code ec = boost::system::error_code(),
+    std::size_t length = 0);
+
+private:
+  AsioExpress::MessagePort::Tcp::SocketPointer   m_socket;
+  AsioExpress::MessagePort::Tcp::SocketStrandPointer m_strand;
+  CreditFramePointer                        m_credit;
+  CompletionHandler                         m_completionHandler;
+};
+
+template<typename CompletionHandler>
+BasicProtocolGrantCommand<CompletionHandler>::BasicProtocolGrantCommand(
+    AsioExpress::MessagePort::Tcp::SocketPointer socket,
+    AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+    boost::uint32_t grant,
+    CompletionHandler completionHandler) :
+  m_socket(socket),
+  m_strand(strand),
+  m_credit(new CreditFrame(grant)),
+  m_completionHandler(completionHandler)
+{
+}
 
+template<typename CompletionHandler>
+void BasicProtocolGrantCommand<CompletionHandler>::operator()(
+    boost::system::error_code ec, std::size_t)
+{
+  if (ec)
+  {
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+    return;
+  }
+
+  REENTER(this)
+  {
+    // Credits granted while there is no message to send them with.
+    YIELD 
       boost::asio::async_write(
         *m_socket,
-        boost::asio::buffer(&header, sizeof(Header)), 
-        *this);
+        GetCreditBuffer(m_credit), 
+        m_strand->wrap(*this));
+
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+  }
+}
+
+template<typename CompletionHandler>
+class BasicProtocolBatchSenderCommand : private AsioExpress::Coroutine
+{
+public:
+  BasicProtocolBatchSenderCommand(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      AsioExpress::MessagePort::DataBufferListPointer batch,
+      boost::uint32_t grant,
+      CompletionHandler completionHandler);
+
+  void operator()(
+    boost::system::error_code ec = boost::system::error_code(),
+    std::size_t length = 0);
+
+private:
+
+  #pragma pack(push)
+  #pragma pack(1)
+  struct Header
+  {
+    explicit Header(AsioExpress::MessagePort::DataBuffer::SizeType length) :
+      version(ProtocolVersionBasic),
+      length(length)
+    {
+      memcpy(
+        protocolHeader, 
+        ProtocolHeaderText, 
+        sizeof(protocolHeader));
     }
+    char protocolHeader[ProtocolHeaderSize];
+    ProtocolVersionType version;
+    AsioExpress::MessagePort::DataBuffer::SizeType length;
+  };
+  #pragma pack(pop)
 
-    // Send buffer.
+  typedef std::vector<Header> HeaderList;
+  typedef boost::shared_ptr<HeaderList> HeaderListPointer;
+
+  AsioExpress::MessagePort::Tcp::SocketPointer   m_socket;
+  AsioExpress::MessagePort::Tcp::SocketStrandPointer m_strand;
+  AsioExpress::MessagePort::DataBufferListPointer m_batch;
+  HeaderListPointer                         m_headers;
+  CreditFramePointer                        m_credit;
+  CompletionHandler                         m_completionHandler;
+};
+
+template<typename CompletionHandler>
+BasicProtocolBatchSenderCommand<CompletionHandler>::BasicProtocolBatchSenderCommand(
+    AsioExpress::MessagePort::Tcp::SocketPointer socket,
+    AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+    AsioExpress::MessagePort::DataBufferListPointer batch,
+    boost::uint32_t grant,
+    CompletionHandler completionHandler) :
+  m_socket(socket),
+  m_strand(strand),
+  m_batch(batch),
+  m_headers(new HeaderList),
+  m_completionHandler(completionHandler)
+{
+  if (grant > 0)
+    m_credit.reset(new CreditFrame(grant));
+
+  m_headers->reserve(m_batch->size());
+
+  DataBufferList::const_iterator  it = m_batch->begin();
+  DataBufferList::const_iterator end = m_batch->end();
+  for (; it != end; ++it)
+    m_headers->push_back(Header((*it)->Size()));
+}
+
+template<typename CompletionHandler>
+void BasicProtocolBatchSenderCommand<CompletionHandler>::operator()(
+    boost::system::error_code ec, std::size_t)
+{
+  if (ec)
+  {
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
+    return;
+  }
+
+  REENTER(this)
+  {
+    // Every header and message of the batch goes out in one write, in order.
     YIELD 
+    {
+      std::vector<boost::asio::const_buffer> buffers;
+      buffers.reserve(2 * m_batch->size() + 1);
+      buffers.push_back(GetCreditBuffer(m_credit));
+
+      for (std::size_t i = 0; i < m_batch->size(); ++i)
+      {
+        DataBufferPointer const & buffer = (*m_batch)[i];
+        buffers.push_back(boost::asio::buffer(&(*m_headers)[i], sizeof(Header)));
+        buffers.push_back(boost::asio::buffer(buffer->Get(), buffer->Size()));
+      }
+
       boost::asio::async_write(
         *m_socket,
-        boost::asio::buffer(m_buffer->Get(), m_buffer->Size()),
-        *this);
+        buffers,
+        m_strand->wrap(*this));
+    }
 
     m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, ec));
   }
 }
 
+// Writes the socket from the port's strand, so a write cannot overlap a
+// read starting or the socket closing.
 class BasicProtocolSender
 {
 public:
   template<typename CompletionHandler>
   void AsyncRun(
       AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
       AsioExpress::MessagePort::DataBufferPointer buffer,
+      boost::uint32_t grant,
+      CompletionHandler completionHandler)
+  {
+    strand->dispatch(BasicProtocolSenderCommand<CompletionHandler>(
+      socket, strand, buffer, grant, completionHandler));
+  }
+
+  template<typename CompletionHandler>
+  void AsyncRunBatch(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      AsioExpress::MessagePort::DataBufferListPointer batch,
+      boost::uint32_t grant,
+      CompletionHandler completionHandler)
+  {
+    strand->dispatch(BasicProtocolBatchSenderCommand<CompletionHandler>(
+      socket, strand, batch, grant, completionHandler));
+  }
+
+  template<typename CompletionHandler>
+  void AsyncRunPing(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      CompletionHandler completionHandler)
+  {
+    strand->dispatch(BasicProtocolPingCommand<CompletionHandler>(
+      socket, strand, completionHandler));
+  }
+
+  template<typename CompletionHandler>
+  void AsyncRunGrant(
+      AsioExpress::MessagePort::Tcp::SocketPointer socket,
+      AsioExpress::MessagePort::Tcp::SocketStrandPointer strand,
+      boost::uint32_t grant,
       CompletionHandler completionHandler)
   {
-    BasicProtocolSenderCommand<CompletionHandler>(
-      socket, buffer, completionHandler)();
+    strand->dispatch(BasicProtocolGrantCommand<CompletionHandler>(
+      socket, strand, grant, completionHandler));
   }
 };
 
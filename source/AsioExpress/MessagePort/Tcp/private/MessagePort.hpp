@@ -4,11 +4,21 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include <deque>
+
 #include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
 
 #include "AsioExpressError/EcToErrorAdapter.hpp"
+#include "AsioExpress/NullCompletionHandler.hpp"
 #include "AsioExpress/MessagePort/DataBuffer.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
 #include "AsioExpress/MessagePort/SendQueue.hpp"
+#include "AsioExpress/MessagePort/FlowControl.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
 #include "AsioExpress/MessagePort/Tcp/ErrorCodes.hpp"
 #include "AsioExpress/MessagePort/Tcp/EndPoint.hpp"
 #include "AsioExpress/MessagePort/Tcp/private/SocketPointer.hpp"
@@ -18,20 +28,29 @@ namespace AsioExpress {
 namespace MessagePort {
 namespace Tcp {
 
+template<typename ProtocolSender>
+void AsyncSendNext(
+    SocketPointer socket,
+    SocketStrandPointer strand,
+    AsioExpress::MessagePort::SendQueuePointer sendQueue,
+    AsioExpress::MessagePort::FlowControlPointer flowControl);
+
+// Goes on with the port's send side once a write completes. It is always
+// called on the port's strand, as the socket is only used from there.
 template<typename H, typename ProtocolSender>
 class AsyncSendHandler
 {
 public:
-  typedef boost::shared_ptr<bool> BoolPointer;
-
   AsyncSendHandler(
       SocketPointer socket,
-      BoolPointer isSending,
+      SocketStrandPointer strand,
       AsioExpress::MessagePort::SendQueuePointer sendQueue,
+      AsioExpress::MessagePort::FlowControlPointer flowControl,
       H completionHandler) :
     m_socket(socket),
-    m_isSending(isSending),
+    m_strand(strand),
     m_sendQueue(sendQueue),
+    m_flowControl(flowControl),
     m_completionHandler(completionHandler)    
   {
   }
@@ -43,40 +62,617 @@ public:
       // We close the socket if we get any error back.
       m_socket->close();
 
-      if (! m_sendQueue->Empty())
-        m_sendQueue->Error(m_socket->get_io_service(), AsioExpress::Error(ec));
+      m_sendQueue->Error(m_socket->get_io_service(), AsioExpress::Error(ec));
+      if (m_flowControl)
+        m_flowControl->Abort(m_socket->get_io_service(), AsioExpress::Error(ec));
+    }
+
+    AsyncSendNext<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+
+    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, AsioExpress::Error(ec)));
+  }
+
+private:
+   SocketPointer        m_socket;
+   SocketStrandPointer  m_strand;
+   SendQueuePointer     m_sendQueue;
+   FlowControlPointer   m_flowControl;
+   H                    m_completionHandler;
+};
+
+// Sends the item, or the grant due ahead of it, by the owner of the port's
+// send side on the port's strand. Without credits the item and the send
+// side are left with the flow control.
+template<typename ProtocolSender>
+void AsyncSendItem(
+    SocketPointer socket,
+    SocketStrandPointer strand,
+    AsioExpress::MessagePort::SendQueuePointer sendQueue,
+    AsioExpress::MessagePort::FlowControlPointer flowControl,
+    AsioExpress::MessagePort::SendQueue::Item const & item)
+{
+  ProtocolSender sender;
+  boost::uint32_t grant = 0;
+
+  if (flowControl)
+  {
+    switch (flowControl->BeginSend(item, grant))
+    {
+      case FlowControl::Wait:
+        return;
+
+      case FlowControl::SendGrant:
+        sender.AsyncRunGrant(
+          socket,
+          strand,
+          grant,
+          strand->wrap(AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
+            socket, 
+            strand,
+            sendQueue, 
+            flowControl,
+            AsioExpress::NullCompletionHandler)));
+        return;
+
+      case FlowControl::SendItem:
+        break;
+    }
+  }
+
+  if (item.batch)
+  {
+    sender.AsyncRunBatch(
+      socket, 
+      strand,
+      item.batch, 
+      grant,
+      strand->wrap(AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
+        socket, 
+        strand,
+        sendQueue, 
+        flowControl,
+        item.completionHandler)));      
+  }
+  else
+  {
+    sender.AsyncRun(
+      socket, 
+      strand,
+      item.dataBuffer, 
+      grant,
+      strand->wrap(AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
+        socket, 
+        strand,
+        sendQueue, 
+        flowControl,
+        item.completionHandler)));      
+  }
+}
+
+// Goes on sending once the owner of the port's send side is done with its
+// last item. The send side is released when there is nothing left to send,
+// but for a grant that is due. Called on the port's strand.
+template<typename ProtocolSender>
+void AsyncSendNext(
+    SocketPointer socket,
+    SocketStrandPointer strand,
+    AsioExpress::MessagePort::SendQueuePointer sendQueue,
+    AsioExpress::MessagePort::FlowControlPointer flowControl)
+{
+  AsioExpress::MessagePort::SendQueue::Item item;
+  if ((flowControl && flowControl->TakeHeldItem(item)) || sendQueue->Pop(item))
+  {
+    AsyncSendItem<ProtocolSender>(socket, strand, sendQueue, flowControl, item);
+    return;
+  }
+
+  if (!flowControl || !socket->is_open() || !flowControl->IsGrantDue() || !sendQueue->Start())
+    return;
+
+  // Another sender may have taken the grant since.
+  boost::uint32_t grant = flowControl->TakeGrant();
+  if (grant == 0)
+  {
+    AsyncSendNext<ProtocolSender>(socket, strand, sendQueue, flowControl);
+    return;
+  }
+
+  ProtocolSender sender;
+  sender.AsyncRunGrant(
+    socket,
+    strand,
+    grant,
+    strand->wrap(AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
+      socket, 
+      strand,
+      sendQueue, 
+      flowControl,
+      AsioExpress::NullCompletionHandler)));
+}
+
+// Goes on with the port's send side from a thread that is not on its strand.
+template<typename ProtocolSender>
+void DispatchSendNext(
+    SocketPointer socket,
+    SocketStrandPointer strand,
+    AsioExpress::MessagePort::SendQueuePointer sendQueue,
+    AsioExpress::MessagePort::FlowControlPointer flowControl)
+{
+  strand->dispatch(boost::bind(
+    &AsyncSendNext<ProtocolSender>, socket, strand, sendQueue, flowControl));
+}
+
+// Adds the credits the peer grants, going on with a send waiting for them.
+// The receiver calls it on the port's strand.
+template<typename ProtocolSender>
+class GrantReceivedFunction
+{
+public:
+  GrantReceivedFunction(
+      SocketPointer socket,
+      SocketStrandPointer strand,
+      AsioExpress::MessagePort::SendQueuePointer sendQueue,
+      AsioExpress::MessagePort::FlowControlPointer flowControl) :
+    m_socket(socket),
+    m_strand(strand),
+    m_sendQueue(sendQueue),
+    m_flowControl(flowControl)
+  {
+  }
+
+  void operator()(boost::uint32_t credits)
+  {
+    if (m_flowControl->AddCredits(credits))
+      AsyncSendNext<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+  }
+
+private:
+   SocketPointer        m_socket;
+   SocketStrandPointer  m_strand;
+   SendQueuePointer     m_sendQueue;
+   FlowControlPointer   m_flowControl;
+};
+
+// Grants the peer back the credits of a message once it is received.
+template<typename H, typename ProtocolSender>
+class FlowControlReceiveHandler
+{
+public:
+  FlowControlReceiveHandler(
+      SocketPointer socket,
+      SocketStrandPointer strand,
+      AsioExpress::MessagePort::SendQueuePointer sendQueue,
+      AsioExpress::MessagePort::FlowControlPointer flowControl,
+      AsioExpress::MessagePort::DataBufferPointer buffer,
+      H completionHandler) :
+    m_socket(socket),
+    m_strand(strand),
+    m_sendQueue(sendQueue),
+    m_flowControl(flowControl),
+    m_buffer(buffer),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    if (m_flowControl && !error)
+    {
+      // A send waiting for credits may be taken over to send the grant.
+      // Otherwise the grant goes with the next send, or on its own if the
+      // port is not sending.
+      if (m_flowControl->Received(m_flowControl->GetCost(*m_buffer)))
+        DispatchSendNext<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+      else if (m_flowControl->IsGrantDue() && m_sendQueue->Start())
+        DispatchSendNext<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+    }
+
+    m_completionHandler(error);
+  }
+
+private:
+  SocketPointer         m_socket;
+  SocketStrandPointer   m_strand;
+  SendQueuePointer      m_sendQueue;
+  FlowControlPointer    m_flowControl;
+  DataBufferPointer     m_buffer;
+  H                     m_completionHandler;
+};
+
+// Tells the heartbeat when a send completes.
+template<typename H>
+class HeartbeatSendHandler
+{
+public:
+  HeartbeatSendHandler(
+      HeartbeatPointer heartbeat,
+      H completionHandler) :
+    m_heartbeat(heartbeat),
+    m_completionHandler(completionHandler)
+  {
+    if (m_heartbeat)
+      m_heartbeat->SendStarted();
+  }
+
+  void operator()(AsioExpress::Error error)
+  {
+    if (m_heartbeat)
+      m_heartbeat->SendCompleted();
+    m_completionHandler(error);
+  }
+
+private:
+  HeartbeatPointer    m_heartbeat;
+  H                   m_completionHandler;
+};
+
+// Lets a heartbeat timeout or deadline end the receive in progress. The
+// receive completes off the port's strand, so the state is atomic.
+struct ReceiveState
+{
+  // No deadline has expired.
+  enum { NotExpired = -1 };
+
+  ReceiveState() :
+    isReceiving(false),
+    isPeerLost(false),
+    expired(NotExpired)
+  {
+  }
+
+  boost::atomic<bool> isReceiving;
+  boost::atomic<bool> isPeerLost;
+  boost::atomic<int>  expired;
+};
+
+typedef boost::shared_ptr<ReceiveState> ReceiveStatePointer;
+
+template<typename H>
+class AsyncReceiveHandler
+{
+public:
+  AsyncReceiveHandler(
+      ReceiveStatePointer receiveState,
+      HeartbeatPointer heartbeat,
+      H completionHandler) :
+    m_receiveState(receiveState),
+    m_heartbeat(heartbeat),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()(boost::system::error_code ec = boost::system::error_code())
+  {
+    m_receiveState->isReceiving = false;
+
+    if (m_heartbeat)
+      m_heartbeat->ReceiveCompleted();
+
+    if (ec && m_receiveState->expired != ReceiveState::NotExpired)
+    {
+      m_completionHandler(GetExpiredError(m_receiveState->expired));
+      return;
     }
 
-    if (! m_sendQueue->Empty())
+    if (ec && m_receiveState->isPeerLost)
     {
-      AsioExpress::MessagePort::SendQueue::Item item = m_sendQueue->Top();
-      m_sendQueue->Pop();
+      m_completionHandler(AsioExpress::Error(
+        ErrorCode::LostConnection,
+        "MessagePort::AsyncReceive(): No ping message received."));
+      return;
+    }
 
-      ProtocolSender sender;
-      sender.AsyncRun(
+    m_completionHandler(AsioExpress::Error(ec));
+  }
+
+private:
+  static AsioExpress::Error GetExpiredError(int deadline)
+  {
+    switch (deadline)
+    {
+      case Heartbeat::SendDeadline:
+        return AsioExpress::Error(
+          ErrorCode::SendTimeout,
+          "MessagePort::AsyncSend(): The send timeout passed.");
+
+      case Heartbeat::ReceiveDeadline:
+        return AsioExpress::Error(
+          ErrorCode::ReceiveTimeout,
+          "MessagePort::AsyncReceive(): The receive timeout passed.");
+    }
+
+    return AsioExpress::Error(
+      ErrorCode::IdleTimeout,
+      "MessagePort::AsyncReceive(): The idle timeout passed.");
+  }
+
+  ReceiveStatePointer   m_receiveState;
+  HeartbeatPointer      m_heartbeat;
+  H                     m_completionHandler;
+};
+
+// The heartbeat functions are called from the heartbeat service's timer, so
+// the port wraps them in its strand before they touch the socket.
+template<typename ProtocolSender>
+class PingFunction
+{
+public:
+  PingFunction(
+      SocketPointer socket,
+      SocketStrandPointer strand,
+      AsioExpress::MessagePort::SendQueuePointer sendQueue,
+      AsioExpress::MessagePort::FlowControlPointer flowControl) :
+    m_socket(socket),
+    m_strand(strand),
+    m_sendQueue(sendQueue),
+    m_flowControl(flowControl)
+  {
+  }
+
+  void operator()()
+  {
+    if (!m_socket->is_open())
+      return;
+
+    // A port that is busy sending needs no ping, but one waiting for
+    // credits is idle.
+    if (!m_sendQueue->Start() && !(m_flowControl && m_flowControl->TakeWaitingSend()))
+      return;
+
+    ProtocolSender sender;
+    sender.AsyncRunPing(
+      m_socket,
+      m_strand,
+      m_strand->wrap(AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
         m_socket, 
-        item.dataBuffer, 
-        AsyncSendHandler<AsioExpress::CompletionHandler, ProtocolSender>(
-          m_socket, 
-          m_isSending, 
-          m_sendQueue, 
-          item.completionHandler));      
+        m_strand,
+        m_sendQueue, 
+        m_flowControl,
+        AsioExpress::NullCompletionHandler)));
+  }
+
+private:
+   SocketPointer        m_socket;
+   SocketStrandPointer  m_strand;
+   SendQueuePointer     m_sendQueue;
+   FlowControlPointer   m_flowControl;
+};
+
+class PingTimeoutFunction
+{
+public:
+  PingTimeoutFunction(
+      SocketPointer socket,
+      ReceiveStatePointer receiveState) :
+    m_socket(socket),
+    m_receiveState(receiveState)
+  {
+  }
+
+  void operator()()
+  {
+    // Only a receive in progress is waiting to hear from the peer.
+    if (!m_receiveState->isReceiving)
+      return;
+
+    m_receiveState->isPeerLost = true;
+
+    boost::system::error_code ignored;
+    m_socket->close(ignored);
+  }
+
+private:
+  SocketPointer         m_socket;
+  ReceiveStatePointer   m_receiveState;
+};
+
+class DeadlineExpiredFunction
+{
+public:
+  DeadlineExpiredFunction(
+      SocketPointer socket,
+      ReceiveStatePointer receiveState) :
+    m_socket(socket),
+    m_receiveState(receiveState)
+  {
+  }
+
+  void operator()(Heartbeat::Deadline deadline)
+  {
+    // The first deadline to pass is the one the connection is closed for.
+    int notExpired = ReceiveState::NotExpired;
+    m_receiveState->expired.compare_exchange_strong(notExpired, deadline);
+
+    boost::system::error_code ignored;
+    m_socket->close(ignored);
+  }
+
+private:
+  SocketPointer         m_socket;
+  ReceiveStatePointer   m_receiveState;
+};
+
+// Closes the socket on the port's strand. A send waiting for credits goes
+// on, to fail with the closed socket.
+template<typename ProtocolSender>
+void CloseSocket(
+    SocketPointer socket,
+    SocketStrandPointer strand,
+    AsioExpress::MessagePort::SendQueuePointer sendQueue,
+    AsioExpress::MessagePort::FlowControlPointer flowControl)
+{
+  boost::system::error_code ignored;
+  socket->close(ignored);
+
+  if (flowControl 
+    && flowControl->Abort(socket->get_io_service(), AsioExpress::Error(boost::asio::error::operation_aborted)))
+  {
+    AsyncSendNext<ProtocolSender>(socket, strand, sendQueue, flowControl);
+  }
+}
+
+inline void ShutdownSocketSend(SocketPointer socket)
+{
+  boost::system::error_code ignored;
+  socket->shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored);
+}
+
+// Keeps a read going on a port with flow control while the application is
+// not receiving, so the credits the peer grants are seen and a send waiting
+// for them goes on. A message read before it is asked for is kept for the
+// next receive. The peer can only send as many of these as it has credits
+// for, since credits are granted back as messages are received. Only used
+// on the port's strand.
+template<typename ProtocolSender, typename ProtocolReceiver>
+class ReadAhead : 
+  public boost::enable_shared_from_this<ReadAhead<ProtocolSender, ProtocolReceiver> >
+{
+public:
+  typedef boost::function<void (boost::system::error_code)> Handler;
+
+  ReadAhead(
+      SocketPointer socket,
+      SocketStrandPointer strand,
+      AsioExpress::MessagePort::SendQueuePointer sendQueue,
+      AsioExpress::MessagePort::FlowControlPointer flowControl,
+      AsioExpress::MessagePort::HeartbeatPointer heartbeat) :
+    m_socket(socket),
+    m_strand(strand),
+    m_sendQueue(sendQueue),
+    m_flowControl(flowControl),
+    m_heartbeat(heartbeat),
+    m_isReading(false)
+  {
+  }
+
+  void Start()
+  {
+    if (!m_isReading)
+      Read(DataBufferPointer(new DataBuffer));
+  }
+
+  void AsyncReceive(
+      AsioExpress::MessagePort::DataBufferPointer buffer, 
+      Handler completionHandler)
+  {
+    if (!m_received.empty())
+    {
+      Message message = m_received.front();
+      m_received.pop_front();
+
+      buffer->Swap(*message.buffer);
+      m_socket->get_io_service().post(boost::asio::detail::bind_handler(completionHandler, message.error));
+      return;
+    }
+
+    m_buffer = buffer;
+    m_completionHandler = completionHandler;
+
+    // The read stops at an error; the receive gets the next one.
+    if (!m_isReading)
+      Read(DataBufferPointer(new DataBuffer));
+  }
+
+private:
+  struct Message
+  {
+    DataBufferPointer           buffer;
+    boost::system::error_code   error;
+  };
+
+  void Read(AsioExpress::MessagePort::DataBufferPointer buffer)
+  {
+    m_isReading = true;
+
+    ProtocolReceiver receiver;
+    receiver.AsyncRun(
+      m_socket, 
+      m_strand,
+      buffer, 
+      m_heartbeat,
+      GrantReceivedFunction<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl),
+      m_strand->wrap(boost::bind(&ReadAhead::ReadCompleted, this->shared_from_this(), buffer, _1)));
+  }
+
+  void ReadCompleted(
+      AsioExpress::MessagePort::DataBufferPointer buffer, 
+      boost::system::error_code error)
+  {
+    m_isReading = false;
+
+    if (m_completionHandler)
+    {
+      // The application's buffer takes the message and the read goes on
+      // with the one it held.
+      m_buffer->Swap(*buffer);
+      m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, error));
+      m_buffer.reset();
+      m_completionHandler = Handler();
     }
     else
     {
-      *m_isSending = false;
+      Message message;
+      message.buffer = buffer;
+      message.error = error;
+      m_received.push_back(message);
+      buffer.reset(new DataBuffer);
     }
 
-    m_socket->get_io_service().post(boost::asio::detail::bind_handler(m_completionHandler, AsioExpress::Error(ec)));
+    if (!error)
+      Read(buffer);
+  }
+
+  SocketPointer         m_socket;
+  SocketStrandPointer   m_strand;
+  SendQueuePointer      m_sendQueue;
+  FlowControlPointer    m_flowControl;
+  HeartbeatPointer      m_heartbeat;
+  bool                  m_isReading;
+  std::deque<Message>   m_received;
+  DataBufferPointer     m_buffer;
+  Handler               m_completionHandler;
+};
+
+// Starts the port's flow control and heartbeat once it is connected.
+template<typename MessagePort, typename H>
+class StartHeartbeatHandler
+{
+public:
+  StartHeartbeatHandler(
+      MessagePort & messagePort,
+      EndPoint const & endPoint,
+      H completionHandler) :
+    m_messagePort(messagePort),
+    m_settings(endPoint.GetHeartbeatSettings()),
+    m_flowControlSettings(endPoint.GetFlowControlSettings()),
+    m_completionHandler(completionHandler)
+  {
+  }
+
+  void operator()(boost::system::error_code ec = boost::system::error_code())
+  {
+    if (!ec)
+    {
+      m_messagePort.StartFlowControl(m_flowControlSettings);
+      m_messagePort.StartHeartbeat(m_settings);
+      m_messagePort.StartReadAhead();
+    }
+
+    m_completionHandler(AsioExpress::Error(ec));
   }
 
 private:
-   SocketPointer      m_socket;
-   BoolPointer        m_isSending;      
-   SendQueuePointer   m_sendQueue;
-   H                  m_completionHandler;
+  MessagePort &         m_messagePort;
+  HeartbeatSettings     m_settings;
+  FlowControlSettings   m_flowControlSettings;
+  H                     m_completionHandler;
 };
 
+///
+/// A message port on a TCP socket. The socket is only used from the port's
+/// own strand, so sends, receives, heartbeats and disconnects may come from
+/// any of the threads running the io_service.
+///
 template<typename ProtocolSender, typename ProtocolReceiver>
 class MessagePort
 {
@@ -101,6 +697,15 @@ public:
       AsioExpress::MessagePort::DataBufferPointer buffer, 
       H completionHandler);
 
+  ///
+  /// Sends the messages of the batch in order, as one write. The handler
+  /// is called once, when the whole batch has been sent or has failed.
+  ///
+  template<typename H>
+  void AsyncSendBatch(
+      AsioExpress::MessagePort::DataBufferListPointer batch, 
+      H completionHandler);
+
   template<typename H>
   void AsyncReceive(
       AsioExpress::MessagePort::DataBufferPointer buffer, 
@@ -108,22 +713,61 @@ public:
 
   void Disconnect();
 
+  ///
+  /// Closes the sending half of the socket. Sends already written reach
+  /// the peer, which then reads the end of the stream.
+  ///
+  void ShutdownSend();
+
   std::string GetAddress() const;
+
+  bool IsBroadcastSubscriber() const;
+
+  void GetStatistics(PortStatistics & statistics) const;
+
+  ///
+  /// Starts pinging the peer when idle, ending receives that hear nothing
+  /// for the ping timeout, and closing the connection when a send, receive
+  /// or idle deadline passes. Called once the port is connected.
+  ///
+  void StartHeartbeat(HeartbeatSettings const & settings);
+
+  ///
+  /// Starts granting the peer credits, and holding sends back until the
+  /// peer grants them, when the settings have any. Called once the port is
+  /// connected.
+  ///
+  void StartFlowControl(FlowControlSettings const & settings);
+
+  ///
+  /// Keeps reading from the socket between receives when the port has flow
+  /// control, so credits are not held up by an application that is not
+  /// receiving. Called once the flow control and heartbeat are started.
+  ///
+  void StartReadAhead();
   
 private:
-   typedef boost::shared_ptr<bool> BoolPointer;
-
-   SocketPointer      m_socket;
-   BoolPointer        m_isSending;      
-   SendQueuePointer   m_sendQueue;
+  typedef ReadAhead<ProtocolSender, ProtocolReceiver> ReadAheadType;
+  typedef boost::shared_ptr<ReadAheadType> ReadAheadPointer;
+
+   SocketPointer        m_socket;
+   SocketStrandPointer  m_strand;
+   SendQueuePointer     m_sendQueue;
+   ReceiveStatePointer  m_receiveState;
+   HeartbeatPointer     m_heartbeat;
+   FlowControlPointer   m_flowControl;
+   PortCountersPointer  m_counters;
+   ReadAheadPointer     m_readAhead;
 };
 
 template<typename ProtocolSender, typename ProtocolReceiver>
 MessagePort<ProtocolSender, ProtocolReceiver>::MessagePort(
     boost::asio::io_service & ioService) :
   m_socket(new boost::asio::ip::tcp::socket(ioService)),
-  m_isSending(new bool(false)),
-  m_sendQueue(new SendQueue)
+  m_strand(new boost::asio::io_service::strand(ioService)),
+  m_sendQueue(new SendQueue),
+  m_receiveState(new ReceiveState),
+  m_counters(new PortCounters)
 {
 }
 
@@ -153,7 +797,7 @@ void MessagePort<ProtocolSender, ProtocolReceiver>::AsyncConnect(
 {
   m_socket->async_connect(
     endPoint.GetEndPoint(m_socket->get_io_service()), 
-    AsioExpress::EcToErrorAdapter<H>(completionHandler));
+    StartHeartbeatHandler<MessagePort, H>(*this, endPoint, completionHandler));
 }
 
 template<typename ProtocolSender, typename ProtocolReceiver>
@@ -162,24 +806,52 @@ void MessagePort<ProtocolSender, ProtocolReceiver>::AsyncSend(
     AsioExpress::MessagePort::DataBufferPointer buffer,
     H completionHandler)
 {
-  if (*m_isSending)
+  typedef CountingSendHandler<HeartbeatSendHandler<H> > Handler;
+  Handler countingHandler(
+    m_counters, 
+    buffer, 
+    HeartbeatSendHandler<H>(m_heartbeat, completionHandler));
+
+  AsioExpress::MessagePort::SendQueue::Item item(buffer, countingHandler);
+  if (m_sendQueue->Push(item))
   {
-    m_sendQueue->Push(
-      AsioExpress::MessagePort::SendQueue::Item(buffer, completionHandler));
     return;
   }
 
-  *m_isSending = true;
+  m_strand->dispatch(boost::bind(
+    &AsyncSendItem<ProtocolSender>, 
+    m_socket, 
+    m_strand, 
+    m_sendQueue, 
+    m_flowControl, 
+    item));
+}
 
-  ProtocolSender sender;
-  sender.AsyncRun(
+template<typename ProtocolSender, typename ProtocolReceiver>
+template<typename H>
+void MessagePort<ProtocolSender, ProtocolReceiver>::AsyncSendBatch(
+    AsioExpress::MessagePort::DataBufferListPointer batch,
+    H completionHandler)
+{
+  typedef CountingBatchSendHandler<HeartbeatSendHandler<H> > Handler;
+  Handler countingHandler(
+    m_counters, 
+    batch, 
+    HeartbeatSendHandler<H>(m_heartbeat, completionHandler));
+
+  AsioExpress::MessagePort::SendQueue::Item item(batch, countingHandler);
+  if (m_sendQueue->Push(item))
+  {
+    return;
+  }
+
+  m_strand->dispatch(boost::bind(
+    &AsyncSendItem<ProtocolSender>, 
     m_socket, 
-    buffer, 
-    AsyncSendHandler<H,ProtocolSender>(
-      m_socket, 
-      m_isSending, 
-      m_sendQueue, 
-      completionHandler));
+    m_strand, 
+    m_sendQueue, 
+    m_flowControl, 
+    item));
 }
 
 template<typename ProtocolSender, typename ProtocolReceiver>
@@ -188,17 +860,83 @@ void MessagePort<ProtocolSender, ProtocolReceiver>::AsyncReceive(
     AsioExpress::MessagePort::DataBufferPointer buffer,
     H completionHandler)
 {
+  // The peer has until the ping timeout from now to be heard from.
+  if (m_heartbeat)
+    m_heartbeat->ReceiveStarted();
+
+  m_receiveState->isReceiving = true;
+  m_receiveState->isPeerLost = false;
+
+  typedef FlowControlReceiveHandler<CountingReceiveHandler<H>, ProtocolSender> Handler;
+
+  if (m_readAhead)
+  {
+    m_strand->dispatch(boost::bind(
+      &ReadAheadType::AsyncReceive,
+      m_readAhead,
+      buffer,
+      typename ReadAheadType::Handler(AsyncReceiveHandler<Handler>(
+        m_receiveState, 
+        m_heartbeat,
+        Handler(
+          m_socket, 
+          m_strand,
+          m_sendQueue, 
+          m_flowControl, 
+          buffer, 
+          CountingReceiveHandler<H>(m_counters, buffer, completionHandler))))));
+    return;
+  }
+
+  CreditFunction creditFunction;
+  if (m_flowControl)
+    creditFunction = GrantReceivedFunction<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+
   ProtocolReceiver receiver;
   receiver.AsyncRun(
     m_socket, 
+    m_strand,
     buffer, 
-    AsioExpress::EcToErrorAdapter<H>(completionHandler));
+    m_heartbeat,
+    creditFunction,
+    AsyncReceiveHandler<Handler>(
+      m_receiveState, 
+      m_heartbeat,
+      Handler(
+        m_socket, 
+        m_strand,
+        m_sendQueue, 
+        m_flowControl, 
+        buffer, 
+        CountingReceiveHandler<H>(m_counters, buffer, completionHandler))));
 }
 
 template<typename ProtocolSender, typename ProtocolReceiver>
 void MessagePort<ProtocolSender, ProtocolReceiver>::Disconnect()
 {
-  m_socket->close();
+  if (m_heartbeat)
+  {
+    m_heartbeat->Stop();
+    m_heartbeat.reset();
+  }
+
+  // A ping the heartbeat has already started is ahead of the close on the
+  // strand.
+  m_strand->dispatch(boost::bind(
+    &CloseSocket<ProtocolSender>, m_socket, m_strand, m_sendQueue, m_flowControl));
+}
+
+template<typename ProtocolSender, typename ProtocolReceiver>
+void MessagePort<ProtocolSender, ProtocolReceiver>::ShutdownSend()
+{
+  // There is nothing more to ping with.
+  if (m_heartbeat)
+  {
+    m_heartbeat->Stop();
+    m_heartbeat.reset();
+  }
+
+  m_strand->dispatch(boost::bind(&ShutdownSocketSend, m_socket));
 }
 
 template<typename ProtocolSender, typename ProtocolReceiver>
@@ -207,6 +945,60 @@ std::string MessagePort<ProtocolSender, ProtocolReceiver>::GetAddress() const
     return m_socket->remote_endpoint().address().to_string();
 }
 
+template<typename ProtocolSender, typename ProtocolReceiver>
+bool MessagePort<ProtocolSender, ProtocolReceiver>::IsBroadcastSubscriber() const
+{
+  // TCP has no broadcast channel; every broadcast is sent to each port.
+  return false;
+}
+
+template<typename ProtocolSender, typename ProtocolReceiver>
+void MessagePort<ProtocolSender, ProtocolReceiver>::GetStatistics(
+    PortStatistics & statistics) const
+{
+  m_counters->Get(statistics);
+}
+
+template<typename ProtocolSender, typename ProtocolReceiver>
+void MessagePort<ProtocolSender, ProtocolReceiver>::StartHeartbeat(
+    HeartbeatSettings const & settings)
+{
+  if (m_heartbeat)
+    m_heartbeat->Stop();
+
+  m_receiveState->expired = ReceiveState::NotExpired;
+
+  m_heartbeat = boost::asio::use_service<HeartbeatService>(m_socket->get_io_service()).Start(
+    settings,
+    m_strand->wrap(PingFunction<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl)),
+    m_strand->wrap(PingTimeoutFunction(m_socket, m_receiveState)),
+    m_strand->wrap(DeadlineExpiredFunction(m_socket, m_receiveState)));
+}
+
+template<typename ProtocolSender, typename ProtocolReceiver>
+void MessagePort<ProtocolSender, ProtocolReceiver>::StartFlowControl(
+    FlowControlSettings const & settings)
+{
+  if (settings.credits == 0)
+    return;
+
+  m_flowControl.reset(new FlowControl(settings));
+
+  // The peer may send nothing until it is granted its first credits.
+  if (m_sendQueue->Start())
+    DispatchSendNext<ProtocolSender>(m_socket, m_strand, m_sendQueue, m_flowControl);
+}
+
+template<typename ProtocolSender, typename ProtocolReceiver>
+void MessagePort<ProtocolSender, ProtocolReceiver>::StartReadAhead()
+{
+  if (!m_flowControl)
+    return;
+
+  m_readAhead.reset(new ReadAheadType(m_socket, m_strand, m_sendQueue, m_flowControl, m_heartbeat));
+  m_strand->dispatch(boost::bind(&ReadAheadType::Start, m_readAhead));
+}
+
 } // namespace Tcp
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -9,7 +9,9 @@
 
 #include "AsioExpressError/EcToErrorAdapter.hpp"
 #include "AsioExpress/CompletionHandler.hpp"
+#include "AsioExpress/MessagePort/DataBuffer.hpp"
 #include "AsioExpress/MessagePort/Tcp/EndPoint.hpp"
+#include "AsioExpress/MessagePort/Tcp/private/MessagePort.hpp"
 
 namespace AsioExpress {
 namespace MessagePort {
@@ -35,16 +37,20 @@ public:
 
   void Close();
 
+  bool PublishBroadcast(AsioExpress::MessagePort::DataBufferPointer buffer);
+
 private:
   typedef boost::shared_ptr<boost::asio::ip::tcp::acceptor> AcceptorPointer;
 
   AcceptorPointer m_acceptor;
+  EndPointType    m_endPoint;
 };
 
 template<typename MessagePort>
 MessagePortAcceptor<MessagePort>::MessagePortAcceptor(
     boost::asio::io_service & ioService,
-    EndPointType endPoint)
+    EndPointType endPoint) :
+  m_endPoint(endPoint)
 {
   m_acceptor.reset(
     new boost::asio::ip::tcp::acceptor(
@@ -66,7 +72,8 @@ void MessagePortAcceptor<MessagePort>::AsyncAccept(
 {
   m_acceptor->async_accept(
     *messagePort.GetSocket(), 
-    AsioExpress::EcToErrorAdapter<CompletionHandler>(completionHandler));
+    StartHeartbeatHandler<MessagePort, CompletionHandler>(
+      messagePort, m_endPoint, completionHandler));
 }
 
 template<typename MessagePort>
@@ -75,6 +82,14 @@ void MessagePortAcceptor<MessagePort>::Close()
   m_acceptor->close();
 }
 
+template<typename MessagePort>
+bool MessagePortAcceptor<MessagePort>::PublishBroadcast(
+    AsioExpress::MessagePort::DataBufferPointer)
+{
+  // TCP has no broadcast channel; every broadcast is sent to each port.
+  return false;
+}
+
 } // namespace Tcp
 } // namespace MessagePort
 } // namespace AsioExpress
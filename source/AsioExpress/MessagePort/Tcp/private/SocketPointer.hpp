@@ -14,6 +14,9 @@ namespace Tcp {
 
 typedef boost::shared_ptr<boost::asio::ip::tcp::socket> SocketPointer;
 
+// The strand a port's socket is only used from.
+typedef boost::shared_ptr<boost::asio::io_service::strand> SocketStrandPointer;
+
 } // namespace Tcp
 } // namespace MessagePort
 } // namespace AsioExpress
@@ -21,6 +21,13 @@ enum
 enum 
 {
   ProtocolVersionBasic = 1,
+
+  // A header on its own, sent to keep an idle connection alive.
+  ProtocolVersionPing = 2,
+
+  // A header followed by the credits granted to the peer under flow
+  // control. It is sent ahead of a message, or on its own.
+  ProtocolVersionCredit = 3,
 };
 
 } // namespace Tcp
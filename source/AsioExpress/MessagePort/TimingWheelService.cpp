@@ -0,0 +1,135 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <boost/bind.hpp>
+
+#include "AsioExpress/MessagePort/TimingWheelService.hpp"
+
+namespace AsioExpress {
+namespace MessagePort {
+
+boost::asio::io_service::id TimingWheelService::id;
+int const TimingWheelService::TickMilliseconds;
+
+TimingWheelService::TimingWheelService(boost::asio::io_service & ioService) :
+  boost::asio::io_service::service(ioService),
+  m_wheel(WheelSize),
+  m_tick(0),
+  m_count(0),
+  m_isRunning(false),
+  m_timer(ioService)
+{
+}
+
+TimingWheelService::Tick TimingWheelService::GetTick() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_tick;
+}
+
+void TimingWheelService::Schedule(Tick due, Function function)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  Insert(due, function);
+
+  if (!m_isRunning)
+  {
+    m_isRunning = true;
+    m_timer.expires_from_now(boost::posix_time::milliseconds(TickMilliseconds));
+    m_timer.async_wait(boost::bind(&TimingWheelService::TimerExpired, this, _1));
+  }
+}
+
+TimingWheelService::Tick TimingWheelService::ToTicks(int milliseconds)
+{
+  if (milliseconds <= 0)
+    return 0;
+
+  return (static_cast<Tick>(milliseconds) + TickMilliseconds - 1) / TickMilliseconds;
+}
+
+void TimingWheelService::shutdown_service()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  boost::system::error_code ignored;
+  m_timer.cancel(ignored);
+
+  // The functions can hold on to their owners' resources.
+  for (std::size_t i = 0; i < m_wheel.size(); ++i)
+    m_wheel[i].clear();
+  m_count = 0;
+}
+
+void TimingWheelService::Insert(Tick due, Function const & function)
+{
+  // A slot that has already been passed would not be seen for a whole turn.
+  if (due <= m_tick)
+    due = m_tick + 1;
+
+  Entry entry;
+  entry.due = due;
+  entry.function = function;
+  m_wheel[due % WheelSize].push_back(entry);
+  ++m_count;
+}
+
+void TimingWheelService::TimerExpired(boost::system::error_code const & error)
+{
+  if (error)
+    return;
+
+  Tick now;
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    now = ++m_tick;
+
+    // Entries due on a later turn of the wheel stay where they are.
+    Slot & slot = m_wheel[now % WheelSize];
+    Slot::iterator kept = slot.begin();
+    for (Slot::iterator i = slot.begin(); i != slot.end(); ++i)
+    {
+      if (i->due <= now)
+        m_due.push_back(*i);
+      else
+        *kept++ = *i;
+    }
+    slot.erase(kept, slot.end());
+    m_count -= m_due.size();
+  }
+
+  // The functions are called without the service locked so they are free
+  // to schedule other entries.
+  for (Slot::iterator i = m_due.begin(); i != m_due.end(); ++i)
+  {
+    Tick next = i->function(now);
+    if (next != 0)
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      Insert(next, i->function);
+    }
+  }
+  m_due.clear();
+
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  if (m_count == 0)
+  {
+    m_isRunning = false;
+    return;
+  }
+
+  // Ticks are counted from the previous expiry so the wheel does not drift.
+  m_timer.expires_at(m_timer.expires_at() + boost::posix_time::milliseconds(TickMilliseconds));
+  m_timer.async_wait(boost::bind(&TimingWheelService::TimerExpired, this, _1));
+}
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,82 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace AsioExpress {
+namespace MessagePort {
+
+///
+/// A timing wheel shared by everything on an io_service that needs coarse
+/// timeouts, such as heartbeats and call deadlines. A single timer drives
+/// it, so the cost does not depend on the number of entries, and the timer
+/// only runs while there are entries on the wheel.
+///
+class TimingWheelService : public boost::asio::io_service::service
+{
+public:
+  typedef boost::uint64_t Tick;
+
+  ///
+  /// Called from the io_service with the current tick once an entry is
+  /// due. Returns the tick the entry is next due at, or zero to drop it.
+  ///
+  typedef boost::function<Tick (Tick now)> Function;
+
+  static boost::asio::io_service::id id;
+
+  /// The resolution of the wheel; intervals are rounded up to a whole tick.
+  static int const TickMilliseconds = 10;
+
+  explicit TimingWheelService(boost::asio::io_service & ioService);
+
+  Tick GetTick() const;
+
+  ///
+  /// Calls the function once the wheel reaches the due tick. A tick that
+  /// has already passed is due at the next one.
+  ///
+  void Schedule(Tick due, Function function);
+
+  static Tick ToTicks(int milliseconds);
+
+private:
+  enum { WheelSize = 256 };
+
+  struct Entry
+  {
+    Tick        due;
+    Function    function;
+  };
+
+  typedef std::vector<Entry> Slot;
+
+  virtual void shutdown_service();
+
+  // Requires the service lock to be held.
+  void Insert(Tick due, Function const & function);
+
+  void TimerExpired(boost::system::error_code const & error);
+
+  mutable boost::mutex          m_mutex;
+  std::vector<Slot>             m_wheel;
+  Tick                          m_tick;
+  std::size_t                   m_count;
+  bool                          m_isRunning;
+  boost::asio::deadline_timer   m_timer;
+
+  // only used by TimerExpired()
+  Slot                          m_due;
+};
+
+} // namespace MessagePort
+} // namespace AsioExpress
@@ -0,0 +1,21 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace AsioExpress {
+
+unsigned int GetOwnProcessId();
+
+bool IsProcessRunning(unsigned int processId);
+
+/// Lists the names of the shared memory objects that interprocess queues and
+/// segments are created in.
+void GetSharedMemoryNames(std::vector<std::string> & names);
+
+} // namespace AsioExpress
@@ -0,0 +1,46 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "AsioExpress/Platform/Process.hpp"
+
+namespace AsioExpress {
+
+unsigned int GetOwnProcessId()
+{
+  return static_cast<unsigned int>(::getpid());
+}
+
+bool IsProcessRunning(unsigned int processId)
+{
+  if (::kill(static_cast<pid_t>(processId), 0) == 0)
+    return true;
+
+  // The process exists but belongs to someone else.
+  return errno == EPERM;
+}
+
+void GetSharedMemoryNames(std::vector<std::string> & names)
+{
+  DIR * dir = ::opendir("/dev/shm");
+  if (dir == 0)
+    return;
+
+  while (dirent * entry = ::readdir(dir))
+  {
+    if (entry->d_name[0] != '.')
+      names.push_back(entry->d_name);
+  }
+
+  ::closedir(dir);
+}
+
+} // namespace AsioExpress
@@ -0,0 +1,53 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpress/pch.hpp"
+
+#include <boost/interprocess/detail/shared_dir_helpers.hpp>
+
+#include "AsioExpress/Platform/Process.hpp"
+
+namespace AsioExpress {
+
+unsigned int GetOwnProcessId()
+{
+  return ::GetCurrentProcessId();
+}
+
+bool IsProcessRunning(unsigned int processId)
+{
+  HANDLE process = ::OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, processId);
+  if (process == NULL)
+    return ::GetLastError() == ERROR_ACCESS_DENIED;
+
+  DWORD exitCode = 0;
+  BOOL result = ::GetExitCodeProcess(process, &exitCode);
+  ::CloseHandle(process);
+
+  return !result || exitCode == STILL_ACTIVE;
+}
+
+void GetSharedMemoryNames(std::vector<std::string> & names)
+{
+  // Boost emulates shared memory on Windows with files in a shared directory.
+  std::string directory;
+  boost::interprocess::ipcdetail::get_shared_dir(directory);
+
+  WIN32_FIND_DATAA data;
+  HANDLE find = ::FindFirstFileA((directory + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE)
+    return;
+
+  do
+  {
+    if (data.cFileName[0] != '.')
+      names.push_back(data.cFileName);
+  }
+  while (::FindNextFileA(find, &data));
+
+  ::FindClose(find);
+}
+
+} // namespace AsioExpress
@@ -0,0 +1,330 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "AsioExpress/EventHandling/Backpressure.hpp"
+#include "AsioExpress/EventHandling/EventQueue.hpp"
+#include "AsioExpress/Timer/NoExpiryTimer.hpp"
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47327";
+  int const MessageCount = 50;
+
+  typedef EventQueue<std::string> StringQueue;
+
+  void SetError(AsioExpress::Error & result, int & calls, AsioExpress::Error error)
+  {
+    result = error;
+    ++calls;
+  }
+
+  void IgnoreError(AsioExpress::Error)
+  {
+  }
+
+  /// Passes each message on to a queue that is read separately.
+  class QueueingServerHandler : public ServerEventHandler
+  {
+  public:
+    QueueingServerHandler(StringQueue & queue) :
+      connects(0),
+      disconnects(0),
+      m_queue(queue)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+      ++disconnects;
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      DataBufferPointer buffer = message.GetDataBuffer();
+      m_queue.AsyncAdd(std::string(buffer->Get(), buffer->Size()), IgnoreError);
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int disconnects;
+
+  private:
+    StringQueue &   m_queue;
+  };
+
+  class NullClientHandler : public ClientEventHandler
+  {
+  public:
+    NullClientHandler() :
+      connects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+  };
+
+  bool HasQueued(StringQueue const & queue, std::size_t expected)
+  {
+    return queue.GetSize() >= expected;
+  }
+
+  // Takes the events waiting in the queue.
+  void TakeEvents(StringQueue & queue, boost::asio::io_service & ioService, std::size_t count, std::vector<std::string> & taken)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      StringQueue::EventPointer event(new std::string);
+      AsioExpress::Error error;
+      int calls = 0;
+      queue.AsyncWait(
+        event,
+        TimerPointer(new NoExpiryTimer(ioService)),
+        boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+      BOOST_REQUIRE_EQUAL(calls, 1);
+      BOOST_REQUIRE(!error);
+      taken.push_back(*event);
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(BackpressureTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Watermarks)
+{
+  boost::asio::io_service ioService;
+  Backpressure backpressure(ioService, 4, 1);
+
+  // Not paused, a wait completes at once.
+  AsioExpress::Error error(ErrorCode::MessagePortServerBusy);
+  int calls = 0;
+  backpressure.AsyncWaitUntilResumed(boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+  ioService.poll();
+  ioService.reset();
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(!error);
+
+  backpressure.Add(3);
+  BOOST_CHECK(!backpressure.IsPaused());
+  backpressure.Add();
+  BOOST_CHECK(backpressure.IsPaused());
+  BOOST_CHECK_EQUAL(backpressure.GetLevel(), 4u);
+
+  calls = 0;
+  backpressure.AsyncWaitUntilResumed(boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+
+  // Falling below the high watermark is not enough to resume.
+  backpressure.Remove(2);
+  ioService.poll();
+  ioService.reset();
+  BOOST_CHECK(backpressure.IsPaused());
+  BOOST_CHECK_EQUAL(calls, 0);
+
+  backpressure.Remove();
+  ioService.poll();
+  ioService.reset();
+  BOOST_CHECK(!backpressure.IsPaused());
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(!error);
+
+  // Cancel aborts the waits.
+  backpressure.Add(3);
+  calls = 0;
+  backpressure.AsyncWaitUntilResumed(boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+  backpressure.Cancel();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(error.GetErrorCode() == boost::asio::error::operation_aborted);
+  BOOST_CHECK(backpressure.IsPaused());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Event_Queue_Level)
+{
+  boost::asio::io_service ioService;
+  BackpressurePointer backpressure(new Backpressure(ioService, 3, 1));
+  StringQueue queue(2);
+
+  queue.AsyncAdd("a", IgnoreError);
+  queue.SetBackpressure(backpressure);
+  BOOST_CHECK_EQUAL(backpressure->GetLevel(), 1u);
+
+  // Events waiting for room in a full queue count too.
+  queue.AsyncAdd("b", IgnoreError);
+  queue.AsyncAdd("c", IgnoreError);
+  BOOST_CHECK_EQUAL(queue.GetSize(), 3u);
+  BOOST_CHECK_EQUAL(backpressure->GetLevel(), 3u);
+  BOOST_CHECK(backpressure->IsPaused());
+
+  std::vector<std::string> taken;
+  TakeEvents(queue, ioService, 2, taken);
+  BOOST_CHECK_EQUAL(backpressure->GetLevel(), 1u);
+  BOOST_CHECK(!backpressure->IsPaused());
+
+  // A queue that is shut down no longer holds its producers back.
+  queue.AsyncAdd("d", IgnoreError);
+  queue.ShutDown();
+  queue.ShutDown();
+  BOOST_CHECK_EQUAL(backpressure->GetLevel(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Reads_Pause_And_Resume)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  BackpressurePointer backpressure(new Backpressure(ioService, 4, 1));
+  StringQueue queue;
+  queue.SetBackpressure(backpressure);
+
+  QueueingServerHandler * serverHandler = new QueueingServerHandler(queue);
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.SetBackpressure(backpressure);
+  server.Start();
+
+  NullClientHandler * clientHandler = new NullClientHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 1)));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 1)));
+
+  for (int message = 0; message < MessageCount; ++message)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(boost::lexical_cast<std::string>(message))), IgnoreError);
+
+  // The server stops reading at the high watermark, leaving the rest of
+  // the messages with TCP.
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasQueued, boost::cref(queue), 4u)));
+  RunFor(ioService, 100);
+  BOOST_CHECK_EQUAL(queue.GetSize(), 4u);
+  BOOST_CHECK(backpressure->IsPaused());
+
+  MessagePortIdList ids;
+  server.GetIds(ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 1u);
+  PortStatistics statistics;
+  BOOST_REQUIRE(server.GetStatistics(ids[0], statistics));
+  BOOST_CHECK_EQUAL(statistics.messagesReceived, 4u);
+
+  // Above the low watermark it stays paused.
+  std::vector<std::string> taken;
+  TakeEvents(queue, ioService, 2, taken);
+  RunFor(ioService, 50);
+  BOOST_CHECK_EQUAL(queue.GetSize(), 2u);
+
+  // At the low watermark it reads again, until every message is taken.
+  while (taken.size() < static_cast<std::size_t>(MessageCount))
+  {
+    TakeEvents(queue, ioService, 1, taken);
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasQueued, boost::cref(queue),
+      std::min<std::size_t>(1, MessageCount - taken.size()))));
+  }
+
+  for (int message = 0; message < MessageCount; ++message)
+    BOOST_CHECK_EQUAL(taken[message], boost::lexical_cast<std::string>(message));
+
+  client.ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Drain_Closes_Paused_Connections)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  BackpressurePointer backpressure(new Backpressure(ioService, 2, 1));
+  StringQueue queue;
+  queue.SetBackpressure(backpressure);
+
+  QueueingServerHandler * serverHandler = new QueueingServerHandler(queue);
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.SetBackpressure(backpressure);
+  server.Start();
+
+  NullClientHandler * clientHandler = new NullClientHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 1)));
+
+  for (int message = 0; message < 4; ++message)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(boost::lexical_cast<std::string>(message))), IgnoreError);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasQueued, boost::cref(queue), 2u)));
+  BOOST_REQUIRE(backpressure->IsPaused());
+
+  // The paused connection is closed rather than left waiting for a resume
+  // that never comes.
+  DrainResultPointer result(new DrainResult);
+  AsioExpress::Error error(ErrorCode::MessagePortServerBusy);
+  int calls = 0;
+  server.AsyncStop(2000, result, boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(calls), 1)));
+  BOOST_CHECK(!error);
+  BOOST_CHECK_EQUAL(serverHandler->disconnects, 1);
+  BOOST_CHECK_EQUAL(result->connectionsForced, 0u);
+
+  client.ShutDown();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/private/BroadcastProcessor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  // Holds on to each send until the test completes it.
+  class SenderStub : public AsyncSendable
+  {
+  public:
+    virtual void AsyncSend(
+        MessagePortId id,
+        DataBufferPointer buffer,
+        AsioExpress::CompletionHandler completionHandler)
+    {
+      sends[id] = completionHandler;
+      buffers.push_back(buffer);
+    }
+
+    void Complete(MessagePortId id, AsioExpress::Error error = AsioExpress::Error())
+    {
+      sends[id](error);
+    }
+
+    std::map<MessagePortId, AsioExpress::CompletionHandler>  sends;
+    std::vector<DataBufferPointer>                          buffers;
+  };
+
+  MessagePortIdList Ids(int count)
+  {
+    MessagePortIdList ids;
+    for (int id = 1; id <= count; ++id)
+      ids.push_back(id);
+    return ids;
+  }
+}
+
+struct BroadcastProcessorFixture : UnitTestModeFixture
+{
+  BroadcastProcessorFixture() :
+    UnitTestModeFixture(true),
+    sender(new SenderStub),
+    buffer(new DataBuffer("Hello")),
+    result(new BroadcastResult)
+  {
+  }
+
+  boost::asio::io_service           ioService;
+  boost::shared_ptr<SenderStub>     sender;
+  DataBufferPointer                 buffer;
+  BroadcastResultPointer            result;
+};
+
+BOOST_FIXTURE_TEST_SUITE(BroadcastProcessorTest, BroadcastProcessorFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Sends_Start_Together)
+{
+  MessagePortIdList ids = Ids(3);
+  TestCompletionHandler handler;
+  BroadcastProcessor proc(ioService, sender, ids, buffer, result, 0, handler);
+  proc();
+
+  // Every send is under way before any has completed, all with the same
+  // buffer.
+  BOOST_REQUIRE_EQUAL(sender->sends.size(), 3u);
+  BOOST_CHECK(sender->buffers[0] == buffer);
+  BOOST_CHECK(sender->buffers[2] == buffer);
+  BOOST_CHECK_EQUAL(result->GetRecipientCount(), 3u);
+
+  sender->Complete(3);
+  sender->Complete(1);
+  BOOST_CHECK_EQUAL(handler.Calls(), 0);
+
+  sender->Complete(2);
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(result->IsComplete());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Failures_Reported_Per_Port)
+{
+  MessagePortIdList ids = Ids(3);
+  TestCompletionHandler handler;
+  BroadcastProcessor proc(ioService, sender, ids, buffer, result, 0, handler);
+  proc();
+
+  sender->Complete(1);
+  sender->Complete(2, AsioExpress::Error(boost::asio::error::connection_reset));
+  sender->Complete(3);
+
+  BOOST_REQUIRE_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), ErrorCode::MessagePortBroadcastIncomplete);
+  BOOST_REQUIRE_EQUAL(result->GetFailures().size(), 1u);
+  BOOST_CHECK_EQUAL(result->GetFailures()[0].id, 2);
+  BOOST_CHECK_EQUAL(
+    result->GetFailures()[0].error.GetErrorCode(),
+    boost::asio::error::connection_reset);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Failures_Ignored_Without_Result)
+{
+  MessagePortIdList ids = Ids(2);
+  TestCompletionHandler handler;
+  BroadcastProcessor proc(ioService, sender, ids, buffer, BroadcastResultPointer(), 0, handler);
+  proc();
+
+  sender->Complete(1, AsioExpress::Error(boost::asio::error::connection_reset));
+  sender->Complete(2);
+
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(!handler.LastError());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Slow_Port_Times_Out)
+{
+  boost::asio::io_service::work work(ioService);
+
+  MessagePortIdList ids = Ids(3);
+  TestCompletionHandler handler;
+  BroadcastProcessor proc(ioService, sender, ids, buffer, result, 20, handler);
+  proc();
+
+  sender->Complete(1);
+  sender->Complete(3);
+
+  while (handler.Calls() == 0)
+    ioService.run_one();
+
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), ErrorCode::MessagePortBroadcastIncomplete);
+  BOOST_REQUIRE_EQUAL(result->GetFailures().size(), 1u);
+  BOOST_CHECK_EQUAL(result->GetFailures()[0].id, 2);
+  BOOST_CHECK_EQUAL(
+    result->GetFailures()[0].error.GetErrorCode(),
+    ErrorCode::MessagePortBroadcastTimeout);
+
+  // The slow port finishing later changes nothing.
+  sender->Complete(2, AsioExpress::Error(boost::asio::error::connection_reset));
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK_EQUAL(result->GetFailures().size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_No_Ports)
+{
+  MessagePortIdList ids;
+  TestCompletionHandler handler;
+  BroadcastProcessor proc(ioService, sender, ids, buffer, result, 20, handler);
+  proc();
+
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(sender->sends.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
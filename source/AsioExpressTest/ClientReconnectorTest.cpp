@@ -0,0 +1,388 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/ClientServer/private/ClientReconnector.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpress/MessagePort/Tcp/ErrorCodes.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47313";
+
+  // Stands in for the client's connection.
+  struct Connection
+  {
+    Connection() :
+      isConnected(false),
+      connects(0)
+    {
+    }
+
+    bool Send(DataBufferPointer buffer, AsioExpress::CompletionHandler completionHandler)
+    {
+      if (!isConnected)
+        return false;
+
+      sent.push_back(buffer);
+      handlers.push_back(completionHandler);
+      return true;
+    }
+
+    void Connect()
+    {
+      ++connects;
+    }
+
+    bool                                          isConnected;
+    int                                           connects;
+    std::vector<DataBufferPointer>                sent;
+    std::vector<AsioExpress::CompletionHandler>   handlers;
+  };
+
+  class EventsStub : public ClientEvents
+  {
+  public:
+    virtual AsioExpress::Error HandleConnected(ClientConnection)
+    {
+      return AsioExpress::Error();
+    }
+
+    virtual void HandleDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void HandleMessage(ClientMessage)
+    {
+    }
+
+    virtual AsioExpress::Error HandleMessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual void HandleReconnecting(ClientConnection, unsigned int delayMilliseconds)
+    {
+      delays.push_back(delayMilliseconds);
+    }
+
+    std::vector<unsigned int> delays;
+  };
+
+  // Counts the messages the server receives.
+  class CountingHandler : public ServerEventHandler
+  {
+  public:
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      received.push_back(std::string(
+        message.GetDataBuffer()->Get(),
+        message.GetDataBuffer()->Size()));
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    std::vector<std::string> received;
+  };
+
+  // Records the reconnect events the client reports.
+  class ReconnectingHandler : public ClientEventHandler
+  {
+  public:
+    ReconnectingHandler() :
+      connects(0),
+      reconnects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual void ClientReconnecting(ClientConnection, unsigned int)
+    {
+      ++reconnects;
+    }
+
+    int connects;
+    int reconnects;
+  };
+
+  bool HasReceived(CountingHandler const & handler, std::size_t count)
+  {
+    return handler.received.size() >= count;
+  }
+
+  std::string Text(int index)
+  {
+    std::ostringstream text;
+    text << "Message " << index;
+    return text.str();
+  }
+}
+
+struct ClientReconnectorFixture : UnitTestModeFixture
+{
+  ClientReconnectorFixture() :
+    events(new EventsStub),
+    connection(new Connection),
+    reconnector(new ClientReconnector(
+      ioService,
+      ReconnectPolicy(10, 80, 3),
+      events,
+      boost::bind(&Connection::Send, connection, _1, _2),
+      boost::bind(&Connection::Connect, connection),
+      1))
+  {
+    reconnector->Start();
+  }
+
+  ~ClientReconnectorFixture()
+  {
+    reconnector->Stop();
+  }
+
+  ClientConnection Connected()
+  {
+    connection->isConnected = true;
+    return ClientConnection(ioService, 1, ClientInterfacePointer());
+  }
+
+  ClientConnection Disconnected()
+  {
+    connection->isConnected = false;
+    return ClientConnection(ioService, 1, ClientInterfacePointer());
+  }
+
+  boost::asio::io_service             ioService;
+  boost::shared_ptr<EventsStub>       events;
+  boost::shared_ptr<Connection>       connection;
+  ClientReconnectorPointer            reconnector;
+};
+
+BOOST_FIXTURE_TEST_SUITE(ClientReconnectorTest, ClientReconnectorFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Held_Messages_Replayed_In_Order)
+{
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(1))), NullCompletionHandler);
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(2))), NullCompletionHandler);
+  BOOST_CHECK(connection->sent.empty());
+
+  reconnector->HandleConnected(Connected());
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(3))), NullCompletionHandler);
+
+  BOOST_REQUIRE_EQUAL(connection->sent.size(), 3u);
+  for (int i = 0; i < 3; ++i)
+    BOOST_CHECK(*connection->sent[i] == DataBuffer(Text(i + 1)));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Held_Messages_Bounded)
+{
+  std::vector<TestCompletionHandler> handlers;
+  for (int i = 0; i < 4; ++i)
+  {
+    handlers.push_back(TestCompletionHandler());
+    reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(i))), handlers[i]);
+  }
+  ioService.poll();
+
+  BOOST_CHECK_EQUAL(handlers[2].Calls(), 0);
+  BOOST_REQUIRE_EQUAL(handlers[3].Calls(), 1);
+  BOOST_CHECK_EQUAL(handlers[3].LastError().GetErrorCode(), ErrorCode::MessagePortSendBufferFull);
+
+  // Disconnecting for good fails the held messages.
+  reconnector->Stop();
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(handlers[0].Calls(), 1);
+  BOOST_CHECK_EQUAL(handlers[0].LastError().GetErrorCode(), boost::asio::error::operation_aborted);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Failed_Send_Held_For_Reconnect)
+{
+  reconnector->HandleConnected(Connected());
+
+  TestCompletionHandler handler;
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(1))), handler);
+  BOOST_REQUIRE_EQUAL(connection->sent.size(), 1u);
+
+  // The connection drops with the message still being sent.
+  reconnector->HandleDisconnected(Disconnected(), AsioExpress::Error(boost::asio::error::connection_reset));
+  connection->handlers[0](AsioExpress::Error(boost::asio::error::connection_reset));
+  ioService.poll();
+  BOOST_CHECK_EQUAL(handler.Calls(), 0);
+
+  reconnector->HandleConnected(Connected());
+  BOOST_REQUIRE_EQUAL(connection->sent.size(), 2u);
+  BOOST_CHECK(*connection->sent[1] == DataBuffer(Text(1)));
+
+  connection->handlers[1](AsioExpress::Error());
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(!handler.LastError());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Other_Send_Errors_Not_Retried)
+{
+  reconnector->HandleConnected(Connected());
+
+  TestCompletionHandler handler;
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(1))), handler);
+  BOOST_REQUIRE_EQUAL(connection->sent.size(), 1u);
+
+  // A timed out send would only time out again.
+  connection->handlers[0](AsioExpress::Error(Tcp::ErrorCode::SendTimeout));
+  ioService.poll();
+  BOOST_REQUIRE_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), Tcp::ErrorCode::SendTimeout);
+
+  reconnector->HandleDisconnected(Disconnected(), AsioExpress::Error(boost::asio::error::connection_reset));
+  reconnector->HandleConnected(Connected());
+  BOOST_CHECK_EQUAL(connection->sent.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Resends_Capped)
+{
+  reconnector->HandleConnected(Connected());
+
+  TestCompletionHandler handler;
+  reconnector->AsyncSend(DataBufferPointer(new DataBuffer(Text(1))), handler);
+
+  // The policy allows three attempts in all.
+  for (std::size_t attempt = 1; attempt <= 3; ++attempt)
+  {
+    BOOST_REQUIRE_EQUAL(connection->sent.size(), attempt);
+    reconnector->HandleDisconnected(Disconnected(), AsioExpress::Error(boost::asio::error::connection_reset));
+    connection->handlers.back()(AsioExpress::Error(boost::asio::error::connection_reset));
+    ioService.poll();
+    ioService.reset();
+    reconnector->HandleConnected(Connected());
+  }
+
+  BOOST_CHECK_EQUAL(connection->sent.size(), 3u);
+  BOOST_REQUIRE_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), boost::asio::error::connection_reset);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Backoff)
+{
+  // The waits double up to the maximum, less up to half at random.
+  unsigned int const backoffs[] = { 10, 20, 40, 80, 80 };
+  for (int i = 0; i < 5; ++i)
+  {
+    BOOST_CHECK_EQUAL(reconnector->GetBackoff(), backoffs[i]);
+    reconnector->HandleDisconnected(Disconnected(), AsioExpress::Error(boost::asio::error::connection_refused));
+    BOOST_REQUIRE_EQUAL(events->delays.size(), static_cast<std::size_t>(i + 1));
+    BOOST_CHECK(events->delays[i] >= backoffs[i] / 2);
+    BOOST_CHECK(events->delays[i] <= backoffs[i]);
+  }
+
+  BOOST_CHECK(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(connection->connects), 1)));
+
+  reconnector->HandleConnected(Connected());
+  BOOST_CHECK_EQUAL(reconnector->GetBackoff(), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_No_Reconnect_After_Stop)
+{
+  reconnector->Stop();
+  reconnector->HandleDisconnected(Disconnected(), AsioExpress::Error(boost::asio::error::connection_reset));
+
+  BOOST_CHECK(events->delays.empty());
+  ioService.poll();
+  BOOST_CHECK_EQUAL(connection->connects, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Client_Reconnects)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service::work work(ioService);
+
+  CountingHandler * serverHandler = new CountingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  ReconnectingHandler * clientHandler = new ReconnectingHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler);
+  client.SetReconnectPolicy(ReconnectPolicy(10, 50, 100));
+  client.Connect();
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 1)));
+  client.AsyncSend(DataBufferPointer(new DataBuffer(Text(0))), NullCompletionHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasReceived, boost::cref(*serverHandler), 1)));
+
+  // While the server is away the client keeps trying and holds its messages.
+  server.Stop();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->reconnects), 2)));
+  for (int i = 1; i <= 5; ++i)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(Text(i))), NullCompletionHandler);
+
+  server.Start();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasReceived, boost::cref(*serverHandler), 6)));
+  BOOST_CHECK_EQUAL(clientHandler->connects, 2);
+  for (int i = 0; i <= 5; ++i)
+    BOOST_CHECK_EQUAL(serverHandler->received[i], Text(i));
+
+  client.ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -77,4 +77,66 @@ BOOST_AUTO_TEST_CASE(Test_Assignment)
     BOOST_CHECK( memcmp(b1.Get(), b2.Get(), b1.Size()) == 0 );
 }
 
+BOOST_AUTO_TEST_CASE(Test_Attach)
+{
+    char text[] = "123456789a";
+    boost::shared_ptr<int> owner(new int(0));
+
+    DataBuffer buffer(25);
+    buffer.Attach(text, 10, owner);
+
+    BOOST_CHECK( buffer.IsAttached() );
+    BOOST_CHECK_EQUAL( buffer.Size(), 10);
+    BOOST_CHECK( buffer.Get() == text );
+    BOOST_CHECK_EQUAL( owner.use_count(), 2 );
+
+    DataBuffer copy(buffer);
+    BOOST_CHECK( !copy.IsAttached() );
+    BOOST_CHECK( copy.Get() != text );
+
+    buffer.Resize(10);
+    BOOST_CHECK( !buffer.IsAttached() );
+    BOOST_CHECK( buffer.Get() != text );
+    BOOST_CHECK_EQUAL( owner.use_count(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE(Test_Resize_Keeps_Memory)
+{
+    DataBuffer buffer(100);
+    char * data = buffer.Get();
+
+    buffer.Resize(10);
+    BOOST_CHECK_EQUAL( buffer.Size(), 10u );
+    BOOST_CHECK( buffer.Get() == data );
+
+    buffer.Assign("12345", 5);
+    BOOST_CHECK_EQUAL( buffer.Size(), 5u );
+    BOOST_CHECK( buffer.Get() == data );
+
+    buffer.Resize(100);
+    BOOST_CHECK( buffer.Get() == data );
+
+    buffer.Resize(101);
+    BOOST_CHECK_EQUAL( buffer.Size(), 101u );
+}
+
+BOOST_AUTO_TEST_CASE(Test_Consume)
+{
+    DataBuffer buffer("header:body");
+    buffer.Consume(7);
+    BOOST_CHECK( buffer == DataBuffer("body") );
+
+    char text[] = "header:body";
+    boost::shared_ptr<int> owner(new int(0));
+    DataBuffer attached;
+    attached.Attach(text, 11, owner);
+    attached.Consume(7);
+    BOOST_CHECK( attached.IsAttached() );
+    BOOST_CHECK( attached.Get() == text + 7 );
+    BOOST_CHECK( attached == DataBuffer("body") );
+
+    attached.Consume(10);
+    BOOST_CHECK_EQUAL( attached.Size(), 0u );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/RoundRobinServer.hpp"
+#include "AsioExpress/ClientServer/RoundRobinStrategy.hpp"
+#include "AsioExpress/ClientServer/LeastOutstandingStrategy.hpp"
+#include "AsioExpress/ClientServer/WeightedStrategy.hpp"
+#include "AsioExpress/ClientServer/PowerOfTwoChoicesStrategy.hpp"
+#include "AsioExpress/ClientServer/ConsistentHashStrategy.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+
+namespace
+{
+  typedef std::map<MessagePortId, int> CountMap;
+
+  CountMap Count(DispatchStrategy & strategy, int selects)
+  {
+    CountMap counts;
+    for (int i = 0; i < selects; ++i)
+      ++counts[strategy.Select(std::string())];
+    return counts;
+  }
+
+  std::string Key(int index)
+  {
+    std::ostringstream key;
+    key << "key" << index;
+    return key.str();
+  }
+
+  // Records the sends and holds the listener the way a server would.
+  class ServerStub : public ServerInterface
+  {
+  public:
+    virtual void Start()
+    {
+    }
+
+    virtual void Stop()
+    {
+    }
+
+    virtual void GetIds(MessagePortIdList &) const
+    {
+      BOOST_ERROR("The ids should not be listed for each send.");
+    }
+
+    virtual void AsyncSend(
+        MessagePortId id,
+        DataBufferPointer,
+        AsioExpress::CompletionHandler)
+    {
+      sent.push_back(id);
+    }
+
+    virtual void AsyncBroadcast(
+        DataBufferPointer,
+        AsioExpress::CompletionHandler)
+    {
+    }
+
+    virtual void AsyncBroadcast(
+        DataBufferPointer,
+        BroadcastResultPointer,
+        unsigned int,
+        AsioExpress::CompletionHandler)
+    {
+    }
+
+    virtual void AsyncSendMany(
+        SendList const &,
+        AsioExpress::CompletionHandler)
+    {
+    }
+
+    virtual void AsyncSendMany(
+        SendList const &,
+        SendManyResultPointer,
+        AsioExpress::CompletionHandler)
+    {
+    }
+
+    virtual std::string GetAddress(MessagePortId) const
+    {
+      return std::string();
+    }
+
+    virtual bool GetStatistics(MessagePortId, PortStatistics &) const
+    {
+      return false;
+    }
+
+    virtual void AddListener(ConnectionListenerPointer listener)
+    {
+      this->listener = listener;
+      listener->Connected(1);
+    }
+
+    ConnectionListenerPointer   listener;
+    MessagePortIdList           sent;
+  };
+}
+
+BOOST_AUTO_TEST_SUITE(DispatchStrategyTest)
+
+BOOST_AUTO_TEST_CASE(Test_Round_Robin)
+{
+  RoundRobinStrategy strategy;
+  BOOST_CHECK_EQUAL(strategy.Select(std::string()), InvalidMessagePortId);
+
+  for (MessagePortId id = 1; id <= 4; ++id)
+    strategy.Add(id);
+
+  CountMap counts = Count(strategy, 40);
+  BOOST_REQUIRE_EQUAL(counts.size(), 4u);
+  for (MessagePortId id = 1; id <= 4; ++id)
+    BOOST_CHECK_EQUAL(counts[id], 10);
+
+  strategy.Remove(2);
+  counts = Count(strategy, 30);
+  BOOST_CHECK_EQUAL(counts.count(2), 0u);
+  BOOST_CHECK_EQUAL(counts[1], 10);
+  BOOST_CHECK_EQUAL(counts[3], 10);
+  BOOST_CHECK_EQUAL(counts[4], 10);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Least_Outstanding)
+{
+  LeastOutstandingStrategy strategy;
+  strategy.Add(1);
+  strategy.Add(2);
+  strategy.Add(3);
+
+  // Each port gets one message before any gets a second.
+  std::set<MessagePortId> first;
+  for (int i = 0; i < 3; ++i)
+    first.insert(strategy.Select(std::string()));
+  BOOST_CHECK_EQUAL(first.size(), 3u);
+
+  strategy.Completed(2);
+  BOOST_CHECK_EQUAL(strategy.Select(std::string()), 2);
+  BOOST_CHECK_EQUAL(strategy.GetOutstanding(2), 1u);
+
+  strategy.Completed(1);
+  strategy.Completed(1);
+  strategy.Completed(1);
+  BOOST_CHECK_EQUAL(strategy.GetOutstanding(1), 0u);
+  BOOST_CHECK_EQUAL(strategy.Select(std::string()), 1);
+
+  strategy.Remove(1);
+  BOOST_CHECK(strategy.Select(std::string()) != 1);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Weighted)
+{
+  WeightedStrategy strategy;
+  strategy.Add(1);
+  strategy.Add(2);
+  strategy.Add(3);
+  strategy.SetWeight(2, 2);
+  strategy.SetWeight(3, 3);
+
+  CountMap counts = Count(strategy, 600);
+  BOOST_CHECK(counts[1] >= 99 && counts[1] <= 101);
+  BOOST_CHECK(counts[2] >= 199 && counts[2] <= 201);
+  BOOST_CHECK(counts[3] >= 299 && counts[3] <= 301);
+
+  // A port joining late is not given the turns it missed.
+  strategy.Add(4);
+  counts = Count(strategy, 7);
+  BOOST_CHECK_EQUAL(counts[4], 1);
+
+  // A heavier port would get a stride of zero and take every turn.
+  BOOST_CHECK_THROW(
+        strategy.SetWeight(1, (1u << 20) + 1),
+        AsioExpress::ContractViolationException);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Power_Of_Two_Choices)
+{
+  PowerOfTwoChoicesStrategy strategy;
+  for (MessagePortId id = 1; id <= 100; ++id)
+    strategy.Add(id);
+
+  Count(strategy, 10000);
+
+  unsigned least = strategy.GetOutstanding(1);
+  unsigned most = least;
+  for (MessagePortId id = 2; id <= 100; ++id)
+  {
+    least = std::min(least, strategy.GetOutstanding(id));
+    most = std::max(most, strategy.GetOutstanding(id));
+  }
+  // Picking one port at random would leave a spread of around fifty.
+  BOOST_CHECK(most - least <= 8);
+
+  strategy.Remove(50);
+  for (int i = 0; i < 1000; ++i)
+    BOOST_REQUIRE(strategy.Select(std::string()) != 50);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Consistent_Hash)
+{
+  ConsistentHashStrategy strategy;
+  for (MessagePortId id = 1; id <= 10; ++id)
+    strategy.Add(id);
+
+  std::map<int, MessagePortId> owners;
+  CountMap counts;
+  for (int i = 0; i < 1000; ++i)
+  {
+    owners[i] = strategy.Select(Key(i));
+    ++counts[owners[i]];
+    BOOST_REQUIRE_EQUAL(strategy.Select(Key(i)), owners[i]);
+  }
+  BOOST_CHECK_EQUAL(counts.size(), 10u);
+
+  // Only the keys of the port that left move.
+  strategy.Remove(3);
+  for (int i = 0; i < 1000; ++i)
+  {
+    MessagePortId owner = strategy.Select(Key(i));
+    if (owners[i] == 3)
+      BOOST_CHECK(owner != 3);
+    else
+      BOOST_CHECK_EQUAL(owner, owners[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Test_Round_Robin_Server_Follows_Connections)
+{
+  boost::shared_ptr<ServerStub> server(new ServerStub);
+  RoundRobinServer roundRobin(server);
+
+  // Ports connected before the round robin started are included.
+  BOOST_REQUIRE(server->listener);
+  server->listener->Connected(2);
+  server->listener->Connected(3);
+
+  DataBufferPointer buffer(new DataBuffer("Hello"));
+  for (int i = 0; i < 6; ++i)
+    roundRobin.AsyncSendRoundRobin(buffer, NullCompletionHandler);
+
+  CountMap counts;
+  for (std::size_t i = 0; i < server->sent.size(); ++i)
+    ++counts[server->sent[i]];
+  BOOST_CHECK_EQUAL(counts[1], 2);
+  BOOST_CHECK_EQUAL(counts[2], 2);
+  BOOST_CHECK_EQUAL(counts[3], 2);
+
+  server->listener->Disconnected(1);
+  server->listener->Disconnected(2);
+  server->listener->Disconnected(3);
+
+  BOOST_CHECK_EQUAL(roundRobin.AsyncSendRoundRobin(buffer, NullCompletionHandler), InvalidMessagePortId);
+  BOOST_CHECK_EQUAL(server->sent.back(), InvalidMessagePortId);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,369 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/FailoverMessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const FirstTcpPort = "47315";
+  char const * const SecondTcpPort = "47316";
+  char const * const UnusedTcpPort = "47317";
+
+  AsioExpress::Error const Failed(boost::asio::error::connection_reset);
+
+  // Stands in for the client of one end point.
+  class StubClient : public ClientInterface
+  {
+  public:
+    StubClient() :
+      connects(0)
+    {
+    }
+
+    virtual void Connect()
+    {
+      ++connects;
+    }
+
+    virtual void Disconnect()
+    {
+    }
+
+    virtual void ShutDown()
+    {
+    }
+
+    virtual void AsyncSend(
+        DataBufferPointer buffer,
+        AsioExpress::CompletionHandler completionHandler)
+    {
+      sent.push_back(buffer);
+      handlers.push_back(completionHandler);
+    }
+
+    virtual std::string GetAddress() const
+    {
+      return "stub";
+    }
+
+    virtual bool GetStatistics(PortStatistics &) const
+    {
+      return false;
+    }
+
+    int                                           connects;
+    std::vector<DataBufferPointer>                sent;
+    std::vector<AsioExpress::CompletionHandler>   handlers;
+  };
+
+  typedef boost::shared_ptr<StubClient> StubClientPointer;
+
+  // Sends every message straight back.
+  class EchoHandler : public ServerEventHandler
+  {
+  public:
+    EchoHandler() :
+      count(0)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      ++count;
+      message.AsyncSend(
+        message.GetMessagePortId(),
+        DataBufferPointer(new DataBuffer(*message.GetDataBuffer())),
+        NullCompletionHandler);
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int count;
+  };
+
+  class CountingHandler : public ClientEventHandler
+  {
+  public:
+    CountingHandler() :
+      connects(0),
+      disconnects(0),
+      messages(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+      ++disconnects;
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      ++messages;
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int disconnects;
+    int messages;
+  };
+
+  std::string Text(DataBuffer const & buffer)
+  {
+    return std::string(buffer.Get(), buffer.Size());
+  }
+
+  bool HasSent(StubClient const & client, std::size_t count)
+  {
+    return client.sent.size() >= count;
+  }
+
+  bool IsCompleted(TestCompletionHandler & handler, int calls)
+  {
+    return handler.Calls() >= calls;
+  }
+}
+
+struct FailoverClientFixture : UnitTestModeFixture
+{
+  FailoverClientFixture() :
+    failoverClient(new FailoverClient(ioService))
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      clients.push_back(StubClientPointer(new StubClient));
+      failoverClient->AddEndPoint(clients[i]);
+    }
+    failoverClient->SetReplyKey(Text);
+    failoverClient->Start(1000);
+  }
+
+  ~FailoverClientFixture()
+  {
+    failoverClient->Stop();
+    ioService.reset();
+    ioService.poll();
+  }
+
+  DataBufferPointer Buffer(std::string const & text)
+  {
+    return DataBufferPointer(new DataBuffer(text));
+  }
+
+  boost::asio::io_service             ioService;
+  FailoverClientPointer               failoverClient;
+  std::vector<StubClientPointer>      clients;
+};
+
+BOOST_FIXTURE_TEST_SUITE(FailoverMessagePortClientTest, FailoverClientFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Fails_Over_To_Next_Best)
+{
+  BOOST_CHECK_EQUAL(clients[0]->connects, 1);
+  BOOST_CHECK_EQUAL(failoverClient->GetBest(), -1);
+
+  // The end point that connects quicker is preferred.
+  failoverClient->Connected(1);
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+  failoverClient->Connected(0);
+  BOOST_CHECK(failoverClient->GetLatency(0) > failoverClient->GetLatency(1));
+  BOOST_CHECK_EQUAL(failoverClient->GetBest(), 1);
+
+  TestCompletionHandler handler;
+  DataBufferPointer reply(new DataBuffer);
+  failoverClient->AsyncRequest("first", Buffer("first"), reply, handler);
+  BOOST_REQUIRE_EQUAL(clients[1]->sent.size(), 1u);
+
+  // The request is sent again as soon as its connection is lost.
+  BOOST_CHECK(failoverClient->Disconnected(1, Failed));
+  BOOST_REQUIRE_EQUAL(clients[0]->sent.size(), 1u);
+  BOOST_CHECK_EQUAL(failoverClient->GetBest(), 0);
+
+  BOOST_CHECK(failoverClient->Replied(0, DataBuffer("first")));
+  ioService.poll();
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(*reply == DataBuffer("first"));
+
+  // An end point that never connected is not reported as disconnected.
+  BOOST_CHECK(!failoverClient->Disconnected(2, Failed));
+  BOOST_CHECK(!failoverClient->Replied(0, DataBuffer("other")));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Send_Fails_Over)
+{
+  TestCompletionHandler handler;
+  failoverClient->AsyncSend(Buffer("message"), handler);
+  ioService.poll();
+  BOOST_REQUIRE_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), ErrorCode::MessagePortNoEndPoint);
+
+  failoverClient->Connected(0);
+  failoverClient->Connected(2);
+  int best = failoverClient->GetBest();
+  int other = 2 - best;
+  failoverClient->AsyncSend(Buffer("message"), handler);
+  BOOST_REQUIRE_EQUAL(clients[best]->sent.size(), 1u);
+
+  clients[best]->handlers[0](Failed);
+  BOOST_REQUIRE_EQUAL(clients[other]->sent.size(), 1u);
+  BOOST_CHECK(*clients[other]->sent[0] == DataBuffer("message"));
+
+  // Once every end point has failed the last error is reported.
+  clients[other]->handlers[0](Failed);
+  ioService.reset();
+  ioService.poll();
+  BOOST_REQUIRE_EQUAL(handler.Calls(), 2);
+  BOOST_CHECK_EQUAL(handler.LastError().GetErrorCode(), boost::asio::error::connection_reset);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Hedged_Request)
+{
+  failoverClient->SetHedging(true);
+  failoverClient->Connected(0);
+  failoverClient->Connected(1);
+
+  // Requests are not hedged until the reply times are known.
+  BOOST_CHECK_EQUAL(failoverClient->GetHedgeDelay(), 0u);
+  for (int i = 0; i < 20; ++i)
+  {
+    std::string key(1, static_cast<char>('a' + i));
+    int best = failoverClient->GetBest();
+    failoverClient->AsyncRequest(key, Buffer(key), DataBufferPointer(new DataBuffer), NullCompletionHandler);
+    BOOST_CHECK(failoverClient->Replied(best, DataBuffer(key)));
+  }
+  BOOST_CHECK(failoverClient->GetHedgeDelay() >= 1u);
+
+  int best = failoverClient->GetBest();
+  int other = 1 - best;
+  std::size_t sent = clients[other]->sent.size();
+
+  TestCompletionHandler handler;
+  DataBufferPointer reply(new DataBuffer);
+  failoverClient->AsyncRequest("slow", Buffer("slow"), reply, handler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasSent, boost::cref(*clients[other]), sent + 1)));
+  BOOST_CHECK(*clients[other]->sent.back() == DataBuffer("slow"));
+
+  // The first reply is taken and the second dropped.
+  BOOST_CHECK(failoverClient->Replied(other, DataBuffer("slow")));
+  BOOST_CHECK(failoverClient->Replied(best, DataBuffer("slow")));
+  BOOST_CHECK(!failoverClient->Replied(best, DataBuffer("slow")));
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(handler.Calls(), 1);
+  BOOST_CHECK(*reply == DataBuffer("slow"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Failover)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef FailoverMessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service::work work(ioService);
+
+  EchoHandler * firstHandler = new EchoHandler;
+  ServerType first(ioService, Tcp::EndPoint(TcpAddress, FirstTcpPort), firstHandler);
+  first.Start();
+
+  EchoHandler * secondHandler = new EchoHandler;
+  ServerType second(ioService, Tcp::EndPoint(TcpAddress, SecondTcpPort), secondHandler);
+  second.Start();
+
+  ClientType::EndPointList endPoints;
+  endPoints.push_back(Tcp::EndPoint(TcpAddress, UnusedTcpPort));
+  endPoints.push_back(Tcp::EndPoint(TcpAddress, FirstTcpPort));
+  endPoints.push_back(Tcp::EndPoint(TcpAddress, SecondTcpPort));
+
+  CountingHandler * clientHandler = new CountingHandler;
+  ClientType client(ioService, endPoints, clientHandler);
+  client.SetReplyKey(Text);
+  client.SetHealthCheckInterval(20);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 2)));
+  BOOST_CHECK(!client.GetAddress().empty());
+
+  TestCompletionHandler handler;
+  DataBufferPointer reply(new DataBuffer);
+  client.AsyncRequest("first", DataBufferPointer(new DataBuffer("first")), reply, handler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(handler), 1)));
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(*reply == DataBuffer("first"));
+
+  // Stop whichever server answered; the next request goes to the other.
+  bool isFirst = firstHandler->count == 1;
+  if (isFirst)
+    first.Stop();
+  else
+    second.Stop();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->disconnects), 1)));
+
+  client.AsyncRequest("second", DataBufferPointer(new DataBuffer("second")), reply, handler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(handler), 2)));
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(*reply == DataBuffer("second"));
+  BOOST_CHECK_EQUAL((isFirst ? secondHandler : firstHandler)->count, 1);
+
+  // Neither the replies nor the failed health checks reach the handler.
+  BOOST_CHECK_EQUAL(clientHandler->messages, 0);
+  BOOST_CHECK_EQUAL(clientHandler->disconnects, 1);
+
+  client.ShutDown();
+  first.Stop();
+  second.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,475 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <algorithm>
+#include <deque>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/ClientServer/private/FairScheduler.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47326";
+
+  typedef std::vector<MessagePortId> TurnList;
+  typedef boost::chrono::steady_clock Clock;
+
+  void RecordTurn(TurnList & turns, MessagePortId id, AsioExpress::Error error)
+  {
+    if (!error)
+      turns.push_back(id);
+  }
+
+  void CountAborted(int & aborted, AsioExpress::Error error)
+  {
+    if (error.GetErrorCode() == boost::asio::error::operation_aborted)
+      ++aborted;
+  }
+
+  void WaitForTurn(
+      FairScheduler & scheduler,
+      TurnList & turns,
+      MessagePortId id,
+      std::size_t size)
+  {
+    scheduler.AsyncWaitForTurn(id, size, boost::bind(RecordTurn, boost::ref(turns), id, _1));
+  }
+
+  // Ends each turn in the handler once it has begun.
+  void RunTurns(boost::asio::io_service & ioService, FairScheduler & scheduler, TurnList & turns, std::size_t count)
+  {
+    ioService.poll();
+    ioService.reset();
+    while (turns.size() < count)
+    {
+      std::size_t begun = turns.size();
+      scheduler.EndTurn();
+      ioService.poll();
+      ioService.reset();
+      if (turns.size() == begun)
+        break;
+    }
+  }
+
+  void IgnoreError(AsioExpress::Error)
+  {
+  }
+
+  ///
+  /// Stands for a back end that does one message at a time, each taking a
+  /// millisecond. Messages beginning with 'q' are answered when done.
+  ///
+  class WorkerServerHandler : public ServerEventHandler
+  {
+  public:
+    WorkerServerHandler(boost::asio::io_service & ioService) :
+      connects(0),
+      noisyDone(0),
+      m_timer(ioService),
+      m_isBusy(false)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      m_queue.push_back(message);
+      if (!m_isBusy)
+        StartNext();
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    bool IsBusy() const
+    {
+      return m_isBusy;
+    }
+
+    int connects;
+    int noisyDone;
+
+  private:
+    void StartNext()
+    {
+      m_isBusy = true;
+      m_timer.expires_from_now(boost::posix_time::milliseconds(1));
+      m_timer.async_wait(boost::bind(&WorkerServerHandler::Done, this, _1));
+    }
+
+    void Done(boost::system::error_code error)
+    {
+      if (error)
+        return;
+
+      ServerMessage message = m_queue.front();
+      m_queue.pop_front();
+
+      if (message.GetDataBuffer()->Get()[0] == 'q')
+      {
+        DataBufferPointer answer(new DataBuffer(std::string("q")));
+        message.AsyncSend(message.GetMessagePortId(), answer, IgnoreError);
+      }
+      else
+        ++noisyDone;
+      message.CallCompletionHandler(AsioExpress::Error());
+
+      if (m_queue.empty())
+        m_isBusy = false;
+      else
+        StartNext();
+    }
+
+    std::deque<ServerMessage>       m_queue;
+    boost::asio::deadline_timer     m_timer;
+    bool                            m_isBusy;
+  };
+
+  /// Sends a ping after each answer and times the round trips.
+  class QuietClientHandler : public ClientEventHandler
+  {
+  public:
+    QuietClientHandler(std::size_t pingCount) :
+      connects(0),
+      m_pingCount(pingCount)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      latencies.push_back(
+        boost::chrono::duration_cast<boost::chrono::microseconds>(Clock::now() - m_sentAt).count());
+      if (latencies.size() < m_pingCount)
+        Ping(*message.GetClient());
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    void Ping(ClientInterface & client)
+    {
+      m_sentAt = Clock::now();
+      client.AsyncSend(DataBufferPointer(new DataBuffer(std::string("q"))), IgnoreError);
+    }
+
+    bool IsDone() const
+    {
+      return latencies.size() >= m_pingCount;
+    }
+
+    int connects;
+    std::vector<boost::int64_t> latencies;
+
+  private:
+    std::size_t         m_pingCount;
+    Clock::time_point   m_sentAt;
+  };
+
+  class NoisyClientHandler : public ClientEventHandler
+  {
+  public:
+    NoisyClientHandler() :
+      connects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+  };
+
+  /// Keeps sending as fast as the connection takes messages.
+  struct NoisySender
+  {
+    NoisySender(ClientInterface & client) :
+      client(client),
+      isStopped(false),
+      sent(0),
+      pending(0)
+    {
+    }
+
+    void Send()
+    {
+      ++pending;
+      client.AsyncSend(
+        DataBufferPointer(new DataBuffer(std::string(256, 'n'))),
+        boost::bind(&NoisySender::Sent, this, _1));
+    }
+
+    void Sent(AsioExpress::Error error)
+    {
+      --pending;
+      if (error)
+        return;
+      ++sent;
+      if (!isStopped)
+        Send();
+    }
+
+    ClientInterface &   client;
+    bool                isStopped;
+    int                 sent;
+    int                 pending;
+  };
+
+  // Runs handlers as they become ready, so the timings are not held up.
+  template<typename Condition>
+  bool RunBusyUntil(boost::asio::io_service & ioService, Condition condition)
+  {
+    Clock::time_point deadline = Clock::now() + boost::chrono::seconds(20);
+    while (!condition() && Clock::now() < deadline)
+    {
+      if (ioService.poll() == 0)
+        boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+      ioService.reset();
+    }
+    return condition();
+  }
+
+  bool AreQuietDone(QuietClientHandler const & first, QuietClientHandler const & second)
+  {
+    return first.IsDone() && second.IsDone();
+  }
+
+  bool IsWorkDone(WorkerServerHandler const & handler, NoisySender const & sender)
+  {
+    return sender.pending == 0 && handler.noisyDone == sender.sent && !handler.IsBusy();
+  }
+
+  boost::int64_t Percentile99(std::vector<boost::int64_t> samples)
+  {
+    std::sort(samples.begin(), samples.end());
+    std::size_t index = (samples.size() * 99 + 99) / 100 - 1;
+    return samples[index];
+  }
+
+  ///
+  /// Times the round trips of two quiet clients while a noisy one floods
+  /// the server, and returns the 99th percentile in microseconds.
+  ///
+  boost::int64_t QuietClientPercentile99(bool isFair)
+  {
+    typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+    typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+    std::size_t const PingCount = 50;
+
+    boost::asio::io_service ioService;
+    boost::asio::io_service::work work(ioService);
+
+    WorkerServerHandler * serverHandler = new WorkerServerHandler(ioService);
+    ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+    server.SetMessageWindow(16);
+    if (isFair)
+      server.SetFairScheduling(1, 256);
+    server.Start();
+
+    NoisyClientHandler * noisyHandler = new NoisyClientHandler;
+    ClientType noisy(ioService, Tcp::EndPoint(TcpAddress, TcpPort), noisyHandler);
+    noisy.Connect();
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(noisyHandler->connects), 1)));
+
+    QuietClientHandler * firstHandler = new QuietClientHandler(PingCount);
+    ClientType first(ioService, Tcp::EndPoint(TcpAddress, TcpPort), firstHandler);
+    first.Connect();
+    QuietClientHandler * secondHandler = new QuietClientHandler(PingCount);
+    ClientType second(ioService, Tcp::EndPoint(TcpAddress, TcpPort), secondHandler);
+    second.Connect();
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 3)));
+
+    NoisySender sender(noisy);
+    for (int i = 0; i < 32; ++i)
+      sender.Send();
+
+    // Let the noisy client fill its window before the quiet ones start.
+    RunBusyUntil(ioService, boost::bind(IsAtLeast, boost::cref(sender.sent), 64));
+
+    firstHandler->Ping(first);
+    secondHandler->Ping(second);
+    BOOST_REQUIRE(RunBusyUntil(ioService, boost::bind(AreQuietDone, boost::cref(*firstHandler), boost::cref(*secondHandler))));
+
+    sender.isStopped = true;
+    BOOST_REQUIRE(RunBusyUntil(ioService, boost::bind(IsWorkDone, boost::cref(*serverHandler), boost::cref(sender))));
+
+    std::vector<boost::int64_t> latencies(firstHandler->latencies);
+    latencies.insert(latencies.end(), secondHandler->latencies.begin(), secondHandler->latencies.end());
+
+    noisy.ShutDown();
+    first.ShutDown();
+    second.ShutDown();
+    server.Stop();
+    ioService.poll();
+
+    return Percentile99(latencies);
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(FairSchedulerTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Connections_Take_Turns)
+{
+  boost::asio::io_service ioService;
+  FairScheduler scheduler(ioService, 1, 100);
+  TurnList turns;
+
+  for (int i = 0; i < 4; ++i)
+    WaitForTurn(scheduler, turns, 1, 100);
+  for (int i = 0; i < 2; ++i)
+    WaitForTurn(scheduler, turns, 2, 100);
+  BOOST_CHECK_EQUAL(scheduler.GetWaitingMessages(), 5u);
+
+  RunTurns(ioService, scheduler, turns, 6);
+
+  MessagePortId const expected[] = { 1, 1, 2, 1, 2, 1 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(turns.begin(), turns.end(), expected, expected + 6);
+  BOOST_CHECK_EQUAL(scheduler.GetWaitingMessages(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Weights_And_Sizes)
+{
+  boost::asio::io_service ioService;
+  FairScheduler scheduler(ioService, 1, 100);
+  TurnList turns;
+
+  scheduler.SetWeight(1, 2);
+  BOOST_CHECK_EQUAL(scheduler.GetWeight(1), 2u);
+  BOOST_CHECK_EQUAL(scheduler.GetWeight(2), 1u);
+
+  // The first message holds the handler while the others queue.
+  WaitForTurn(scheduler, turns, 9, 1);
+  for (int i = 0; i < 4; ++i)
+    WaitForTurn(scheduler, turns, 1, 100);
+  for (int i = 0; i < 4; ++i)
+    WaitForTurn(scheduler, turns, 2, 100);
+
+  // A message larger than the quantum waits for the allowance of two turns.
+  WaitForTurn(scheduler, turns, 3, 200);
+
+  RunTurns(ioService, scheduler, turns, 10);
+
+  MessagePortId const expected[] = { 9, 1, 1, 2, 1, 1, 2, 3, 2, 2 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(turns.begin(), turns.end(), expected, expected + 10);
+
+  // The weight goes with the connection.
+  scheduler.Disconnected(1);
+  BOOST_CHECK_EQUAL(scheduler.GetWeight(1), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Stop_Aborts_Waiting)
+{
+  boost::asio::io_service ioService;
+  FairScheduler scheduler(ioService, 1, 100);
+  TurnList turns;
+  int aborted = 0;
+
+  WaitForTurn(scheduler, turns, 1, 10);
+  scheduler.AsyncWaitForTurn(1, 10, boost::bind(CountAborted, boost::ref(aborted), _1));
+  scheduler.AsyncWaitForTurn(2, 10, boost::bind(CountAborted, boost::ref(aborted), _1));
+  scheduler.Stop();
+  ioService.poll();
+  ioService.reset();
+
+  BOOST_CHECK_EQUAL(turns.size(), 1u);
+  BOOST_CHECK_EQUAL(aborted, 2);
+  BOOST_CHECK_EQUAL(scheduler.GetWaitingMessages(), 0u);
+
+  // A stopped scheduler aborts at once until it is started again.
+  scheduler.AsyncWaitForTurn(3, 10, boost::bind(CountAborted, boost::ref(aborted), _1));
+  ioService.poll();
+  ioService.reset();
+  BOOST_CHECK_EQUAL(aborted, 3);
+
+  scheduler.EndTurn();
+  scheduler.Start();
+  WaitForTurn(scheduler, turns, 3, 10);
+  ioService.poll();
+  BOOST_CHECK_EQUAL(turns.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Quiet_Client_Latency)
+{
+  // The quiet clients wait behind the noisy client's window without fair
+  // scheduling, and behind at most one of its messages with it. Timings
+  // depend on the machine's load, so they are only reported; the turn
+  // order is checked by the tests above.
+  boost::int64_t unfair = QuietClientPercentile99(false);
+  boost::int64_t fair = QuietClientPercentile99(true);
+
+  BOOST_TEST_MESSAGE("Quiet client p99 round trip: " << unfair << " us without fair scheduling, "
+    << fair << " us with it.");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
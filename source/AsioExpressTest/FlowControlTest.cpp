@@ -0,0 +1,388 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/FlowControl.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47328";
+  int const MessageCount = 10;
+
+  void CountSent(int & calls, int & errors, AsioExpress::Error error)
+  {
+    ++calls;
+    if (error)
+      ++errors;
+  }
+
+  void SetError(AsioExpress::Error & result, AsioExpress::Error error)
+  {
+    result = error;
+  }
+
+  void IgnoreError(AsioExpress::Error)
+  {
+  }
+
+  /// Pushes messages to the client for each request before replying. The
+  /// request is only completed once the reply has been sent.
+  class PushingServerHandler : public ServerEventHandler
+  {
+  public:
+    PushingServerHandler(int pushCount) :
+      connects(0),
+      m_pushCount(pushCount)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      for (int push = 0; push < m_pushCount; ++push)
+      {
+        message.AsyncSend(
+          message.GetMessagePortId(), 
+          DataBufferPointer(new DataBuffer("push")), 
+          IgnoreError);
+      }
+
+      message.AsyncSend(
+        message.GetMessagePortId(), 
+        DataBufferPointer(new DataBuffer("reply")), 
+        message.GetCompletionHandler());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+
+  private:
+    int m_pushCount;
+  };
+
+  class CountingClientHandler : public ClientEventHandler
+  {
+  public:
+    CountingClientHandler() :
+      connects(0),
+      received(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      ++received;
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int received;
+  };
+
+  bool WasCalled(TestCompletionHandler & handler)
+  {
+    return handler.Calls() > 0;
+  }
+
+  SendQueue::Item MakeItem(std::string const & text, AsioExpress::Error & error)
+  {
+    return SendQueue::Item(
+      DataBufferPointer(new DataBuffer(text)),
+      boost::bind(SetError, boost::ref(error), _1));
+  }
+
+  struct Connection
+  {
+    Connection(
+        boost::asio::io_service & ioService,
+        Tcp::EndPoint const & endPoint) :
+      acceptor(ioService, endPoint),
+      server(ioService),
+      client(ioService)
+    {
+      TestCompletionHandler accepted;
+      TestCompletionHandler connected;
+      acceptor.AsyncAccept(server, accepted);
+      client.AsyncConnect(endPoint, connected);
+      BOOST_REQUIRE(RunUntil(ioService, boost::bind(WasCalled, boost::ref(accepted))));
+      BOOST_REQUIRE(RunUntil(ioService, boost::bind(WasCalled, boost::ref(connected))));
+      BOOST_REQUIRE(!accepted.LastError());
+      BOOST_REQUIRE(!connected.LastError());
+    }
+
+    Tcp::BasicMessagePortAcceptor acceptor;
+    Tcp::BasicMessagePort server;
+    Tcp::BasicMessagePort client;
+  };
+
+  // Receives a message, waiting for it to arrive.
+  std::string Receive(boost::asio::io_service & ioService, Tcp::BasicMessagePort & port)
+  {
+    TestCompletionHandler received;
+    DataBufferPointer buffer(new DataBuffer);
+    port.AsyncReceive(buffer, received);
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(WasCalled, boost::ref(received))));
+    BOOST_REQUIRE(!received.LastError());
+    return std::string(buffer->Get(), buffer->Size());
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(FlowControlTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Message_Credits)
+{
+  FlowControlSettings settings;
+  settings.credits = 4;
+  FlowControl flowControl(settings);
+
+  AsioExpress::Error error;
+  SendQueue::Item item = MakeItem("a", error);
+  boost::uint32_t grant = 0;
+
+  // The first credits are granted to the peer before anything is sent.
+  BOOST_CHECK(flowControl.IsGrantDue());
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(item, grant), FlowControl::SendGrant);
+  BOOST_CHECK_EQUAL(grant, 4u);
+  BOOST_CHECK(!flowControl.IsGrantDue());
+
+  // Until the peer grants some, the item waits.
+  SendQueue::Item held;
+  BOOST_REQUIRE(flowControl.TakeHeldItem(held));
+  BOOST_CHECK(!flowControl.TakeHeldItem(held));
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(held, grant), FlowControl::Wait);
+  BOOST_CHECK(flowControl.AddCredits(4));
+  BOOST_CHECK(!flowControl.TakeWaitingSend());
+
+  BOOST_REQUIRE(flowControl.TakeHeldItem(held));
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(held, grant), FlowControl::SendItem);
+  BOOST_CHECK_EQUAL(grant, 0u);
+  BOOST_CHECK_EQUAL(flowControl.GetCredits(), 3);
+
+  // Received messages are granted back with the next send.
+  BOOST_CHECK(!flowControl.Received(1));
+  BOOST_CHECK(!flowControl.IsGrantDue());
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(item, grant), FlowControl::SendItem);
+  BOOST_CHECK_EQUAL(grant, 1u);
+  BOOST_CHECK_EQUAL(flowControl.GetCredits(), 2);
+
+  // A send waiting for credits is taken over once a grant is due.
+  flowControl.BeginSend(item, grant);
+  flowControl.BeginSend(item, grant);
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(item, grant), FlowControl::Wait);
+  BOOST_CHECK(!flowControl.Received(1));
+  BOOST_CHECK(flowControl.Received(1));
+  BOOST_REQUIRE(flowControl.TakeHeldItem(held));
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(held, grant), FlowControl::SendGrant);
+  BOOST_CHECK_EQUAL(grant, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Byte_Credits_And_Abort)
+{
+  boost::asio::io_service ioService;
+
+  FlowControlSettings settings;
+  settings.credits = 8;
+  settings.unit = FlowControlSettings::ByteCredits;
+  FlowControl flowControl(settings);
+  flowControl.AddCredits(8);
+
+  AsioExpress::Error error;
+  boost::uint32_t grant = 0;
+
+  // The last credit lets a message larger than it through.
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(MakeItem("12345", error), grant), FlowControl::SendItem);
+  BOOST_CHECK_EQUAL(grant, 8u);
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(MakeItem("12345", error), grant), FlowControl::SendItem);
+  BOOST_CHECK_EQUAL(flowControl.GetCredits(), -2);
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(MakeItem("1", error), grant), FlowControl::Wait);
+  BOOST_CHECK(!flowControl.AddCredits(2));
+  BOOST_CHECK_EQUAL(flowControl.GetCredits(), 0);
+
+  // Aborting fails the held item and hands back the waiting send. Later
+  // sends need no credits.
+  BOOST_CHECK(flowControl.Abort(ioService, AsioExpress::Error(boost::asio::error::operation_aborted)));
+  ioService.poll();
+  BOOST_CHECK(error.GetErrorCode() == boost::asio::error::operation_aborted);
+  BOOST_CHECK_EQUAL(flowControl.BeginSend(MakeItem("1", error), grant), FlowControl::SendItem);
+  BOOST_CHECK(!flowControl.Received(8));
+  BOOST_CHECK(!flowControl.IsGrantDue());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Sends_Wait_For_Receives)
+{
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint endPoint(TcpAddress, TcpPort);
+  endPoint.SetFlowControl(4);
+  Connection connection(ioService, endPoint);
+
+  // The client reads the grants the server sends.
+  TestCompletionHandler clientReceived;
+  connection.client.AsyncReceive(DataBufferPointer(new DataBuffer), clientReceived);
+
+  int sent = 0;
+  int errors = 0;
+  for (int message = 0; message < MessageCount; ++message)
+  {
+    connection.client.AsyncSend(
+      DataBufferPointer(new DataBuffer(boost::lexical_cast<std::string>(message))),
+      boost::bind(CountSent, boost::ref(sent), boost::ref(errors), _1));
+  }
+
+  // Only the credits are sent while the server receives nothing.
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), 4)));
+  RunFor(ioService, 100);
+  BOOST_CHECK_EQUAL(sent, 4);
+
+  // Half the credits received are granted back.
+  BOOST_CHECK_EQUAL(Receive(ioService, connection.server), "0");
+  RunFor(ioService, 50);
+  BOOST_CHECK_EQUAL(sent, 4);
+  BOOST_CHECK_EQUAL(Receive(ioService, connection.server), "1");
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), 6)));
+  RunFor(ioService, 50);
+  BOOST_CHECK_EQUAL(sent, 6);
+
+  for (int message = 2; message < MessageCount; ++message)
+    BOOST_CHECK_EQUAL(Receive(ioService, connection.server), boost::lexical_cast<std::string>(message));
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), MessageCount)));
+  BOOST_CHECK_EQUAL(errors, 0);
+  BOOST_CHECK_EQUAL(clientReceived.Calls(), 0);
+
+  connection.client.Disconnect();
+  connection.server.Disconnect();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Byte_Credits_From_Server)
+{
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint endPoint(TcpAddress, TcpPort);
+  endPoint.SetFlowControl(10, FlowControlSettings::ByteCredits);
+  Connection connection(ioService, endPoint);
+
+  TestCompletionHandler serverReceived;
+  connection.server.AsyncReceive(DataBufferPointer(new DataBuffer), serverReceived);
+
+  int sent = 0;
+  int errors = 0;
+  for (int message = 0; message < MessageCount; ++message)
+  {
+    connection.server.AsyncSend(
+      DataBufferPointer(new DataBuffer("abcde")),
+      boost::bind(CountSent, boost::ref(sent), boost::ref(errors), _1));
+  }
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), 2)));
+  RunFor(ioService, 100);
+  BOOST_CHECK_EQUAL(sent, 2);
+
+  BOOST_CHECK_EQUAL(Receive(ioService, connection.client), "abcde");
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), 3)));
+  RunFor(ioService, 50);
+  BOOST_CHECK_EQUAL(sent, 3);
+  BOOST_CHECK_EQUAL(errors, 0);
+
+  // Disconnecting fails the sends still waiting for credits.
+  connection.server.Disconnect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(sent), MessageCount)));
+  BOOST_CHECK_EQUAL(errors, MessageCount - 3);
+
+  connection.client.Disconnect();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Push_With_Full_Window)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  Tcp::EndPoint endPoint(TcpAddress, TcpPort);
+  endPoint.SetFlowControl(2);
+
+  // The pushes use up the server's credits, so the reply waits for the
+  // client's grant while the request fills the server's window.
+  PushingServerHandler * serverHandler = new PushingServerHandler(2);
+  ServerType server(ioService, endPoint, serverHandler);
+  server.SetMessageWindow(1);
+  server.Start();
+
+  CountingClientHandler * clientHandler = new CountingClientHandler;
+  ClientType client(ioService, endPoint, clientHandler);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 1)));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 1)));
+
+  client.AsyncSend(DataBufferPointer(new DataBuffer("request")), IgnoreError);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->received), 3)));
+
+  // The reply completed the request, so the server reads the next one.
+  client.AsyncSend(DataBufferPointer(new DataBuffer("request")), IgnoreError);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->received), 6)));
+
+  client.ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,627 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/MessagePort/HeartbeatService.hpp"
+#include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePortAcceptor.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+// RunFor() here runs the io_service to a timer, so the ticks are on time.
+using AsioExpressTest::RunUntilCalled;
+using AsioExpressTest::UnitTestModeFixture;
+
+namespace
+{
+  char const * const EndPointName = "HeartbeatServiceTest";
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47310";
+
+  void Count(int * calls)
+  {
+    ++*calls;
+  }
+
+  void RecordTime(
+      boost::chrono::steady_clock::time_point * first,
+      int * calls)
+  {
+    if (++*calls == 1)
+      *first = boost::chrono::steady_clock::now();
+  }
+
+  void CountAndStop(int * calls, HeartbeatPointer * heartbeat)
+  {
+    ++*calls;
+    (*heartbeat)->Stop();
+  }
+
+  void RecordDeadline(
+      std::vector<Heartbeat::Deadline> * deadlines,
+      Heartbeat::Deadline deadline)
+  {
+    deadlines->push_back(deadline);
+  }
+
+  void RecordReceive(
+      boost::atomic<int> * receives,
+      boost::atomic<int> * timeouts,
+      AsioExpress::Error error)
+  {
+    if (error.GetErrorCode() == Tcp::ErrorCode::ReceiveTimeout)
+      ++*timeouts;
+    ++*receives;
+  }
+
+  void RunFor(boost::asio::io_service & ioService, int milliseconds)
+  {
+    boost::asio::deadline_timer timer(ioService, boost::posix_time::milliseconds(milliseconds));
+    timer.async_wait(boost::bind(&boost::asio::io_service::stop, &ioService));
+    ioService.run();
+    ioService.reset();
+  }
+
+  // Reports traffic on a heartbeat every tick until told to stop.
+  class Traffic
+  {
+  public:
+    Traffic(boost::asio::io_service & ioService, HeartbeatPointer heartbeat, bool isSending) :
+      m_timer(ioService),
+      m_heartbeat(heartbeat),
+      m_isSending(isSending)
+    {
+      Next();
+    }
+
+    void Stop()
+    {
+      m_timer.cancel();
+    }
+
+  private:
+    void Next()
+    {
+      if (m_isSending)
+        m_heartbeat->Sent();
+      else
+        m_heartbeat->Received();
+
+      m_timer.expires_from_now(boost::posix_time::milliseconds(HeartbeatService::TickMilliseconds));
+      m_timer.async_wait(boost::bind(&Traffic::OnTimer, this, _1));
+    }
+
+    void OnTimer(boost::system::error_code error)
+    {
+      if (!error)
+        Next();
+    }
+
+    boost::asio::deadline_timer   m_timer;
+    HeartbeatPointer              m_heartbeat;
+    bool                          m_isSending;
+  };
+}
+
+BOOST_FIXTURE_TEST_SUITE(HeartbeatServiceTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Ping_When_Idle)
+{
+  boost::asio::io_service ioService;
+  int pings = 0;
+  int timeouts = 0;
+
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    50, 0, boost::bind(Count, &pings), boost::bind(Count, &timeouts));
+
+  RunFor(ioService, 330);
+  heartbeat->Stop();
+
+  BOOST_CHECK(pings >= 4 && pings <= 7);
+  BOOST_CHECK_EQUAL(timeouts, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Test_No_Ping_While_Sending)
+{
+  boost::asio::io_service ioService;
+  int pings = 0;
+
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    50, 0, boost::bind(Count, &pings), 0);
+  Traffic traffic(ioService, heartbeat, true);
+
+  RunFor(ioService, 300);
+  heartbeat->Stop();
+
+  BOOST_CHECK_EQUAL(pings, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Timeout_When_Nothing_Received)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+  int timeouts = 0;
+  steady_clock::time_point first;
+
+  steady_clock::time_point start = steady_clock::now();
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    0, 100, 0, boost::bind(RecordTime, &first, &timeouts));
+
+  RunFor(ioService, 250);
+  heartbeat->Stop();
+
+  BOOST_REQUIRE(timeouts >= 1);
+  BOOST_CHECK(first - start >= milliseconds(100));
+  BOOST_CHECK(first - start < milliseconds(200));
+}
+
+BOOST_AUTO_TEST_CASE(Test_No_Timeout_While_Receiving)
+{
+  boost::asio::io_service ioService;
+  int timeouts = 0;
+
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    0, 50, 0, boost::bind(Count, &timeouts));
+  Traffic traffic(ioService, heartbeat, false);
+
+  RunFor(ioService, 300);
+  heartbeat->Stop();
+
+  BOOST_CHECK_EQUAL(timeouts, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Receive_Deadline)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+  std::vector<Heartbeat::Deadline> deadlines;
+
+  HeartbeatSettings settings;
+  settings.receiveTimeout = 100;
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    settings, 0, 0, boost::bind(RecordDeadline, &deadlines, _1));
+
+  // A receive that completes in time keeps its deadline from passing.
+  heartbeat->ReceiveStarted();
+  RunFor(ioService, 60);
+  heartbeat->ReceiveCompleted();
+  heartbeat->ReceiveStarted();
+  RunFor(ioService, 60);
+  BOOST_CHECK(deadlines.empty());
+
+  // Pings are heard but the receive still waits for a message.
+  steady_clock::time_point start = steady_clock::now();
+  heartbeat->ReceiveCompleted();
+  heartbeat->ReceiveStarted();
+  Traffic traffic(ioService, heartbeat, false);
+  while (deadlines.empty())
+    ioService.run_one();
+  steady_clock::duration elapsed = steady_clock::now() - start;
+  traffic.Stop();
+  heartbeat->Stop();
+
+  BOOST_CHECK(deadlines[0] == Heartbeat::ReceiveDeadline);
+  BOOST_CHECK(elapsed >= milliseconds(100));
+  BOOST_CHECK(elapsed < milliseconds(200));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Send_And_Idle_Deadlines)
+{
+  boost::asio::io_service ioService;
+  std::vector<Heartbeat::Deadline> deadlines;
+
+  HeartbeatSettings settings;
+  settings.sendTimeout = 80;
+  settings.idleTimeout = 300;
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    settings, 0, 0, boost::bind(RecordDeadline, &deadlines, _1));
+
+  // Sends that keep completing do not expire, however many wait.
+  heartbeat->SendStarted();
+  heartbeat->SendStarted();
+  RunFor(ioService, 50);
+  heartbeat->SendCompleted();
+  RunFor(ioService, 50);
+  heartbeat->SendCompleted();
+  BOOST_CHECK(deadlines.empty());
+
+  // A send that does not, expires.
+  heartbeat->SendStarted();
+  RunFor(ioService, 150);
+  BOOST_REQUIRE_EQUAL(deadlines.size(), 1u);
+  BOOST_CHECK(deadlines[0] == Heartbeat::SendDeadline);
+  heartbeat->SendCompleted();
+
+  // With nothing sent or received after a last message the connection
+  // goes idle; completions are not messages.
+  deadlines.clear();
+  heartbeat->SendStarted();
+  heartbeat->SendCompleted();
+  RunFor(ioService, 450);
+  heartbeat->Stop();
+
+  BOOST_REQUIRE_EQUAL(deadlines.size(), 1u);
+  BOOST_CHECK(deadlines[0] == Heartbeat::IdleDeadline);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Timer_Stops_With_Last_Heartbeat)
+{
+  boost::asio::io_service ioService;
+  int pings = 0;
+
+  HeartbeatPointer heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    20, 0, boost::bind(Count, &pings), 0);
+  heartbeat->Stop();
+
+  // With nothing left to check the wheel stops and run() returns.
+  ioService.run();
+
+  BOOST_CHECK_EQUAL(pings, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Function_Stops_Its_Heartbeat)
+{
+  boost::asio::io_service ioService;
+  int timeouts = 0;
+
+  // The functions are called without the heartbeat locked.
+  HeartbeatPointer heartbeat;
+  heartbeat = boost::asio::use_service<HeartbeatService>(ioService).Start(
+    0, 50, 0, boost::bind(CountAndStop, &timeouts, &heartbeat));
+
+  RunFor(ioService, 250);
+
+  BOOST_CHECK_EQUAL(timeouts, 1);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Ipc_Lost_Peer)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  // The server never pings so the client gives up on it.
+  Ipc::EndPoint serverEndPoint(EndPointName);
+  serverEndPoint.SetHeartbeat(0, 0);
+  Ipc::EndPoint clientEndPoint(EndPointName);
+  clientEndPoint.SetHeartbeat(0, 200);
+
+  Ipc::MessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Ipc::MessagePort server(ioService);
+  Ipc::MessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  steady_clock::time_point start = steady_clock::now();
+
+  TestCompletionHandler received;
+  client.AsyncReceive(DataBufferPointer(new DataBuffer), received);
+  RunUntilCalled(ioService, received);
+
+  steady_clock::duration elapsed = steady_clock::now() - start;
+
+  BOOST_CHECK(received.LastError().GetErrorCode() == Ipc::ErrorCode::LostConnection);
+  BOOST_CHECK(elapsed >= milliseconds(200));
+  BOOST_CHECK(elapsed < milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Ipc_Pings_Keep_Peer)
+{
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  Ipc::EndPoint serverEndPoint(EndPointName);
+  serverEndPoint.SetHeartbeat(50, 0);
+  Ipc::EndPoint clientEndPoint(EndPointName);
+  clientEndPoint.SetHeartbeat(0, 200);
+
+  Ipc::MessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Ipc::MessagePort server(ioService);
+  Ipc::MessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  TestCompletionHandler received;
+  DataBufferPointer buffer(new DataBuffer);
+  client.AsyncReceive(buffer, received);
+
+  RunFor(ioService, 600);
+  BOOST_CHECK_EQUAL(received.Calls(), 0);
+
+  TestCompletionHandler sent;
+  server.AsyncSend(DataBufferPointer(new DataBuffer("Hello")), sent);
+  RunUntilCalled(ioService, received);
+
+  BOOST_CHECK(!received.LastError());
+  BOOST_CHECK(*buffer == DataBuffer("Hello"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Lost_Peer)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+  clientEndPoint.SetHeartbeat(0, 200);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Tcp::BasicMessagePort server(ioService);
+  Tcp::BasicMessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  steady_clock::time_point start = steady_clock::now();
+
+  TestCompletionHandler received;
+  client.AsyncReceive(DataBufferPointer(new DataBuffer), received);
+  RunUntilCalled(ioService, received);
+
+  steady_clock::duration elapsed = steady_clock::now() - start;
+
+  BOOST_CHECK(received.LastError().GetErrorCode() == Tcp::ErrorCode::LostConnection);
+  BOOST_CHECK(elapsed >= milliseconds(200));
+  BOOST_CHECK(elapsed < milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Pings_Keep_Peer)
+{
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  serverEndPoint.SetHeartbeat(50, 0);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+  clientEndPoint.SetHeartbeat(0, 200);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Tcp::BasicMessagePort server(ioService);
+  Tcp::BasicMessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  TestCompletionHandler received;
+  DataBufferPointer buffer(new DataBuffer);
+  client.AsyncReceive(buffer, received);
+
+  RunFor(ioService, 600);
+  BOOST_CHECK_EQUAL(received.Calls(), 0);
+
+  TestCompletionHandler sent;
+  server.AsyncSend(DataBufferPointer(new DataBuffer("Hello")), sent);
+  RunUntilCalled(ioService, received);
+
+  BOOST_CHECK(!received.LastError());
+  BOOST_CHECK(*buffer == DataBuffer("Hello"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Idle_Timeout)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+
+  // The client pings, which does not keep the connection from idling.
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  serverEndPoint.SetIdleTimeout(200);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+  clientEndPoint.SetHeartbeat(50, 0);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Tcp::BasicMessagePort server(ioService);
+  Tcp::BasicMessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  // A message keeps it open for a while longer.
+  TestCompletionHandler received;
+  DataBufferPointer buffer(new DataBuffer);
+  server.AsyncReceive(buffer, received);
+  RunFor(ioService, 120);
+  TestCompletionHandler sent;
+  client.AsyncSend(DataBufferPointer(new DataBuffer("Hello")), sent);
+  RunUntilCalled(ioService, received);
+  BOOST_REQUIRE(!received.LastError());
+
+  steady_clock::time_point start = steady_clock::now();
+
+  TestCompletionHandler idle;
+  server.AsyncReceive(buffer, idle);
+  RunUntilCalled(ioService, idle);
+
+  steady_clock::duration elapsed = steady_clock::now() - start;
+
+  BOOST_CHECK(idle.LastError().GetErrorCode() == Tcp::ErrorCode::IdleTimeout);
+  BOOST_CHECK(elapsed >= milliseconds(150));
+  BOOST_CHECK(elapsed < milliseconds(1000));
+
+  client.Disconnect();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Receive_Timeout)
+{
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  serverEndPoint.SetTimeouts(0, 150);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+  clientEndPoint.SetHeartbeat(50, 0);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Tcp::BasicMessagePort server(ioService);
+  Tcp::BasicMessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  TestCompletionHandler received;
+  server.AsyncReceive(DataBufferPointer(new DataBuffer), received);
+  RunUntilCalled(ioService, received);
+
+  BOOST_CHECK(received.LastError().GetErrorCode() == Tcp::ErrorCode::ReceiveTimeout);
+
+  client.Disconnect();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Send_Timeout)
+{
+  boost::asio::io_service ioService;
+
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  serverEndPoint.SetTimeouts(150, 0);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  Tcp::BasicMessagePort server(ioService);
+  Tcp::BasicMessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(clientEndPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  // The client never reads, so a message bigger than the socket buffers
+  // cannot be sent.
+  TestCompletionHandler received;
+  server.AsyncReceive(DataBufferPointer(new DataBuffer), received);
+  TestCompletionHandler sent;
+  server.AsyncSend(DataBufferPointer(new DataBuffer(64 * 1024 * 1024)), sent);
+  RunUntilCalled(ioService, received);
+  RunUntilCalled(ioService, sent);
+
+  BOOST_CHECK(received.LastError().GetErrorCode() == Tcp::ErrorCode::SendTimeout);
+  BOOST_CHECK(sent.LastError());
+
+  client.Disconnect();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Heartbeats_On_Thread_Pool)
+{
+  typedef boost::shared_ptr<Tcp::BasicMessagePort> PortPointer;
+
+  int const ConnectionCount = 8;
+  int const ThreadCount = 4;
+
+  boost::asio::io_service ioService;
+
+  // Both ends ping all the time, so pings are written while the sockets
+  // are being read, and every client closes on its receive deadline.
+  Tcp::EndPoint serverEndPoint(TcpAddress, TcpPort);
+  serverEndPoint.SetHeartbeat(10, 0);
+  Tcp::EndPoint clientEndPoint(TcpAddress, TcpPort);
+  clientEndPoint.SetHeartbeat(10, 0);
+  clientEndPoint.SetTimeouts(0, 150);
+
+  Tcp::BasicMessagePortAcceptor acceptor(ioService, serverEndPoint);
+  std::vector<PortPointer> servers;
+  std::vector<PortPointer> clients;
+  for (int i = 0; i < ConnectionCount; ++i)
+  {
+    servers.push_back(PortPointer(new Tcp::BasicMessagePort(ioService)));
+    clients.push_back(PortPointer(new Tcp::BasicMessagePort(ioService)));
+
+    TestCompletionHandler accepted;
+    TestCompletionHandler connected;
+    acceptor.AsyncAccept(*servers.back(), accepted);
+    clients.back()->AsyncConnect(clientEndPoint, connected);
+    RunUntilCalled(ioService, accepted);
+    RunUntilCalled(ioService, connected);
+    BOOST_REQUIRE(!connected.LastError());
+  }
+
+  boost::atomic<int> receives(0);
+  boost::atomic<int> timeouts(0);
+  for (int i = 0; i < ConnectionCount; ++i)
+  {
+    clients[i]->AsyncReceive(
+      DataBufferPointer(new DataBuffer),
+      boost::bind(RecordReceive, &receives, &timeouts, _1));
+    servers[i]->AsyncReceive(
+      DataBufferPointer(new DataBuffer),
+      boost::bind(RecordReceive, &receives, &timeouts, _1));
+  }
+
+  boost::scoped_ptr<boost::asio::io_service::work> work(
+    new boost::asio::io_service::work(ioService));
+  boost::thread_group threads;
+  for (int i = 0; i < ThreadCount; ++i)
+    threads.create_thread(boost::bind(&boost::asio::io_service::run, &ioService));
+
+  // A client closing ends its server's receive too.
+  for (int i = 0; i < 400 && receives.load() < 2 * ConnectionCount; ++i)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+
+  for (int i = 0; i < ConnectionCount; ++i)
+  {
+    clients[i]->Disconnect();
+    servers[i]->Disconnect();
+  }
+  work.reset();
+  threads.join_all();
+
+  BOOST_CHECK_EQUAL(receives.load(), 2 * ConnectionCount);
+  BOOST_CHECK_EQUAL(timeouts.load(), ConnectionCount);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
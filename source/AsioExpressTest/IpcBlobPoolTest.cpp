@@ -0,0 +1,152 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/MessagePort/Ipc/private/IpcBlobPool.hpp"
+
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::MessagePort::Ipc;
+
+namespace
+{
+  char const * const QueueName = "IpcBlobPoolTest#Client#1";
+  std::size_t const SegmentSize = 1024 * 1024;
+
+  DataBuffer MakePayload(std::size_t size)
+  {
+    DataBuffer payload(size);
+    for (std::size_t i = 0; i < size; ++i)
+      payload.Get()[i] = static_cast<char>(i * 7);
+    return payload;
+  }
+}
+
+struct IpcBlobPoolFixture
+{
+  IpcBlobPoolFixture()
+  {
+    IpcBlobPool::Remove(QueueName);
+  }
+
+  ~IpcBlobPoolFixture()
+  {
+    IpcBlobPool::Remove(QueueName);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(IpcBlobPoolTest, IpcBlobPoolFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Store_And_Load)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+  IpcBlobPool receiver(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(200000));
+  DataBuffer descriptor;
+
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+  BOOST_CHECK(descriptor.Size() < 64);
+
+  DataBuffer received;
+  BOOST_REQUIRE(receiver.Load(descriptor.Get(), descriptor.Size(), received));
+
+  BOOST_CHECK(received.IsAttached());
+  BOOST_CHECK(received == payload);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Release_Reclaims_Memory)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+  IpcBlobPool receiver(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(SegmentSize / 2));
+  DataBuffer descriptor;
+
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+
+  // The pool has no room for a second payload until the first is released.
+  DataBuffer secondDescriptor;
+  BOOST_CHECK(!sender.Store(payload, secondDescriptor));
+
+  {
+    DataBuffer received;
+    BOOST_REQUIRE(receiver.Load(descriptor.Get(), descriptor.Size(), received));
+  }
+
+  BOOST_CHECK(sender.Store(payload, secondDescriptor));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Stale_Descriptor_Is_Rejected)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+  IpcBlobPool receiver(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(1000));
+  DataBuffer descriptor;
+
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+
+  DataBuffer received;
+  BOOST_REQUIRE(receiver.Load(descriptor.Get(), descriptor.Size(), received));
+  received.Resize(0);
+
+  DataBuffer again;
+  BOOST_CHECK(!receiver.Load(descriptor.Get(), descriptor.Size(), again));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Ordinary_Message_Is_Not_Loaded)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+  IpcBlobPool receiver(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(1000));
+  DataBuffer descriptor;
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+
+  DataBuffer message(MakePayload(descriptor.Size()));
+  DataBuffer received;
+  BOOST_CHECK(!receiver.Load(message.Get(), message.Size(), received));
+  BOOST_CHECK(!received.IsAttached());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Release)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(SegmentSize / 2));
+  DataBuffer descriptor;
+
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+  BOOST_CHECK(sender.Release(descriptor));
+  BOOST_CHECK(!sender.Release(descriptor));
+
+  BOOST_CHECK(sender.Store(payload, descriptor));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Overflowing_Descriptor_Is_Rejected)
+{
+  IpcBlobPool sender(QueueName, SegmentSize);
+  IpcBlobPool receiver(QueueName, SegmentSize);
+
+  DataBuffer payload(MakePayload(1000));
+  DataBuffer descriptor;
+  BOOST_REQUIRE(sender.Store(payload, descriptor));
+
+  // A length that wraps the end of the block around to its start.
+  boost::uint64_t offset;
+  memcpy(&offset, descriptor.Get() + 16, sizeof(offset));
+  boost::uint64_t length = ~boost::uint64_t(0) - offset - 7;
+  memcpy(descriptor.Get() + 24, &length, sizeof(length));
+
+  DataBuffer received;
+  BOOST_CHECK(!receiver.Load(descriptor.Get(), descriptor.Size(), received));
+  BOOST_CHECK(!received.IsAttached());
+  BOOST_CHECK(!sender.Release(descriptor));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,214 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePortAcceptor.hpp"
+#include "AsioExpress/MessagePort/Ipc/private/IpcBroadcastRing.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::MessagePort::Ipc;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const EndPointName = "IpcBroadcastRingTest";
+  std::size_t const Capacity = 4096;
+
+  DataBuffer MakePayload(std::size_t size, int seed)
+  {
+    DataBuffer payload(size);
+    for (std::size_t i = 0; i < size; ++i)
+      payload.Get()[i] = static_cast<char>(i * 7 + seed);
+    return payload;
+  }
+}
+
+struct IpcBroadcastRingFixture : UnitTestModeFixture
+{
+  IpcBroadcastRingFixture()
+  {
+    IpcBroadcastRing::Remove(EndPointName);
+  }
+
+  ~IpcBroadcastRingFixture()
+  {
+    IpcBroadcastRing::Remove(EndPointName);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE(IpcBroadcastRingTest, IpcBroadcastRingFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Readers_Have_Own_Cursors)
+{
+  IpcBroadcastRingPointer writer(IpcBroadcastRing::Create(EndPointName, Capacity, boost::interprocess::permissions()));
+  IpcBroadcastRingPointer reader(IpcBroadcastRing::Open(EndPointName));
+
+  IpcBroadcastRing::Position cursor1 = reader->GetWritePosition();
+  IpcBroadcastRing::Position cursor2 = reader->GetWritePosition();
+
+  BOOST_REQUIRE(writer->Publish(MakePayload(100, 1)));
+  BOOST_REQUIRE(writer->Publish(MakePayload(200, 2)));
+
+  DataBuffer received;
+  BOOST_CHECK_EQUAL(reader->Read(cursor1, received), IpcBroadcastRing::Message);
+  BOOST_CHECK(received == MakePayload(100, 1));
+  BOOST_CHECK_EQUAL(reader->Read(cursor1, received), IpcBroadcastRing::Message);
+  BOOST_CHECK(received == MakePayload(200, 2));
+  BOOST_CHECK_EQUAL(reader->Read(cursor1, received), IpcBroadcastRing::Empty);
+
+  BOOST_CHECK_EQUAL(reader->Read(cursor2, received), IpcBroadcastRing::Message);
+  BOOST_CHECK(received == MakePayload(100, 1));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Wrap_Around)
+{
+  IpcBroadcastRingPointer ring(IpcBroadcastRing::Create(EndPointName, Capacity, boost::interprocess::permissions()));
+
+  IpcBroadcastRing::Position cursor = ring->GetWritePosition();
+
+  // Odd sizes force padding records at the end of the ring.
+  for (int i = 0; i < 100; ++i)
+  {
+    BOOST_REQUIRE(ring->Publish(MakePayload(300 + i, i)));
+
+    DataBuffer received;
+    BOOST_REQUIRE_EQUAL(ring->Read(cursor, received), IpcBroadcastRing::Message);
+    BOOST_REQUIRE(received == MakePayload(300 + i, i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Test_Lagging_Reader_Is_Overrun)
+{
+  IpcBroadcastRingPointer ring(IpcBroadcastRing::Create(EndPointName, Capacity, boost::interprocess::permissions()));
+
+  IpcBroadcastRing::Position cursor = ring->GetWritePosition();
+
+  for (int i = 0; i < 20; ++i)
+    BOOST_REQUIRE(ring->Publish(MakePayload(500, i)));
+
+  DataBuffer received;
+  BOOST_CHECK_EQUAL(ring->Read(cursor, received), IpcBroadcastRing::Overrun);
+
+  // The reader resumes with the oldest message still in the ring.
+  BOOST_REQUIRE_EQUAL(ring->Read(cursor, received), IpcBroadcastRing::Message);
+  int first = static_cast<unsigned char>(received.Get()[0]);
+  BOOST_CHECK(first > 0);
+
+  int count = 1;
+  while (ring->Read(cursor, received) == IpcBroadcastRing::Message)
+    ++count;
+  BOOST_CHECK(received == MakePayload(500, 19));
+  BOOST_CHECK_EQUAL(first + count, 20);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Large_Message_Is_Rejected)
+{
+  IpcBroadcastRingPointer ring(IpcBroadcastRing::Create(EndPointName, Capacity, boost::interprocess::permissions()));
+
+  BOOST_CHECK(ring->Publish(MakePayload(ring->MaxPayloadSize(), 1)));
+  BOOST_CHECK(!ring->Publish(MakePayload(ring->MaxPayloadSize() + 1, 1)));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Broadcast_To_Message_Ports)
+{
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+  EndPoint endPoint(EndPointName);
+  MessagePortAcceptor acceptor(ioService, endPoint);
+
+  int const clientCount = 3;
+  typedef boost::shared_ptr<AsioExpress::MessagePort::Ipc::MessagePort> MessagePortPointer;
+  std::vector<MessagePortPointer> servers;
+  std::vector<MessagePortPointer> clients;
+
+  for (int i = 0; i < clientCount; ++i)
+  {
+    servers.push_back(MessagePortPointer(new AsioExpress::MessagePort::Ipc::MessagePort(ioService)));
+    clients.push_back(MessagePortPointer(new AsioExpress::MessagePort::Ipc::MessagePort(ioService)));
+
+    TestCompletionHandler accepted;
+    TestCompletionHandler connected;
+    acceptor.AsyncAccept(*servers.back(), accepted);
+    clients.back()->AsyncConnect(endPoint, connected);
+    RunUntilCalled(ioService, accepted);
+    RunUntilCalled(ioService, connected);
+
+    BOOST_REQUIRE_MESSAGE(!connected.LastError(), connected.LastError().Message());
+    BOOST_CHECK(servers.back()->IsBroadcastSubscriber());
+  }
+
+  DataBufferPointer payload(new DataBuffer(MakePayload(10000, 3)));
+  BOOST_REQUIRE(acceptor.PublishBroadcast(payload));
+
+  for (int i = 0; i < clientCount; ++i)
+  {
+    DataBufferPointer received(new DataBuffer);
+    TestCompletionHandler handler;
+    clients[i]->AsyncReceive(received, handler);
+    RunUntilCalled(ioService, handler);
+
+    BOOST_CHECK(!handler.LastError());
+    BOOST_CHECK(*received == *payload);
+  }
+
+  // Messages sent to a single port still arrive through its queue.
+  DataBufferPointer direct(new DataBuffer(MakePayload(100, 4)));
+  TestCompletionHandler sent;
+  servers[0]->AsyncSend(direct, sent);
+  RunUntilCalled(ioService, sent);
+
+  DataBufferPointer received(new DataBuffer);
+  TestCompletionHandler handler;
+  clients[0]->AsyncReceive(received, handler);
+  RunUntilCalled(ioService, handler);
+  BOOST_CHECK(*received == *direct);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Message_Port_Overrun)
+{
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+  EndPoint endPoint(EndPointName);
+  endPoint.SetBroadcastBytes(Capacity);
+  MessagePortAcceptor acceptor(ioService, endPoint);
+
+  AsioExpress::MessagePort::Ipc::MessagePort server(ioService);
+  AsioExpress::MessagePort::Ipc::MessagePort client(ioService);
+
+  TestCompletionHandler accepted;
+  TestCompletionHandler connected;
+  acceptor.AsyncAccept(server, accepted);
+  client.AsyncConnect(endPoint, connected);
+  RunUntilCalled(ioService, accepted);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  for (int i = 0; i < 20; ++i)
+    BOOST_REQUIRE(acceptor.PublishBroadcast(DataBufferPointer(new DataBuffer(MakePayload(500, i)))));
+
+  DataBufferPointer received(new DataBuffer);
+  TestCompletionHandler overrun;
+  client.AsyncReceive(received, overrun);
+  RunUntilCalled(ioService, overrun);
+  BOOST_CHECK(overrun.LastError().GetErrorCode() == ErrorCode::BroadcastOverrun);
+
+  // The port stays connected and carries on from the oldest message left.
+  TestCompletionHandler handler;
+  client.AsyncReceive(received, handler);
+  RunUntilCalled(ioService, handler);
+  BOOST_CHECK(!handler.LastError());
+  BOOST_CHECK(client.IsConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/Platform/Process.hpp"
+#include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort::Ipc;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const EndPointName = "IpcConnectTest";
+
+  // The IPC threads post their completions so the caller must hold work on
+  // the io_service while waiting for them.
+  void RunUntilCalled(
+      boost::asio::io_service & ioService,
+      TestCompletionHandler & handler1,
+      TestCompletionHandler & handler2)
+  {
+    while (handler1.Calls() == 0 || handler2.Calls() == 0)
+      ioService.run_one();
+  }
+
+  bool QueueExists(std::string const & name)
+  {
+    try
+    {
+      boost::interprocess::message_queue queue(boost::interprocess::open_only, name.c_str());
+    }
+    catch(boost::interprocess::interprocess_exception &)
+    {
+      return false;
+    }
+    return true;
+  }
+
+  void CreateQueue(std::string const & name)
+  {
+    boost::interprocess::message_queue::remove(name.c_str());
+    boost::interprocess::message_queue queue(boost::interprocess::create_only, name.c_str(), 1, 16);
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(IpcConnectTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Connect_Latency)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+  EndPoint endPoint(EndPointName);
+  MessagePortAcceptor acceptor(ioService, endPoint);
+
+  int const connectCount = 20;
+  steady_clock::duration total(0);
+  steady_clock::duration worst(0);
+
+  for (int i = 0; i < connectCount; ++i)
+  {
+    AsioExpress::MessagePort::Ipc::MessagePort server(ioService);
+    AsioExpress::MessagePort::Ipc::MessagePort client(ioService);
+    TestCompletionHandler accepted;
+    TestCompletionHandler connected;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    acceptor.AsyncAccept(server, accepted);
+    client.AsyncConnect(endPoint, connected);
+    RunUntilCalled(ioService, accepted, connected);
+
+    steady_clock::duration elapsed = steady_clock::now() - start;
+    total += elapsed;
+    if (elapsed > worst)
+      worst = elapsed;
+
+    BOOST_REQUIRE_MESSAGE(!accepted.LastError(), accepted.LastError().Message());
+    BOOST_REQUIRE_MESSAGE(!connected.LastError(), connected.LastError().Message());
+  }
+
+  BOOST_TEST_MESSAGE("IPC connect latency over " << connectCount << " connections: average "
+    << duration_cast<microseconds>(total / connectCount).count() << " us, worst "
+    << duration_cast<microseconds>(worst).count() << " us");
+
+  BOOST_CHECK(worst < milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Connect_Timeout)
+{
+  using namespace boost::chrono;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+  EndPoint endPoint(EndPointName);
+  endPoint.SetConnectTimeout(200);
+
+  // The acceptor exists but never accepts, so no acknowledgement is sent.
+  MessagePortAcceptor acceptor(ioService, endPoint);
+
+  AsioExpress::MessagePort::Ipc::MessagePort client(ioService);
+  TestCompletionHandler connected;
+
+  steady_clock::time_point start = steady_clock::now();
+
+  client.AsyncConnect(endPoint, connected);
+  RunUntilCalled(ioService, connected, connected);
+
+  steady_clock::duration elapsed = steady_clock::now() - start;
+
+  BOOST_CHECK(connected.LastError().GetErrorCode() == ErrorCode::TimeOutExpired);
+  BOOST_CHECK(elapsed >= milliseconds(200));
+  BOOST_CHECK(elapsed < milliseconds(2000));
+  BOOST_CHECK(!client.IsConnected());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Orphaned_Queues_Removed)
+{
+  std::ostringstream ownId;
+  ownId << GetOwnProcessId() << "-1000000";
+
+  std::string const endPoint(EndPointName);
+  std::string const orphanedQueue(endPoint + "#Client#2147483646-1");
+  std::string const legacyQueue(endPoint + "#Server#42");
+  std::string const liveQueue(endPoint + "#Client#" + ownId.str());
+  std::string const otherQueue(endPoint + "Other#Client#2147483646-1");
+
+  CreateQueue(orphanedQueue);
+  CreateQueue(legacyQueue);
+  CreateQueue(liveQueue);
+  CreateQueue(otherQueue);
+
+  {
+    boost::asio::io_service ioService;
+    MessagePortAcceptor acceptor(ioService, EndPoint(EndPointName));
+  }
+
+  BOOST_CHECK(!QueueExists(orphanedQueue));
+  BOOST_CHECK(!QueueExists(legacyQueue));
+  BOOST_CHECK(QueueExists(liveQueue));
+  BOOST_CHECK(QueueExists(otherQueue));
+
+  boost::interprocess::message_queue::remove(liveQueue.c_str());
+  boost::interprocess::message_queue::remove(otherQueue.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
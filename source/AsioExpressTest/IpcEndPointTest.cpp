@@ -77,4 +77,19 @@ BOOST_AUTO_TEST_CASE(Test_Get_Permissions)
   BOOST_CHECK(endPoint.GetPermissions().get_permissions() == perm1.get_permissions());
 }
 
+BOOST_AUTO_TEST_CASE(Test_Connect_Timeout)
+{
+  using namespace AsioExpress::MessagePort::Ipc;
+
+  EndPoint endPoint1("MessagePortName");
+  EndPoint endPoint2("MessagePortName");
+
+  BOOST_CHECK_EQUAL(endPoint1.GetConnectTimeout(), 8000);
+
+  endPoint2.SetConnectTimeout(250);
+
+  BOOST_CHECK_EQUAL(endPoint2.GetConnectTimeout(), 250);
+  BOOST_CHECK(!(endPoint1 == endPoint2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,733 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <map>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47311";
+  char const * const WindowTcpPort = "47312";
+  char const * const AdmissionTcpPort = "47319";
+  char const * const DrainTcpPort = "47322";
+  char const * const DeadlineTcpPort = "47323";
+  char const * const FailingTcpPort = "47329";
+  int const ThreadCount = 4;
+  int const ClientCount = 8;
+  int const MessageCount = 20;
+
+  struct NullMessagePort
+  {
+    NullMessagePort() :
+      sends(0)
+    {
+    }
+
+    void AsyncSend(DataBufferPointer, AsioExpress::CompletionHandler)
+    {
+      ++sends;
+    }
+
+    void Disconnect()
+    {
+    }
+
+    std::string GetAddress() const
+    {
+      return std::string();
+    }
+
+    bool IsBroadcastSubscriber() const
+    {
+      return false;
+    }
+
+    void GetStatistics(PortStatistics &) const
+    {
+    }
+
+    int sends;
+  };
+
+  typedef MessagePortManager<NullMessagePort> NullMessagePortManager;
+
+  void AddAndRemove(
+      NullMessagePortManager & manager,
+      std::vector<MessagePortId> & kept)
+  {
+    for (int i = 0; i < 1000; ++i)
+    {
+      MessagePortId id = manager.Add(boost::shared_ptr<NullMessagePort>(new NullMessagePort));
+      if (i % 2 == 0)
+        manager.Remove(id);
+      else
+        kept.push_back(id);
+    }
+  }
+
+  // Echoes every message back to the client that sent it.
+  class EchoHandler : public ServerEventHandler
+  {
+  public:
+    EchoHandler() :
+      m_busy(0),
+      m_mostBusy(0),
+      m_messages(0),
+      m_isConnectionOverlapped(false)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      int busy = ++m_busy;
+      int mostBusy = m_mostBusy;
+      while (busy > mostBusy && !m_mostBusy.compare_exchange_weak(mostBusy, busy))
+        ;
+
+      if (!Enter(message.GetMessagePortId()))
+        m_isConnectionOverlapped = true;
+
+      // Holding on to the thread lets other connections overlap this one.
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(2));
+
+      Leave(message.GetMessagePortId());
+      --m_busy;
+      ++m_messages;
+
+      message.AsyncSend(
+        message.GetMessagePortId(),
+        DataBufferPointer(new DataBuffer(*message.GetDataBuffer())),
+        AsioExpress::NullCompletionHandler);
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int MostBusy() const
+    {
+      return m_mostBusy;
+    }
+
+    int Messages() const
+    {
+      return m_messages;
+    }
+
+    bool IsConnectionOverlapped() const
+    {
+      return m_isConnectionOverlapped;
+    }
+
+  private:
+    bool Enter(MessagePortId id)
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      return m_inside.insert(id).second;
+    }
+
+    void Leave(MessagePortId id)
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_inside.erase(id);
+    }
+
+    boost::atomic<int>        m_busy;
+    boost::atomic<int>        m_mostBusy;
+    boost::atomic<int>        m_messages;
+    boost::atomic<bool>       m_isConnectionOverlapped;
+    boost::mutex              m_mutex;
+    std::set<MessagePortId>   m_inside;
+  };
+
+  // Holds on to each message until the test completes it.
+  class HoldingHandler : public ServerEventHandler
+  {
+  public:
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      messages.push_back(ServerMessagePointer(new ServerMessage(message)));
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    std::vector<ServerMessagePointer> messages;
+  };
+
+  // Keeps the connection when a message fails, remembering the error.
+  class SheddingHandler : public HoldingHandler
+  {
+  public:
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      errors.push_back(error);
+      return AsioExpress::Error();
+    }
+
+    std::vector<AsioExpress::Error> errors;
+  };
+
+  // Closes the connection when a message fails, counting the messages
+  // that still reach it once it has been told the connection is gone.
+  class FailingHandler : public HoldingHandler
+  {
+  public:
+    FailingHandler() :
+      isDisconnected(false),
+      lateMessages(0)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+      isDisconnected = true;
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      if (isDisconnected)
+        ++lateMessages;
+      HoldingHandler::AsyncProcessMessage(message);
+    }
+
+    bool isDisconnected;
+    int lateMessages;
+  };
+
+  bool IsCalled(TestCompletionHandler & handler)
+  {
+    return handler.Calls() > 0;
+  }
+
+  bool IsSet(bool const & flag)
+  {
+    return flag;
+  }
+
+  template<typename Condition>
+  bool PollUntil(boost::asio::io_service & ioService, Condition condition)
+  {
+    for (int i = 0; i < 400 && !condition(); ++i)
+    {
+      ioService.poll();
+      ioService.reset();
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+    }
+    return condition();
+  }
+
+  void Poll(boost::asio::io_service & ioService)
+  {
+    for (int i = 0; i < 20; ++i)
+    {
+      ioService.poll();
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+    }
+  }
+
+  std::string MessageText(int client, int index)
+  {
+    std::ostringstream text;
+    text << "Client " << client << " message " << index;
+    return text.str();
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(MessagePortServerTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Manager_Add_Remove_From_Threads)
+{
+  boost::asio::io_service ioService;
+  NullMessagePortManager manager(ioService);
+
+  std::vector<MessagePortId> kept[ThreadCount];
+  boost::thread_group threads;
+  for (int i = 0; i < ThreadCount; ++i)
+    threads.create_thread(boost::bind(AddAndRemove, boost::ref(manager), boost::ref(kept[i])));
+  threads.join_all();
+
+  std::set<MessagePortId> expected;
+  for (int i = 0; i < ThreadCount; ++i)
+    expected.insert(kept[i].begin(), kept[i].end());
+  BOOST_CHECK_EQUAL(expected.size(), 500u * ThreadCount);
+
+  MessagePortIdList ids;
+  manager.GetIds(ids);
+  BOOST_CHECK(std::set<MessagePortId>(ids.begin(), ids.end()) == expected);
+
+  manager.RemoveAll();
+  ids.clear();
+  manager.GetIds(ids);
+  BOOST_CHECK(ids.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Manager_Stale_Ids)
+{
+  boost::asio::io_service ioService;
+  NullMessagePortManager manager(ioService);
+  boost::shared_ptr<NullMessagePort> port(new NullMessagePort);
+
+  // Enough connections come and go for the freed slots to be reused.
+  std::set<MessagePortId> removed;
+  for (int i = 0; i < 3000; ++i)
+  {
+    MessagePortId id = manager.Add(port);
+    BOOST_REQUIRE(id > 0);
+    BOOST_REQUIRE(removed.insert(id).second);
+    manager.Remove(id);
+  }
+
+  boost::shared_ptr<NullMessagePort> live(new NullMessagePort);
+  MessagePortId liveId = manager.Add(live);
+  BOOST_CHECK_EQUAL(removed.count(liveId), 0u);
+
+  DataBufferPointer buffer(new DataBuffer("Hello"));
+  std::set<MessagePortId>::const_iterator  it = removed.begin();
+  std::set<MessagePortId>::const_iterator end = removed.end();
+  for (; it != end; ++it)
+    manager.AsyncSend(*it, buffer, AsioExpress::NullCompletionHandler);
+  manager.AsyncSend(InvalidMessagePortId, buffer, AsioExpress::NullCompletionHandler);
+
+  BOOST_CHECK_EQUAL(port->sends, 0);
+  BOOST_CHECK_EQUAL(live->sends, 0);
+
+  manager.AsyncSend(liveId, buffer, AsioExpress::NullCompletionHandler);
+  BOOST_CHECK_EQUAL(live->sends, 1);
+
+  // Removing a stale id leaves the live port alone.
+  manager.Remove(*removed.begin());
+  MessagePortIdList ids;
+  manager.GetIds(ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 1u);
+  BOOST_CHECK_EQUAL(ids[0], liveId);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_On_Thread_Pool)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef boost::shared_ptr<Tcp::BasicMessagePort> ClientPointer;
+
+  boost::asio::io_service serverService;
+  boost::scoped_ptr<boost::asio::io_service::work> serverWork(
+    new boost::asio::io_service::work(serverService));
+
+  EchoHandler * echoHandler = new EchoHandler;
+  ServerType server(serverService, Tcp::EndPoint(TcpAddress, TcpPort), echoHandler);
+  server.Start();
+
+  boost::thread_group threads;
+  for (int i = 0; i < ThreadCount; ++i)
+    threads.create_thread(boost::bind(&boost::asio::io_service::run, &serverService));
+
+  boost::asio::io_service clientService;
+  boost::asio::io_service::work clientWork(clientService);
+  std::vector<ClientPointer> clients;
+  for (int i = 0; i < ClientCount; ++i)
+  {
+    clients.push_back(ClientPointer(new Tcp::BasicMessagePort(clientService)));
+    TestCompletionHandler connected;
+    clients.back()->AsyncConnect(Tcp::EndPoint(TcpAddress, TcpPort), connected);
+    RunUntilCalled(clientService, connected);
+    BOOST_REQUIRE(!connected.LastError());
+  }
+
+  // Each client keeps a message in flight; the replies come back in order.
+  for (int m = 0; m < MessageCount; ++m)
+  {
+    std::vector<TestCompletionHandler> sent(ClientCount);
+    for (int c = 0; c < ClientCount; ++c)
+      clients[c]->AsyncSend(DataBufferPointer(new DataBuffer(MessageText(c, m))), sent[c]);
+
+    for (int c = 0; c < ClientCount; ++c)
+    {
+      DataBufferPointer reply(new DataBuffer);
+      TestCompletionHandler received;
+      clients[c]->AsyncReceive(reply, received);
+      RunUntilCalled(clientService, received);
+      BOOST_REQUIRE(!received.LastError());
+      BOOST_REQUIRE(*reply == DataBuffer(MessageText(c, m)));
+    }
+  }
+
+  BOOST_CHECK_EQUAL(echoHandler->Messages(), ClientCount * MessageCount);
+  BOOST_CHECK(!echoHandler->IsConnectionOverlapped());
+  BOOST_CHECK(echoHandler->MostBusy() > 1);
+
+  MessagePortIdList ids;
+  server.GetIds(ids);
+  BOOST_CHECK_EQUAL(ids.size(), static_cast<size_t>(ClientCount));
+
+  server.Stop();
+  clients.clear();
+  serverWork.reset();
+  threads.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Message_Window)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  HoldingHandler * handler = new HoldingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, WindowTcpPort), handler);
+  server.SetMessageWindow(4, true);
+  server.Start();
+
+  Tcp::BasicMessagePort client(ioService);
+  TestCompletionHandler connected;
+  client.AsyncConnect(Tcp::EndPoint(TcpAddress, WindowTcpPort), connected);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  for (int m = 0; m < 6; ++m)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, m))), AsioExpress::NullCompletionHandler);
+
+  // The pipelined messages are in the handler together, up to the window.
+  while (handler->messages.size() < 4)
+    ioService.run_one();
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 4u);
+  for (int m = 0; m < 4; ++m)
+    BOOST_CHECK(*handler->messages[m]->GetDataBuffer() == DataBuffer(MessageText(0, m)));
+
+  // The window is ordered, so the last message completing frees no slot.
+  handler->messages[3]->CallCompletionHandler(AsioExpress::Error());
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(handler->messages.size(), 4u);
+
+  handler->messages[0]->CallCompletionHandler(AsioExpress::Error());
+  handler->messages[1]->CallCompletionHandler(AsioExpress::Error());
+  handler->messages[2]->CallCompletionHandler(AsioExpress::Error());
+  while (handler->messages.size() < 6)
+    ioService.run_one();
+  BOOST_CHECK(*handler->messages[4]->GetDataBuffer() == DataBuffer(MessageText(0, 4)));
+  BOOST_CHECK(*handler->messages[5]->GetDataBuffer() == DataBuffer(MessageText(0, 5)));
+
+  handler->messages[4]->CallCompletionHandler(AsioExpress::Error());
+  handler->messages[5]->CallCompletionHandler(AsioExpress::Error());
+  server.Stop();
+  client.Disconnect();
+  Poll(ioService);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Message_Error_Closes_Connection)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  FailingHandler * handler = new FailingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, FailingTcpPort), handler);
+  server.SetMessageWindow(4);
+  server.Start();
+
+  Tcp::BasicMessagePort client(ioService);
+  TestCompletionHandler connected;
+  client.AsyncConnect(Tcp::EndPoint(TcpAddress, FailingTcpPort), connected);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  for (int m = 0; m < 6; ++m)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, m))), AsioExpress::NullCompletionHandler);
+
+  while (handler->messages.size() < 4)
+    ioService.run_one();
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 4u);
+
+  // The failed message frees a slot in the full window and then closes the
+  // connection. The receive loop must stop rather than take the next
+  // message, and the client must see the connection close.
+  TestCompletionHandler closed;
+  client.AsyncReceive(DataBufferPointer(new DataBuffer), closed);
+  handler->messages[0]->CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortBadFrame));
+  BOOST_CHECK(RunUntil(ioService, boost::bind(IsCalled, boost::ref(closed))));
+  BOOST_CHECK(closed.LastError());
+  BOOST_CHECK(handler->isDisconnected);
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(handler->lateMessages, 0);
+  BOOST_CHECK_EQUAL(handler->messages.size(), 4u);
+  BOOST_CHECK_EQUAL(server.GetConnectionCount(), 0u);
+
+  for (int m = 1; m < 4; ++m)
+    handler->messages[m]->CallCompletionHandler(AsioExpress::Error());
+  server.Stop();
+  client.Disconnect();
+  Poll(ioService);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Admission_Control)
+{
+  boost::asio::io_service ioService;
+  AdmissionControlPointer admission(new AdmissionControl(ioService));
+
+  bool isOverloaded = false;
+  AdmissionPolicy policy(1, 1, AdmissionPolicy::PauseAccepting);
+  policy.isOverloaded = boost::bind(IsSet, boost::cref(isOverloaded));
+  policy.checkIntervalMilliseconds = 5;
+  admission->SetPolicy(policy);
+  admission->Start();
+
+  TestCompletionHandler accept;
+  admission->AsyncWaitToAccept(accept);
+  ioService.poll();
+  BOOST_CHECK_EQUAL(accept.Calls(), 1);
+  BOOST_CHECK(admission->AdmitConnection());
+
+  // Accepting pauses at the connection limit until a connection closes.
+  admission->AsyncWaitToAccept(accept);
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(accept.Calls(), 1);
+  admission->ConnectionClosed();
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(accept.Calls(), 2);
+  BOOST_CHECK(admission->AdmitConnection());
+
+  // Messages over the limit are shed.
+  BOOST_CHECK(admission->BeginMessage());
+  BOOST_CHECK(!admission->BeginMessage());
+  admission->EndMessage();
+  BOOST_CHECK(admission->BeginMessage());
+  admission->EndMessage();
+  BOOST_CHECK_EQUAL(admission->GetShedMessages(), 1u);
+
+  // So is everything while the overload signal is on.
+  isOverloaded = true;
+  BOOST_REQUIRE(PollUntil(ioService, boost::bind(&AdmissionControl::IsOverloaded, admission)));
+  BOOST_CHECK(!admission->BeginMessage());
+  isOverloaded = false;
+  BOOST_REQUIRE(PollUntil(ioService, !boost::bind(&AdmissionControl::IsOverloaded, admission)));
+  BOOST_CHECK(admission->BeginMessage());
+  admission->EndMessage();
+
+  // Stopping aborts a paused accept.
+  admission->AsyncWaitToAccept(accept);
+  admission->Stop();
+  ioService.reset();
+  ioService.poll();
+  BOOST_REQUIRE_EQUAL(accept.Calls(), 3);
+  BOOST_CHECK_EQUAL(accept.LastError().GetErrorCode(), boost::asio::error::operation_aborted);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Admission)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  SheddingHandler * handler = new SheddingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, AdmissionTcpPort), handler);
+  server.SetMessageWindow(2);
+  server.SetAdmissionPolicy(AdmissionPolicy(1, 1));
+  server.Start();
+
+  Tcp::BasicMessagePort client(ioService);
+  TestCompletionHandler connected;
+  client.AsyncConnect(Tcp::EndPoint(TcpAddress, AdmissionTcpPort), connected);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(server.GetConnectionCount(), 1u);
+
+  // A second connection is accepted and closed at once.
+  Tcp::BasicMessagePort rejected(ioService);
+  TestCompletionHandler rejectedConnected;
+  rejected.AsyncConnect(Tcp::EndPoint(TcpAddress, AdmissionTcpPort), rejectedConnected);
+  RunUntilCalled(ioService, rejectedConnected);
+  TestCompletionHandler closed;
+  rejected.AsyncReceive(DataBufferPointer(new DataBuffer), closed);
+  RunUntilCalled(ioService, closed);
+  BOOST_CHECK(closed.LastError());
+  BOOST_CHECK_EQUAL(server.GetRejectedConnections(), 1u);
+
+  // With one message in the handler the next fails as busy.
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 0))), AsioExpress::NullCompletionHandler);
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 1))), AsioExpress::NullCompletionHandler);
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 1u);
+  BOOST_REQUIRE_EQUAL(handler->errors.size(), 1u);
+  BOOST_CHECK_EQUAL(handler->errors[0].GetErrorCode(), ErrorCode::MessagePortServerBusy);
+  BOOST_CHECK_EQUAL(server.GetShedMessages(), 1u);
+  BOOST_CHECK_EQUAL(server.GetPendingMessages(), 1u);
+
+  // Once it completes there is room again.
+  handler->messages[0]->CallCompletionHandler(AsioExpress::Error());
+  Poll(ioService);
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 2))), AsioExpress::NullCompletionHandler);
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 2u);
+  BOOST_CHECK(*handler->messages[1]->GetDataBuffer() == DataBuffer(MessageText(0, 2)));
+  handler->messages[1]->CallCompletionHandler(AsioExpress::Error());
+
+  server.Stop();
+  client.Disconnect();
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(server.GetConnectionCount(), 0u);
+}
+
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Graceful_Stop)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  HoldingHandler * handler = new HoldingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, DrainTcpPort), handler);
+  server.Start();
+
+  Tcp::BasicMessagePort client(ioService);
+  TestCompletionHandler connected;
+  client.AsyncConnect(Tcp::EndPoint(TcpAddress, DrainTcpPort), connected);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 0))), AsioExpress::NullCompletionHandler);
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 1u);
+
+  DrainResultPointer result(new DrainResult);
+  TestCompletionHandler stopped;
+  server.AsyncStop(5000, result, stopped);
+
+  // Messages received while draining are dropped; the one in the handler
+  // holds up the stop.
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 1))), AsioExpress::NullCompletionHandler);
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(handler->messages.size(), 1u);
+  BOOST_CHECK_EQUAL(stopped.Calls(), 0);
+
+  // Its reply is still delivered before the server hangs up.
+  handler->messages[0]->AsyncSend(
+    handler->messages[0]->GetMessagePortId(),
+    DataBufferPointer(new DataBuffer(MessageText(0, 2))),
+    AsioExpress::NullCompletionHandler);
+  handler->messages[0]->CallCompletionHandler(AsioExpress::Error());
+
+  DataBufferPointer reply(new DataBuffer);
+  TestCompletionHandler received;
+  client.AsyncReceive(reply, received);
+  RunUntilCalled(ioService, received);
+  BOOST_REQUIRE(!received.LastError());
+  BOOST_CHECK(*reply == DataBuffer(MessageText(0, 2)));
+
+  TestCompletionHandler hungUp;
+  client.AsyncReceive(DataBufferPointer(new DataBuffer), hungUp);
+  RunUntilCalled(ioService, hungUp);
+  BOOST_CHECK(hungUp.LastError());
+  client.Disconnect();
+
+  RunUntilCalled(ioService, stopped);
+  BOOST_CHECK(!stopped.LastError());
+  BOOST_CHECK_EQUAL(result->messagesFlushed, 1u);
+  BOOST_CHECK_EQUAL(result->messagesDropped, 1u);
+  BOOST_CHECK_EQUAL(result->connectionsClosed, 1u);
+  BOOST_CHECK_EQUAL(result->connectionsForced, 0u);
+  BOOST_CHECK_EQUAL(server.GetConnectionCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Server_Stop_Deadline)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  HoldingHandler * handler = new HoldingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, DeadlineTcpPort), handler);
+  server.Start();
+
+  Tcp::BasicMessagePort client(ioService);
+  TestCompletionHandler connected;
+  client.AsyncConnect(Tcp::EndPoint(TcpAddress, DeadlineTcpPort), connected);
+  RunUntilCalled(ioService, connected);
+  BOOST_REQUIRE(!connected.LastError());
+
+  client.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(0, 0))), AsioExpress::NullCompletionHandler);
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler->messages.size(), 1u);
+
+  // The handler never finishes, so the connection is closed at the deadline.
+  DrainResultPointer result(new DrainResult);
+  TestCompletionHandler stopped;
+  server.AsyncStop(100, result, stopped);
+  RunUntilCalled(ioService, stopped);
+  BOOST_CHECK(!stopped.LastError());
+  BOOST_CHECK_EQUAL(result->messagesFlushed, 0u);
+  BOOST_CHECK_EQUAL(result->messagesDropped, 1u);
+  BOOST_CHECK_EQUAL(result->connectionsClosed, 0u);
+  BOOST_CHECK_EQUAL(result->connectionsForced, 1u);
+
+  TestCompletionHandler closed;
+  client.AsyncReceive(DataBufferPointer(new DataBuffer), closed);
+  RunUntilCalled(ioService, closed);
+  BOOST_CHECK(closed.LastError());
+
+  handler->messages[0]->CallCompletionHandler(AsioExpress::Error());
+  client.Disconnect();
+  Poll(ioService);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
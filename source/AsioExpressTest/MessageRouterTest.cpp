@@ -0,0 +1,163 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/vector.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/MessageRouter.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+
+namespace
+{
+  class RoutedHandler : public MessageRouter<RoutedHandler>
+  {
+  public:
+    void ProcessPing(ServerMessage message)
+    {
+      pings.push_back(std::string(message.GetDataBuffer()->Get(), message.GetDataBuffer()->Size()));
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    void ProcessWork(ServerMessage message)
+    {
+      work.push_back(ServerMessagePointer(new ServerMessage(message)));
+    }
+
+    typedef boost::mpl::vector<
+      MessageRoute<RoutedHandler, 1, &RoutedHandler::ProcessPing>,
+      MessageRoute<RoutedHandler, 3, &RoutedHandler::ProcessWork> > Routes;
+
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    std::vector<std::string> pings;
+    std::vector<ServerMessagePointer> work;
+  };
+
+  ServerMessage MakeMessage(
+      boost::asio::io_service & ioService,
+      DataBufferPointer buffer,
+      TestCompletionHandler & completed)
+  {
+    return ServerMessage(ServerConnection(ioService, 1, ServerInterfacePointer()), buffer, completed);
+  }
+
+  // Completion handlers are called through the io_service.
+  void Poll(boost::asio::io_service & ioService)
+  {
+    ioService.poll();
+    ioService.reset();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(MessageRouterTest)
+
+BOOST_AUTO_TEST_CASE(Test_Message_Type_Frame)
+{
+  DataBufferPointer frame = MessageTypeFrame::Encode(0x1234, DataBuffer(std::string("payload")));
+  BOOST_CHECK_EQUAL(frame->Size(), MessageTypeFrame::HeaderSize + 7);
+
+  MessageTypeFrame::TypeId type = 0;
+  BOOST_REQUIRE(MessageTypeFrame::Decode(*frame, type));
+  BOOST_CHECK_EQUAL(type, 0x1234);
+  BOOST_CHECK(*frame == DataBuffer(std::string("payload")));
+
+  DataBuffer empty(*MessageTypeFrame::Encode(7, DataBuffer()));
+  BOOST_REQUIRE(MessageTypeFrame::Decode(empty, type));
+  BOOST_CHECK_EQUAL(type, 7);
+  BOOST_CHECK_EQUAL(empty.Size(), 0u);
+
+  DataBuffer tooShort(std::string("x"));
+  BOOST_CHECK(!MessageTypeFrame::Decode(tooShort, type));
+  BOOST_CHECK_EQUAL(tooShort.Size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Routing)
+{
+  boost::asio::io_service ioService;
+  RoutedHandler handler;
+
+  TestCompletionHandler ping;
+  handler.AsyncProcessMessage(MakeMessage(ioService, 
+    MessageTypeFrame::Encode(1, DataBuffer(std::string("hello"))), ping));
+  Poll(ioService);
+  BOOST_REQUIRE_EQUAL(handler.pings.size(), 1u);
+  BOOST_CHECK_EQUAL(handler.pings[0], "hello");
+  BOOST_CHECK_EQUAL(ping.Calls(), 1);
+  BOOST_CHECK(!ping.LastError());
+
+  TestCompletionHandler work;
+  handler.AsyncProcessMessage(MakeMessage(ioService, 
+    MessageTypeFrame::Encode(3, DataBuffer(std::string("job"))), work));
+  BOOST_REQUIRE_EQUAL(handler.work.size(), 1u);
+  BOOST_CHECK_EQUAL(work.Calls(), 0);
+
+  // The route counts the message while its handler has it.
+  RouteStatistics statistics;
+  BOOST_REQUIRE(handler.GetStatistics(3, statistics));
+  BOOST_CHECK_EQUAL(statistics.messages, 1u);
+  BOOST_CHECK_EQUAL(statistics.pending, 1u);
+
+  handler.work[0]->CallCompletionHandler(AsioExpress::Error(ErrorCode::MessagePortServerBusy));
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(work.Calls(), 1);
+  BOOST_CHECK_EQUAL(work.LastError().GetErrorCode(), ErrorCode::MessagePortServerBusy);
+  BOOST_REQUIRE(handler.GetStatistics(3, statistics));
+  BOOST_CHECK_EQUAL(statistics.pending, 0u);
+  BOOST_CHECK_EQUAL(statistics.failures, 1u);
+  BOOST_CHECK(statistics.GetLatencyPercentile(1.0) > 0u);
+
+  BOOST_REQUIRE(handler.GetStatistics(1, statistics));
+  BOOST_CHECK_EQUAL(statistics.messages, 1u);
+  BOOST_CHECK_EQUAL(statistics.failures, 0u);
+
+  // Types without routes, inside the table and past it, and short frames fail.
+  TestCompletionHandler unrouted;
+  handler.AsyncProcessMessage(MakeMessage(ioService, 
+    MessageTypeFrame::Encode(2, DataBuffer()), unrouted));
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(unrouted.LastError().GetErrorCode(), ErrorCode::MessagePortUnknownMessageType);
+
+  TestCompletionHandler unknown;
+  handler.AsyncProcessMessage(MakeMessage(ioService, 
+    MessageTypeFrame::Encode(900, DataBuffer()), unknown));
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(unknown.LastError().GetErrorCode(), ErrorCode::MessagePortUnknownMessageType);
+
+  TestCompletionHandler bad;
+  handler.AsyncProcessMessage(MakeMessage(ioService, 
+    DataBufferPointer(new DataBuffer(std::string("x"))), bad));
+  Poll(ioService);
+  BOOST_CHECK_EQUAL(bad.LastError().GetErrorCode(), ErrorCode::MessagePortBadFrame);
+
+  BOOST_CHECK(!handler.GetStatistics(2, statistics));
+  BOOST_CHECK(!handler.GetStatistics(900, statistics));
+  BOOST_CHECK_EQUAL(handler.pings.size(), 1u);
+  BOOST_CHECK_EQUAL(handler.work.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
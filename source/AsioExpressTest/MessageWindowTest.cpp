@@ -0,0 +1,165 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/private/MessageWindow.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+
+namespace
+{
+  AsioExpress::Error const Failed(boost::asio::error::connection_reset);
+
+  DataBufferPointer Buffer(std::string const & text)
+  {
+    return DataBufferPointer(new DataBuffer(text));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(MessageWindowTest)
+
+BOOST_AUTO_TEST_CASE(Test_Unordered_Completions)
+{
+  boost::asio::io_service ioService;
+  MessageWindow window(ioService, 3, false);
+
+  unsigned int first = window.Begin();
+  unsigned int second = window.Begin();
+  BOOST_CHECK(!window.IsFull());
+  unsigned int third = window.Begin();
+  BOOST_CHECK(window.IsFull());
+
+  MessageWindow::CompletionList ready;
+  DataBufferPointer buffer = Buffer("third");
+  window.Complete(third, buffer, Failed, ready);
+  BOOST_REQUIRE_EQUAL(ready.size(), 1u);
+  BOOST_CHECK(!buffer);
+  BOOST_CHECK(*ready[0].buffer == DataBuffer("third"));
+  BOOST_CHECK(ready[0].error);
+  BOOST_CHECK(!window.IsFull());
+
+  ready.clear();
+  buffer = Buffer("first");
+  window.Complete(first, buffer, AsioExpress::Error(), ready);
+  buffer = Buffer("second");
+  window.Complete(second, buffer, AsioExpress::Error(), ready);
+  BOOST_REQUIRE_EQUAL(ready.size(), 2u);
+  BOOST_CHECK(*ready[0].buffer == DataBuffer("first"));
+  BOOST_CHECK(*ready[1].buffer == DataBuffer("second"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Ordered_Completions)
+{
+  boost::asio::io_service ioService;
+  MessageWindow window(ioService, 3, true);
+
+  unsigned int first = window.Begin();
+  unsigned int second = window.Begin();
+  unsigned int third = window.Begin();
+
+  // Later messages wait for the first.
+  MessageWindow::CompletionList ready;
+  DataBufferPointer buffer = Buffer("third");
+  window.Complete(third, buffer, AsioExpress::Error(), ready);
+  buffer = Buffer("second");
+  window.Complete(second, buffer, Failed, ready);
+  BOOST_CHECK(ready.empty());
+  BOOST_CHECK(window.IsFull());
+
+  buffer = Buffer("first");
+  window.Complete(first, buffer, AsioExpress::Error(), ready);
+  BOOST_REQUIRE_EQUAL(ready.size(), 3u);
+  BOOST_CHECK(*ready[0].buffer == DataBuffer("first"));
+  BOOST_CHECK(*ready[1].buffer == DataBuffer("second"));
+  BOOST_CHECK(ready[1].error);
+  BOOST_CHECK(*ready[2].buffer == DataBuffer("third"));
+  BOOST_CHECK(!window.IsFull());
+
+  // Sequence numbers carry on after the window empties.
+  unsigned int fourth = window.Begin();
+  ready.clear();
+  buffer = Buffer("fourth");
+  window.Complete(fourth, buffer, AsioExpress::Error(), ready);
+  BOOST_REQUIRE_EQUAL(ready.size(), 1u);
+  BOOST_CHECK(*ready[0].buffer == DataBuffer("fourth"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Wait_For_Slot)
+{
+  boost::asio::io_service ioService;
+  MessageWindow window(ioService, 1, false);
+
+  unsigned int sequence = window.Begin();
+  TestCompletionHandler waiter;
+  window.AsyncWaitForSlot(waiter);
+  ioService.poll();
+  BOOST_CHECK_EQUAL(waiter.Calls(), 0);
+
+  MessageWindow::CompletionList ready;
+  DataBufferPointer buffer = Buffer("message");
+  window.Complete(sequence, buffer, AsioExpress::Error(), ready);
+
+  // The waiter is never called from inside the completion.
+  BOOST_CHECK_EQUAL(waiter.Calls(), 0);
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(waiter.Calls(), 1);
+  BOOST_CHECK(!waiter.LastError());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Close)
+{
+  boost::asio::io_service ioService;
+  MessageWindow window(ioService, 1, true);
+
+  unsigned int sequence = window.Begin();
+  TestCompletionHandler waiter;
+  window.AsyncWaitForSlot(waiter);
+
+  BOOST_CHECK(window.Close());
+  BOOST_CHECK(!window.Close());
+  ioService.poll();
+  BOOST_CHECK_EQUAL(waiter.Calls(), 1);
+  BOOST_CHECK_EQUAL(waiter.LastError().GetErrorCode(), boost::asio::error::operation_aborted);
+
+  // Messages completed after the connection has gone are dropped.
+  MessageWindow::CompletionList ready;
+  DataBufferPointer buffer = Buffer("message");
+  window.Complete(sequence, buffer, Failed, ready);
+  BOOST_CHECK(ready.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Test_Buffer_Pool)
+{
+  boost::asio::io_service ioService;
+  MessageWindow window(ioService, 2, false);
+
+  DataBufferPointer buffer = window.GetBuffer();
+  DataBuffer * pooled = buffer.get();
+  unsigned int sequence = window.Begin();
+
+  MessageWindow::CompletionList ready;
+  window.Complete(sequence, buffer, AsioExpress::Error(), ready);
+  window.Recycle(ready);
+  BOOST_CHECK(ready[0].buffer == 0);
+  BOOST_CHECK(window.GetBuffer().get() == pooled);
+
+  // A buffer something else still refers to is not handed out again.
+  buffer = window.GetBuffer();
+  DataBufferPointer kept = buffer;
+  sequence = window.Begin();
+  ready.clear();
+  window.Complete(sequence, buffer, AsioExpress::Error(), ready);
+  window.Recycle(ready);
+  BOOST_CHECK(window.GetBuffer() != kept);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,281 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <map>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/ConsistentHashStrategy.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/ClientServer/PooledMessagePortClient.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47314";
+  int const ThreadCount = 4;
+  int const ThroughputMessageCount = 500;
+
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef PooledMessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  // Counts the messages the server receives on each connection.
+  class CountingHandler : public ServerEventHandler
+  {
+  public:
+    CountingHandler() :
+      count(0)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        std::string text(message.GetDataBuffer()->Get(), message.GetDataBuffer()->Size());
+        ports[text].insert(message.GetMessagePortId());
+        ++received[message.GetMessagePortId()];
+      }
+      ++count;
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    boost::mutex                                      mutex;
+    boost::atomic<int>                                count;
+    std::map<std::string, std::set<MessagePortId> >   ports;
+    std::map<MessagePortId, int>                      received;
+  };
+
+  class ConnectingHandler : public ClientEventHandler
+  {
+  public:
+    ConnectingHandler() :
+      connects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    boost::atomic<int> connects;
+  };
+
+  template<typename Value>
+  bool WaitFor(boost::atomic<Value> const & value, Value expected)
+  {
+    for (int i = 0; i < 10000 && value < expected; ++i)
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    return value >= expected;
+  }
+
+  std::string Text(int index)
+  {
+    std::ostringstream text;
+    text << "Message " << index;
+    return text.str();
+  }
+}
+
+struct PooledMessagePortClientFixture : UnitTestModeFixture
+{
+  PooledMessagePortClientFixture() :
+    work(new boost::asio::io_service::work(ioService))
+  {
+    for (int i = 0; i < ThreadCount; ++i)
+      threads.create_thread(boost::bind(&boost::asio::io_service::run, &ioService));
+  }
+
+  ~PooledMessagePortClientFixture()
+  {
+    work.reset();
+    ioService.stop();
+    threads.join_all();
+  }
+
+  boost::asio::io_service                               ioService;
+  boost::scoped_ptr<boost::asio::io_service::work>      work;
+  boost::thread_group                                   threads;
+};
+
+BOOST_AUTO_TEST_SUITE(PooledMessagePortClientTest)
+
+BOOST_AUTO_TEST_CASE(Test_Pool_Selects_Connected)
+{
+  ClientPool pool(DispatchStrategyPointer(new LeastOutstandingStrategy), 3);
+
+  // With none connected the connections take turns.
+  BOOST_CHECK_EQUAL(pool.Select(""), 0u);
+  BOOST_CHECK_EQUAL(pool.Select(""), 1u);
+  BOOST_CHECK_EQUAL(pool.Select(""), 2u);
+
+  pool.Connected(0);
+  pool.Connected(2);
+  unsigned int first = pool.Select("");
+  unsigned int second = pool.Select("");
+  BOOST_CHECK(first != second);
+  BOOST_CHECK(first != 1 && second != 1);
+
+  // The connection whose send completes is the least loaded.
+  pool.Completed(second);
+  BOOST_CHECK_EQUAL(pool.Select(""), second);
+
+  pool.Disconnected(second);
+  BOOST_CHECK_EQUAL(pool.Select(""), first);
+  BOOST_CHECK_EQUAL(pool.Select(""), first);
+}
+
+BOOST_FIXTURE_TEST_CASE(Test_Tcp_Sends_Spread, PooledMessagePortClientFixture)
+{
+  CountingHandler * serverHandler = new CountingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  ConnectingHandler * clientHandler = new ConnectingHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler, 4);
+  BOOST_CHECK_EQUAL(client.GetConnectionCount(), 4u);
+  client.Connect();
+  BOOST_REQUIRE(WaitFor(clientHandler->connects, 4));
+  BOOST_CHECK(!client.GetAddress().empty());
+
+  for (int i = 0; i < 100; ++i)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(Text(i))), NullCompletionHandler);
+  BOOST_REQUIRE(WaitFor(serverHandler->count, 100));
+
+  {
+    boost::mutex::scoped_lock lock(serverHandler->mutex);
+    BOOST_CHECK_EQUAL(serverHandler->received.size(), 4u);
+  }
+
+  client.ShutDown();
+  server.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(Test_Tcp_Sends_Sticky_By_Key, PooledMessagePortClientFixture)
+{
+  CountingHandler * serverHandler = new CountingHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  ConnectingHandler * clientHandler = new ConnectingHandler;
+  ClientType client(
+    ioService,
+    Tcp::EndPoint(TcpAddress, TcpPort),
+    clientHandler,
+    4,
+    DispatchStrategyPointer(new ConsistentHashStrategy));
+  client.Connect();
+  BOOST_REQUIRE(WaitFor(clientHandler->connects, 4));
+
+  // The key is sent as the message so the server can tell them apart.
+  for (int i = 0; i < 100; ++i)
+  {
+    std::string key = Text(i % 10);
+    client.AsyncSend(key, DataBufferPointer(new DataBuffer(key)), NullCompletionHandler);
+  }
+  BOOST_REQUIRE(WaitFor(serverHandler->count, 100));
+
+  {
+    boost::mutex::scoped_lock lock(serverHandler->mutex);
+    BOOST_CHECK_EQUAL(serverHandler->ports.size(), 10u);
+    std::map<std::string, std::set<MessagePortId> >::const_iterator  it = serverHandler->ports.begin();
+    std::map<std::string, std::set<MessagePortId> >::const_iterator end = serverHandler->ports.end();
+    for (; it != end; ++it)
+      BOOST_CHECK_EQUAL(it->second.size(), 1u);
+    BOOST_CHECK(serverHandler->received.size() > 1);
+  }
+
+  client.ShutDown();
+  server.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(Test_Tcp_Throughput, PooledMessagePortClientFixture)
+{
+  // The rates are only reported, so a short run is enough to show them
+  // without slowing the suite.
+  unsigned int const connectionCounts[] = { 1, 4, 16 };
+  std::string const payload(256, 'x');
+
+  for (int i = 0; i < 3; ++i)
+  {
+    CountingHandler * serverHandler = new CountingHandler;
+    ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+    server.Start();
+
+    ConnectingHandler * clientHandler = new ConnectingHandler;
+    ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler, connectionCounts[i]);
+    client.Connect();
+    BOOST_REQUIRE(WaitFor(clientHandler->connects, static_cast<int>(connectionCounts[i])));
+
+    boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    for (int message = 0; message < ThroughputMessageCount; ++message)
+      client.AsyncSend(DataBufferPointer(new DataBuffer(payload)), NullCompletionHandler);
+    BOOST_REQUIRE(WaitFor(serverHandler->count, ThroughputMessageCount));
+    boost::chrono::duration<double> elapsed = boost::chrono::steady_clock::now() - start;
+
+    BOOST_TEST_MESSAGE(
+      connectionCounts[i] << " connections: " <<
+      static_cast<int>(ThroughputMessageCount / elapsed.count()) << " messages/s");
+
+    client.ShutDown();
+    server.Stop();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
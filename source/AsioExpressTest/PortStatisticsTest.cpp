@@ -0,0 +1,207 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/MessagePort/PortStatistics.hpp"
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47320";
+  int const MessageCount = 10;
+  std::size_t const MessageSize = 100;
+
+  // Sends every message straight back.
+  class EchoHandler : public ServerEventHandler
+  {
+  public:
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      message.AsyncSend(
+        message.GetMessagePortId(),
+        DataBufferPointer(new DataBuffer(*message.GetDataBuffer())),
+        NullCompletionHandler);
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+  };
+
+  class CountingHandler : public ClientEventHandler
+  {
+  public:
+    CountingHandler() :
+      connects(0),
+      messages(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      ++messages;
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int messages;
+  };
+}
+
+BOOST_FIXTURE_TEST_SUITE(PortStatisticsTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Counters)
+{
+  PortCounters counters;
+  PortStatistics statistics;
+
+  counters.Get(statistics);
+  BOOST_CHECK(statistics.lastActivity.is_not_a_date_time());
+
+  // A send is queued until it completes.
+  counters.SendStarted(10);
+  counters.SendStarted(20);
+  counters.Get(statistics);
+  BOOST_CHECK_EQUAL(statistics.sendQueueDepth, 2u);
+  BOOST_CHECK_EQUAL(statistics.sendQueueBytes, 30u);
+  BOOST_CHECK_EQUAL(statistics.messagesSent, 0u);
+
+  // A send that took 300 microseconds is counted in the 256 to 511 bucket.
+  counters.SendCompleted(10, PortCounters::Now() - 300, true);
+  counters.SendCompleted(20, PortCounters::Now(), false);
+  counters.Received(5);
+  counters.Get(statistics);
+  BOOST_CHECK_EQUAL(statistics.sendQueueDepth, 0u);
+  BOOST_CHECK_EQUAL(statistics.sendQueueBytes, 0u);
+  BOOST_CHECK_EQUAL(statistics.messagesSent, 1u);
+  BOOST_CHECK_EQUAL(statistics.bytesSent, 10u);
+  BOOST_CHECK_EQUAL(statistics.messagesReceived, 1u);
+  BOOST_CHECK_EQUAL(statistics.bytesReceived, 5u);
+  BOOST_CHECK(!statistics.lastActivity.is_not_a_date_time());
+  BOOST_CHECK_EQUAL(statistics.GetLatencyCount(), 1u);
+  BOOST_CHECK(statistics.sendLatency[8] == 1u || statistics.sendLatency[9] == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Latency_Percentile)
+{
+  PortStatistics statistics;
+  BOOST_CHECK_EQUAL(statistics.GetLatencyPercentile(0.99), 0u);
+
+  statistics.sendLatency[2] = 90;
+  statistics.sendLatency[10] = 10;
+  BOOST_CHECK_EQUAL(statistics.GetLatencyPercentile(0.5), 8u);
+  BOOST_CHECK_EQUAL(statistics.GetLatencyPercentile(0.9), 8u);
+  BOOST_CHECK_EQUAL(statistics.GetLatencyPercentile(0.99), 2048u);
+
+  // Connections add up, keeping the latest activity.
+  PortStatistics other;
+  other.messagesSent = 3;
+  other.sendLatency[10] = 100;
+  other.lastActivity = boost::posix_time::ptime(boost::gregorian::date(2013, 1, 1));
+  statistics.Add(other);
+  BOOST_CHECK_EQUAL(statistics.messagesSent, 3u);
+  BOOST_CHECK_EQUAL(statistics.GetLatencyCount(), 200u);
+  BOOST_CHECK_EQUAL(statistics.GetLatencyPercentile(0.5), 2048u);
+  BOOST_CHECK(statistics.lastActivity == other.lastActivity);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Connection_Statistics)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), new EchoHandler);
+  server.Start();
+
+  CountingHandler * clientHandler = new CountingHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler);
+  PortStatistics statistics;
+  BOOST_CHECK(!client.GetStatistics(statistics));
+
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 1)));
+
+  for (int i = 0; i < MessageCount; ++i)
+    client.AsyncSend(DataBufferPointer(new DataBuffer(std::string(MessageSize, 'x'))), NullCompletionHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->messages), MessageCount)));
+
+  BOOST_REQUIRE(client.GetStatistics(statistics));
+  BOOST_CHECK_EQUAL(statistics.messagesSent, static_cast<boost::uint64_t>(MessageCount));
+  BOOST_CHECK_EQUAL(statistics.bytesSent, MessageCount * MessageSize);
+  BOOST_CHECK_EQUAL(statistics.messagesReceived, static_cast<boost::uint64_t>(MessageCount));
+  BOOST_CHECK_EQUAL(statistics.bytesReceived, MessageCount * MessageSize);
+  BOOST_CHECK_EQUAL(statistics.sendQueueDepth, 0u);
+  BOOST_CHECK_EQUAL(statistics.GetLatencyCount(), static_cast<boost::uint64_t>(MessageCount));
+  BOOST_CHECK(statistics.GetLatencyPercentile(0.99) > 0u);
+
+  // The server sees the same traffic the other way round.
+  MessagePortIdList ids;
+  server.GetIds(ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 1u);
+  PortStatistics serverStatistics;
+  BOOST_REQUIRE(server.GetStatistics(ids[0], serverStatistics));
+  BOOST_CHECK_EQUAL(serverStatistics.messagesReceived, static_cast<boost::uint64_t>(MessageCount));
+  BOOST_CHECK_EQUAL(serverStatistics.bytesReceived, MessageCount * MessageSize);
+  BOOST_CHECK_EQUAL(serverStatistics.messagesSent, static_cast<boost::uint64_t>(MessageCount));
+  BOOST_CHECK(!server.GetStatistics(ids[0] + 1, serverStatistics));
+
+  client.ShutDown();
+  server.Stop();
+  ioService.poll();
+  BOOST_CHECK(!client.GetStatistics(statistics));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,312 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "AsioExpress/ErrorCodes.hpp"
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/RpcMessagePortClient.hpp"
+#include "AsioExpress/ClientServer/RpcServerEventHandler.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47318";
+
+  // Replies to each request with its own text, except requests for "hold"
+  // which are never answered.
+  class EchoRpcHandler : public RpcServerEventHandler
+  {
+  public:
+    EchoRpcHandler() :
+      requests(0),
+      oneWays(0)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessRequest(RpcRequest request)
+    {
+      ++requests;
+      if (!(*request.GetDataBuffer() == DataBuffer("hold")))
+      {
+        request.AsyncReply(
+          DataBufferPointer(new DataBuffer(*request.GetDataBuffer())),
+          NullCompletionHandler);
+      }
+      request.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual void AsyncProcessOneWay(ServerMessage message)
+    {
+      ++oneWays;
+      message.AsyncSend(
+        message.GetMessagePortId(),
+        OneWay(*message.GetDataBuffer()),
+        NullCompletionHandler);
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int requests;
+    int oneWays;
+  };
+
+  class CountingHandler : public ClientEventHandler
+  {
+  public:
+    CountingHandler() :
+      connects(0),
+      disconnects(0),
+      messages(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+      ++disconnects;
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      ++messages;
+      lastMessage = *message.GetDataBuffer();
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int disconnects;
+    int messages;
+    DataBuffer lastMessage;
+  };
+
+  bool IsCompleted(TestCompletionHandler & handler, int calls)
+  {
+    return handler.Calls() >= calls;
+  }
+}
+
+struct RpcFixture : UnitTestModeFixture
+{
+  RpcFixture() :
+    calls(new RpcCalls(ioService))
+  {
+  }
+
+  ~RpcFixture()
+  {
+    calls->FailAll(AsioExpress::Error(boost::asio::error::operation_aborted));
+    ioService.reset();
+    ioService.poll();
+  }
+
+  boost::asio::io_service     ioService;
+  RpcCallsPointer             calls;
+};
+
+BOOST_FIXTURE_TEST_SUITE(RpcMessagePortClientTest, RpcFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Frame)
+{
+  DataBufferPointer frame = RpcFrame::Encode(RpcFrame::Request, 0x01020304, DataBuffer("payload"));
+  BOOST_REQUIRE_EQUAL(frame->Size(), RpcFrame::HeaderSize + 7);
+  BOOST_CHECK_EQUAL(frame->Get()[0], 2);
+  BOOST_CHECK_EQUAL(frame->Get()[1], 1);
+  BOOST_CHECK_EQUAL(frame->Get()[4], 4);
+
+  RpcFrame::Kind kind = RpcFrame::Message;
+  RpcFrame::CallId id = 0;
+  BOOST_REQUIRE(RpcFrame::Decode(*frame, kind, id));
+  BOOST_CHECK_EQUAL(kind, RpcFrame::Request);
+  BOOST_CHECK_EQUAL(id, 0x01020304u);
+  BOOST_CHECK(*frame == DataBuffer("payload"));
+
+  // A message that is too short or of no known kind is left as it was.
+  DataBuffer shortMessage("abc");
+  BOOST_CHECK(!RpcFrame::Decode(shortMessage, kind, id));
+  BOOST_CHECK(shortMessage == DataBuffer("abc"));
+
+  DataBuffer unknownKind(std::string("\x09\0\0\0\x01text", 9));
+  BOOST_CHECK(!RpcFrame::Decode(unknownKind, kind, id));
+  BOOST_CHECK_EQUAL(unknownKind.Size(), 9u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Calls_Complete_By_Id)
+{
+  TestCompletionHandler first;
+  TestCompletionHandler second;
+  DataBufferPointer firstReply(new DataBuffer);
+  DataBufferPointer secondReply(new DataBuffer);
+
+  RpcCalls::CallId firstId = calls->Begin(firstReply, first, 0);
+  RpcCalls::CallId secondId = calls->Begin(secondReply, second, 0);
+  BOOST_CHECK(firstId != 0);
+  BOOST_CHECK(firstId != secondId);
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 2u);
+
+  // The replies may come in any order.
+  BOOST_CHECK(calls->Complete(secondId, DataBuffer("second")));
+  BOOST_CHECK(calls->Complete(firstId, DataBuffer("first")));
+  ioService.poll();
+  BOOST_CHECK_EQUAL(first.Calls(), 1);
+  BOOST_CHECK_EQUAL(second.Calls(), 1);
+  BOOST_CHECK(*firstReply == DataBuffer("first"));
+  BOOST_CHECK(*secondReply == DataBuffer("second"));
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 0u);
+
+  // The slot is reused, but a reply to the old id does not find the new call.
+  RpcCalls::CallId thirdId = calls->Begin(firstReply, first, 0);
+  BOOST_CHECK(thirdId != firstId && thirdId != secondId);
+  BOOST_CHECK(!calls->Complete(firstId, DataBuffer("late")));
+  BOOST_CHECK(!calls->Complete(secondId, DataBuffer("late")));
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 1u);
+
+  calls->RequestSent(thirdId, AsioExpress::Error());
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 1u);
+  calls->RequestSent(thirdId, AsioExpress::Error(boost::asio::error::connection_reset));
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(first.Calls(), 2);
+  BOOST_CHECK_EQUAL(first.LastError().GetErrorCode(), boost::asio::error::connection_reset);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Calls_Time_Out)
+{
+  TestCompletionHandler quick;
+  TestCompletionHandler slow;
+  TestCompletionHandler answered;
+
+  calls->Begin(DataBufferPointer(), quick, 20);
+  RpcCalls::CallId slowId = calls->Begin(DataBufferPointer(), slow, 5000);
+  RpcCalls::CallId answeredId = calls->Begin(DataBufferPointer(), answered, 20);
+  BOOST_CHECK(calls->Complete(answeredId, DataBuffer("reply")));
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(quick), 1)));
+  BOOST_CHECK_EQUAL(quick.LastError().GetErrorCode(), ErrorCode::MessagePortCallTimeout);
+  BOOST_CHECK_EQUAL(answered.Calls(), 1);
+  BOOST_CHECK(!answered.LastError());
+  BOOST_CHECK_EQUAL(slow.Calls(), 0);
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 1u);
+
+  // The calls still waiting fail together, and their deadlines are dropped.
+  calls->FailAll(AsioExpress::Error(boost::asio::error::connection_reset));
+  ioService.reset();
+  ioService.poll();
+  BOOST_CHECK_EQUAL(slow.Calls(), 1);
+  BOOST_CHECK_EQUAL(slow.LastError().GetErrorCode(), boost::asio::error::connection_reset);
+  BOOST_CHECK(!calls->Complete(slowId, DataBuffer("late")));
+  BOOST_CHECK_EQUAL(calls->GetOutstanding(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Calls)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef RpcMessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  int const CallCount = 50;
+
+  boost::asio::io_service::work work(ioService);
+
+  EchoRpcHandler * serverHandler = new EchoRpcHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  CountingHandler * clientHandler = new CountingHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), clientHandler);
+  client.SetMessageWindow(16);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->connects), 1)));
+
+  // Many calls wait on the one connection and each gets its own reply.
+  TestCompletionHandler handler;
+  std::vector<DataBufferPointer> replies;
+  for (int i = 0; i < CallCount; ++i)
+  {
+    replies.push_back(DataBufferPointer(new DataBuffer));
+    client.AsyncCall(
+      DataBufferPointer(new DataBuffer(boost::lexical_cast<std::string>(i))),
+      replies.back(),
+      5000,
+      handler);
+  }
+  BOOST_CHECK_EQUAL(client.GetOutstandingCalls(), static_cast<std::size_t>(CallCount));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(handler), CallCount)));
+  BOOST_CHECK(!handler.LastError());
+  for (int i = 0; i < CallCount; ++i)
+    BOOST_CHECK(*replies[i] == DataBuffer(boost::lexical_cast<std::string>(i)));
+  BOOST_CHECK_EQUAL(client.GetOutstandingCalls(), 0u);
+
+  // One-way messages pass through both ways without a reply.
+  client.AsyncSend(DataBufferPointer(new DataBuffer("event")), NullCompletionHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(clientHandler->messages), 1)));
+  BOOST_CHECK_EQUAL(serverHandler->oneWays, 1);
+  BOOST_CHECK(clientHandler->lastMessage == DataBuffer("event"));
+
+  // A call that is never answered times out.
+  TestCompletionHandler heldHandler;
+  client.AsyncCall(DataBufferPointer(new DataBuffer("hold")), DataBufferPointer(), 30, heldHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(heldHandler), 1)));
+  BOOST_CHECK_EQUAL(heldHandler.LastError().GetErrorCode(), ErrorCode::MessagePortCallTimeout);
+
+  // A call without a deadline fails once the connection is lost.
+  client.AsyncCall(DataBufferPointer(new DataBuffer("hold")), DataBufferPointer(), 0, heldHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->requests), CallCount + 2)));
+  BOOST_CHECK_EQUAL(client.GetOutstandingCalls(), 1u);
+  server.Stop();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsCompleted, boost::ref(heldHandler), 2)));
+  BOOST_CHECK(heldHandler.LastError());
+  BOOST_CHECK(heldHandler.LastError().GetErrorCode() != ErrorCode::MessagePortCallTimeout);
+  BOOST_CHECK_EQUAL(client.GetOutstandingCalls(), 0u);
+
+  client.ShutDown();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,243 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47325";
+  int const ClientCount = 3;
+  int const MessageCount = 5;
+
+  class CountingServerHandler : public ServerEventHandler
+  {
+  public:
+    CountingServerHandler() :
+      connects(0),
+      disconnects(0)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+      ++disconnects;
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int disconnects;
+  };
+
+  class RecordingClientHandler : public ClientEventHandler
+  {
+  public:
+    RecordingClientHandler() :
+      connects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      DataBufferPointer buffer = message.GetDataBuffer();
+      received.push_back(std::string(buffer->Get(), buffer->Size()));
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    std::vector<std::string> received;
+  };
+
+  bool HasReceived(RecordingClientHandler const & handler, std::size_t expected)
+  {
+    return handler.received.size() >= expected;
+  }
+
+  void SetError(AsioExpress::Error & result, int & calls, AsioExpress::Error error)
+  {
+    result = error;
+    ++calls;
+  }
+
+  std::string MakeText(int client, int message)
+  {
+    return boost::lexical_cast<std::string>(client) + "-" + boost::lexical_cast<std::string>(message);
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(SendManyTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Send_Many)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+  typedef boost::shared_ptr<ClientType> ClientPointer;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  CountingServerHandler * serverHandler = new CountingServerHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  std::vector<ClientPointer> clients;
+  std::vector<RecordingClientHandler *> handlers;
+  for (int client = 0; client < ClientCount; ++client)
+  {
+    handlers.push_back(new RecordingClientHandler);
+    clients.push_back(ClientPointer(
+      new ClientType(ioService, Tcp::EndPoint(TcpAddress, TcpPort), handlers.back())));
+    clients.back()->Connect();
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(handlers.back()->connects), 1)));
+  }
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), ClientCount)));
+
+  MessagePortIdList ids;
+  server.GetIds(ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), static_cast<std::size_t>(ClientCount));
+
+  // One more client connects and leaves again.
+  ClientType leaving(ioService, Tcp::EndPoint(TcpAddress, TcpPort), new RecordingClientHandler);
+  leaving.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), ClientCount + 1)));
+  MessagePortIdList allIds;
+  server.GetIds(allIds);
+  BOOST_REQUIRE_EQUAL(allIds.size(), static_cast<std::size_t>(ClientCount + 1));
+  MessagePortId goneId = 0;
+  for (std::size_t i = 0; i < allIds.size(); ++i)
+  {
+    if (std::find(ids.begin(), ids.end(), allIds[i]) == ids.end())
+      goneId = allIds[i];
+  }
+  BOOST_REQUIRE(goneId != 0);
+  leaving.ShutDown();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->disconnects), 1)));
+
+  // The messages for the clients are interleaved in the list, and one goes
+  // to the port that has gone.
+  SendList list;
+  for (int message = 0; message < MessageCount; ++message)
+  {
+    for (int client = 0; client < ClientCount; ++client)
+      list.push_back(SendItem(ids[client], DataBufferPointer(new DataBuffer(MakeText(client, message)))));
+  }
+  list.push_back(SendItem(goneId, DataBufferPointer(new DataBuffer(std::string("gone")))));
+
+  SendManyResultPointer result(new SendManyResult);
+  AsioExpress::Error error(ErrorCode::MessagePortServerBusy);
+  int calls = 0;
+  server.AsyncSendMany(list, result, boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(calls), 1)));
+  for (int client = 0; client < ClientCount; ++client)
+    BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasReceived, boost::cref(*handlers[client]), MessageCount)));
+
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(!error);
+  BOOST_CHECK_EQUAL(result->GetItemCount(), list.size());
+  BOOST_CHECK(result->IsComplete());
+
+  // Each client gets the messages of one port, in the order they were
+  // listed.
+  std::set<std::string> firstMessages;
+  for (int client = 0; client < ClientCount; ++client)
+  {
+    std::vector<std::string> const & received = handlers[client]->received;
+    BOOST_REQUIRE_EQUAL(received.size(), static_cast<std::size_t>(MessageCount));
+    std::string port = received[0].substr(0, received[0].find('-'));
+    firstMessages.insert(received[0]);
+    for (int message = 0; message < MessageCount; ++message)
+      BOOST_CHECK_EQUAL(received[message], port + "-" + boost::lexical_cast<std::string>(message));
+
+    // A batch counts as a send of each of its messages.
+    PortStatistics statistics;
+    BOOST_REQUIRE(server.GetStatistics(ids[client], statistics));
+    BOOST_CHECK_EQUAL(statistics.messagesSent, static_cast<boost::uint64_t>(MessageCount));
+    BOOST_CHECK_EQUAL(statistics.sendQueueDepth, 0u);
+  }
+  BOOST_CHECK_EQUAL(firstMessages.size(), static_cast<std::size_t>(ClientCount));
+
+  // A list with nothing to send completes at once.
+  calls = 0;
+  server.AsyncSendMany(SendList(), boost::bind(SetError, boost::ref(error), boost::ref(calls), _1));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(calls), 1)));
+  BOOST_CHECK(!error);
+
+  for (int client = 0; client < ClientCount; ++client)
+    clients[client]->ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Send_Many_Result)
+{
+  SendManyResult result;
+  BOOST_CHECK(result.IsComplete());
+
+  result.SetItemCount(4);
+  result.AddFailure(2, 7, AsioExpress::Error(ErrorCode::MessagePortServerBusy));
+  BOOST_CHECK(!result.IsComplete());
+  BOOST_CHECK_EQUAL(result.GetItemCount(), 4u);
+  BOOST_REQUIRE_EQUAL(result.GetFailures().size(), 1u);
+  BOOST_CHECK_EQUAL(result.GetFailures()[0].position, 2u);
+  BOOST_CHECK_EQUAL(result.GetFailures()[0].id, 7u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
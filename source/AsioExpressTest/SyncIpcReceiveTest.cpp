@@ -0,0 +1,172 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpressError/CommonException.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+#include "AsioExpress/MessagePort/Ipc/ErrorCodes.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePort.hpp"
+#include "AsioExpress/MessagePort/Ipc/MessagePortAcceptor.hpp"
+#include "AsioExpress/MessagePort/SyncIpc/MessagePort.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpress::Testing;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const EndPointName = "SyncIpcReceiveTest";
+
+  void Connect(SyncIpc::MessagePort & client, Ipc::EndPoint endPoint)
+  {
+    client.Connect(endPoint);
+  }
+
+  void ReceiveUntilDisconnected(SyncIpc::MessagePort & client, Error & error)
+  {
+    try
+    {
+      DataBufferPointer buffer(new DataBuffer);
+      client.Receive(buffer);
+    }
+    catch(CommonException & ex)
+    {
+      error = ex.GetError();
+    }
+  }
+
+  std::string MessageText(int index)
+  {
+    std::ostringstream text;
+    text << "Message " << index;
+    return text.str();
+  }
+}
+
+struct SyncIpcReceiveFixture : UnitTestModeFixture
+{
+  SyncIpcReceiveFixture() :
+    work(ioService),
+    endPoint(EndPointName),
+    acceptor(ioService, endPoint),
+    server(ioService)
+  {
+    // The synchronous connect blocks until the acceptor, which runs on this
+    // thread, acknowledges it.
+    TestCompletionHandler accepted;
+    acceptor.AsyncAccept(server, accepted);
+    boost::thread connectThread(Connect, boost::ref(client), endPoint);
+    RunUntilCalled(ioService, accepted);
+    connectThread.join();
+
+    BOOST_REQUIRE_MESSAGE(!accepted.LastError(), accepted.LastError().Message());
+    BOOST_REQUIRE(client.IsConnected());
+  }
+
+  ~SyncIpcReceiveFixture()
+  {
+    client.Disconnect();
+  }
+
+  void Send(int count)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      TestCompletionHandler sent;
+      server.AsyncSend(DataBufferPointer(new DataBuffer(MessageText(i).c_str())), sent);
+      RunUntilCalled(ioService, sent);
+      BOOST_REQUIRE(!sent.LastError());
+    }
+  }
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work;
+  Ipc::EndPoint endPoint;
+  Ipc::MessagePortAcceptor acceptor;
+  Ipc::MessagePort server;
+  SyncIpc::MessagePort client;
+};
+
+BOOST_FIXTURE_TEST_SUITE(SyncIpcReceiveTest, SyncIpcReceiveFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Receive_Reuses_Port_Buffer)
+{
+  Send(3);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    DataBufferPointer buffer(new DataBuffer);
+    BOOST_REQUIRE(client.Receive(buffer, 1000));
+    BOOST_CHECK(*buffer == DataBuffer(MessageText(i).c_str()));
+  }
+
+  DataBufferPointer buffer(new DataBuffer);
+  BOOST_CHECK(!client.Receive(buffer, 50));
+}
+
+BOOST_AUTO_TEST_CASE(Test_ReceiveMany_Drains_Ready_Messages)
+{
+  Send(5);
+
+  std::vector<DataBufferPointer> buffers;
+  BOOST_REQUIRE_EQUAL(client.ReceiveMany(buffers, 10, 1000), 5u);
+  BOOST_REQUIRE_EQUAL(buffers.size(), 5u);
+  for (int i = 0; i < 5; ++i)
+    BOOST_CHECK(*buffers[i] == DataBuffer(MessageText(i).c_str()));
+
+  Send(3);
+
+  // The buffers handed back are reused for the next call.
+  DataBuffer * reused = buffers[0].get();
+  BOOST_REQUIRE_EQUAL(client.ReceiveMany(buffers, 2, 1000), 2u);
+  BOOST_CHECK(buffers[0].get() == reused);
+  BOOST_CHECK(*buffers[1] == DataBuffer(MessageText(1).c_str()));
+
+  BOOST_REQUIRE_EQUAL(client.ReceiveMany(buffers, 2, 1000), 1u);
+  BOOST_CHECK(*buffers[0] == DataBuffer(MessageText(2).c_str()));
+}
+
+BOOST_AUTO_TEST_CASE(Test_ReceiveMany_Timeout)
+{
+  using namespace boost::chrono;
+
+  steady_clock::time_point start = steady_clock::now();
+
+  std::vector<DataBufferPointer> buffers;
+  BOOST_CHECK_EQUAL(client.ReceiveMany(buffers, 10, 100), 0u);
+  BOOST_CHECK(buffers.empty());
+
+  steady_clock::duration elapsed = steady_clock::now() - start;
+  BOOST_CHECK(elapsed >= milliseconds(100));
+  BOOST_CHECK(elapsed < milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Disconnect_Wakes_Receiver)
+{
+  using namespace boost::chrono;
+
+  Error error;
+  boost::thread receiveThread(ReceiveUntilDisconnected, boost::ref(client), boost::ref(error));
+
+  // Give the receiver time to block.
+  boost::this_thread::sleep_for(milliseconds(100));
+
+  steady_clock::time_point start = steady_clock::now();
+  client.Disconnect();
+  receiveThread.join();
+  steady_clock::duration elapsed = steady_clock::now() - start;
+
+  BOOST_CHECK(error.GetErrorCode() == Ipc::ErrorCode::Disconnected);
+  BOOST_CHECK(elapsed < milliseconds(250));
+  BOOST_CHECK(!client.IsConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "AsioExpress/Testing/SetUnitTestMode.hpp"
+#include "AsioExpress/Testing/TestCompletionHandler.hpp"
+
+namespace AsioExpressTest {
+
+///
+/// Sets the unit test mode for the length of a test and puts back the mode
+/// it found. Tests on real sockets and timers turn it off, so completion
+/// handlers are posted to the io_service rather than called in place.
+///
+struct UnitTestModeFixture
+{
+  explicit UnitTestModeFixture(bool enable = false) :
+    wasUnitTestMode(AsioExpress::g_isUnitTestMode)
+  {
+    AsioExpress::SetUnitTestMode(enable);
+  }
+
+  ~UnitTestModeFixture()
+  {
+    AsioExpress::SetUnitTestMode(wasUnitTestMode);
+  }
+
+  bool wasUnitTestMode;
+};
+
+///
+/// Runs the handlers that are ready until the condition holds, for up to
+/// about two seconds. Returns whether it holds.
+///
+template<typename Condition>
+bool RunUntil(boost::asio::io_service & ioService, Condition condition)
+{
+  for (int i = 0; i < 400 && !condition(); ++i)
+  {
+    ioService.poll();
+    ioService.reset();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+  }
+  return condition();
+}
+
+///
+/// Runs the handlers that are ready for the given time, to show that
+/// something does not happen.
+///
+inline void RunFor(boost::asio::io_service & ioService, int milliseconds)
+{
+  for (int i = 0; i < milliseconds / 5; ++i)
+  {
+    ioService.poll();
+    ioService.reset();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+  }
+}
+
+///
+/// Runs handlers one at a time until the handler has been called. The
+/// caller must hold work on the io_service if the completion is posted from
+/// another thread.
+///
+inline void RunUntilCalled(
+    boost::asio::io_service & ioService,
+    AsioExpress::Testing::TestCompletionHandler & handler)
+{
+  while (handler.Calls() == 0)
+    ioService.run_one();
+}
+
+inline bool IsAtLeast(int const & value, int expected)
+{
+  return value >= expected;
+}
+
+} // namespace AsioExpressTest
@@ -0,0 +1,268 @@
+//               Copyright Ross MacGregor 2013
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "AsioExpressTest/pch.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+
+#include "AsioExpress/NullCompletionHandler.hpp"
+#include "AsioExpress/ClientServer/TopicControl.hpp"
+#include "AsioExpress/ClientServer/private/TopicIndex.hpp"
+#include "AsioExpress/ClientServer/MessagePortClient.hpp"
+#include "AsioExpress/ClientServer/MessagePortServer.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePort.hpp"
+#include "AsioExpress/MessagePort/Tcp/BasicMessagePortAcceptor.hpp"
+#include "AsioExpressTest/TestHelpers.hpp"
+
+using namespace AsioExpress;
+using namespace AsioExpress::MessagePort;
+using namespace AsioExpressTest;
+
+namespace
+{
+  char const * const TcpAddress = "127.0.0.1";
+  char const * const TcpPort = "47321";
+
+  class CountingServerHandler : public ServerEventHandler
+  {
+  public:
+    CountingServerHandler() :
+      connects(0),
+      messages(0)
+    {
+    }
+
+    virtual void ClientConnected(ServerConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ServerConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ServerMessage message)
+    {
+      ++messages;
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ServerConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ServerMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    int messages;
+  };
+
+  class RecordingClientHandler : public ClientEventHandler
+  {
+  public:
+    RecordingClientHandler() :
+      connects(0)
+    {
+    }
+
+    virtual void ClientConnected(ClientConnection)
+    {
+      ++connects;
+    }
+
+    virtual void ClientDisconnected(ClientConnection, AsioExpress::Error)
+    {
+    }
+
+    virtual void AsyncProcessMessage(ClientMessage message)
+    {
+      DataBufferPointer buffer = message.GetDataBuffer();
+      received.push_back(std::string(buffer->Get(), buffer->Size()));
+      message.CallCompletionHandler(AsioExpress::Error());
+    }
+
+    virtual AsioExpress::Error ConnectionError(ClientConnection, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    virtual AsioExpress::Error MessageError(ClientMessage, AsioExpress::Error error)
+    {
+      return error;
+    }
+
+    int connects;
+    std::vector<std::string> received;
+  };
+
+  template<typename Server>
+  bool HasTopics(Server const & server, std::size_t expected)
+  {
+    return server.GetTopicCount() == expected;
+  }
+
+  bool HasReceived(RecordingClientHandler const & handler, std::size_t expected)
+  {
+    return handler.received.size() >= expected;
+  }
+
+  void SetError(AsioExpress::Error & result, int & calls, AsioExpress::Error error)
+  {
+    result = error;
+    ++calls;
+  }
+}
+
+BOOST_FIXTURE_TEST_SUITE(TopicPublishTest, UnitTestModeFixture)
+
+BOOST_AUTO_TEST_CASE(Test_Topic_Control)
+{
+  TopicControl::Operation operation;
+  std::string topic;
+
+  BOOST_REQUIRE(TopicControl::Parse(*TopicControl::MakeSubscribe("prices"), operation, topic));
+  BOOST_CHECK_EQUAL(operation, TopicControl::Subscribe);
+  BOOST_CHECK_EQUAL(topic, "prices");
+
+  BOOST_REQUIRE(TopicControl::Parse(*TopicControl::MakeUnsubscribe(""), operation, topic));
+  BOOST_CHECK_EQUAL(operation, TopicControl::Unsubscribe);
+  BOOST_CHECK(topic.empty());
+
+  // Ordinary messages, even ones starting with a zero byte, are left alone.
+  BOOST_CHECK(!TopicControl::Parse(DataBuffer(std::string("prices")), operation, topic));
+  BOOST_CHECK(!TopicControl::Parse(DataBuffer(std::string("\0TOP", 4)), operation, topic));
+  BOOST_CHECK(!TopicControl::Parse(DataBuffer(std::string("\0TOPICX", 7)), operation, topic));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Topic_Index)
+{
+  TopicIndex index;
+  MessagePortIdList ids;
+
+  BOOST_CHECK(index.Subscribe(1, "a"));
+  BOOST_CHECK(!index.Subscribe(1, "a"));
+  BOOST_CHECK(index.Subscribe(2, "a"));
+  BOOST_CHECK(index.Subscribe(1, "b"));
+  BOOST_CHECK_EQUAL(index.GetTopicCount(), 2u);
+
+  index.GetSubscribers("a", ids);
+  BOOST_CHECK_EQUAL(ids.size(), 2u);
+  ids.clear();
+  index.GetSubscribers("c", ids);
+  BOOST_CHECK(ids.empty());
+
+  BOOST_CHECK(index.Unsubscribe(2, "a"));
+  BOOST_CHECK(!index.Unsubscribe(2, "a"));
+  index.GetSubscribers("a", ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 1u);
+  BOOST_CHECK_EQUAL(ids[0], 1u);
+
+  // A disconnected port loses its subscriptions and empty topics go.
+  index.Disconnected(1);
+  BOOST_CHECK_EQUAL(index.GetTopicCount(), 0u);
+  BOOST_CHECK(!index.Unsubscribe(1, "b"));
+}
+
+BOOST_AUTO_TEST_CASE(Test_Tcp_Publish)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  CountingServerHandler * serverHandler = new CountingServerHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.EnableTopics();
+  server.Start();
+
+  RecordingClientHandler * handler1 = new RecordingClientHandler;
+  RecordingClientHandler * handler2 = new RecordingClientHandler;
+  ClientType client1(ioService, Tcp::EndPoint(TcpAddress, TcpPort), handler1);
+  ClientType client2(ioService, Tcp::EndPoint(TcpAddress, TcpPort), handler2);
+  client1.Connect();
+  client2.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 2)));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(handler2->connects), 1)));
+
+  client1.AsyncSend(TopicControl::MakeSubscribe("a"), NullCompletionHandler);
+  client1.AsyncSend(TopicControl::MakeSubscribe("b"), NullCompletionHandler);
+  client2.AsyncSend(TopicControl::MakeSubscribe("b"), NullCompletionHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasTopics<ServerType>, boost::cref(server), 2u)));
+
+  AsioExpress::Error result(ErrorCode::MessagePortServerBusy);
+  int calls = 0;
+  server.AsyncPublish("a", DataBufferPointer(new DataBuffer(std::string("to a"))),
+    boost::bind(SetError, boost::ref(result), boost::ref(calls), _1));
+  server.AsyncPublish("b", DataBufferPointer(new DataBuffer(std::string("to b"))),
+    NullCompletionHandler);
+  server.AsyncPublish("c", DataBufferPointer(new DataBuffer(std::string("to c"))),
+    NullCompletionHandler);
+
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasReceived, boost::cref(*handler1), 2u)));
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasReceived, boost::cref(*handler2), 1u)));
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_CHECK(!result);
+
+  // Only the subscribers get a topic's messages.
+  BOOST_CHECK_EQUAL(handler1->received.size(), 2u);
+  BOOST_CHECK_EQUAL(handler2->received.size(), 1u);
+  BOOST_CHECK_EQUAL(handler2->received[0], "to b");
+
+  // The control messages never reached the handler.
+  BOOST_CHECK_EQUAL(serverHandler->messages, 0);
+
+  // Closing a connection ends its subscriptions.
+  client1.ShutDown();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(HasTopics<ServerType>, boost::cref(server), 1u)));
+
+  MessagePortIdList ids;
+  server.GetIds(ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 1u);
+  BOOST_CHECK(server.Unsubscribe(ids[0], "b"));
+  BOOST_CHECK_EQUAL(server.GetTopicCount(), 0u);
+  BOOST_CHECK(server.Subscribe(ids[0], "d"));
+  BOOST_CHECK(!server.Subscribe(ids[0] + 1, "d"));
+  BOOST_CHECK_EQUAL(server.GetTopicCount(), 1u);
+
+  client2.ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_CASE(Test_Topic_Control_Needs_Enabling)
+{
+  typedef MessagePortServer<Tcp::BasicMessagePortAcceptor> ServerType;
+  typedef MessagePortClient<Tcp::BasicMessagePort> ClientType;
+
+  boost::asio::io_service ioService;
+  boost::asio::io_service::work work(ioService);
+
+  CountingServerHandler * serverHandler = new CountingServerHandler;
+  ServerType server(ioService, Tcp::EndPoint(TcpAddress, TcpPort), serverHandler);
+  server.Start();
+
+  RecordingClientHandler * handler = new RecordingClientHandler;
+  ClientType client(ioService, Tcp::EndPoint(TcpAddress, TcpPort), handler);
+  client.Connect();
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->connects), 1)));
+
+  // Without topics a message that looks like a control message is the
+  // application's own.
+  client.AsyncSend(TopicControl::MakeSubscribe("a"), NullCompletionHandler);
+  BOOST_REQUIRE(RunUntil(ioService, boost::bind(IsAtLeast, boost::cref(serverHandler->messages), 1)));
+  BOOST_CHECK_EQUAL(server.GetTopicCount(), 0u);
+
+  client.ShutDown();
+  server.Stop();
+  ioService.poll();
+}
+
+BOOST_AUTO_TEST_SUITE_END()